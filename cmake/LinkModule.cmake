@@ -56,6 +56,6 @@ function (pinhao_link_local Target)
     ${ARGN}
     GrammarEvolution
     Formula Features Optimizer
-    GEOSWrapper SProfWrapper PAPIWrapper
+    GEOSWrapper SProfWrapper PAPIWrapper MeasurementDatabase
     Support Initialization)
 endfunction(pinhao_link_local)
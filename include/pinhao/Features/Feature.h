@@ -21,6 +21,9 @@
 
 namespace pinhao {
 
+  class BinaryFeatureWriter;
+  class BinaryFeatureDump;
+
   /// @brief The kind of the feature.
   enum class FeatureKind {
     LinearKind, ///< Can get the value only by the name of the feature.
@@ -107,6 +110,20 @@ namespace pinhao {
        */
       virtual void get(const YAML::Node &Node) = 0;
 
+      /**
+       * @brief Appends this feature data to a binary feature dump.
+       *
+       * @return False if the feature can not be written in binary.
+       */
+      virtual bool write(BinaryFeatureWriter &Writer) const;
+
+      /**
+       * @brief Gets the feature data from a binary feature dump.
+       *
+       * @return False if the dump has no such feature (or it can not be read in binary).
+       */
+      virtual bool read(const BinaryFeatureDump &Dump);
+
       /**
        * @brief Gets the necessary information from a llvm::Module.
        *
@@ -30,7 +30,10 @@ namespace pinhao {
       /// @brief All the enabled features.
       std::map<std::string, std::unique_ptr<Feature>> Features;
 
-      FeatureSet() {}
+      /// @brief Identifies this set in the process, unlike its address, which is reused.
+      uint64_t Id;
+
+      FeatureSet();
 
     public:
       /// @brief Constructs a @a FeatureSet object based on the @a EnableFeature.
@@ -112,6 +115,9 @@ namespace pinhao {
     public:
       ~FeatureSet() {}
 
+      /// @brief Gets the id of this set, which no other set of this process has.
+      uint64_t getId() const;
+
       /// @brief Returns the number of features (and subfeatures).
       uint64_t count();
       /// @brief Returns the number of features with kind @a FKind, and type @a FType.
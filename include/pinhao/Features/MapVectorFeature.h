@@ -9,6 +9,7 @@
 
 #include "pinhao/Features/Features.h"
 #include "pinhao/Support/FeatureYAMLWrapper.h"
+#include "pinhao/Support/FeatureBinaryWrapper.h"
 #include "pinhao/Support/Iterator.h"
 
 using namespace pinhao;
@@ -76,6 +77,8 @@ namespace pinhao {
 
         virtual void append(YAML::Emitter &Emitter) const override;
         virtual void get(const YAML::Node &Node) override;
+        virtual bool write(BinaryFeatureWriter &Writer) const override;
+        virtual bool read(const BinaryFeatureDump &Dump) override;
 
     };
 
@@ -130,4 +133,15 @@ void MapVectorFeature<KeyType, ElemType>::get(const YAML::Node &Node) {
   YAMLWrapper::fill(*this, Node);
 }
 
+template <class KeyType, class ElemType>
+bool MapVectorFeature<KeyType, ElemType>::write(BinaryFeatureWriter &Writer) const {
+  Writer.append(*this);
+  return true;
+}
+
+template <class KeyType, class ElemType>
+bool MapVectorFeature<KeyType, ElemType>::read(const BinaryFeatureDump &Dump) {
+  return Dump.fill(*this);
+}
+
 #endif
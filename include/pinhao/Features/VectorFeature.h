@@ -9,6 +9,7 @@
 
 #include "pinhao/Features/Features.h"
 #include "pinhao/Support/FeatureYAMLWrapper.h"
+#include "pinhao/Support/FeatureBinaryWrapper.h"
 
 using namespace pinhao;
 
@@ -52,6 +53,8 @@ namespace pinhao {
 
         virtual void append(YAML::Emitter &Emitter) const override;
         virtual void get(const YAML::Node &Node) override;
+        virtual bool write(BinaryFeatureWriter &Writer) const override;
+        virtual bool read(const BinaryFeatureDump &Dump) override;
 
     };
 
@@ -91,4 +94,15 @@ void VectorFeature<ElemType>::get(const YAML::Node &Node) {
   YAMLWrapper::fill(*this, Node);
 }
 
+template <class ElemType>
+bool VectorFeature<ElemType>::write(BinaryFeatureWriter &Writer) const {
+  Writer.append(*this);
+  return true;
+}
+
+template <class ElemType>
+bool VectorFeature<ElemType>::read(const BinaryFeatureDump &Dump) {
+  return Dump.fill(*this);
+}
+
 #endif
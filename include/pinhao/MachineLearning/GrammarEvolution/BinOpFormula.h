@@ -35,10 +35,10 @@ namespace pinhao {
         virtual BinOpFormulaBase<T, OpT> *getChildConstructor() = 0;
 
       public:
-        virtual ~BinOpFormulaBase() {}
+        virtual ~BinOpFormulaBase() { this->unlinkOperands(); }
 
-        std::unique_ptr<FormulaBase> Lhs;
-        std::unique_ptr<FormulaBase> Rhs;
+        FormulaRef Lhs;
+        FormulaRef Rhs;
         OperatorKind Operator;
 
         /// @brief Returns the operator with its offset.
@@ -57,8 +57,11 @@ namespace pinhao {
 
         ValueType getOperandsType() const override; 
 
+        std::vector<FormulaRef*> getOperands() override;
+        uint64_t getLocalHash() const override;
+
         void evolve(Evolution*) override; 
-        FormulaBase *simplify() override; 
+        FormulaRef simplify() override; 
         void generate(FeatureSet *Set) override; 
         void solveFor(FeatureSet *Set) override;
 
@@ -66,6 +69,7 @@ namespace pinhao {
         bool operator<(const FormulaBase &Rhs) const override;
 
         std::unique_ptr<FormulaBase> clone() override;
+        FormulaRef copy() override;
 
     };
 }
@@ -78,6 +82,7 @@ pinhao::OperatorKind pinhao::BinOpFormulaBase<T, OpT>::getOperator() const {
 
 template <class T, class OpT>
 void pinhao::BinOpFormulaBase<T, OpT>::setOperator(OperatorKind K) {
+  FormulaBase::changed();
   Operator = static_cast<OperatorKind>(
       static_cast<int>(K) - static_cast<int>(getMinOperator()));
 }
@@ -94,6 +99,7 @@ bool pinhao::BinOpFormulaBase<T, OpT>::isBooleanBinOp() const {
 
 template <class T, class OpT>
 void pinhao::BinOpFormulaBase<T, OpT>::setOperatorId(int NewId) {
+  FormulaBase::changed();
   Operator = static_cast<OperatorKind>(NewId);
 }
 
@@ -107,13 +113,24 @@ pinhao::ValueType pinhao::BinOpFormulaBase<T, OpT>::getOperandsType() const {
   return getValueTypeFor<OpT>();
 }
 
+template <class T, class OpT>
+std::vector<pinhao::FormulaRef*> pinhao::BinOpFormulaBase<T, OpT>::getOperands() {
+  return { &Lhs, &Rhs };
+}
+
+template <class T, class OpT>
+uint64_t pinhao::BinOpFormulaBase<T, OpT>::getLocalHash() const {
+  return static_cast<uint64_t>(Operator);
+}
+
 template <class T, class OpT>
 void pinhao::BinOpFormulaBase<T, OpT>::evolve(Evolution *Ev) {
+  FormulaBase::changed();
   Ev->evolve({&Lhs, &Rhs});
 }
 
 template <class T, class OpT>
-pinhao::FormulaBase *pinhao::BinOpFormulaBase<T, OpT>::simplify() {
+pinhao::FormulaRef pinhao::BinOpFormulaBase<T, OpT>::simplify() {
   simplifyFormula(Lhs);
   simplifyFormula(Rhs);
   checkZeroDivision();
@@ -121,13 +138,14 @@ pinhao::FormulaBase *pinhao::BinOpFormulaBase<T, OpT>::simplify() {
     LitFormula<T> *Simplified = new LitFormula<T>();
     T Value = doOperation(getFormulaValue<OpT>(Lhs.get()), getFormulaValue<OpT>(Rhs.get()));
     Simplified->setValue(Value);
-    return Simplified;
+    return FormulaRef(Simplified);
   }
   return nullptr;
 }
 
 template <class T, class OpT>
 void pinhao::BinOpFormulaBase<T, OpT>::generate(FeatureSet *Set) {
+  FormulaBase::changed();
   int RandomOperator = UniformRandom::getRandomInt(0, getNumberOfOperators()-1);
   Operator = static_cast<OperatorKind>(RandomOperator);
   Lhs = generateFormula(Set, getValueTypeFor<OpT>());
@@ -144,12 +162,14 @@ void pinhao::BinOpFormulaBase<T, OpT>::solveFor(FeatureSet *Set) {
 
 template <class T, class OpT>
 bool pinhao::BinOpFormulaBase<T, OpT>::operator==(const FormulaBase &Rhs) const {
+  if (this == &Rhs) return true;
   auto &RhsCast = static_cast<const Formula<T>&>(Rhs);
   if (this->getKind() != RhsCast.getKind() || this->getType() != RhsCast.getType() || 
       this->getOperandsType() != RhsCast.getOperandsType())
     return false;
   auto &RhsBOCast = static_cast<const BinOpFormulaBase<T, OpT>&>(Rhs);
-  return *this->Lhs == *RhsBOCast.Lhs && *this->Rhs == *RhsBOCast.Rhs;
+  return this->Operator == RhsBOCast.Operator &&
+    *this->Lhs == *RhsBOCast.Lhs && *this->Rhs == *RhsBOCast.Rhs;
 }
 
 template <class T, class OpT>
@@ -163,6 +183,8 @@ bool pinhao::BinOpFormulaBase<T, OpT>::operator<(const FormulaBase &Rhs) const {
     return static_cast<int>(this->getOperandsType()) < static_cast<int>(RhsCast.getOperandsType());
 
   auto &RhsBOCast = static_cast<const BinOpFormulaBase<T, OpT>&>(Rhs);
+  if (this->Operator != RhsBOCast.Operator)
+    return static_cast<int>(this->Operator) < static_cast<int>(RhsBOCast.Operator);
   if (*this->Lhs != *RhsBOCast.Lhs)
     return *this->Lhs < *RhsBOCast.Lhs;
   if (*this->Rhs != *RhsBOCast.Rhs)
@@ -179,6 +201,15 @@ std::unique_ptr<pinhao::FormulaBase> pinhao::BinOpFormulaBase<T, OpT>::clone() {
   return std::unique_ptr<FormulaBase>(Clone);
 }
 
+template <class T, class OpT>
+pinhao::FormulaRef pinhao::BinOpFormulaBase<T, OpT>::copy() {
+  auto Copy = getChildConstructor();
+  Copy->Lhs = Lhs;
+  Copy->Rhs = Rhs;
+  Copy->Operator = Operator;
+  return FormulaRef(Copy);
+}
+
 namespace pinhao {
 
   /**
@@ -211,8 +242,11 @@ namespace pinhao {
 
         void checkZeroDivision() override {
           if (this->getOperator() == OperatorKind::DIV) {
-            while (this->Rhs->isLiteral() && getFormulaValue<T>(this->Rhs.get()) == 0)
+            while (this->Rhs->isLiteral() && getFormulaValue<T>(this->Rhs.get()) == 0) {
+              this->changed();
+              makeFormulaUnique(this->Rhs);
               this->Rhs->generate(nullptr);
+            }
           }
         }
 
@@ -0,0 +1,153 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file BinaryKnowledgeBase.h
+ */
+
+#ifndef PINHAO_BINARY_KNOWLEDGE_BASE_H
+#define PINHAO_BINARY_KNOWLEDGE_BASE_H
+
+#include "pinhao/MachineLearning/GrammarEvolution/Candidate.h"
+#include "pinhao/MachineLearning/GrammarEvolution/KnowledgeBaseJournal.h"
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+namespace pinhao {
+
+  /**
+   * @brief A knowledge base in a compact binary file, which is mapped in memory so that
+   * its candidates are decoded only when they are needed.
+   *
+   * @details
+   * The file starts with a header and an index of entries sorted by decreasing score
+   * (the order of @a CompareByScore), and then the marks of the journals merged into it
+   * (see @a mergeKnowledgeBase). They are followed by the payload of each entry: its
+   * objectives, and then its formulas encoded in pre-order (see @a encode). Reading the
+   * N best candidates touches only the index and their payloads. Two candidates are the
+   * same if their formulas have the same encoding, so the entries can be compared and
+   * merged without decoding them. Everything is in the byte order of the host.
+   *
+   * The binary knowledge bases are the files ending with ".kb"; the others are in YAML.
+   */
+  class BinaryKnowledgeBase {
+    public:
+      struct Entry {
+        double Score;
+        uint64_t Count;
+        /// @brief Where the payload starts, from the beginning of the file.
+        uint64_t Offset;
+        /// @brief The size of the formulas, which follow the objectives.
+        uint32_t Size;
+        uint32_t Objectives;
+      };
+
+    private:
+      int Fd;
+      const char *Data;
+      uint64_t Length;
+      const Entry *Index;
+      uint64_t Entries;
+      /// @brief The entries by the hash of their formulas, built on the first @a find.
+      mutable std::unordered_multimap<uint64_t, uint64_t> ByFormulas;
+      JournalMarks Journals;
+
+    public:
+      BinaryKnowledgeBase();
+      ~BinaryKnowledgeBase();
+
+      BinaryKnowledgeBase(const BinaryKnowledgeBase&) = delete;
+      BinaryKnowledgeBase &operator=(const BinaryKnowledgeBase&) = delete;
+
+      /// @brief Maps @a Filename in memory, closing the file mapped before.
+      /// @return False if it could not be mapped, or it is not a valid knowledge base.
+      bool open(std::string Filename);
+      /// @brief Unmaps the file, if there is one.
+      void close();
+      bool isOpen() const;
+
+      /// @brief Gets the number of candidates in the file.
+      uint64_t size() const;
+      /// @brief Gets the @a Nth entry of the index (the @a Nth best score).
+      const Entry &getEntry(uint64_t N) const;
+      /// @brief Gets the objectives of the @a Nth entry.
+      std::vector<double> getObjectives(uint64_t N) const;
+      /// @brief Gets the encoded formulas of the @a Nth entry.
+      std::string getFormulas(uint64_t N) const;
+      /// @brief Gets the last record of each journal merged into the file.
+      const JournalMarks &getJournalMarks() const;
+
+      /// @brief Gets the entry whose formulas are encoded as @a Formulas.
+      /// @return Its position in the index, or @a size if there is none. The first call
+      /// reads the formulas of all entries, without decoding them.
+      uint64_t find(const std::string &Formulas) const;
+
+      /// @brief Decodes the @a Nth candidate. Its formulas are simplified and interned.
+      /// @return False if its payload is malformed.
+      bool get(uint64_t N, Candidate &C) const;
+
+      /// @brief Encodes the formulas of @a C, with the names and types of their decision
+      /// points.
+      static std::string encode(const Candidate &C);
+      /// @brief Decodes formulas encoded by @a encode into @a C.
+      /// @return False if they are malformed.
+      static bool decode(const std::string &Formulas, Candidate &C);
+
+      /**
+       * @brief Writes @a KnowledgeBase in a binary file.
+       *
+       * @details
+       * If @a Stored is given, its entries that are not marked in @a Loaded (the ones that
+       * were not loaded) are also written, without being decoded. When one of them is also in
+       * @a KnowledgeBase, both scores (and objectives) are averaged by their counts.
+       * The file is written beside @a Filename and then renamed, so @a Stored may be
+       * mapped from the very same file. It stores @a Journals as the journals merged.
+       *
+       * @return False if the file could not be written.
+       */
+      static bool write(std::string Filename, const std::set<Candidate> &KnowledgeBase,
+          const BinaryKnowledgeBase *Stored = nullptr, const std::vector<bool> *Loaded = nullptr,
+          const JournalMarks &Journals = JournalMarks());
+
+      /// @brief Returns true if @a Filename names a binary knowledge base.
+      static bool isBinary(std::string Filename);
+  };
+
+  /// @brief Converts the knowledge base in @a From into @a To, between YAML and binary,
+  /// as told by their names.
+  /// @return The number of candidates converted.
+  uint64_t convertKnowledgeBase(std::string From, std::string To);
+
+  /**
+   * @brief Merges the evaluations of a run into the knowledge base in @a Filename (YAML or
+   * binary), so that the runs sharing it do not overwrite each other.
+   *
+   * @details
+   * The file is read again under its lock (@a Filename + ".lock"), which is held until it
+   * is replaced. Each of the @a Evaluations (the score and count of the evaluations since
+   * the last merge) is averaged by count with the candidate in the file. The candidates of
+   * @a KnowledgeBase that are not in the file are added as they are; the others are taken
+   * from the file, which has the evaluations of every run.
+   *
+   * The file also keeps the last record of each journal merged into it, updated with
+   * @a MergedJournals (the marks of the journal records in @a Evaluations) in the same rename. The
+   * replays of those journals skip what is already merged (see @a readJournalMarks), so a
+   * crash before they are removed does not merge their records twice. The marks of the
+   * journals that no longer exist are dropped.
+   *
+   * @return False if the file could not be read or written, in which case it is untouched.
+   */
+  bool mergeKnowledgeBase(std::string Filename, const std::set<Candidate> &KnowledgeBase,
+      const std::set<Candidate> &Evaluations, const JournalMarks &MergedJournals = JournalMarks());
+
+  /// @brief Gets the last record of each journal merged into the knowledge base in
+  /// @a Filename (YAML or binary). It is empty if there is no such file.
+  /// @return False if the file could not be read.
+  bool readJournalMarks(std::string Filename, JournalMarks &Marks);
+
+}
+
+#endif
@@ -9,7 +9,9 @@
 
 #include "pinhao/Support/YAMLWrapper.h"
 
+#include <functional>
 #include <map>
+#include <memory>
 #include <vector>
 
 namespace pinhao {
@@ -21,10 +23,17 @@ namespace pinhao {
   /**
    * @brief Simple implementation of a @a Candidate class to be used within the
    * @a GrammarEvolution algorithm.
+   *
+   * @details
+   * The formulas are interned in the @a FormulaPool, so they are shared with the other
+   * candidates, and copying a candidate only copies the references.
    */
-  struct Candidate : public std::map<DecisionPoint, FormulaBase*> {
+  struct Candidate : public std::map<DecisionPoint, std::shared_ptr<FormulaBase>> {
     double Score;
     uint64_t Count;
+    /// @brief The (minimized) objectives of the multi-objective mode, averaged over the
+    /// @a Count evaluations. Empty otherwise.
+    std::vector<double> Objectives;
 
     virtual ~Candidate();
     /// @brief Evolves the current candidate.
@@ -32,10 +41,18 @@ namespace pinhao {
     /// @brief Generate the decision point heuristics that are missing in this candidate.
     virtual void generateMissing(std::vector<DecisionPoint>, FeatureSet*);
 
-    /// @brief Deep copy of this candidate.
+    /// @brief Copy of this candidate. Its formulas are shared until they evolve.
     Candidate *clone() const;
     /// @brief Gets the Nth @a FormulaBase.
-    FormulaBase* &get(uint64_t N);
+    std::shared_ptr<FormulaBase> &get(uint64_t N);
+    /// @brief Adds the evaluations of @a Other, an equal candidate, to this one: the scores
+    /// (and objectives) are averaged by their counts.
+    void merge(const Candidate &Other);
+    /// @brief Gets the hash of the names of the decision points and of the hashes of their
+    /// formulas (see @a FormulaBase::getHash). Equal candidates have equal hashes.
+    uint64_t getHash() const;
+    /// @brief Orders the candidates by the hashes of their formulas, in the order of the
+    /// decision points. The formulas are compared whole only if their hashes collide.
     bool operator<(const Candidate &Rhs) const; 
   };
 
@@ -51,4 +68,12 @@ namespace pinhao {
 
 }
 
+namespace std {
+  /// @brief Hashes the candidates by @a Candidate::getHash, e.g. for the lookups in a
+  /// @a SerialSet.
+  template<> struct hash<pinhao::Candidate> {
+    size_t operator()(const pinhao::Candidate &C) const { return C.getHash(); }
+  };
+}
+
 #endif
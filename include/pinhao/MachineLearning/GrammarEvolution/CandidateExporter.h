@@ -0,0 +1,66 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file CandidateExporter.h
+ */
+
+#ifndef PINHAO_CANDIDATE_EXPORTER_H
+#define PINHAO_CANDIDATE_EXPORTER_H
+
+#include "pinhao/MachineLearning/GrammarEvolution/Candidate.h"
+#include "pinhao/Optimizer/OptimizationSequence.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace pinhao {
+
+  class FeatureLayout;
+  class FormulaProgram;
+
+  /**
+   * @brief Writes the source of a standalone LLVM pass plugin (for `opt -load`) that
+   * compiles a module the way a @a Candidate does, without any of pinhao.
+   *
+   * @details
+   * The pass counts only the sub-features of cfg_md_static that the formulas reference,
+   * straight from the module, evaluates the formulas as native code, and runs the
+   * optimizations they enable, in the order of the sequence. The formulas are translated
+   * from their @a FormulaProgram, so they behave exactly as when they were evolved. The
+   * passes run as in @a runOptimizations: with the target analyses of the module's
+   * triple, after the passes of the OLevel. The pass option -<arg>-print-decisions
+   * prints whether each optimization is enabled.
+   *
+   * Only the candidates whose formulas can be compiled into a @a FormulaProgram, and
+   * depend only on cfg_md_static, can be exported.
+   */
+  class CandidateExporter {
+    private:
+      std::string PassArg;
+      std::string Description;
+
+      /// @brief Writes the function that counts the features of the @a Layout.
+      bool writeFeatures(const FeatureLayout &Layout, std::ostream &Out);
+      /// @brief Writes the function that evaluates the formulas of @a Program.
+      void writeFormulas(const FormulaProgram &Program, std::ostream &Out);
+      /// @brief Writes the function that runs the optimizations of @a Sequence enabled,
+      /// where @a Decisions is the formula of each optimization (or -1), after the ones
+      /// of @a OLevel.
+      void writeOptimizations(const std::vector<int> &Sequence, const std::vector<int> &Decisions,
+          OptLevel OLevel, std::ostream &Out);
+
+    public:
+      CandidateExporter(std::string PassArg = "pinhao-candidate",
+          std::string Description = "Applies the optimizations chosen by a pinhao candidate.");
+
+      /// @brief Writes to @a Out the plugin that applies the optimizations of @a Sequence
+      /// enabled by @a C, compiled for @a OLevel as the evolution did.
+      /// @return False if @a C can not be exported, in which case nothing is written.
+      bool exportPass(const Candidate &C, const std::vector<int> &Sequence, std::ostream &Out,
+          OptLevel OLevel = OptLevel::None);
+  };
+
+}
+
+#endif
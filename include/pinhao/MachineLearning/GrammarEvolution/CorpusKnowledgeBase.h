@@ -0,0 +1,100 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file CorpusKnowledgeBase.h
+ */
+
+#ifndef PINHAO_CORPUS_KNOWLEDGE_BASE_H
+#define PINHAO_CORPUS_KNOWLEDGE_BASE_H
+
+#include "pinhao/MachineLearning/GrammarEvolution/Candidate.h"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace pinhao {
+
+  class FeatureSet;
+  class FeatureLayout;
+  union BytecodeValue;
+
+  /**
+   * @brief A knowledge base shared by the runs of many modules: the static features
+   * (cfg_md_static) of each module, next to its best candidates.
+   *
+   * @details
+   * The modules are indexed by their feature vectors, normalized so that no feature
+   * dominates the distances: each count is log-scaled, and then standardized by the mean
+   * and the deviation of the corpus. A new module then starts its evolution from the
+   * candidates of its nearest modules, instead of random ones.
+   *
+   * The file is YAML: a sequence of modules, each with its name, its features and
+   * its candidates (as in a knowledge base).
+   */
+  class CorpusKnowledgeBase {
+    public:
+      typedef std::map<std::string, double> FeatureVector;
+
+      struct Module {
+        std::string Name;
+        FeatureVector Features;
+        /// @brief The best candidates, in decreasing order of score.
+        std::vector<Candidate> Candidates;
+      };
+
+    private:
+      std::vector<Module> Modules;
+
+      /// @brief The features of the index (all the features of the modules), and the
+      /// mean and deviation of each one, once log-scaled.
+      std::vector<std::string> Dimensions;
+      std::vector<double> Mean;
+      std::vector<double> Deviation;
+      /// @brief The normalized vectors of the modules, one row per module.
+      std::vector<double> Index;
+
+      /// @brief Builds the index of the modules.
+      void reindex();
+      /// @brief Appends the normalized @a Features to @a Row.
+      void normalize(const FeatureVector &Features, std::vector<double> &Row) const;
+
+    public:
+      /// @brief Gets the static features of the module of @a Set, if they are enabled.
+      static FeatureVector getFeatures(FeatureSet *Set);
+
+      /// @brief Loads the corpus in @a Filename. A missing file is an empty corpus.
+      /// @return False if it could not be parsed.
+      bool load(std::string Filename);
+      /// @brief Writes the corpus to @a Filename, replacing it only once it is complete.
+      bool save(std::string Filename) const;
+
+      /// @brief Gets the number of modules.
+      uint64_t size() const;
+      const Module &getModule(uint64_t N) const;
+      /// @brief Gets the features of the @a Nth module in the slots of @a Layout, as a row
+      /// of a @a FeatureMatrix. False if the layout has features not in the corpus.
+      bool getFeatureRow(uint64_t N, const FeatureLayout &Layout, std::vector<BytecodeValue> &Row) const;
+
+      /// @brief Adds the module @a Name, or replaces it if it is there already.
+      void addModule(std::string Name, const FeatureVector &Features,
+          const std::vector<Candidate> &Candidates);
+
+      /// @brief Gets the (up to) @a K modules nearest to @a Features, nearest first, except
+      /// the one called @a Except.
+      std::vector<uint64_t> findNearest(const FeatureVector &Features, uint64_t K,
+          std::string Except = "") const;
+
+      /**
+       * @brief Gets (up to) @a N distinct candidates to start the evolution of a module
+       * with @a Features: the best of each of its @a K nearest modules, then the second
+       * best of each, and so on.
+       */
+      std::vector<Candidate> getSeeds(const FeatureVector &Features, uint64_t K, uint64_t N,
+          std::string Except = "") const;
+  };
+
+}
+
+#endif
@@ -27,7 +27,7 @@ namespace pinhao {
       virtual ~Evolution() {}
 
       /// @brief Evolves a set of @a Formula's, namely the @a BinOpFormula and the @a IfFormula.
-      virtual void evolve(std::vector<std::unique_ptr<FormulaBase>*>) = 0;
+      virtual void evolve(std::vector<std::shared_ptr<FormulaBase>*>) = 0;
 
       /// @brief Evolves an @a int value of a @a LitFormula<int>.
       virtual void evolve(int &Value) {} 
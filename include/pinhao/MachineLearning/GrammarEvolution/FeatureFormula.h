@@ -23,8 +23,10 @@ namespace pinhao {
         ValueType getType() const override;
         FormulaKind getKind() const override;
 
+        uint64_t getLocalHash() const override;
+
         void evolve(Evolution*) override;
-        FormulaBase *simplify() override;
+        FormulaRef simplify() override;
         void generate(FeatureSet *Set) override;
         void solveFor(FeatureSet *Set) override; 
 
@@ -32,18 +34,26 @@ namespace pinhao {
         bool operator<(const FormulaBase &Rhs) const override;
 
         std::unique_ptr<FormulaBase> clone() override;
+        FormulaRef copy() override;
 
     };
 
 }
 
+template <class T>
+uint64_t pinhao::FeatureFormula<T>::getLocalHash() const {
+  std::hash<std::string> Hash;
+  return Hash(FeaturePair.first) * 31 + Hash(FeaturePair.second);
+}
+
 template <class T>
 void pinhao::FeatureFormula<T>::evolve(Evolution *Ev) {
+  FormulaBase::changed();
   Ev->evolve(FeaturePair);
 }
 
 template <class T>
-pinhao::FormulaBase *pinhao::FeatureFormula<T>::simplify() {
+pinhao::FormulaRef pinhao::FeatureFormula<T>::simplify() {
   return nullptr;
 }
 
@@ -59,6 +69,7 @@ pinhao::FormulaKind pinhao::FeatureFormula<T>::getKind() const {
 
 template <class T>
 void pinhao::FeatureFormula<T>::generate(FeatureSet *Set) {
+  FormulaBase::changed();
   auto Total = Set->count(getValueTypeFor<T>());
   auto Index = UniformRandom::getRandomInt(0, Total-1);
   FeaturePair = *Set->get(Index, getValueTypeFor<T>());
@@ -71,6 +82,7 @@ void pinhao::FeatureFormula<T>::solveFor(FeatureSet *Set) {
 
 template <class T>
 bool pinhao::FeatureFormula<T>::operator==(const FormulaBase &Rhs) const {
+  if (this == &Rhs) return true;
   if (this->getKind() != Rhs.getKind() && this->getType() != Rhs.getType())
     return false;
   auto &RhsCast = static_cast<const FeatureFormula<T>&>(Rhs);
@@ -94,4 +106,9 @@ std::unique_ptr<pinhao::FormulaBase> pinhao::FeatureFormula<T>::clone() {
   return std::unique_ptr<FormulaBase>(Clone);
 }
 
+template <class T>
+pinhao::FormulaRef pinhao::FeatureFormula<T>::copy() {
+  return FormulaRef(clone().release());
+}
+
 #endif
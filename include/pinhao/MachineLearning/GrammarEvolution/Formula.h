@@ -12,6 +12,8 @@
 #include "pinhao/Support/Types.h"
 #include "pinhao/MachineLearning/GrammarEvolution/Evolution.h"
 
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -42,6 +44,7 @@ namespace pinhao {
   /// @brief Gets the corresponding weight for the @a FormulaKind.
   uint64_t getFormulaKindWeight(FormulaKind); 
   /// @brief Gets the corresponding @a FormulaKind for the @a std::string.
+  /// @throw std::invalid_argument if there is none.
   FormulaKind getFormulaKind(std::string); 
   /// @brief Gets the corresponding @a std::string for the @a FormulaKind.
   std::string getFormulaKindString(FormulaKind);
@@ -84,17 +87,59 @@ namespace pinhao {
   }; 
 
   /// @brief Gets the corresponding @a OperatorKind for the @a std::string.
+  /// @throw std::invalid_argument if there is none.
   OperatorKind getOperatorKind(std::string); 
   /// @brief Gets the corresponding @a std::string for the @a OperatorKind.
   std::string getOperatorKindString(OperatorKind);
 
+  class FormulaBase;
+
+  /// @brief A reference to a formula, which may be shared by several candidates.
+  typedef std::shared_ptr<FormulaBase> FormulaRef;
+
   /**
    * @brief The base class for all @a Formula types. A @a Formula is a
    * statement which when evaluated for a @a FeatureSet, it yields a value.
+   *
+   * @details
+   * The operands of a formula are references, so that subtrees can be shared. A formula
+   * interned in the @a FormulaPool must not be modified anymore: it is copied first
+   * (see @a makeFormulaUnique).
    */
   class FormulaBase {
+    private:
+      bool Interned;
+      /// @brief Whether the formula, or one of its operands, changed since @a Hash was
+      /// computed.
+      bool Dirty;
+      /// @brief The hash of the structure, cached when the formula is interned or hashed.
+      uint64_t Hash;
+      /// @brief The formula that hashed this one last as one of its operands, if this one
+      /// is not interned. It is marked dirty with this one (see @a changed).
+      FormulaBase *Parent;
+
+      friend class FormulaPool;
+
+    protected:
+      /// @brief Unlinks the operands whose @a Parent is this formula. Called by the
+      /// destructors of the formulas with operands.
+      void unlinkOperands();
+
     public:
-      virtual ~FormulaBase() {}
+      FormulaBase();
+      virtual ~FormulaBase();
+
+      /// @brief Gets the number of formulas allocated since the start.
+      static uint64_t getNumberOfAllocated();
+      /// @brief Gets the number of formulas that were not freed.
+      static uint64_t getNumberOfLive();
+
+      /// @brief Returns true if it is in the @a FormulaPool, and thus immutable.
+      bool isInterned() const;
+      /// @brief Marks this formula as changed, and so the formulas above it, up to the
+      /// first one that is marked already, so that their hashes are computed again.
+      /// A formula that replaces one of its operands marks itself.
+      void changed();
 
       /// @brief Gets the type of the @a Formula (what is the returning type).
       virtual ValueType getType() const = 0;
@@ -112,10 +157,28 @@ namespace pinhao {
       /// @brief Returns true if it is a If formula.
       virtual bool isIf() const;
 
+      /// @brief Gets the references to the operands of this formula, if any.
+      virtual std::vector<FormulaRef*> getOperands();
+      /// @brief Gets a hash of what distinguishes this formula from the others of its
+      /// kind and type, except its operands.
+      virtual uint64_t getLocalHash() const = 0;
+      /**
+       * @brief Gets the hash of the structure of this formula: its kind, type, local
+       * fields (see @a getLocalHash) and the hashes of its operands.
+       *
+       * @details
+       * It is cached once the formula is interned. The formulas that are not interned yet
+       * cache it until they, or one of their operands, change (see @a changed). A formula
+       * shared by more than one parent must be copied before it changes (see
+       * @a makeFormulaUnique), as the evolution does, since only its last parent is marked.
+       */
+      uint64_t getHash();
+
       /// @brief Evolves this formula, based on the @a Evolution algorithm.
       virtual void evolve(Evolution*) = 0;
       /// @brief Simplifies the current formula.
-      virtual FormulaBase *simplify() = 0;
+      /// @return The formula that replaces this one, or nullptr if it stays.
+      virtual FormulaRef simplify() = 0;
       /// @brief Randomizes the generations of a @a Formula.
       virtual void generate(FeatureSet *Set) = 0;
       /// @brief Evaluates the @a Formula for the @a Set.
@@ -134,6 +197,8 @@ namespace pinhao {
 
       /// @brief Clones (deep copy) the formula.
       virtual std::unique_ptr<FormulaBase> clone() = 0; 
+      /// @brief Copies only this formula, sharing its operands.
+      virtual FormulaRef copy() = 0;
 
   };
 
@@ -191,9 +256,13 @@ namespace pinhao {
   template <class T> 
     T getFormulaValue(const FormulaBase*); 
 
-  void simplifyFormula(FormulaBase*&);
+  void simplifyFormula(FormulaRef&);
   void simplifyFormula(std::unique_ptr<FormulaBase>&);
 
+  /// @brief Replaces @a Form by a copy of it, if it is shared or interned, so that it can
+  /// be modified. Its operands stay shared.
+  void makeFormulaUnique(FormulaRef &Form);
+
 }
 
 template <class T>
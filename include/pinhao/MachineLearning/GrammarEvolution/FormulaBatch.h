@@ -0,0 +1,129 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file FormulaBatch.h
+ */
+
+#ifndef PINHAO_FORMULA_BATCH_H
+#define PINHAO_FORMULA_BATCH_H
+
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaBytecode.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace pinhao {
+
+  /**
+   * @brief A column of values of a single type. Only the vector of its type is used.
+   */
+  struct BatchColumn {
+    ValueType Type;
+    std::vector<int> Int;
+    std::vector<double> Float;
+    std::vector<uint8_t> Bool;
+
+    BatchColumn(ValueType Type = ValueType::Bool, uint64_t Size = 0);
+
+    /// @brief Gets the number of values.
+    uint64_t size() const;
+    /// @brief Appends @a Value, of the type of the column.
+    void push_back(BytecodeValue Value);
+    /// @brief Gets the address of the @a Nth value.
+    const void *getData(uint64_t N = 0) const;
+    void *getData(uint64_t N = 0);
+  };
+
+  /**
+   * @brief The features of many modules, one per row, in a structure of arrays: the
+   * values of each slot of a @a FeatureLayout are in a column.
+   *
+   * @details
+   * The columns are those of the layout when the matrix is created, so the programs
+   * evaluated over it must be compiled before.
+   */
+  class FeatureMatrix {
+    private:
+      std::vector<BatchColumn> Columns;
+      uint64_t Rows;
+
+    public:
+      FeatureMatrix(const FeatureLayout &Layout);
+
+      /// @brief Appends the row of the features @a Values, in the order of the slots.
+      void addRow(const std::vector<BytecodeValue> &Values);
+      /// @brief Appends the row of the features of @a Set.
+      void addRow(const FeatureLayout &Layout, FeatureSet *Set);
+
+      uint64_t getNumberOfRows() const;
+      uint64_t getNumberOfColumns() const;
+
+      /// @brief Gets the column of the @a Slot.
+      const BatchColumn &getColumn(uint32_t Slot) const;
+  };
+
+  /**
+   * @brief The results of a @a FormulaProgram for each row of a @a FeatureMatrix: one
+   * column per formula of the program, with its type.
+   */
+  class DecisionMatrix {
+    private:
+      std::vector<BatchColumn> Columns;
+
+      friend class BatchEvaluator;
+
+    public:
+      uint64_t getNumberOfRows() const;
+      uint64_t getNumberOfColumns() const;
+
+      /// @brief Gets the type of the results of the formula @a Col.
+      ValueType getType(uint64_t Col) const;
+
+      /// @brief Gets the result of the formula @a Col, for the module in @a Row. Numerical
+      /// results are converted to @a T.
+      template <class T>
+        T get(uint64_t Row, uint64_t Col) const;
+  };
+
+  template<> int DecisionMatrix::get<int>(uint64_t, uint64_t) const;
+  template<> double DecisionMatrix::get<double>(uint64_t, uint64_t) const;
+  template<> bool DecisionMatrix::get<bool>(uint64_t, uint64_t) const;
+
+  /**
+   * @brief Evaluates @a FormulaPrograms for all the rows of a @a FeatureMatrix at once.
+   *
+   * @details
+   * The rows are evaluated in blocks, and each instruction is a loop over the block,
+   * which the compiler vectorizes: the registers are columns of the block, the features
+   * are read in place from the matrix, and the literals are broadcast once. With a
+   * population, all the programs are evaluated over a block before the next one, so
+   * that the block of the matrix stays in the cache.
+   */
+  class BatchEvaluator {
+    private:
+      uint64_t BlockSize;
+
+      /// @brief The registers of a program, for a block.
+      struct BlockRegisters {
+        std::vector<BatchColumn> Columns;
+        std::vector<const void*> Data;
+      };
+
+      BlockRegisters createRegisters(const FormulaProgram &Program);
+      void runBlock(const FormulaProgram &Program, const FeatureMatrix &Matrix, BlockRegisters &Registers,
+          uint64_t Begin, uint64_t Size, DecisionMatrix &Decisions);
+
+    public:
+      BatchEvaluator(uint64_t BlockSize = 512);
+
+      /// @brief Evaluates the valid @a Program for each row of @a Matrix.
+      DecisionMatrix evaluate(const FormulaProgram &Program, const FeatureMatrix &Matrix);
+      /// @brief Evaluates each program of @a Population (e.g. one per candidate) for each
+      /// row of @a Matrix.
+      std::vector<DecisionMatrix> evaluate(const std::vector<const FormulaProgram*> &Population,
+          const FeatureMatrix &Matrix);
+  };
+
+}
+
+#endif
@@ -0,0 +1,197 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file FormulaBytecode.h
+ */
+
+#ifndef PINHAO_FORMULA_BYTECODE_H
+#define PINHAO_FORMULA_BYTECODE_H
+
+#include "pinhao/Support/Types.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+
+namespace pinhao {
+
+  class FeatureSet;
+  class FormulaBase;
+
+  /// @brief A value of a register, or of a feature, of a @a FormulaProgram.
+  union BytecodeValue {
+    int Int;
+    double Float;
+    bool Bool;
+  };
+
+  /**
+   * @brief The operations of the @a FormulaProgram. The suffix is the type of the operands.
+   */
+  enum class Opcode : uint8_t {
+    Feature = 0,    ///< Dest = Features[One]
+    Select,         ///< Dest = One ? Two : Three
+    AddInt, SubInt, MulInt, DivInt,
+    AddFloat, SubFloat, MulFloat, DivFloat,
+    LtInt, GtInt, LeqInt, GeqInt, EqInt, NeqInt,
+    LtFloat, GtFloat, LeqFloat, GeqFloat, EqFloat, NeqFloat,
+    EqBool, NeqBool, And, Or
+  };
+
+  /// @brief An instruction of the @a FormulaProgram, over its registers.
+  struct Instruction {
+    Opcode Op;
+    uint32_t Dest;
+    uint32_t One;
+    uint32_t Two;
+    uint32_t Three;
+  };
+
+  /**
+   * @brief Assigns a slot of a dense array to each feature (or sub-feature) used
+   * by the formulas, so that they are looked up by name only once.
+   */
+  class FeatureLayout {
+    private:
+      typedef std::pair<std::string, std::string> FeaturePair;
+
+      std::map<FeaturePair, uint32_t> Slots;
+      std::vector<FeaturePair> Pairs;
+      std::vector<ValueType> Types;
+
+      /// @brief The id of the set whose values were fetched (see @a FeatureSet::getId),
+      /// and the values of its first slots.
+      uint64_t Fetched;
+      std::vector<BytecodeValue> Values;
+
+    public:
+      FeatureLayout();
+
+      /// @brief Gets the slot of the feature @a Pair, adding it if it is new.
+      uint32_t getSlot(const FeaturePair &Pair, ValueType Type);
+      /// @brief Gets the number of slots.
+      uint64_t size() const;
+      /// @brief Gets the type of the feature in @a Slot.
+      ValueType getType(uint32_t Slot) const;
+      /// @brief Gets the feature (and sub-feature) in @a Slot.
+      const FeaturePair &getPair(uint32_t Slot) const;
+
+      /// @brief Looks up the values of all the slots for @a Set.
+      std::vector<BytecodeValue> fetchValues(FeatureSet *Set) const;
+
+      /// @brief Gets the values of all the slots for @a Set. Only the slots added since
+      /// the last call are looked up, unless the set is another one.
+      const std::vector<BytecodeValue> &getValues(FeatureSet *Set);
+  };
+
+  /**
+   * @brief A set of formulas (e.g. all the decision points of a candidate) compiled
+   * into a straight-line register bytecode, which is evaluated in a single loop.
+   *
+   * @details
+   * Each distinct formula is compiled once, so that the subtrees shared through the
+   * @a FormulaPool are evaluated only once. Literals are kept in registers that are
+   * never written, and features are read from the dense array of a @a FeatureLayout.
+   * Both bodies of an @a IfFormula are evaluated, since formulas have no side effects.
+   *
+   * Formulas of strings, or whose operands are not of the expected type, are not
+   * supported: if there is any, the program is not valid, and the formulas must be
+   * evaluated with @a FormulaBase::solveFor.
+   */
+  class FormulaProgram {
+    private:
+      FeatureLayout *Layout;
+      bool Valid;
+
+      std::vector<Instruction> Code;
+      std::vector<BytecodeValue> Registers;
+      std::vector<ValueType> Types;
+      std::vector<uint32_t> Results;
+      std::vector<ValueType> ResultTypes;
+
+      /// @brief The register of each formula already compiled.
+      std::unordered_map<const FormulaBase*, uint32_t> Compiled;
+
+      uint32_t addRegister(ValueType Type);
+      uint32_t addConstant(BytecodeValue Value, ValueType Type);
+      uint32_t addInstruction(Opcode Op, ValueType Type, uint32_t One, uint32_t Two = 0, uint32_t Three = 0);
+
+      /// @brief Invalidates the program if @a Register is not of type @a Type.
+      void checkType(uint32_t Register, ValueType Type);
+
+      uint32_t compile(FormulaBase *Form);
+      uint32_t compileBinOp(FormulaBase *Form);
+
+    public:
+      FormulaProgram(FeatureLayout &Layout);
+
+      /// @brief Compiles @a Form, whose result will be the next one.
+      /// @return The index of its result.
+      uint64_t add(FormulaBase *Form);
+
+      /// @brief Returns false if some formula could not be compiled.
+      bool isValid() const;
+      /// @brief Gets the number of instructions.
+      uint64_t size() const;
+
+      /// @brief Evaluates all the formulas for the dense @a Features.
+      void run(const std::vector<BytecodeValue> &Features);
+      /// @brief Evaluates all the formulas for @a Set.
+      void run(FeatureSet *Set);
+
+      /// @brief Gets the result of the @a Nth formula added, after running. Numerical
+      /// results are converted to @a T.
+      template <class T>
+        T getResult(uint64_t N) const;
+
+      friend class BatchEvaluator;
+      friend class CandidateExporter;
+  };
+
+  /**
+   * @brief Keeps the programs of the formulas of the last candidates evaluated, since
+   * the best candidates are evaluated again in each generation.
+   *
+   * @details
+   * The programs are found by the addresses of their formulas, which are kept alive by
+   * the cache. Thus, only formulas that are not modified anymore (i.e. interned in the
+   * @a FormulaPool) are cached, and the others are compiled each time. The cache is
+   * cleared when it is full.
+   */
+  class FormulaProgramCache {
+    private:
+      typedef std::vector<std::shared_ptr<FormulaBase>> FormulaVector;
+
+      struct Entry {
+        FormulaVector Formulas;
+        FormulaProgram Program;
+      };
+
+      FeatureLayout Layout;
+      std::map<std::vector<const FormulaBase*>, Entry> Entries;
+      std::unique_ptr<FormulaProgram> Uncached;
+      uint64_t Capacity;
+      uint64_t Hits, Misses;
+
+    public:
+      FormulaProgramCache(uint64_t Capacity = 4096);
+
+      /// @brief Gets the program that evaluates @a Formulas, in this order. It is valid
+      /// until the next call.
+      FormulaProgram &get(const FormulaVector &Formulas);
+
+      /// @brief Prints the number of hits and misses to @a Out.
+      void printStatistics(std::ostream &Out = std::cerr) const;
+  };
+
+  template<> int FormulaProgram::getResult<int>(uint64_t) const;
+  template<> double FormulaProgram::getResult<double>(uint64_t) const;
+  template<> bool FormulaProgram::getResult<bool>(uint64_t) const;
+
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file FormulaPool.h
+ */
+
+#ifndef PINHAO_FORMULA_POOL_H
+#define PINHAO_FORMULA_POOL_H
+
+#include "pinhao/MachineLearning/GrammarEvolution/Formula.h"
+
+#include <unordered_map>
+
+namespace pinhao {
+
+  /**
+   * @brief Keeps a single copy of each distinct formula (hash-consing), so that equal
+   * subtrees are shared by all candidates of a run.
+   *
+   * @details
+   * The formulas are interned bottom-up, so two formulas are the same if they have the
+   * same kind, type and local fields (see @a FormulaBase::getLocalHash), and the very
+   * same operands. They are found by their structural hash (see @a FormulaBase::getHash),
+   * which is cached in them when they are interned. Once interned, a formula is
+   * immutable: evolving it copies only the path from the root to the formula that
+   * changes (see @a makeFormulaUnique). The pool does not own the formulas, which are
+   * freed when no candidate uses them anymore.
+   */
+  class FormulaPool {
+    private:
+      std::unordered_multimap<uint64_t, std::weak_ptr<FormulaBase>> Formulas;
+      uint64_t Hits;
+      uint64_t Misses;
+      /// @brief The number of entries that triggers the next removal of the dead ones.
+      uint64_t PurgeAt;
+
+      FormulaPool();
+
+      /// @brief Removes the entries of the formulas that were freed.
+      void purge();
+
+    public:
+      /// @brief Gets the pool of this process.
+      static FormulaPool &get();
+
+      /// @brief Interns @a Form and its operands, replacing each one by the formula
+      /// equal to it already in the pool, if there is one.
+      void intern(FormulaRef &Form);
+
+      /// @brief Gets the number of formulas in the pool that are still alive.
+      uint64_t getNumberOfFormulas();
+
+      /// @brief Prints how many formulas were shared, how many are alive, and the peak
+      /// resident set size of the process.
+      void printStatistics();
+
+  };
+
+}
+
+#endif
@@ -16,6 +16,17 @@ namespace pinhao {
    * @brief This is the geos version of the @a SimpleGrammarEvolution.
    */
   class GEOSSimpleGrammarEvolution : public SimpleGrammarEvolution {
+    protected:
+      virtual double measureCost(llvm::Module&) override;
+      virtual std::string getMeasurementBackend() override;
+      /// @brief The static analysis is deterministic, so it is never repeated.
+      virtual RepetitionPolicy getRepetitionPolicy() override;
+      /// @brief Repeats the static analysis itself, instead of running the module.
+      virtual std::vector<double> measureCostRepeatedly(llvm::Module&) override;
+      /// @brief The static analysis needs the compiled module, so they are never fused.
+      virtual std::vector<double> compileAndMeasure(OptimizationSequence&, 
+          std::shared_ptr<llvm::Module>*, uint64_t*) override;
+
     public:
       GEOSSimpleGrammarEvolution(std::shared_ptr<llvm::Module> /* Module */, std::string /* KBFilename */ = "config.yaml",
           double /* EvolveProb */ = 0.2, double /* MaxEvolutionRate */ = 0.3, double /* MutateProb */ = 0.3);
@@ -16,6 +16,10 @@
 
 #include <vector>
 #include <algorithm>
+#include <functional>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
 
 namespace pinhao {
 
@@ -46,9 +50,10 @@ namespace pinhao {
    * @details
    * It contains the basic information and implementations that a @a GrammarEvolution
    * algorithm needs. As default, it starts when the @a run function is executed, and
-   * it ends with the execution of the @a stop function.
+   * it ends with the execution of the @a stop function. The knowledge base is also
+   * indexed in the order of @a RankType (e.g.: the best candidates first).
    */
-  template <class T>
+  template <class T, class RankType = std::less<T>>
     class GrammarEvolution {
       protected:
         std::shared_ptr<llvm::Module> Module;
@@ -59,7 +64,7 @@ namespace pinhao {
 
         std::vector<DecisionPoint> DecisionPoints;
         std::vector<int> Sequence;
-        SerialSet<T> KnowledgeBase;
+        SerialSet<T, std::less<T>, RankType> KnowledgeBase;
 
         std::vector<std::string> Argv;
 
@@ -75,6 +80,10 @@ namespace pinhao {
         virtual void importKnowledgeBase();
         /// @brief Exports the knowledge base to the file @a KnowledgeBaseFile.
         virtual void exportKnowledgeBase();
+        /// @brief Writes the knowledge base to the file @a KnowledgeBaseFile, replacing it
+        /// only once it is complete.
+        /// @return False if it could not be written.
+        virtual bool writeKnowledgeBase();
 
         /// @brief Generates a sequence for the execution.
         virtual void generateSequence();
@@ -82,7 +91,7 @@ namespace pinhao {
         virtual void getSequence(std::string);
 
         /// @brief Depends on the @a DecisionPoint's added. As it changes, the way to compile
-        /// the module also changes.
+        /// the module also changes. The module returned must be deleted with @a deleteModule.
         virtual llvm::Module *compileWithCandidate(llvm::Module*, T&, FeatureSet*) = 0;
 
       public:
@@ -104,40 +113,55 @@ namespace pinhao {
 }
 
 
-template <class T>
-pinhao::GrammarEvolution<T>::~GrammarEvolution() {
+template <class T, class RankType>
+pinhao::GrammarEvolution<T, RankType>::~GrammarEvolution() {
 
 }
 
-template <class T>
-pinhao::GrammarEvolution<T>::GrammarEvolution(std::shared_ptr<llvm::Module> Module, std::string KBFilename,
+template <class T, class RankType>
+pinhao::GrammarEvolution<T, RankType>::GrammarEvolution(std::shared_ptr<llvm::Module> Module, std::string KBFilename,
     double EvolveProb, double MaxEvolutionRate, double MutateProb) : 
   Module(Module), KnowledgeBaseFile(KBFilename), 
   EvolveProbability(EvolveProb), MaxEvolutionRate(MaxEvolutionRate), MutateProbability(MutateProb) {
   }
 
-template <class T>
-void pinhao::GrammarEvolution<T>::addPreDefinedDecisionPoints() {
+template <class T, class RankType>
+void pinhao::GrammarEvolution<T, RankType>::addPreDefinedDecisionPoints() {
   for (auto OptName : Optimizations) {
     DecisionPoint DP(OptName, ValueType::Bool); 
     DecisionPoints.push_back(DP);
   }
 }
 
-template <class T>
-void pinhao::GrammarEvolution<T>::importKnowledgeBase() {
+template <class T, class RankType>
+void pinhao::GrammarEvolution<T, RankType>::importKnowledgeBase() {
   auto Node = YAMLWrapper::loadFile(KnowledgeBaseFile);
   YAMLWrapper::fill(KnowledgeBase, Node);
 }
 
-template <class T>
-void pinhao::GrammarEvolution<T>::exportKnowledgeBase() {
-  std::ofstream Of(KnowledgeBaseFile);
-  YAMLWrapper::print(KnowledgeBase, Of);
+template <class T, class RankType>
+void pinhao::GrammarEvolution<T, RankType>::exportKnowledgeBase() {
+  writeKnowledgeBase();
 }
 
-template <class T>
-void pinhao::GrammarEvolution<T>::generateSequence() {
+template <class T, class RankType>
+bool pinhao::GrammarEvolution<T, RankType>::writeKnowledgeBase() {
+  // Written aside and then renamed, so a crash never leaves a half written file.
+  std::string Temporary = KnowledgeBaseFile + ".tmp";
+  {
+    std::ofstream Of(Temporary);
+    YAMLWrapper::print(KnowledgeBase, Of);
+    Of.flush();
+    if (!Of.good()) {
+      std::cerr << "Could not write the knowledge base " << Temporary << std::endl;
+      return false;
+    }
+  }
+  return !std::rename(Temporary.c_str(), KnowledgeBaseFile.c_str());
+}
+
+template <class T, class RankType>
+void pinhao::GrammarEvolution<T, RankType>::generateSequence() {
   std::vector<std::string> OptimizationsCopy = Optimizations;
   while (!OptimizationsCopy.empty()) {
     int Idx = UniformRandom::getRandomInt(0, OptimizationsCopy.size()-1);
@@ -147,8 +171,8 @@ void pinhao::GrammarEvolution<T>::generateSequence() {
   }
 }
 
-template <class T>
-void pinhao::GrammarEvolution<T>::getSequence(std::string SequenceFile) {
+template <class T, class RankType>
+void pinhao::GrammarEvolution<T, RankType>::getSequence(std::string SequenceFile) {
   if (FILE *f = fopen(SequenceFile.c_str(), "r")) {
     fclose(f); 
     auto Node = YAMLWrapper::loadFile(SequenceFile);
@@ -160,8 +184,8 @@ void pinhao::GrammarEvolution<T>::getSequence(std::string SequenceFile) {
   }
 }
 
-template <class T>
-void pinhao::GrammarEvolution<T>::setModuleArgv(std::vector<std::string> Argv) {
+template <class T, class RankType>
+void pinhao::GrammarEvolution<T, RankType>::setModuleArgv(std::vector<std::string> Argv) {
   this->Argv = Argv;
 }
 
@@ -21,15 +21,20 @@ namespace pinhao {
   template <class T>
     class IfFormula : public Formula<T> {
       public:
-        std::unique_ptr<FormulaBase> Condition;
-        std::unique_ptr<FormulaBase> ThenBody;
-        std::unique_ptr<FormulaBase> ElseBody;
+        FormulaRef Condition;
+        FormulaRef ThenBody;
+        FormulaRef ElseBody;
+
+        ~IfFormula();
 
         ValueType getType() const override;
         FormulaKind getKind() const override; 
 
+        std::vector<FormulaRef*> getOperands() override;
+        uint64_t getLocalHash() const override;
+
         void evolve(Evolution*) override; 
-        FormulaBase *simplify() override; 
+        FormulaRef simplify() override; 
         void generate(FeatureSet *Set) override; 
         void solveFor(FeatureSet *Set) override; 
 
@@ -37,11 +42,17 @@ namespace pinhao {
         bool operator<(const FormulaBase &Rhs) const override;
 
         std::unique_ptr<FormulaBase> clone() override;
+        FormulaRef copy() override;
 
     };
 
 }
 
+template <class T>
+pinhao::IfFormula<T>::~IfFormula() {
+  this->unlinkOperands();
+}
+
 template <class T>
 pinhao::ValueType pinhao::IfFormula<T>::getType() const {
   return getValueTypeFor<T>();
@@ -52,26 +63,38 @@ pinhao::FormulaKind pinhao::IfFormula<T>::getKind() const {
   return FormulaKind::If;
 }
 
+template <class T>
+std::vector<pinhao::FormulaRef*> pinhao::IfFormula<T>::getOperands() {
+  return { &Condition, &ThenBody, &ElseBody };
+}
+
+template <class T>
+uint64_t pinhao::IfFormula<T>::getLocalHash() const {
+  return 0;
+}
+
 template <class T>
 void pinhao::IfFormula<T>::evolve(Evolution *Ev) {
+  FormulaBase::changed();
   Ev->evolve({&Condition, &ThenBody, &ElseBody});
 }
 
 template <class T>
-pinhao::FormulaBase *pinhao::IfFormula<T>::simplify() {
+pinhao::FormulaRef pinhao::IfFormula<T>::simplify() {
   simplifyFormula(Condition);
   simplifyFormula(ThenBody);
   simplifyFormula(ElseBody);
   if (Condition->isLiteral()) {
     if (getFormulaValue<bool>(Condition.get()))
-      return ThenBody.release();
-    return ElseBody.release();
+      return ThenBody;
+    return ElseBody;
   }
   return nullptr;
 }
 
 template <class T>
 void pinhao::IfFormula<T>::generate(FeatureSet *Set) {
+  FormulaBase::changed();
   Condition = generateFormula(Set, ValueType::Bool);
   ThenBody = generateFormula(Set, getValueTypeFor<T>());
   ElseBody = generateFormula(Set, getValueTypeFor<T>());
@@ -91,6 +114,7 @@ void pinhao::IfFormula<T>::solveFor(FeatureSet *Set) {
 
 template <class T>
 bool pinhao::IfFormula<T>::operator==(const FormulaBase &Rhs) const {
+  if (this == &Rhs) return true;
   if (this->getKind() != Rhs.getKind() || this->getType() != Rhs.getType())
     return false;
   auto &RhsCast = static_cast<const IfFormula<T>&>(Rhs);
@@ -125,4 +149,13 @@ std::unique_ptr<pinhao::FormulaBase> pinhao::IfFormula<T>::clone() {
   return std::unique_ptr<FormulaBase>(Clone);
 }
 
+template <class T>
+pinhao::FormulaRef pinhao::IfFormula<T>::copy() {
+  auto Copy = new IfFormula<T>();
+  Copy->Condition = Condition;
+  Copy->ThenBody = ThenBody;
+  Copy->ElseBody = ElseBody;
+  return FormulaRef(Copy);
+}
+
 #endif
@@ -0,0 +1,141 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file KnowledgeBaseJournal.h
+ */
+
+#ifndef PINHAO_KNOWLEDGE_BASE_JOURNAL_H
+#define PINHAO_KNOWLEDGE_BASE_JOURNAL_H
+
+#include "pinhao/MachineLearning/GrammarEvolution/Candidate.h"
+#include "pinhao/Support/FileLock.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <sys/types.h>
+
+namespace pinhao {
+
+  /**
+   * @brief Identifies a record of a journal: the instance of the journal that appended it,
+   * and how many records that instance had appended.
+   */
+  struct JournalMark {
+    uint64_t Instance;
+    uint64_t Sequence;
+
+    JournalMark() : Instance(0), Sequence(0) {}
+    JournalMark(uint64_t Instance, uint64_t Sequence) : Instance(Instance), Sequence(Sequence) {}
+
+    /// @brief Returns true if @a Record was appended by the same instance, at or before this one.
+    bool covers(const JournalMark &Record) const;
+  };
+
+  /// @brief The last record of each journal merged into a knowledge base, by the name of
+  /// the journal (see @a mergeKnowledgeBase).
+  typedef std::map<std::string, JournalMark> JournalMarks;
+
+  /**
+   * @brief A write-ahead journal of the updates of a knowledge base, so that the
+   * candidates measured survive a crash of the run.
+   *
+   * @details
+   * Each record is a candidate (its score, count, objectives and formulas), with its size
+   * and a hash, so that a record torn by a crash is detected and dropped. Each record also
+   * has a @a JournalMark, so that the records already merged into a knowledge base are
+   * skipped when the journal is replayed again, e.g. after a crash that left it behind. What a record
+   * means is up to its owner, who replays it: the evolutions append each evaluation, and
+   * average the records replayed with the knowledge base.
+   *
+   * The records are written as soon as they are appended, so they survive the crash of
+   * the process; they are only synced to the disk every few records, though.
+   *
+   * Compaction folds the journal into a new snapshot: the journal is moved aside (to the
+   * ".old" file), and a child process writes the snapshot and then removes it, while the
+   * run goes on appending to a new journal.
+   *
+   * The journal is locked (its ".lock" file) while it is open, so that each run sharing a knowledge
+   * base has its own, and the journals of the runs that crashed are told apart by their
+   * lock being free.
+   */
+  class KnowledgeBaseJournal {
+    private:
+      std::string Filename;
+      int Fd;
+      std::unique_ptr<FileLock> Lock;
+      /// @brief The number of records appended between two syncs.
+      uint64_t SyncEvery;
+      uint64_t Unsynced;
+      /// @brief The number of records since the last compaction.
+      uint64_t Records;
+      /// @brief The process writing the snapshot, if any.
+      pid_t Compactor;
+      /// @brief The mark of the last record appended (or replayed).
+      JournalMark Last;
+
+      /// @brief Gets the name of the journal being compacted.
+      std::string getOldFilename() const;
+      /// @brief Moves the records of the journal to the ".old" one, which is created if
+      /// there is none, and truncates the journal.
+      bool rotate();
+
+    public:
+      KnowledgeBaseJournal(std::string Filename, uint64_t SyncEvery = 16);
+      ~KnowledgeBaseJournal();
+
+      /**
+       * @brief Replays the records of a compaction that did not finish, and then of the
+       * journal, calling @a Restore for each candidate, in the order they were appended.
+       * The records covered by @a Merged are skipped. The torn records of both are
+       * truncated, and the journal is then opened for appending, after its last record.
+       *
+       * Nothing is replayed if another process holds the journal, and it is not opened.
+       *
+       * @return The number of records replayed.
+       */
+      uint64_t open(std::function<void(const Candidate&)> Restore, JournalMark Merged = JournalMark());
+      bool isOpen() const;
+      std::string getFilename() const;
+
+      /// @brief Replays the records of the compaction that did not finish (the ".old" file),
+      /// if any. Only those that were appended before the last @a compact started, and
+      /// that are not covered by @a Merged.
+      /// @a LastCompacting, if given, is set to the mark of its last record.
+      uint64_t replayCompacting(std::function<void(const Candidate&)> Restore,
+          JournalMark Merged = JournalMark(), JournalMark *LastCompacting = nullptr) const;
+
+      /// @brief Appends the state of @a C.
+      /// @return False if it could not be written.
+      bool append(const Candidate &C);
+      /// @brief Syncs the records appended to the disk.
+      void sync();
+
+      /// @brief Gets the number of records appended (or replayed) since the last compaction.
+      uint64_t size() const;
+      /// @brief Gets the mark of the last record appended (or replayed).
+      JournalMark getLastMark() const;
+
+      /// @brief Starts folding the journal into a snapshot written by @a WriteSnapshot, in
+      /// a child process. It returns false if the previous compaction is still running.
+      bool compact(std::function<bool()> WriteSnapshot);
+      /// @brief Waits for the compaction running, if any.
+      void wait();
+      /// @brief Removes every record, once they are all in a snapshot.
+      void clear();
+      /// @brief Closes the journal and removes its files, except its lock, which another
+      /// process may be waiting for (see @a FileLock).
+      void remove();
+
+      /// @brief Gets the journals whose names start with @a Prefix (e.g.: the ones of the
+      /// runs that share a knowledge base).
+      static std::vector<std::string> list(std::string Prefix);
+  };
+
+}
+
+#endif
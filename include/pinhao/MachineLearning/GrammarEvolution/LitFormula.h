@@ -31,8 +31,10 @@ namespace pinhao {
 
         FormulaKind getKind() const override; 
 
+        uint64_t getLocalHash() const override;
+
         void evolve(Evolution*) override; 
-        FormulaBase *simplify() override; 
+        FormulaRef simplify() override; 
         void generate(FeatureSet *Set) override; 
         void solveFor(FeatureSet *Set) override; 
 
@@ -40,6 +42,7 @@ namespace pinhao {
         bool operator<(const FormulaBase &Rhs) const override;
 
         std::unique_ptr<FormulaBase> clone() override;
+        FormulaRef copy() override;
 
     };
 
@@ -47,16 +50,23 @@ namespace pinhao {
 
 template <class T>
 void pinhao::LitFormula<T>::setValue(T Value) {
+  FormulaBase::changed();
   this->Value = Value;
 }
 
+template <class T>
+uint64_t pinhao::LitFormula<T>::getLocalHash() const {
+  return std::hash<T>()(this->getValue());
+}
+
 template <class T>
 void pinhao::LitFormula<T>::evolve(Evolution *Ev) {
+  FormulaBase::changed();
   Ev->evolve(this->Value);
 }
 
 template <class T>
-pinhao::FormulaBase *pinhao::LitFormula<T>::simplify() {
+pinhao::FormulaRef pinhao::LitFormula<T>::simplify() {
   return nullptr;
 }
 
@@ -72,6 +82,7 @@ pinhao::FormulaKind pinhao::LitFormula<T>::getKind() const {
 
 template <class T>
 void pinhao::LitFormula<T>::generate(FeatureSet *Set) {
+  FormulaBase::changed();
   this->Value = generateLiteral<T>();
 }
 
@@ -82,6 +93,7 @@ void pinhao::LitFormula<T>::solveFor(FeatureSet *Set) {
 
 template <class T>
 bool pinhao::LitFormula<T>::operator==(const FormulaBase &Rhs) const {
+  if (this == &Rhs) return true;
   if (this->getKind() != Rhs.getKind() || this->getType() != Rhs.getType())
     return false;
   auto &RhsCast = static_cast<const Formula<T>&>(Rhs);
@@ -105,4 +117,9 @@ std::unique_ptr<pinhao::FormulaBase> pinhao::LitFormula<T>::clone() {
   return std::unique_ptr<FormulaBase>(Clone);
 }
 
+template <class T>
+pinhao::FormulaRef pinhao::LitFormula<T>::copy() {
+  return FormulaRef(clone().release());
+}
+
 #endif
@@ -0,0 +1,86 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file MultiObjectiveGrammarEvolution.h
+ */
+
+#ifndef PINHAO_MULTI_OBJECTIVE_GRAMMAR_EVOLUTION_H
+#define PINHAO_MULTI_OBJECTIVE_GRAMMAR_EVOLUTION_H
+
+#include "pinhao/MachineLearning/GrammarEvolution/SimpleGrammarEvolution.h"
+
+#include <map>
+
+namespace pinhao {
+  class Candidate;
+
+  /**
+   * @brief A @a SimpleGrammarEvolution that optimizes the cycles, the code size and the
+   * compile time at the same time.
+   *
+   * @details
+   * Each evaluation records three objectives, all relative to the original module, and
+   * all minimized: its cycles (the inverse of the speed up), the size of its object file,
+   * and the time spent in the optimizations plus the code generation. The candidates of
+   * each generation are selected by non-dominated sorting, with the crowding distance
+   * breaking the ties (as in NSGA-II). The objectives of every candidate are stored in
+   * the knowledge base, so the whole Pareto front survives between runs.
+   */
+  class MultiObjectiveGrammarEvolution : public SimpleGrammarEvolution {
+    private:
+      /// @brief The object size and compile time of the original module.
+      double BaseSize;
+      double BaseTime;
+      /// @brief The objectives of the phenotypes already evaluated (empty if it failed).
+      std::map<Phenotype, std::vector<double>> Evaluated;
+
+    protected:
+      /// @brief Compiles the module with @a OptSequence compile-time-samples times,
+      /// keeping the last module in @a Compiled, then generates its object file once,
+      /// keeping its size in @a Size.
+      /// @return The median compile time plus the code generation time, or zero if it
+      /// failed.
+      double measureCompileTime(OptimizationSequence &OptSequence,
+          OptimizedModule &Compiled, double &Size);
+      /// @brief Compiles the module with @a OptSequence, timing it.
+      /// @return The size of the object file and the median compile time, followed by the
+      /// samples of its cost and the hash of the compiled module (see
+      /// @a appendFingerprint); or nothing, if it failed.
+      virtual std::vector<double> compileAndMeasureAll(OptimizationSequence &OptSequence);
+
+      /// @brief Compiles and measures each candidate, returning their objectives in the
+      /// same order (empty, for the ones that failed). The phenotypes measured before are
+      /// not measured again, except for the elite (the last candidate, if @a HasElite),
+      /// until it was measured as many times as the option @a elite-evaluations. If
+      /// @a Fresh is not null, it tells which objectives were measured in this call, like
+      /// in @a evaluateCandidates.
+      std::vector<std::vector<double>> evaluateObjectives(std::vector<Candidate>&, FeatureSet*,
+          bool HasElite = false, std::vector<bool> *Fresh = nullptr);
+
+      /// @brief Adds an evaluation of @a C with its @a Objectives to the knowledge base. A
+      /// failed one (without objectives) is skipped if @a C has objectives already. If they
+      /// are not @a Fresh, they are added as a cached score (see @a addCachedScore).
+      void addObjectives(const Candidate &C, const std::vector<double> &Objectives,
+          bool Fresh = true);
+
+      /// @brief Gets the objectives of the candidates that have them: the ones of the
+      /// @a KnowledgeBase, stored in @a Population, and then the entries of the
+      /// @a StoredKnowledgeBase not loaded yet, whose positions are stored in @a Stored.
+      /// Those entries are not decoded.
+      std::vector<std::vector<double>> getObjectivePoints(std::vector<Candidate> &Population,
+          std::vector<uint64_t> &Stored);
+      /// @brief Orders the candidates that have objectives by front and crowding distance,
+      /// and returns the first @a N of them. Only the stored ones among those are loaded.
+      std::vector<Candidate> getParetoRanking(uint64_t N);
+
+    public:
+      MultiObjectiveGrammarEvolution(std::shared_ptr<llvm::Module> /* Module */, std::string /* KBFilename */ = "config.yaml",
+          double /* EvolveProb */ = 0.2, double /* MaxEvolutionRate */ = 0.3, double /* MutateProb */ = 0.3);
+
+      virtual void run(int /* CandidatesNumber */, int /* GenerationsNumber */, std::shared_ptr<FeatureSet>) override;
+
+  };
+
+}
+
+#endif
@@ -13,7 +13,7 @@ namespace pinhao {
 
   class ParSimpleGrammarEvolution : public SimpleGrammarEvolution {
     private:
-      virtual llvm::Module *compileWithCandidate(llvm::Module*, Candidate&, FeatureSet*) override;
+      virtual OptimizationSequence getOptimizationSequence(Candidate&, FeatureSet*) override;
       virtual void addPreDefinedDecisionPoints() override;
 
     public:
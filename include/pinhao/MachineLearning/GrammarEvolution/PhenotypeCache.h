@@ -0,0 +1,77 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file PhenotypeCache.h
+ */
+
+#ifndef PINHAO_PHENOTYPE_CACHE_H
+#define PINHAO_PHENOTYPE_CACHE_H
+
+#include "pinhao/Optimizer/Phenotype.h"
+
+#include "llvm/IR/Module.h"
+
+#include <map>
+#include <memory>
+#include <iostream>
+
+namespace pinhao {
+
+  /**
+   * @brief Keeps the measured fitness (and, optionally, the compiled module) of each
+   * @a Phenotype already evaluated.
+   *
+   * @details
+   * Different candidates often resolve to the same phenotype. Since they would be
+   * compiled into the same module, they only need to be evaluated once. Different
+   * phenotypes may also be compiled into the same module: when the fingerprint of the
+   * compiled module is known, the phenotypes with the same fingerprint share their entry.
+   */
+  class PhenotypeCache {
+    public:
+      struct Entry {
+        /// @brief The average fitness of its evaluations.
+        double Fitness;
+        uint64_t Evaluations;
+        /// @brief The compiled module, if it was kept.
+        std::shared_ptr<llvm::Module> Compiled;
+        /// @brief The hash of the compiled module, or zero if it is unknown.
+        uint64_t Fingerprint;
+      };
+
+    private:
+      std::map<Phenotype, std::shared_ptr<Entry>> Entries;
+      std::map<uint64_t, std::shared_ptr<Entry>> Fingerprints;
+      uint64_t Hits;
+      uint64_t Misses;
+
+    public:
+      PhenotypeCache();
+
+      /// @brief Gets the entry of @a P, counting a hit, or nullptr, counting a miss.
+      const Entry *find(const Phenotype &P);
+      /// @brief Gets the entry of @a P, or nullptr, without counting it.
+      const Entry *peek(const Phenotype &P) const;
+      /// @brief Counts a hit for a phenotype whose evaluation is still pending.
+      void countHit();
+
+      /// @brief Inserts (or replaces) the entry of @a P.
+      void insert(const Phenotype &P, double Fitness, std::shared_ptr<llvm::Module> Compiled = nullptr,
+          uint64_t Fingerprint = 0);
+      /// @brief Averages a new evaluation of @a P with its entry (or the one of its
+      /// @a Fingerprint, if it is not zero), or inserts it. The failed evaluations (a
+      /// non-positive @a Fitness) do not replace the ones that succeeded.
+      void add(const Phenotype &P, double Fitness, std::shared_ptr<llvm::Module> Compiled = nullptr,
+          uint64_t Fingerprint = 0);
+
+      uint64_t getNumberOfHits() const;
+      uint64_t getNumberOfMisses() const;
+      uint64_t size() const;
+
+      /// @brief Prints the number of hits and misses to @a Out.
+      void printStatistics(std::ostream &Out = std::cerr) const;
+  };
+
+}
+
+#endif
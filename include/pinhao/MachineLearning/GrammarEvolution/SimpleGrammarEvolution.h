@@ -7,7 +7,19 @@
 #ifndef PINHAO_SIMPLE_GRAMMAR_EVOLUTION_H
 #define PINHAO_SIMPLE_GRAMMAR_EVOLUTION_H
 
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaBytecode.h"
 #include "pinhao/MachineLearning/GrammarEvolution/GrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/BinaryKnowledgeBase.h"
+#include "pinhao/MachineLearning/GrammarEvolution/CorpusKnowledgeBase.h"
+#include "pinhao/MachineLearning/GrammarEvolution/KnowledgeBaseJournal.h"
+#include "pinhao/MachineLearning/GrammarEvolution/PhenotypeCache.h"
+#include "pinhao/Optimizer/OptimizationSequence.h"
+#include "pinhao/PerformanceAnalyser/MeasurementDatabase.h"
+#include "pinhao/PerformanceAnalyser/PAPIWrapper.h"
+#include "pinhao/Support/HelperPool.h"
+#include "pinhao/Support/Island.h"
+#include "pinhao/Support/Statistics.h"
+#include "pinhao/Support/WorkerPool.h"
 
 #include <vector>
 
@@ -25,9 +37,10 @@ namespace pinhao {
       SimpleEvolution(double M, FeatureSet *Set) : Evolution(Set), M(M) {}
 
       /// @brief Mutates the node's @a FormulaBases.
-      void mutate(std::unique_ptr<FormulaBase>*);
-      /// @brief Evolves a @a FormulaBase from a node.
-      void evolve(std::vector<std::unique_ptr<FormulaBase>*>) override;
+      void mutate(std::shared_ptr<FormulaBase>*);
+      /// @brief Evolves a @a FormulaBase from a node. The one that evolves in place is
+      /// copied first, if it is shared.
+      void evolve(std::vector<std::shared_ptr<FormulaBase>*>) override;
       /// @brief Evolves an @a FeaturePair.
       void evolve(std::pair<std::string, std::string>&) override;
       /// @brief Evolvels an @a int value.
@@ -43,10 +56,290 @@ namespace pinhao {
    * It uses all default implementations, and also implements a simple @a run and @a stop
    * function.
    */
-  class SimpleGrammarEvolution : public GrammarEvolution<Candidate> {
+  class SimpleGrammarEvolution : public GrammarEvolution<Candidate, CompareByScore> {
     protected:
+      /// @brief The cost of the original module, which the candidates are compared to.
+      double BaseLine;
+      /// @brief The score given to the candidates that could not be compiled or measured.
+      double FailureScore;
+
+      /// @brief The long-lived processes that compile and measure the candidates, when
+      /// the option @a helper-processes is set. They are created on the first evaluation,
+      /// and the ones that do not answer within the option @a helper-timeout are replaced.
+      std::unique_ptr<HelperPool> Helpers;
+
+      /// @brief The fitness of the phenotypes already evaluated.
+      PhenotypeCache Cache;
+
+      /// @brief The formulas of the candidates compiled to bytecode.
+      FormulaProgramCache Programs;
+
+      /// @brief This process as one of the islands of the option @a islands, created on the
+      /// first migration.
+      std::unique_ptr<Island> Archipelago;
+
+      /// @brief The measurements of previous runs, if the option @a measurement-db is set.
+      std::unique_ptr<MeasurementDatabase> Database;
+      uint64_t ModuleHash;
+      std::string HostFingerprint;
+      /// @brief The number of evaluations taken from the @a Database.
+      uint64_t Reused;
+
+      /// @brief The knowledge base file, if it is binary. Its candidates are loaded into the
+      /// @a KnowledgeBase as they are needed.
+      BinaryKnowledgeBase StoredKnowledgeBase;
+      /// @brief The entries of the @a StoredKnowledgeBase already loaded.
+      std::vector<bool> LoadedEntries;
+      /// @brief The first entry of the @a StoredKnowledgeBase index that may not be loaded.
+      uint64_t Loaded;
+
+      /// @brief The journal of the evaluations of this run, if the option @a kb-journal is
+      /// set. Each run sharing the knowledge base has its own.
+      std::unique_ptr<KnowledgeBaseJournal> Journal;
+      /// @brief The evaluations of this run that are not in the knowledge base file yet, nor
+      /// in a compaction of the @a Journal: one per candidate, with their count and average.
+      SerialSet<Candidate> Unsaved;
+
+      /// @brief The static features of the module, which identify it in the corpus (option
+      /// @a kb-corpus).
+      CorpusKnowledgeBase::FeatureVector ModuleFeatures;
+      /// @brief The candidates of the nearest modules of the corpus, which start the
+      /// evolution when the @a KnowledgeBase is empty.
+      std::vector<Candidate> Seeds;
+      uint64_t SeedsUsed;
+
+      /// @brief Imports the knowledge base, once the journals of the runs that crashed are
+      /// merged into it. If it is binary, only the best candidates (option @a kb-resident)
+      /// are loaded, and the others stay in the mapped file.
+      void importKnowledgeBase() override;
+      /// @brief Exports the knowledge base, and then clears its journal.
+      void exportKnowledgeBase() override;
+      /// @brief Merges the evaluations that are not in the knowledge base file yet (the
+      /// @a Unsaved ones, and the ones of a compaction that failed) into it, along with the
+      /// candidates it does not have (see @a mergeKnowledgeBase). Other runs may be
+      /// updating it as well.
+      bool writeKnowledgeBase() override;
+
+      /// @brief Gets the prefix of the names of the journals of the knowledge base.
+      std::string getJournalPrefix() const;
+      /// @brief Merges the journals left by the runs that crashed (the ones no run holds)
+      /// into the knowledge base file, and removes them. The records that the file has
+      /// merged already (see @a readJournalMarks) are skipped.
+      void recoverJournals();
+
+      /**
+       * @brief Takes the @a Seeds from the corpus of the option @a kb-corpus: the best
+       * candidates of the modules nearest to this one. Only when the @a KnowledgeBase is
+       * empty, i.e.: when this module was never evolved before.
+       */
+      void warmStart(FeatureSet*);
+      /// @brief Gets @a N candidates to start the evolution with: the @a Seeds not used yet,
+      /// and then empty ones, to be generated.
+      std::vector<Candidate> getInitialPopulation(uint64_t N);
+      /// @brief Stores the best candidates of this module in the corpus, if it is set.
+      void updateCorpus();
+      /**
+       * @brief Prints how well the best candidate generalizes to the other modules of the
+       * @a Corpus: in how many of them it takes the same decisions as their own best
+       * candidate. Its formulas are evaluated over all the modules at once, by a
+       * @a BatchEvaluator.
+       */
+      void printGeneralization(const CorpusKnowledgeBase &Corpus);
+
+      /// @brief Loads the @a Nth entry of the @a StoredKnowledgeBase, if it is not loaded yet.
+      /// If the candidate is already in the @a KnowledgeBase, they are merged (see
+      /// @a Candidate::merge). The candidate, as it is then in the @a KnowledgeBase, is
+      /// stored in @a Decoded, if it is not null.
+      /// @return False if it was loaded already, or it is malformed.
+      bool loadStoredCandidate(uint64_t N, Candidate *Decoded = nullptr);
+      /// @brief Loads the candidates of the @a StoredKnowledgeBase that rank among the @a N
+      /// best of the @a KnowledgeBase.
+      void loadBestCandidates(uint64_t N);
+
+      /// @brief Loads the entry of the @a StoredKnowledgeBase equal to @a C, if there is one
+      /// and @a C is not in the @a KnowledgeBase yet.
+      void loadStoredEntryOf(const Candidate &C);
+
+      /// @brief Averages the @a Evaluation (its score, count and objectives) with its
+      /// candidate in the @a KnowledgeBase, if any (see @a Candidate::merge). Its entry in
+      /// the @a StoredKnowledgeBase is loaded first, so that the state of every candidate of
+      /// the @a KnowledgeBase includes it.
+      void mergeEvaluation(const Candidate &Evaluation);
+
+      /**
+       * @brief Adds an evaluation of @a C to the @a KnowledgeBase: its score (and
+       * objectives) are averaged with the ones it has there, if any.
+       *
+       * @details
+       * The evaluation is appended to the @a Journal, which is compacted in the background
+       * every few evaluations (option @a kb-compact-every).
+       */
+      void addEvaluation(const Candidate &C, double Score,
+          const std::vector<double> &Objectives = std::vector<double>());
+      /// @brief Adds a score (and objectives) of @a C taken from the @a Cache or the
+      /// @a Database, which is not a new measurement: it is merged with no count, so it only
+      /// scores @a C if it is not in the @a KnowledgeBase yet, and it is not journaled.
+      void addCachedScore(const Candidate &C, double Score,
+          const std::vector<double> &Objectives = std::vector<double>());
+      /// @brief Adds the @a Scores of @a Candidates given by @a evaluateCandidates: the
+      /// @a Fresh ones with @a addEvaluation, and the others with @a addCachedScore.
+      void addScores(const std::vector<Candidate> &Candidates, const std::vector<double> &Scores,
+          const std::vector<bool> &Fresh);
+
       virtual llvm::Module *compileWithCandidate(llvm::Module*, Candidate&, FeatureSet*) override;
 
+      /// @brief Gets the optimizations enabled by the candidate, in the order of @a Sequence.
+      virtual OptimizationSequence getOptimizationSequence(Candidate&, FeatureSet*);
+
+      /// @brief Gets the cost (e.g.: the number of cycles) of the module. Returns a
+      /// non-positive value if it could not be measured, and infinity if it was killed
+      /// for exceeding its budget (options @a budget-factor and @a timeout).
+      virtual double measureCost(llvm::Module&);
+      /// @brief Gets the name of what @a measureCost measures.
+      virtual std::string getMeasurementBackend();
+      /// @brief Gets how many times @a measureCost is repeated for each module. By
+      /// default, it is taken from the options @a min-samples, @a max-samples,
+      /// @a ci-width and @a confidence.
+      virtual RepetitionPolicy getRepetitionPolicy();
+
+      /// @brief Gets the budget of each run measured, from the @a BaseLine.
+      PAPIWrapper::Budget getBudget();
+      /// @brief Gets the budget of the measurements stored in the @a MeasurementDatabase, so
+      /// that the ones over a smaller budget are not reused.
+      MeasurementDatabase::Budget getDatabaseBudget();
+
+      /// @brief Repeats @a measureCost as told by @a getRepetitionPolicy.
+      /// @return The samples, none if any of them could not be measured, or a single
+      /// infinite sample if it exceeded its budget.
+      std::vector<double> repeatMeasureCost(llvm::Module&);
+      /// @brief Measures the cost repeatedly, like @a repeatMeasureCost. By default, the
+      /// cycles are measured with a fork server (option @a fork-server), so the module is
+      /// JIT compiled only once.
+      virtual std::vector<double> measureCostRepeatedly(llvm::Module&);
+      /// @brief Gets the speed up over the @a BaseLine of the median of @a Samples. The
+      /// ones that exceeded their budget get a capped penalty.
+      double getSpeedUp(const std::vector<double> &Samples);
+
+      /// @brief Gets the speed up of the compiled module over the @a BaseLine, using the
+      /// median of repeated measurements. Returns a non-positive value if it could not be
+      /// measured.
+      virtual double measureSpeedUp(llvm::Module&);
+
+      /// @brief Measures the (median) cost of the original module, or takes it from the
+      /// database. Returns 0, after reporting it, if it could not be measured; then the
+      /// engines stop before evaluating any candidate.
+      double measureBaseLine();
+
+      /// @brief Opens the database on the first call, if it is enabled.
+      /// @return The database, or nullptr if it is not enabled.
+      MeasurementDatabase *getDatabase();
+      /// @brief Gets the key of the measurement of the module compiled with @a Sequence
+      /// (in YAML).
+      MeasurementDatabase::Key getMeasurementKey(const std::string &Sequence);
+
+      /// @brief Compiles the module with the sequence in this process, and then measures
+      /// it with @a measureCostRepeatedly. The compiled module is stored in @a Compiled, and
+      /// its hash in @a Fingerprint, if they are not null.
+      std::vector<double> compileThenMeasure(OptimizationSequence&, 
+          std::shared_ptr<llvm::Module> *Compiled = nullptr, uint64_t *Fingerprint = nullptr);
+      /// @brief Compiles the module with the sequence, and measures it. By default, unless
+      /// the compiled module is asked for, it is compiled inside the fork server that
+      /// measures it (option @a fused-measurement), so only the samples and the hash of the
+      /// compiled module (in @a Fingerprint, if it is not null) come back.
+      /// @return The samples, like @a measureCostRepeatedly.
+      virtual std::vector<double> compileAndMeasure(OptimizationSequence&, 
+          std::shared_ptr<llvm::Module> *Compiled = nullptr, uint64_t *Fingerprint = nullptr);
+      /// @brief Runs @a compileAndMeasure in a task of a @a WorkerPool, which may be forked,
+      /// so the hash of the compiled module follows the samples in the result. It takes two
+      /// values, one for each 32-bit half, since a double holds those exactly.
+      WorkerPool::Values compileAndMeasureInWorker(OptimizationSequence&,
+          std::shared_ptr<llvm::Module> *Compiled = nullptr);
+      /// @brief Appends @a Fingerprint to @a Values, the way @a compileAndMeasureInWorker does.
+      static void appendFingerprint(WorkerPool::Values &Values, uint64_t Fingerprint);
+      /// @brief Removes the hash appended by @a appendFingerprint from @a Values.
+      /// @return The hash, or zero if the worker died before sending it.
+      static uint64_t takeFingerprint(WorkerPool::Values &Values);
+
+      /**
+       * @brief Answers a request sent to a helper process.
+       *
+       * @details
+       * The request is an @a OptimizationSequence in YAML. The module is compiled with it
+       * and measured, and the reply is a YAML map with the "status" (0 if it succeeded, 1
+       * if it failed, and 2 if it exceeded its budget), the "samples" of the cost, the
+       * "time" it took in seconds, and the "fingerprint" of the compiled module (in hex, zero
+       * if it is unknown).
+       */
+      std::string serveEvaluation(const std::string&);
+      /// @brief Reads a reply of @a serveEvaluation into @a Samples and @a Fingerprint.
+      /// @return False if it is malformed (e.g.: cut short by a helper that crashed).
+      static bool parseEvaluation(const std::string &Reply, std::vector<double> &Samples,
+          uint64_t &Fingerprint);
+
+      /// @brief Gets the number of candidates compiled and measured at the same time (option
+      /// @a eval-workers).
+      static int getEvaluationWorkers();
+      /// @brief Gets how many evaluations the phenotype of the best candidate needs before
+      /// its cached fitness is reused (option @a elite-evaluations). At least one.
+      static uint64_t getEliteEvaluations();
+
+      /// @brief Compiles and measures each sequence, returning the samples of their costs
+      /// in the same order (none, if it failed). If the option @a share-prefixes is set,
+      /// they are compiled together with an @a OptimizationTrie. The compiled modules are
+      /// stored in @a Compiled only if they were compiled in this process, and the option
+      /// @a cache-modules is set. The hashes of the compiled modules are stored in
+      /// @a Fingerprints, when they are known (zero otherwise).
+      std::vector<std::vector<double>> evaluateSequences(std::vector<OptimizationSequence>&,
+          std::vector<std::shared_ptr<llvm::Module>> &Compiled, std::vector<uint64_t> &Fingerprints);
+
+      /// @brief Looks for the score of a phenotype already evaluated, in the @a Cache, and
+      /// then in the @a Database.
+      /// @return True if it was found.
+      bool findScore(const OptimizationSequence&, const Phenotype&, double &Score);
+      /// @brief Stores the samples of a new evaluation in the @a Database and in the @a Cache,
+      /// where it is averaged with the previous evaluations of the phenotype (and of the
+      /// others compiled into the same module, if its @a Fingerprint is known).
+      /// @return The speed up, or zero if it failed.
+      double storeEvaluation(const OptimizationSequence&, const Phenotype&, 
+          const std::vector<double> &Samples, std::shared_ptr<llvm::Module> Compiled = nullptr,
+          uint64_t Fingerprint = 0);
+
+      /**
+       * @brief Compiles and measures each candidate, returning their scores in the same order.
+       *
+       * @details
+       * The candidates must have all decision points already generated. They are spread
+       * among the evaluation workers (option @a eval-workers), so that each one is compiled
+       * and measured in its own process; or among the helper processes, if the option
+       * @a helper-processes is set. The rest of the algorithm stays serial, which keeps
+       * the results the same as with a single worker.
+       *
+       * Candidates that resolve to the same @a Phenotype are evaluated only once, and the
+       * ones already evaluated are taken from the @a Cache, or from the @a Database.
+       * The score is the speed up of the median of the samples of each candidate.
+       *
+       * If @a HasElite, the last candidate is the best of the knowledge base. It is measured
+       * again until its phenotype has the evaluations of the option @a elite-evaluations,
+       * whose average is then reused.
+       *
+       * If @a Fresh is not null, it tells which scores were measured in this call: one
+       * candidate for each phenotype measured, and none of those taken from the @a Cache
+       * or the @a Database.
+       */
+      std::vector<double> evaluateCandidates(std::vector<Candidate>&, FeatureSet*, bool HasElite = false,
+          std::vector<bool> *Fresh = nullptr);
+
+      /**
+       * @brief Exchanges the best candidates of the knowledge base with the other islands,
+       * if the option @a islands is set, and @a Generation is a multiple of the option
+       * @a migration-interval.
+       *
+       * @details
+       * The immigrants that are not in the knowledge base yet are inserted with the score
+       * they had in their island, so they take part in the next generations.
+       */
+      void migrateCandidates(int Generation);
+
     public:
       virtual ~SimpleGrammarEvolution();
       SimpleGrammarEvolution(std::shared_ptr<llvm::Module> /* Module */, std::string /* KBFilename */ = "config.yaml",
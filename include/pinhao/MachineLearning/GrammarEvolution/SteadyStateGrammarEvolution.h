@@ -0,0 +1,48 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file SteadyStateGrammarEvolution.h
+ */
+
+#ifndef PINHAO_STEADY_STATE_GRAMMAR_EVOLUTION_H
+#define PINHAO_STEADY_STATE_GRAMMAR_EVOLUTION_H
+
+#include "pinhao/MachineLearning/GrammarEvolution/SimpleGrammarEvolution.h"
+
+namespace pinhao {
+  class Candidate;
+  class SimpleEvolution;
+
+  /**
+   * @brief A @a SimpleGrammarEvolution without generations.
+   *
+   * @details
+   * Instead of waiting for the slowest candidate of a generation, a new offspring is
+   * bred as soon as an evaluation worker is free. It evolves from one of the best
+   * candidates of the knowledge base at that moment, and its score is merged into the
+   * knowledge base as soon as it arrives. The run evaluates as many candidates as the
+   * generational one would, and migrates (if there are islands) every time that many
+   * candidates of a generation were merged.
+   */
+  class SteadyStateGrammarEvolution : public SimpleGrammarEvolution {
+    protected:
+      /// @brief Breeds a new candidate from one of the @a CandidatesNumber best ones of
+      /// the knowledge base, chosen at random.
+      Candidate breedCandidate(int CandidatesNumber, SimpleEvolution*, FeatureSet*);
+
+      /// @brief Merges the @a Score of @a C into the knowledge base: as an evaluation if it
+      /// is @a Fresh (measured for @a C), and otherwise as a cached score (see
+      /// @a addCachedScore).
+      void mergeCandidate(Candidate C, double Score, bool Fresh = true);
+
+    public:
+      SteadyStateGrammarEvolution(std::shared_ptr<llvm::Module> /* Module */, std::string /* KBFilename */ = "config.yaml",
+          double /* EvolveProb */ = 0.2, double /* MaxEvolutionRate */ = 0.3, double /* MutateProb */ = 0.3);
+
+      virtual void run(int /* CandidatesNumber */, int /* GenerationsNumber */, std::shared_ptr<FeatureSet>) override;
+
+  };
+
+}
+
+#endif
@@ -0,0 +1,62 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file TieredSimpleGrammarEvolution.h
+ */
+
+#ifndef PINHAO_TIERED_SIMPLE_GRAMMAR_EVOLUTION_H
+#define PINHAO_TIERED_SIMPLE_GRAMMAR_EVOLUTION_H
+
+#include "pinhao/MachineLearning/GrammarEvolution/SimpleGrammarEvolution.h"
+
+#include <map>
+
+namespace pinhao {
+  class Candidate;
+
+  /**
+   * @brief A @a SimpleGrammarEvolution that screens the candidates with a static cost
+   * model before measuring them.
+   *
+   * @details
+   * Each generation explores @a screen-factor times more candidates than the plain one.
+   * All of them are scored by the static model (option @a screen-model, "sprof" or
+   * "geos"), and only the best @a screen-fraction of them is measured, and stored in the
+   * knowledge base. The rank correlation between the predicted and the measured speed
+   * ups is reported, so that the fraction can be tuned.
+   */
+  class TieredSimpleGrammarEvolution : public SimpleGrammarEvolution {
+    private:
+      /// @brief The static cost of the original module.
+      double StaticBaseLine;
+      /// @brief The static cost of the phenotypes already screened (zero if it failed).
+      std::map<Phenotype, double> Screened;
+
+      /// @brief The predicted and measured speed ups of every candidate measured.
+      std::vector<double> Predicted;
+      std::vector<double> Measured;
+
+    protected:
+      /// @brief Gets the cost of the module given by the static model. Returns a
+      /// non-positive value if it could not be analysed.
+      double measureStaticCost(llvm::Module&);
+
+      /// @brief Predicts the speed up of each candidate with the static model. The
+      /// candidates are compiled and analysed by the evaluation workers.
+      std::vector<double> screenCandidates(std::vector<Candidate>&, FeatureSet*);
+
+      /// @brief Prints the rank correlation between the predicted and measured speed ups,
+      /// of this generation and of all of them.
+      void printCorrelation(const std::vector<double> &Predictions, const std::vector<double> &Scores);
+
+    public:
+      TieredSimpleGrammarEvolution(std::shared_ptr<llvm::Module> /* Module */, std::string /* KBFilename */ = "config.yaml",
+          double /* EvolveProb */ = 0.2, double /* MaxEvolutionRate */ = 0.3, double /* MutateProb */ = 0.3);
+
+      virtual void run(int /* CandidatesNumber */, int /* GenerationsNumber */, std::shared_ptr<FeatureSet>) override;
+
+  };
+
+}
+
+#endif
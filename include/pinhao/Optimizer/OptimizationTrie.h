@@ -0,0 +1,72 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file OptimizationTrie.h
+ */
+
+#ifndef PINHAO_OPTIMIZATION_TRIE_H
+#define PINHAO_OPTIMIZATION_TRIE_H
+
+#include "pinhao/Optimizer/OptimizationSequence.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace pinhao {
+
+  /**
+   * @brief Groups sequences by their common prefixes, so that each distinct prefix is
+   * applied only once.
+   *
+   * @details
+   * The module is optimized along each path of the trie, and it is cloned only where two
+   * or more sequences diverge. When a sequence is split like this, its passes are run in
+   * more than one pass manager, which gives the same result as running them at once for
+   * the passes that only change the function they run on.
+   *
+   * All the sequences must have the same @a OLevel.
+   */
+  class OptimizationTrie {
+    private:
+      struct Node {
+        /// @brief The sequences that end at this node.
+        std::vector<uint64_t> Ends;
+        std::map<OptimizationInfo, std::unique_ptr<Node>> Children;
+      };
+
+      Node Root;
+      OptLevel OLevel;
+      uint64_t NumberOfSequences;
+      uint64_t NumberOfPasses;
+      uint64_t NumberOfNodes;
+
+      /// @brief Applies @a Pending to @a Module, which already has the passes up to the
+      /// parent of @a N, and compiles the rest of the subtree of @a N.
+      void compile(const Node *N, OptimizedModule Module, OptimizationSequence Pending,
+          std::vector<std::shared_ptr<llvm::Module>> &Compiled) const;
+
+    public:
+      OptimizationTrie(const std::vector<OptimizationSequence> &Sequences);
+
+      /// @brief Gets the number of passes in all the sequences.
+      uint64_t getNumberOfPasses() const;
+      /// @brief Gets the number of passes applied by @a compile, i.e. one per distinct prefix.
+      uint64_t getNumberOfSharedPasses() const;
+
+      /**
+       * @brief Compiles @a Module with each sequence.
+       *
+       * @details
+       * The first copy of the module is made by @a applyOptimizations (see its options),
+       * and the rest of the passes are applied in the calling process.
+       *
+       * @return The compiled modules, in the order of the sequences. Sequences that are
+       * equal share the same module, and the ones that failed have nullptr.
+       */
+      std::vector<std::shared_ptr<llvm::Module>> compile(llvm::Module &Module) const;
+  };
+
+}
+
+#endif
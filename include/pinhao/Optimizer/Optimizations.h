@@ -10,6 +10,7 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Function.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <map>
@@ -146,6 +147,22 @@ namespace pinhao {
   /// @brief Gets the @a PassKind of the @a Opt.
   int getPassKind(Optimization Opt);
 
+  /**
+   * @brief Runs the @a OptimizationSequence directly on @a Module, in the calling process.
+   *
+   * @details
+   * The module is modified in place. A pass that crashes takes the calling process down
+   * with it, so this should only be used when the caller is isolated already.
+   *
+   * The target machine is the one for the @a OLevel of the sequence, whose passes are only
+   * run before the sequence's if @a WithOLevel is set, i.e. not when the module has them
+   * already.
+   */
+  void runOptimizations(llvm::Module &Module, OptimizationSequence *Seq, bool WithOLevel = true);
+  /// @brief Runs the function passes of @a OptimizationSequence directly on @a Function,
+  /// in the calling process.
+  void runOptimizations(llvm::Function &Function, OptimizationSequence *Seq);
+
   /** 
    * @brief Applies a generated @a OptimizationSequence to a module, from the @a OptimizationSet.
    * @return The optimized module.
@@ -153,7 +170,17 @@ namespace pinhao {
   llvm::Module *applyOptimizations(llvm::Module &Module, OptimizationSet *Set);
   /** 
    * @brief Applies the @a OptimizationSequence to a module.
-   * @return The optimized module.
+   *
+   * @details
+   * By default, @a Module is cloned into a context of its own, and the optimizations are
+   * applied to the clone. So, different threads may optimize the same module at the same
+   * time, as long as nobody modifies it. The optimized module must be deleted with
+   * @a deleteModule, which also deletes its context.
+   *
+   * If the option "opt-fork" is set, the optimizations are applied in a forked process,
+   * which isolates passes that crash, and the module is read back in the global context.
+   *
+   * @return The optimized module, or nullptr if it failed.
    */
   llvm::Module *applyOptimizations(llvm::Module &Module, OptimizationSequence *Seq);
   /** 
@@ -179,6 +206,29 @@ namespace pinhao {
    */
   llvm::Module *applyOptimizations(llvm::Module &Module, llvm::Function *Function, OptimizationSequence *Seq);
 
+  /// @brief Clones @a Module in the same context, so that the clone may be deleted with
+  /// @a deleteModule, like the modules returned by @a applyOptimizations.
+  llvm::Module *cloneModule(llvm::Module &Module);
+  /// @brief Deletes @a Module, and the context created for it by @a applyOptimizations once
+  /// no other clone lives there.
+  void deleteModule(llvm::Module *Module);
+
+  /// @brief Deleter for the modules returned by @a applyOptimizations and @a cloneModule.
+  struct ModuleDeleter {
+    void operator()(llvm::Module *Module) const { deleteModule(Module); }
+  };
+  typedef std::unique_ptr<llvm::Module, ModuleDeleter> OptimizedModule;
+
+  /**
+   * @brief Gets the size in bytes of the object file emitted for @a Module, by the target
+   * machine used for the @a OptimizationSequence.
+   *
+   * @details
+   * A clone of @a Module goes through the code generator, so @a Module is not modified.
+   * @return The size, or zero if the module has no target, or could not be emitted.
+   */
+  uint64_t getObjectSize(llvm::Module &Module, OptimizationSequence *Seq);
+
 }
 
 #endif
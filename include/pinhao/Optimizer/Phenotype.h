@@ -0,0 +1,52 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file Phenotype.h
+ */
+
+#ifndef PINHAO_PHENOTYPE_H
+#define PINHAO_PHENOTYPE_H
+
+#include "pinhao/Optimizer/Optimizations.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace pinhao {
+  class OptimizationSequence;
+
+  /**
+   * @brief A compact description of what a module is compiled with.
+   *
+   * @details
+   * It has a bitset of the enabled optimizations, and the values of their arguments,
+   * in the order they appear in the sequence. Two sequences taken from the same ordering
+   * (e.g.: the @a Sequence of a @a GrammarEvolution) have the same phenotype if and only
+   * if they produce the same compiled module.
+   */
+  class Phenotype {
+    private:
+      std::vector<uint64_t> Enabled;
+      /// @brief The argument values of the enabled optimizations, encoded as bytes.
+      std::string Args;
+
+    public:
+      Phenotype();
+      Phenotype(const OptimizationSequence &Sequence);
+
+      /// @brief Returns true if @a Opt is enabled.
+      bool isEnabled(Optimization Opt) const;
+      /// @brief Gets the number of enabled optimizations.
+      uint64_t getNumberOfEnabled() const;
+
+      /// @brief Gets the phenotype as a string of bytes, suitable as a key.
+      std::string getKey() const;
+
+      bool operator<(const Phenotype &Rhs) const;
+      bool operator==(const Phenotype &Rhs) const;
+  };
+
+}
+
+#endif
@@ -0,0 +1,109 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file MeasurementDatabase.h
+ */
+
+#ifndef PINHAO_MEASUREMENT_DATABASE_H
+#define PINHAO_MEASUREMENT_DATABASE_H
+
+#include "llvm/IR/Module.h"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace pinhao {
+
+  /**
+   * @brief Stores, in a file, the measurements taken in previous runs.
+   *
+   * @details
+   * Each measurement is identified by a @a Key: the content of the original module, the
+   * sequence it was compiled with, its arguments, the measurement backend, and the host
+   * where it was measured. The file is a list of YAML documents, to which new samples are
+   * appended as soon as they are measured, so that it survives interrupted runs. Each one
+   * has its whole key, which is compared on lookup, so the keys whose hashes collide do not
+   * share their samples. The documents are read one by one, skipping the malformed ones,
+   * and the last one is truncated if an interrupted append tore it, so the next appends
+   * start on a document of their own.
+   *
+   * A measurement killed for exceeding its @a Budget is an infinite sample. It is stored
+   * with that budget, and only reused under budgets that are not larger.
+   */
+  class MeasurementDatabase {
+    public:
+      struct Key {
+        /// @brief The hash of the original module (see @a hashModule).
+        uint64_t ModuleHash;
+        /// @brief The resolved optimization sequence, with its arguments (e.g.: in YAML).
+        std::string Sequence;
+        std::vector<std::string> Argv;
+        /// @brief The name of what was measured (e.g.: "papi-cycles").
+        std::string Backend;
+        /// @brief The host fingerprint (see @a getHostFingerprint).
+        std::string Host;
+
+        uint64_t getHash() const;
+
+        bool operator<(const Key &Rhs) const;
+        bool operator==(const Key &Rhs) const;
+      };
+
+      /// @brief The limits of a measurement, each of them zero if there is none.
+      struct Budget {
+        /// @brief In the unit of the backend (e.g.: cycles).
+        double Cost;
+        double Seconds;
+
+        Budget(double Cost = 0, double Seconds = 0) : Cost(Cost), Seconds(Seconds) {}
+
+        /// @brief Returns true if every limit of @a Other is at most the one of this.
+        bool covers(const Budget &Other) const;
+      };
+
+    private:
+      struct Entry {
+        std::vector<double> Samples;
+        /// @brief The budgets that were exceeded.
+        std::vector<Budget> Exceeded;
+      };
+
+      std::string Filename;
+      std::map<Key, Entry> Samples;
+
+      /// @brief Adds @a NewSamples, measured under @a B, to @a K.
+      void insert(const Key &K, const std::vector<double> &NewSamples, const Budget &B);
+
+      /// @brief Loads the samples of a single document of the file.
+      /// @return False if it is malformed or has no key. @a Torn is set if it is not even
+      /// valid YAML.
+      bool loadDocument(const std::string &Text, bool &Torn);
+      /// @brief Loads all samples inside @a Filename, one document at a time. The last
+      /// document is dropped from the file if it is torn.
+      void load();
+
+    public:
+      MeasurementDatabase(std::string Filename);
+
+      /// @brief Returns true if there is any sample for @a K.
+      bool has(const Key &K) const;
+      /// @brief Gets the samples of @a K (empty if there is none). If it exceeded a budget
+      /// that covers @a B, there is an infinite sample.
+      std::vector<double> getSamples(const Key &K, const Budget &B = Budget()) const;
+      /// @brief Adds @a NewSamples, measured under @a B, to @a K, and appends them to the file.
+      void addSamples(const Key &K, const std::vector<double> &NewSamples, const Budget &B = Budget());
+
+      /// @brief Gets the total number of keys with samples.
+      uint64_t size() const;
+
+      /// @brief Gets a string that identifies this host: its system, machine and cpu model.
+      static std::string getHostFingerprint();
+      /// @brief Gets a hash of the bitcode of @a Module.
+      static uint64_t hashModule(llvm::Module &Module);
+  };
+
+}
+
+#endif
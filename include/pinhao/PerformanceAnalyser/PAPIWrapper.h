@@ -8,7 +8,9 @@
 #define PINHAO_PAPI_WRAPPER_H
 
 #include "pinhao/Support/JITExecutor.h"
+#include "pinhao/Support/Statistics.h"
 
+#include <functional>
 #include <vector>
 #include "papi.h"
 
@@ -23,10 +25,28 @@ namespace pinhao {
       typedef std::vector<int> EventCodeVector;
       typedef std::vector<LLong> CounterVector;
       typedef std::vector<std::string> ArgVector;
+      typedef std::function<void(llvm::Module&)> ModuleTransform;
+
+      /// @brief The exit status of the runs killed for exceeding their @a Budget.
+      static const int BudgetExceeded = -1;
+
+      /**
+       * @brief Limits how long a single run may take. Zero means no limit.
+       *
+       * @details
+       * The @a Cycles are counted with PAPI overflow interrupts (they are only checked when
+       * the total number of cycles is one of the events counted), and the @a Seconds with a
+       * timer. Both start right before the module is executed, so the JIT compilation is not
+       * accounted for.
+       */
+      struct Budget {
+        LLong Cycles;
+        double Seconds;
+
+        Budget(LLong Cycles = 0, double Seconds = 0) : Cycles(Cycles), Seconds(Seconds) {}
+      };
 
     private:
-      /// @brief Initializes the papi library.
-      static void initialize();
       /// @brief Creates an @a EventSet.
       static int createEventSet();
       /// @brief Returns true if all the events inside the vector are valid (available).
@@ -35,10 +55,24 @@ namespace pinhao {
       static void addEvent(int, int);
       /// @brief Returns true if it successfuly added all events to an @a EventSet.
       static bool addEvents(int, EventCodeVector);
-      /// @brief Runs the @a llvm::Module, while counting the events.
-      static int run(llvm::Module&, ArgVector, char* const*, EventCodeVector, long long*);
+      /// @brief Arms the timer and the overflow interrupts that kill the current process
+      /// when it exceeds the budget.
+      static void armBudget(int, const Budget&);
+      /// @brief Runs the @a JITExecutor in a forked process, while counting the events. If
+      /// it is null, the @a llvm::Module is JIT compiled in the forked process. The run is
+      /// killed if it exceeds the @a Budget, in which case @a BudgetExceeded is returned.
+      static int runInFork(JITExecutor*, llvm::Module*, ArgVector, char* const*, EventCodeVector,
+          long long*, const Budget&);
+      /// @brief Runs the @a llvm::Module, while counting the events. The run is killed if it
+      /// exceeds the @a Budget, in which case @a BudgetExceeded is returned.
+      static int run(llvm::Module&, ArgVector, char* const*, EventCodeVector, long long*,
+          const Budget& = Budget());
 
     public:
+      /// @brief Initializes the papi library, if it was not initialized in this process
+      /// (or in the one it was forked from) yet.
+      static void initialize();
+
       /// @brief Counts specific events detailed by the user.
       static std::pair<int, CounterVector> countEvents(llvm::Module&, EventCodeVector);
       /// @brief Returns the total number of clocks.
@@ -52,9 +86,33 @@ namespace pinhao {
       /// @brief Returns the total number of clocks. For execution that requires
       /// arguments.
       static std::pair<int, LLong> getTotalCycles(llvm::Module&, ArgVector);
+      /// @brief Returns the total number of clocks, killing the run if it exceeds the
+      /// @a Budget.
+      static std::pair<int, LLong> getTotalCycles(llvm::Module&, ArgVector, const Budget&);
       /// @brief Returns the total number of instructions completed. For execution
       /// that requires arguments.
       static std::pair<int, LLong> getTotalInstructions(llvm::Module&, ArgVector);
+
+      /**
+       * @brief Runs the module repeatedly, until the confidence interval of the median
+       * number of clocks is tight enough (see @a measureRepeatedly). The exit status is
+       * the one of the run that failed, if any.
+       *
+       * @details
+       * It works as a fork server: a forked process JIT compiles the module once, and then
+       * forks a copy-on-write child for each run. So, each new sample costs only the
+       * execution of the module.
+       */
+      static std::pair<int, RobustEstimate> getTotalCyclesRepeatedly(llvm::Module&, ArgVector,
+          const RepetitionPolicy& = RepetitionPolicy(), const Budget& = Budget());
+      /// @brief Applies @a Transform (e.g.: an optimization sequence) to the module, and
+      /// measures it like @a getTotalCyclesRepeatedly, all in the same forked process. Only
+      /// the samples come back, and the module in this process is left untouched. If
+      /// @a Fingerprint is not null, it gets the hash of the transformed module (see
+      /// @a MeasurementDatabase::hashModule).
+      static std::pair<int, RobustEstimate> getTotalCyclesRepeatedly(llvm::Module&, ModuleTransform,
+          ArgVector, const RepetitionPolicy& = RepetitionPolicy(), const Budget& = Budget(),
+          uint64_t *Fingerprint = nullptr);
   };
 
 }
@@ -0,0 +1,271 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file BinaryFeatureDump.h
+ */
+
+#ifndef PINHAO_BINARY_FEATURE_DUMP_H
+#define PINHAO_BINARY_FEATURE_DUMP_H
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace pinhao {
+
+  template <class Type> class VectorFeature;
+  template <class KType, class VType> class MapFeature;
+  template <class KType, class VType> class MapVectorFeature;
+
+  /**
+   * @brief The type of the values of a column in a feature dump.
+   */
+  enum class ColumnType : uint8_t {
+    None,
+    UInt64,
+    Int,
+    Double,
+    Bool,
+    Pointer,
+    String
+  };
+
+  /// @brief Gets the @a ColumnType of the values of type @a T.
+  template <class T> ColumnType getColumnType();
+
+  template <> inline ColumnType getColumnType<uint64_t>() { return ColumnType::UInt64; }
+  template <> inline ColumnType getColumnType<int>() { return ColumnType::Int; }
+  template <> inline ColumnType getColumnType<double>() { return ColumnType::Double; }
+  template <> inline ColumnType getColumnType<bool>() { return ColumnType::Bool; }
+  template <> inline ColumnType getColumnType<void*>() { return ColumnType::Pointer; }
+  template <> inline ColumnType getColumnType<std::string>() { return ColumnType::String; }
+
+  /**
+   * @brief A file with the values of some features, stored by columns, which is mapped
+   * in memory.
+   *
+   * @details
+   * The file is a sequence of sections, one for each feature. A section starts with a
+   * header: its layout (a vector, a map, or a map of vectors), the types of its keys and
+   * values, the name of the feature and the names of its columns (the sub-features). Then
+   * come blocks of rows, each starting with its number of rows, followed by the column of
+   * keys (if it has keys) and by the column of each sub-feature. A block without rows ends
+   * the section. The values of fixed width are stored as they are; the strings are stored
+   * as the offsets of their ends, followed by their characters. Every column is padded to
+   * 8 bytes, so the values can be read in place. Everything is in the byte order of the host.
+   *
+   * The YAML (see @a print) is there only to look at the dumps.
+   */
+  class BinaryFeatureDump {
+    public:
+      enum class Layout : uint8_t {
+        Vector,   ///< One row, and no keys.
+        Map,      ///< One value (the feature itself) by key.
+        MapVector ///< One value of each sub-feature by key.
+      };
+
+      struct Block {
+        uint64_t Rows;
+        /// @brief Where the keys start, if there are keys.
+        const char *Keys;
+        /// @brief Where each column starts.
+        std::vector<const char*> Columns;
+      };
+
+      struct Section {
+        std::string Name;
+        Layout TheLayout;
+        ColumnType KeyType;
+        ColumnType ValueType;
+        std::vector<std::string> Columns;
+        std::vector<Block> Blocks;
+
+        /// @brief Gets the position of the column @a Name, or the number of columns
+        /// if there is none.
+        uint64_t getColumn(std::string Name) const;
+        /// @brief Gets the number of rows of all blocks.
+        uint64_t getRows() const;
+      };
+
+    private:
+      int Fd;
+      const char *Data;
+      uint64_t Length;
+      std::vector<Section> Sections;
+
+      /// @brief Reads the sections of the file mapped.
+      bool parse();
+
+      /// @brief Checks that @a S has the @a Expected layout and types.
+      static bool check(const Section *S, Layout Expected, ColumnType Key, ColumnType Value);
+
+    public:
+      BinaryFeatureDump();
+      ~BinaryFeatureDump();
+
+      BinaryFeatureDump(const BinaryFeatureDump&) = delete;
+      BinaryFeatureDump &operator=(const BinaryFeatureDump&) = delete;
+
+      /// @brief Maps @a Filename in memory, closing the file mapped before.
+      /// @return False if it could not be mapped, or it is not a valid feature dump.
+      bool open(std::string Filename);
+      /// @brief Unmaps the file, if there is one.
+      void close();
+      bool isOpen() const;
+
+      /// @brief Gets the number of sections.
+      uint64_t size() const;
+      /// @brief Gets the @a Nth section.
+      const Section &getSection(uint64_t N) const;
+      /// @brief Gets the last section of the feature @a Name, or null if there is none.
+      const Section *find(std::string Name) const;
+
+      /// @brief Gets the value in the @a Row of a column which starts at @a Column.
+      template <class T>
+        static T getValue(const Block &B, const char *Column, uint64_t Row);
+
+      /// @brief Fills @a Vf with the values of its section.
+      /// @return False if there is no such section, or it has other types.
+      template <class Type>
+        bool fill(VectorFeature<Type> &Vf) const;
+      /// @brief Fills @a Mf with the values of its section.
+      template <class KType, class VType>
+        bool fill(MapFeature<KType, VType> &Mf) const;
+      /// @brief Fills @a Mvf with the values of its section.
+      template <class KType, class VType>
+        bool fill(MapVectorFeature<KType, VType> &Mvf) const;
+      /// @brief Fills @a Map with the values of the section @a Name, written by
+      /// @a BinaryFeatureWriter::appendMap.
+      template <class KType, class VType>
+        bool fillMap(std::string Name, std::map<KType, VType> &Map) const;
+
+      /// @brief Prints every section in YAML, like the features print themselves.
+      void print(std::ostream &Out = std::cout) const;
+
+      /// @brief Returns true if @a Filename starts as a feature dump.
+      static bool isBinary(std::string Filename);
+  };
+
+  /**
+   * @brief Writes the features as a @a BinaryFeatureDump, in a stream.
+   *
+   * @details
+   * Only @a BlockRows rows are kept in memory, so that the big features can be written
+   * while they are read (through their key iterators).
+   */
+  class BinaryFeatureWriter {
+    private:
+      std::ostream &Out;
+      uint64_t BlockRows;
+      uint64_t Written;
+
+      /// @brief The types of the section that is being written.
+      ColumnType KeyType;
+      ColumnType ValueType;
+      /// @brief The columns of the block that is being written. The strings are kept
+      /// with their sizes until the block is written.
+      std::vector<std::string> Columns;
+      std::string Keys;
+      uint64_t Rows;
+
+      /// @brief Writes a @a Column of @a Rows values of type @a Type, padded.
+      void writeColumn(const std::string &Column, ColumnType Type);
+
+      void write(const std::string &Bytes);
+
+      /// @brief Writes the header of a section.
+      void beginSection(std::string Name, BinaryFeatureDump::Layout TheLayout, ColumnType KeyType,
+          ColumnType ValueType, const std::vector<std::string> &ColumnNames);
+      /// @brief Writes the block that is being written, if it has rows.
+      void flush();
+      /// @brief Writes the last block of the section.
+      void endSection();
+
+      template <class T>
+        static void put(std::string &Column, const T &Value);
+
+      template <class KType>
+        void addKey(const KType &Key);
+      template <class VType>
+        void addValue(uint64_t Column, const VType &Value);
+      /// @brief Ends the row, writing the block if it is full.
+      void endRow();
+
+    public:
+      BinaryFeatureWriter(std::ostream &Out, uint64_t BlockRows = 4096);
+
+      BinaryFeatureWriter(const BinaryFeatureWriter&) = delete;
+      BinaryFeatureWriter &operator=(const BinaryFeatureWriter&) = delete;
+
+      template <class Type>
+        void append(const VectorFeature<Type> &Vf);
+      template <class KType, class VType>
+        void append(const MapFeature<KType, VType> &Mf);
+      template <class KType, class VType>
+        void append(const MapVectorFeature<KType, VType> &Mvf);
+
+      /// @brief Appends @a Map as a section @a Name with a single column.
+      template <class KType, class VType>
+        void appendMap(std::string Name, const std::map<KType, VType> &Map);
+
+      /// @brief Gets the number of bytes written.
+      uint64_t size() const;
+      /// @brief Returns false if the stream failed.
+      bool good() const;
+  };
+
+  template <> std::string BinaryFeatureDump::getValue<std::string>(const Block &B, const char *Column, uint64_t Row);
+  template <> void BinaryFeatureWriter::put<std::string>(std::string &Column, const std::string &Value);
+
+}
+
+template <class T>
+T pinhao::BinaryFeatureDump::getValue(const Block &B, const char *Column, uint64_t Row) {
+  T Value;
+  std::memcpy(&Value, Column + Row * sizeof(T), sizeof(T));
+  return Value;
+}
+
+template <class T>
+void pinhao::BinaryFeatureWriter::put(std::string &Column, const T &Value) {
+  Column.append(reinterpret_cast<const char*>(&Value), sizeof(T));
+}
+
+template <class KType>
+void pinhao::BinaryFeatureWriter::addKey(const KType &Key) {
+  put(Keys, Key);
+}
+
+template <class VType>
+void pinhao::BinaryFeatureWriter::addValue(uint64_t Column, const VType &Value) {
+  put(Columns[Column], Value);
+}
+
+template <class KType, class VType>
+void pinhao::BinaryFeatureWriter::appendMap(std::string Name, const std::map<KType, VType> &Map) {
+  beginSection(Name, BinaryFeatureDump::Layout::Map, getColumnType<KType>(), getColumnType<VType>(),
+      std::vector<std::string>(1, Name));
+  for (auto &Pair : Map) {
+    addKey(Pair.first);
+    addValue(0, Pair.second);
+    endRow();
+  }
+  endSection();
+}
+
+template <class KType, class VType>
+bool pinhao::BinaryFeatureDump::fillMap(std::string Name, std::map<KType, VType> &Map) const {
+  const Section *S = find(Name);
+  if (!check(S, Layout::Map, getColumnType<KType>(), getColumnType<VType>())) return false;
+
+  for (auto &B : S->Blocks)
+    for (uint64_t Row = 0; Row < B.Rows; ++Row)
+      Map[getValue<KType>(B, B.Keys, Row)] = getValue<VType>(B, B.Columns[0], Row);
+  return true;
+}
+
+#endif
@@ -0,0 +1,120 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file FeatureBinaryWrapper.h
+ */
+
+#ifndef PINHAO_FEATURE_BINARY_WRAPPER_H
+#define PINHAO_FEATURE_BINARY_WRAPPER_H
+
+#include "pinhao/Support/BinaryFeatureDump.h"
+
+#include "pinhao/Features/VectorFeature.h"
+#include "pinhao/Features/MapFeature.h"
+#include "pinhao/Features/MapVectorFeature.h"
+
+using namespace pinhao;
+
+/*
+ * -----------------------------------
+ *  Overloading for: VectorFeature
+ */
+template <class Type>
+void pinhao::BinaryFeatureWriter::append(const VectorFeature<Type> &Vf) {
+  std::vector<std::string> Names;
+  for (auto &InfoPair : Vf)
+    Names.push_back(InfoPair.first);
+
+  beginSection(Vf.getName(), BinaryFeatureDump::Layout::Vector, ColumnType::None,
+      getColumnType<Type>(), Names);
+  for (uint64_t N = 0; N < Names.size(); ++N)
+    addValue(N, Vf.getValueOf(Names[N]));
+  endRow();
+  endSection();
+}
+
+template <class Type>
+bool pinhao::BinaryFeatureDump::fill(VectorFeature<Type> &Vf) const {
+  const Section *S = find(Vf.getName());
+  if (!check(S, Layout::Vector, ColumnType::None, getColumnType<Type>())) return false;
+
+  for (auto &B : S->Blocks)
+    for (uint64_t N = 0; N < S->Columns.size(); ++N)
+      if (Vf.hasSubFeature(S->Columns[N]))
+        Vf.setValueOf(S->Columns[N], getValue<Type>(B, B.Columns[N], B.Rows - 1));
+  return true;
+}
+
+/*
+ * -----------------------------------
+ *  Overloading for: MapFeature<KType, VType>
+ */
+template <class KType, class VType>
+void pinhao::BinaryFeatureWriter::append(const MapFeature<KType, VType> &Mf) {
+  beginSection(Mf.getName(), BinaryFeatureDump::Layout::Map, getColumnType<KType>(),
+      getColumnType<VType>(), std::vector<std::string>(1, Mf.getName()));
+
+  MapFeature<KType, VType> &MfCast = const_cast<MapFeature<KType, VType>&>(Mf);
+  for (auto &I = MfCast.beginKeys(), &Iend = MfCast.endKeys(); I != Iend; ++I) {
+    addKey(*I);
+    addValue(0, Mf.getValueOfKey(Mf.getName(), *I));
+    endRow();
+  }
+  endSection();
+}
+
+template <class KType, class VType>
+bool pinhao::BinaryFeatureDump::fill(MapFeature<KType, VType> &Mf) const {
+  const Section *S = find(Mf.getName());
+  if (!check(S, Layout::Map, getColumnType<KType>(), getColumnType<VType>())) return false;
+
+  for (auto &B : S->Blocks)
+    for (uint64_t Row = 0; Row < B.Rows; ++Row)
+      Mf.setValueOfKey(Mf.getName(), getValue<VType>(B, B.Columns[0], Row), getValue<KType>(B, B.Keys, Row));
+  return true;
+}
+
+/*
+ * -----------------------------------
+ *  Overloading for: MapVectorFeature
+ */
+template <class KType, class VType>
+void pinhao::BinaryFeatureWriter::append(const MapVectorFeature<KType, VType> &Mvf) {
+  std::vector<std::string> Names;
+  for (auto &InfoPair : Mvf)
+    Names.push_back(InfoPair.first);
+
+  beginSection(Mvf.getName(), BinaryFeatureDump::Layout::MapVector, getColumnType<KType>(),
+      getColumnType<VType>(), Names);
+
+  MapVectorFeature<KType, VType> &MvfCast = const_cast<MapVectorFeature<KType, VType>&>(Mvf);
+  for (auto &I = MvfCast.beginKeys(), &Iend = MvfCast.endKeys(); I != Iend; ++I) {
+    addKey(*I);
+    for (uint64_t N = 0; N < Names.size(); ++N)
+      addValue(N, Mvf.getValueOfKey(Names[N], *I));
+    endRow();
+  }
+  endSection();
+}
+
+template <class KType, class VType>
+bool pinhao::BinaryFeatureDump::fill(MapVectorFeature<KType, VType> &Mvf) const {
+  const Section *S = find(Mvf.getName());
+  if (!check(S, Layout::MapVector, getColumnType<KType>(), getColumnType<VType>())) return false;
+
+  // The columns that this feature does not have (anymore) are skipped.
+  std::vector<uint64_t> Known;
+  for (uint64_t N = 0; N < S->Columns.size(); ++N)
+    if (Mvf.hasSubFeature(S->Columns[N])) Known.push_back(N);
+
+  for (auto &B : S->Blocks) {
+    for (uint64_t Row = 0; Row < B.Rows; ++Row) {
+      KType Key = getValue<KType>(B, B.Keys, Row);
+      for (auto N : Known)
+        Mvf.setValueOfKey(S->Columns[N], getValue<VType>(B, B.Columns[N], Row), Key);
+    }
+  }
+  return true;
+}
+
+#endif
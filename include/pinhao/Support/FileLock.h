@@ -0,0 +1,42 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file FileLock.h
+ * @brief An advisory lock on a file, shared by the processes that update it.
+ */
+
+#ifndef PINHAO_FILE_LOCK_H
+#define PINHAO_FILE_LOCK_H
+
+#include <string>
+
+namespace pinhao {
+
+  /**
+   * @brief Holds an exclusive (flock) lock on a file while it lives.
+   *
+   * @details
+   * The lock is advisory: it only excludes the processes that lock the same file. The
+   * file is created if it does not exist, and it is never removed, since another process
+   * may be waiting for it.
+   */
+  class FileLock {
+    private:
+      int Fd;
+
+    public:
+      /// @brief Locks @a Filename, waiting for the process that holds it, unless @a Wait
+      /// is false.
+      FileLock(std::string Filename, bool Wait = true);
+      ~FileLock();
+
+      FileLock(const FileLock&) = delete;
+      FileLock &operator=(const FileLock&) = delete;
+
+      /// @brief Returns false if the lock could not be taken.
+      bool isLocked() const;
+  };
+
+}
+
+#endif
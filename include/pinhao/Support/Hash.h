@@ -0,0 +1,31 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file Hash.h
+ * @brief Non-cryptographic hashing (64-bit FNV-1a), stable across runs and hosts.
+ */
+
+#ifndef PINHAO_HASH_H
+#define PINHAO_HASH_H
+
+#include <string>
+#include <cstdint>
+
+namespace pinhao {
+
+  const uint64_t FNVOffsetBasis = 14695981039346656037ULL;
+  const uint64_t FNVPrime = 1099511628211ULL;
+
+  /// @brief Hashes @a Size bytes of @a Data, starting from @a Hash.
+  uint64_t hashBytes(const void *Data, uint64_t Size, uint64_t Hash = FNVOffsetBasis);
+  /// @brief Hashes the characters of @a Str, starting from @a Hash.
+  uint64_t hashString(const std::string &Str, uint64_t Hash = FNVOffsetBasis);
+  /// @brief Mixes @a Value into @a Seed.
+  uint64_t combineHashes(uint64_t Seed, uint64_t Value);
+
+  /// @brief Gets the 16 hexadecimal digits of @a Hash.
+  std::string toHexString(uint64_t Hash);
+
+}
+
+#endif
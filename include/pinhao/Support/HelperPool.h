@@ -0,0 +1,109 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file HelperPool.h
+ */
+
+#ifndef PINHAO_HELPER_POOL_H
+#define PINHAO_HELPER_POOL_H
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+
+#include <sys/types.h>
+
+namespace pinhao {
+
+  /**
+   * @brief Keeps @a Helpers long-lived processes, which serve requests sent through pipes.
+   *
+   * @details
+   * The helpers are forked when the pool is created, so they see the memory of the
+   * parent as it was at that moment. Each one calls the @a Initializer once, and then
+   * answers each request with the result of the @a Handler, until the pool is destroyed.
+   * This way, costly initializations are not repeated for each request.
+   *
+   * If a helper dies while serving a request, or takes more than @a Timeout seconds to
+   * answer it (if it is not zero), the request fails, and a new helper is forked in its
+   * place. Only the process which created the pool may use it.
+   */
+  class HelperPool {
+    public:
+      typedef std::function<std::string(const std::string&)> Handler;
+      typedef std::function<void()> Initializer;
+
+      struct Result {
+        uint64_t Id;
+        /// @brief False if the helper died (or was killed) before answering.
+        bool Ok;
+        std::string Reply;
+      };
+
+    private:
+      struct Helper {
+        pid_t Pid;
+        /// @brief Where the requests are written to.
+        int In;
+        /// @brief Where the replies are read from.
+        int Out;
+        bool Busy;
+        uint64_t Id;
+        /// @brief When the request being served was sent.
+        std::chrono::steady_clock::time_point Start;
+      };
+
+      Handler Serve;
+      Initializer Init;
+      pid_t Owner;
+      double Timeout;
+      uint64_t NextId;
+      uint64_t Restarts;
+
+      std::vector<Helper> Helpers;
+      std::deque<Result> Finished;
+
+      /// @brief Forks a helper process into @a H.
+      bool spawn(Helper &H);
+      /// @brief Closes the pipes of @a H and reaps its process.
+      void shutdown(Helper &H);
+      /// @brief Replaces a helper that died.
+      void restart(Helper &H);
+      /// @brief The loop executed by the helper processes.
+      void serve(int In, int Out);
+
+      /// @brief Reads the reply of the busy helper @a H.
+      Result collect(Helper &H);
+      /// @brief Fails the request of the busy helper @a H, which is replaced.
+      Result expire(Helper &H);
+      /// @brief Waits for any busy helper to answer.
+      Result waitBusy();
+
+    public:
+      HelperPool(unsigned Helpers, Handler Serve, Initializer Init = nullptr, double Timeout = 0);
+      ~HelperPool();
+
+      /// @brief Gets the number of helpers.
+      unsigned getNumberOfHelpers() const;
+      /// @brief Gets how many times a helper had to be replaced.
+      uint64_t getNumberOfRestarts() const;
+
+      /// @brief Sends @a Request to an idle helper, waiting for one if needed. The replies
+      /// received while waiting are kept until @a wait is called.
+      /// @return The identifier of the request.
+      uint64_t submit(const std::string &Request);
+
+      /// @brief Waits for the reply of any submitted request.
+      Result wait();
+
+      /// @brief Sends all @a Requests, and returns their results in the same order.
+      std::vector<Result> map(const std::vector<std::string> &Requests);
+
+  };
+
+}
+
+#endif
@@ -0,0 +1,37 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file IPC.h
+ * @brief Helpers for exchanging data between processes through file descriptors.
+ */
+
+#ifndef PINHAO_IPC_H
+#define PINHAO_IPC_H
+
+#include <string>
+#include <cstdint>
+
+namespace pinhao {
+
+  /// @brief Writes all @a Size bytes of @a Buffer to @a Fd, retrying on interruptions.
+  /// SIGPIPE is blocked in the calling thread meanwhile, so a reader that is gone makes
+  /// it fail instead of killing the process.
+  /// @return False if it could not write everything.
+  bool writeAll(int Fd, const void *Buffer, uint64_t Size);
+  /// @brief Reads exactly @a Size bytes from @a Fd into @a Buffer, retrying on interruptions.
+  /// @return False if the file ended or an error happened before that.
+  bool readAll(int Fd, void *Buffer, uint64_t Size);
+
+  /// @brief Writes a length-prefixed message to @a Fd.
+  bool writeMessage(int Fd, const std::string &Message);
+  /// @brief Largest message @a readMessage accepts unless told otherwise.
+  const uint64_t MaxMessageSize = UINT64_C(1) << 30;
+
+  /// @brief Reads a message written by @a writeMessage from @a Fd. The memory grows with
+  /// the bytes actually received, so a bogus length can not exhaust it.
+  /// @return False if the message is longer than @a MaxSize or could not be read whole.
+  bool readMessage(int Fd, std::string &Message, uint64_t MaxSize = MaxMessageSize);
+
+}
+
+#endif
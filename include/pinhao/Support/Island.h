@@ -0,0 +1,70 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file Island.h
+ */
+
+#ifndef PINHAO_ISLAND_H
+#define PINHAO_ISLAND_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace pinhao {
+
+  /**
+   * @brief One of several processes that evolve their own populations, and exchange
+   * their best individuals from time to time (the island model).
+   *
+   * @details
+   * Each island listens on its own address (see Socket.h), so they may be processes
+   * in the same host, or in different machines. In each migration, an island sends its
+   * emigrants to its destinations, and waits for the emigrants of its sources. An island
+   * that does not answer within the timeout is skipped for that migration.
+   */
+  class Island {
+    public:
+      enum class Topology {
+        /// @brief Each island sends to the next one.
+        Ring,
+        /// @brief Each island sends to all the others.
+        Complete
+      };
+
+      /// @brief Gets the topology named @a Name ("ring" or "complete").
+      static Topology getTopology(const std::string &Name);
+
+      /// @brief Largest migration accepted from a source, in bytes.
+      static const uint64_t MaxMigrationSize = UINT64_C(64) << 20;
+
+    private:
+      unsigned Id;
+      std::vector<std::string> Addresses;
+      Topology Kind;
+      double Timeout;
+      int Socket;
+      uint64_t Round;
+
+    public:
+      /// @brief Creates the island @a Id, which listens on @a Addresses[Id].
+      Island(unsigned Id, std::vector<std::string> Addresses, Topology Kind = Topology::Ring,
+          double Timeout = 60);
+      ~Island();
+
+      unsigned getId() const;
+      unsigned getNumberOfIslands() const;
+
+      /// @brief Gets the islands that this one sends its emigrants to.
+      std::vector<unsigned> getDestinations() const;
+      /// @brief Gets the islands that this one receives emigrants from.
+      std::vector<unsigned> getSources() const;
+
+      /// @brief Sends @a Emigrants to the destinations.
+      /// @return The emigrants received from the sources.
+      std::vector<std::string> migrate(const std::string &Emigrants);
+  };
+
+}
+
+#endif
@@ -0,0 +1,36 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file Pareto.h
+ * @brief Non-dominated sorting of points with several objectives, all of them minimized.
+ */
+
+#ifndef PINHAO_PARETO_H
+#define PINHAO_PARETO_H
+
+#include <cstdint>
+#include <vector>
+
+namespace pinhao {
+
+  /// @brief Returns true if @a Lhs is no worse than @a Rhs in every objective, and better
+  /// in at least one. Both must have the same number of objectives.
+  bool dominates(const std::vector<double> &Lhs, const std::vector<double> &Rhs);
+
+  /// @brief Sorts the indexes of @a Points into fronts: the first one has the points that
+  /// no other dominates, the second has the ones dominated only by the first, and so on.
+  std::vector<std::vector<uint64_t>> getParetoFronts(const std::vector<std::vector<double>> &Points);
+
+  /// @brief Gets the crowding distance of each point of @a Front, in the same order: the
+  /// sum, over the objectives, of the normalized distance between its two neighbours. The
+  /// points at the extremes of any objective get infinity.
+  std::vector<double> getCrowdingDistances(const std::vector<std::vector<double>> &Points,
+      const std::vector<uint64_t> &Front);
+
+  /// @brief Orders the indexes of @a Points by front, and inside each front by decreasing
+  /// crowding distance (as in NSGA-II), so that the first N are the ones selected.
+  std::vector<uint64_t> getParetoOrder(const std::vector<std::vector<double>> &Points);
+
+}
+
+#endif
@@ -29,6 +29,8 @@ namespace pinhao {
       int getInt(int, int);
       /// @brief Returns a random generated @a double between 0.0 and 1.0.
       double getReal();
+      /// @brief Restarts the generator with the seed @a Seed.
+      void seed(unsigned Seed);
 
       /// @brief Returns a random generated @a int with the singleton reference.
       static int getRandomInt(int, int);
@@ -37,6 +39,10 @@ namespace pinhao {
       /// with the singleton reference.
       static double getRandomReal();
 
+      /// @brief Sets the seed of the singleton reference, so that the sequence of
+      /// generated numbers can be reproduced.
+      static void setSeed(unsigned Seed);
+
   };
 
 }
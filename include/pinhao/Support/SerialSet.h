@@ -11,7 +11,15 @@
 #include "pinhao/Support/SerialSetYAMLWrapper.h"
 
 #include <set>
+#include <unordered_map>
 #include <fstream>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
 
 namespace pinhao {
 
@@ -20,17 +28,99 @@ namespace pinhao {
    * @details
    * Its main members are @a importData and @a exportData. They manipulate the
    * data inside files by calling the YAMLWrapper methods.
+   *
+   * The elements are also indexed in the order of @a RankType (by default, the order
+   * of the set), in an order-statistic tree of pointers to them, so that the @a Nth
+   * element in that order is found in logarithmic time. The 'std::set' is inherited
+   * privately, so the elements are only inserted and erased by the members of this class,
+   * which keep the indexes up to date (@a RankType must be a strict total order, as
+   * @a CompareType). The rest of the 'std::set' is read only, through @a getSet.
+   *
+   * The elements are indexed by their 'std::hash' as well, so that @a find, @a count and
+   * @a has compare whole elements (by @a CompareType) only when their hashes are equal.
+   * The hash of an element must not change while it is in the set.
    */
-  template <class T, class CompareType = std::less<T>>
-    class SerialSet : public std::set<T, CompareType> {
+  template <class T, class CompareType = std::less<T>, class RankType = CompareType>
+    class SerialSet : private std::set<T, CompareType> {
+      private:
+        typedef std::set<T, CompareType> BaseSet;
+
+        struct CompareRank {
+          bool operator()(const T *Lhs, const T *Rhs) const {
+            return RankType()(*Lhs, *Rhs);
+          }
+        };
+
+        typedef __gnu_pbds::tree<const T*, __gnu_pbds::null_type, CompareRank,
+                __gnu_pbds::rb_tree_tag, __gnu_pbds::tree_order_statistics_node_update> RankIndex;
+
+        /// @brief The elements, in the order of @a RankType.
+        RankIndex Ranking;
+        /// @brief The elements, by their hashes.
+        std::unordered_multimap<size_t, typename BaseSet::const_iterator> Hashes;
+
+        /// @brief Builds the @a Ranking and the @a Hashes from scratch.
+        void reindex();
+
       public:
+        using typename BaseSet::key_type;
+        using typename BaseSet::value_type;
+        using typename BaseSet::size_type;
+        using typename BaseSet::difference_type;
+        using typename BaseSet::key_compare;
+        using typename BaseSet::value_compare;
+        using typename BaseSet::reference;
+        using typename BaseSet::const_reference;
+        using typename BaseSet::iterator;
+        using typename BaseSet::const_iterator;
+        using typename BaseSet::reverse_iterator;
+        using typename BaseSet::const_reverse_iterator;
+
+        using BaseSet::begin;
+        using BaseSet::end;
+        using BaseSet::cbegin;
+        using BaseSet::cend;
+        using BaseSet::rbegin;
+        using BaseSet::rend;
+        using BaseSet::crbegin;
+        using BaseSet::crend;
+        using BaseSet::size;
+        using BaseSet::empty;
+        using BaseSet::key_comp;
+        using BaseSet::value_comp;
+
+        SerialSet() {}
+        SerialSet(const SerialSet&);
+        SerialSet(SerialSet&&);
+        SerialSet &operator=(const SerialSet&);
+        SerialSet &operator=(SerialSet&&);
+
+        std::pair<iterator, bool> insert(const T &Value);
+        /// @brief Inserts @a Value, which belongs right before @a Hint.
+        iterator insert(const_iterator Hint, const T &Value);
+        iterator erase(const_iterator It);
+        uint64_t erase(const T &Value);
+        void clear();
+
+        /// @brief Finds @a Value by its hash.
+        const_iterator find(const T &Value) const;
+        uint64_t count(const T &Value) const;
+
         /// @brief Returns true if this @a KnowledgeBase has the element.
         bool has(T) const;
-        /// @brief Gets the @a Nth element of the set.
+        /// @brief Gets the @a Nth element of the set, in the order of @a RankType.
         T get(uint64_t) const;
+        /// @brief Gets the (up to) @a N first elements, in the order of @a RankType.
+        std::vector<T> getFirst(uint64_t N) const;
         /// @brief Updates @a Value, if exists. Else, it inserts the element.
         void update(const T Value);
 
+        /// @brief Gets the elements as a read-only 'std::set'.
+        const BaseSet &getSet() const;
+
+        bool operator==(const SerialSet &Other) const;
+        bool operator!=(const SerialSet &Other) const;
+
         /// @brief Prints the data of this @a SerialSet in an @a std::ostream.
         void print(std::ostream& = std::cout) const;
 
@@ -38,27 +128,156 @@ namespace pinhao {
 
 }
 
-template <class T, class CompareType>
-bool pinhao::SerialSet<T, CompareType>::has(const T Value) const {
+template <class T, class CompareType, class RankType>
+void pinhao::SerialSet<T, CompareType, RankType>::reindex() {
+  Ranking.clear();
+  Hashes.clear();
+  for (auto I = this->cbegin(), E = this->cend(); I != E; ++I) {
+    Ranking.insert(&*I);
+    Hashes.insert(std::make_pair(std::hash<T>()(*I), I));
+  }
+}
+
+template <class T, class CompareType, class RankType>
+pinhao::SerialSet<T, CompareType, RankType>::SerialSet(const SerialSet &Other) : BaseSet(Other) {
+  reindex();
+}
+
+template <class T, class CompareType, class RankType>
+pinhao::SerialSet<T, CompareType, RankType>::SerialSet(SerialSet &&Other) : BaseSet(std::move(Other)) {
+  reindex();
+  Other.clear();
+}
+
+template <class T, class CompareType, class RankType>
+pinhao::SerialSet<T, CompareType, RankType> &
+pinhao::SerialSet<T, CompareType, RankType>::operator=(const SerialSet &Other) {
+  BaseSet::operator=(Other);
+  reindex();
+  return *this;
+}
+
+template <class T, class CompareType, class RankType>
+pinhao::SerialSet<T, CompareType, RankType> &
+pinhao::SerialSet<T, CompareType, RankType>::operator=(SerialSet &&Other) {
+  BaseSet::operator=(std::move(Other));
+  reindex();
+  Other.clear();
+  return *this;
+}
+
+template <class T, class CompareType, class RankType>
+std::pair<typename pinhao::SerialSet<T, CompareType, RankType>::iterator, bool>
+pinhao::SerialSet<T, CompareType, RankType>::insert(const T &Value) {
+  auto Inserted = BaseSet::insert(Value);
+  if (Inserted.second) {
+    Ranking.insert(&*Inserted.first);
+    Hashes.insert(std::make_pair(std::hash<T>()(Value), Inserted.first));
+  }
+  return Inserted;
+}
+
+template <class T, class CompareType, class RankType>
+typename pinhao::SerialSet<T, CompareType, RankType>::iterator
+pinhao::SerialSet<T, CompareType, RankType>::insert(const_iterator Hint, const T &Value) {
+  uint64_t Size = this->size();
+  auto It = BaseSet::insert(Hint, Value);
+  if (this->size() != Size) {
+    Ranking.insert(&*It);
+    Hashes.insert(std::make_pair(std::hash<T>()(Value), It));
+  }
+  return It;
+}
+
+template <class T, class CompareType, class RankType>
+typename pinhao::SerialSet<T, CompareType, RankType>::iterator
+pinhao::SerialSet<T, CompareType, RankType>::erase(const_iterator It) {
+  Ranking.erase(&*It);
+  auto Range = Hashes.equal_range(std::hash<T>()(*It));
+  for (auto I = Range.first; I != Range.second; ++I) {
+    if (I->second == It) {
+      Hashes.erase(I);
+      break;
+    }
+  }
+  return BaseSet::erase(It);
+}
+
+template <class T, class CompareType, class RankType>
+uint64_t pinhao::SerialSet<T, CompareType, RankType>::erase(const T &Value) {
+  auto It = this->find(Value);
+  if (It == this->end()) return 0;
+  erase(It);
+  return 1;
+}
+
+template <class T, class CompareType, class RankType>
+void pinhao::SerialSet<T, CompareType, RankType>::clear() {
+  Ranking.clear();
+  Hashes.clear();
+  BaseSet::clear();
+}
+
+template <class T, class CompareType, class RankType>
+typename pinhao::SerialSet<T, CompareType, RankType>::const_iterator
+pinhao::SerialSet<T, CompareType, RankType>::find(const T &Value) const {
+  CompareType Compare;
+  auto Range = Hashes.equal_range(std::hash<T>()(Value));
+  for (auto I = Range.first; I != Range.second; ++I)
+    if (!Compare(*I->second, Value) && !Compare(Value, *I->second))
+      return I->second;
+  return this->cend();
+}
+
+template <class T, class CompareType, class RankType>
+uint64_t pinhao::SerialSet<T, CompareType, RankType>::count(const T &Value) const {
+  return find(Value) != this->cend() ? 1 : 0;
+}
+
+template <class T, class CompareType, class RankType>
+bool pinhao::SerialSet<T, CompareType, RankType>::has(const T Value) const {
   return this->count(Value) > 0;
 }
 
-template <class T, class CompareType>
-T pinhao::SerialSet<T, CompareType>::get(uint64_t N) const {
+template <class T, class CompareType, class RankType>
+T pinhao::SerialSet<T, CompareType, RankType>::get(uint64_t N) const {
   assert(this->size() > N && "Out of SerialSet bounds.");
-  for (auto &Value : *this) {
-    if (!N--) return Value;
-  }
+  return **Ranking.find_by_order(N);
+}
+
+template <class T, class CompareType, class RankType>
+std::vector<T> pinhao::SerialSet<T, CompareType, RankType>::getFirst(uint64_t N) const {
+  std::vector<T> First;
+  for (auto I = Ranking.begin(), E = Ranking.end(); I != E && First.size() < N; ++I)
+    First.push_back(**I);
+  return First;
+}
+
+template <class T, class CompareType, class RankType>
+void pinhao::SerialSet<T, CompareType, RankType>::update(const T Value) {
+  // The value goes back where the old one was, so it is found only once.
+  auto It = this->find(Value);
+  if (It != this->end()) It = erase(It);
+  insert(It, Value);
+}
+
+template <class T, class CompareType, class RankType>
+const std::set<T, CompareType> &pinhao::SerialSet<T, CompareType, RankType>::getSet() const {
+  return *this;
+}
+
+template <class T, class CompareType, class RankType>
+bool pinhao::SerialSet<T, CompareType, RankType>::operator==(const SerialSet &Other) const {
+  return getSet() == Other.getSet();
 }
 
-template <class T, class CompareType>
-void pinhao::SerialSet<T, CompareType>::update(const T Value) {
-  if (has(Value)) this->erase(Value);
-  this->insert(Value);
+template <class T, class CompareType, class RankType>
+bool pinhao::SerialSet<T, CompareType, RankType>::operator!=(const SerialSet &Other) const {
+  return !(*this == Other);
 }
 
-template <class T, class CompareType>
-void pinhao::SerialSet<T, CompareType>::print(std::ostream &Out) const {
+template <class T, class CompareType, class RankType>
+void pinhao::SerialSet<T, CompareType, RankType>::print(std::ostream &Out) const {
   YAMLWrapper::print(*this, Out);
 }
 
@@ -7,8 +7,8 @@
 #ifndef PINHAO_KNOWLEDGE_BASE_YAML_WRAPPER_H
 #define PINHAO_KNOWLEDGE_BASE_YAML_WRAPPER_H
 
-template <class T, class U>
-void pinhao::YAMLWrapper::fill(SerialSet<T, U> &Value, ConstNode &Node) {
+template <class T, class U, class V>
+void pinhao::YAMLWrapper::fill(SerialSet<T, U, V> &Value, ConstNode &Node) {
   for (auto I = Node.begin(), E = Node.end(); I != E; ++I) {
     T Data;
     YAMLWrapper::fill(Data, *I);
@@ -16,8 +16,8 @@ void pinhao::YAMLWrapper::fill(SerialSet<T, U> &Value, ConstNode &Node) {
   }
 }
 
-template <class T, class U>
-void pinhao::YAMLWrapper::append(const SerialSet<T, U> &Value, Emitter &E) {
+template <class T, class U, class V>
+void pinhao::YAMLWrapper::append(const SerialSet<T, U, V> &Value, Emitter &E) {
   E << YAML::BeginSeq;
   for (auto &Data : Value)
     YAMLWrapper::append(Data, E); 
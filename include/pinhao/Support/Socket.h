@@ -0,0 +1,44 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file Socket.h
+ * @brief Helpers for connecting processes through Unix or TCP sockets.
+ *
+ * @details
+ * An address is either "unix:<path>", or "tcp:<host>:<port>". An address without a
+ * prefix is taken as the path of a Unix socket. Once connected, the data is exchanged
+ * with the functions of IPC.h.
+ */
+
+#ifndef PINHAO_SOCKET_H
+#define PINHAO_SOCKET_H
+
+#include <string>
+
+namespace pinhao {
+
+  /// @brief Creates a socket that listens on @a Address. A Unix socket left by a previous
+  /// run is removed first.
+  /// @return The socket, or -1 if it failed.
+  int listenOn(const std::string &Address);
+
+  /// @brief Connects to @a Address, retrying until it is listening, for at most @a Timeout
+  /// seconds.
+  /// @return The connected socket, or -1 if it failed.
+  int connectTo(const std::string &Address, double Timeout);
+
+  /// @brief Waits at most @a Timeout seconds for a connection on @a Socket.
+  /// @return The connected socket, or -1 if none came.
+  int acceptConnection(int Socket, double Timeout);
+
+  /// @brief Makes reads and writes on the connected @a Socket fail once they block for
+  /// more than @a Timeout seconds.
+  /// @return False if it could not be set.
+  bool setTimeout(int Socket, double Timeout);
+
+  /// @brief Closes @a Socket, removing its file if it is a Unix socket listening on @a Address.
+  void closeSocket(int Socket, const std::string &Address = "");
+
+}
+
+#endif
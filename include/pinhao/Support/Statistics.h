@@ -0,0 +1,99 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file Statistics.h
+ * @brief Robust statistics over samples of noisy measurements.
+ */
+
+#ifndef PINHAO_STATISTICS_H
+#define PINHAO_STATISTICS_H
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace pinhao {
+
+  /// @brief Gets the median of @a Samples.
+  double getMedian(std::vector<double> Samples);
+  /// @brief Gets the median absolute deviation (from the median) of @a Samples.
+  double getMAD(const std::vector<double> &Samples);
+
+  /// @brief Gets the @a P quantile of the standard normal distribution.
+  double getNormalQuantile(double P);
+  /// @brief Gets the @a P quantile of the Student's t distribution with @a Freedom
+  /// degrees of freedom.
+  double getStudentQuantile(double P, unsigned Freedom);
+
+  /**
+   * @brief Gets a confidence interval for the median of @a Samples.
+   *
+   * @details
+   * It is taken from the order statistics whose ranks are @a Confidence apart in the
+   * binomial distribution (approximated as normal), which is distribution-free. With few
+   * samples (at most 10, at 95%), those ranks are the minimum and the maximum, so it would
+   * never narrow; then, the interval is the median plus or minus the t quantile times the
+   * standard error of the median, assuming normal samples. With a single sample, it is
+   * unbounded.
+   */
+  std::pair<double, double> getMedianConfidenceInterval(std::vector<double> Samples, 
+      double Confidence = 0.95);
+
+  /// @brief Gets the rank of each value (starting at 1), where tied values get the mean
+  /// of their ranks.
+  std::vector<double> getRanks(const std::vector<double> &Values);
+  /// @brief Gets the Spearman rank correlation between @a X and @a Y, which must have the
+  /// same size. It is zero if either of them has all values equal.
+  double getSpearmanCorrelation(const std::vector<double> &X, const std::vector<double> &Y);
+
+  /**
+   * @brief A summary of repeated measurements.
+   */
+  struct RobustEstimate {
+    std::vector<double> Samples;
+    double Median;
+    double MAD;
+    /// @brief The confidence interval of the median.
+    double Lower;
+    double Upper;
+
+    RobustEstimate();
+    RobustEstimate(const std::vector<double> &Samples, double Confidence = 0.95);
+
+    /// @brief Gets the width of the confidence interval relative to the median.
+    double getRelativeWidth() const;
+  };
+
+  /**
+   * @brief How many times a measurement is repeated.
+   */
+  struct RepetitionPolicy {
+    unsigned MinSamples;
+    unsigned MaxSamples;
+    /// @brief Stops repeating when the relative width of the confidence interval of the
+    /// median is at most this.
+    double MaxRelativeWidth;
+    double Confidence;
+
+    RepetitionPolicy(unsigned MinSamples = 3, unsigned MaxSamples = 10, 
+        double MaxRelativeWidth = 0.02, double Confidence = 0.95) :
+      MinSamples(MinSamples), MaxSamples(MaxSamples), 
+      MaxRelativeWidth(MaxRelativeWidth), Confidence(Confidence) {}
+  };
+
+  /**
+   * @brief Takes samples with @a Sampler until the estimate is tight enough, according to
+   * @a Policy.
+   *
+   * @details
+   * @a Sampler stores a new sample in its argument, and returns false if it failed. In that
+   * case, the measurement stops.
+   *
+   * @return False if any sample failed.
+   */
+  bool measureRepeatedly(std::function<bool(double&)> Sampler, const RepetitionPolicy &Policy,
+      RobustEstimate &Estimate);
+
+}
+
+#endif
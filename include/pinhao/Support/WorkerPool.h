@@ -0,0 +1,85 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file WorkerPool.h
+ */
+
+#ifndef PINHAO_WORKER_POOL_H
+#define PINHAO_WORKER_POOL_H
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <cstdint>
+
+#include <sys/types.h>
+
+namespace pinhao {
+
+  /**
+   * @brief Executes tasks in forked worker processes, keeping at most @a Workers
+   * of them running at the same time.
+   *
+   * @details
+   * Each task is forked when it is submitted, so it sees the memory of the parent
+   * as it was at that moment, and sends its result (a vector of values, e.g.: the
+   * samples of a measurement) back through a pipe. If a worker dies before sending
+   * its result, the result is empty.
+   *
+   * With only one worker, the tasks are executed in the calling process, exactly as
+   * they would be without the pool.
+   */
+  class WorkerPool {
+    public:
+      typedef std::vector<double> Values;
+      typedef std::function<Values()> Task;
+      typedef std::pair<uint64_t, Values> Result;
+
+    private:
+      struct Worker {
+        uint64_t Id;
+        pid_t Pid;
+        int Fd;
+      };
+
+      unsigned MaxWorkers;
+      uint64_t NextId;
+
+      /// @brief The workers that are still running.
+      std::vector<Worker> Running;
+      /// @brief The results of the tasks executed in the calling process.
+      std::deque<Result> Finished;
+
+      /// @brief Reads the result of the @a Nth running worker, and reaps it.
+      Result collect(uint64_t N);
+      /// @brief Waits for any running worker to finish.
+      Result waitRunning();
+
+    public:
+      WorkerPool(unsigned Workers = 1);
+      ~WorkerPool();
+
+      /// @brief Gets the maximum number of workers running at the same time.
+      unsigned getNumberOfWorkers() const;
+      /// @brief Gets the number of tasks whose results were not taken yet.
+      uint64_t getNumberOfPending() const;
+      /// @brief Returns true if a task can be submitted without waiting.
+      bool hasIdleWorker() const;
+
+      /// @brief Starts the task @a T, waiting for a free worker if needed. The results of
+      /// the tasks finished while waiting are kept until @a wait is called.
+      /// @return The identifier of the task.
+      uint64_t submit(Task T);
+
+      /// @brief Waits for any submitted task to finish.
+      /// @return A pair with the identifier of the task and its result.
+      Result wait();
+
+      /// @brief Executes all @a Tasks, and returns their results in the same order.
+      std::vector<Values> map(std::vector<Task> Tasks);
+
+  };
+
+}
+
+#endif
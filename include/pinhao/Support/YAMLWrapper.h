@@ -40,7 +40,7 @@ namespace pinhao {
   template <class T> class LitFormula;
   template <class T> class FeatureFormula;
 
-  template <class T, class U> class SerialSet;
+  template <class T, class U, class V> class SerialSet;
 
   /**
    * @brief This class is a wrapper class for the yaml-cpp library.
@@ -113,8 +113,8 @@ namespace pinhao {
       template <class T> 
         static void fill(FeatureFormula<T> &Value, ConstNode &Node);
 
-      template <class T, class U> 
-        static void fill(SerialSet<T, U> &Value, ConstNode &Node);
+      template <class T, class U, class V> 
+        static void fill(SerialSet<T, U, V> &Value, ConstNode &Node);
 
       // append overloads.
       template <class T> 
@@ -137,8 +137,8 @@ namespace pinhao {
       template <class T> 
         static void append(const FeatureFormula<T> &Value, Emitter &E);
 
-      template <class T, class U> 
-        static void append(const SerialSet<T, U> &Value, Emitter &E);
+      template <class T, class U, class V> 
+        static void append(const SerialSet<T, U, V> &Value, Emitter &E);
   };
 
   template<> std::unique_ptr<FormulaBase> YAMLWrapper::get<FormulaBase>(ConstNode&);
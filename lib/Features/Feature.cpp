@@ -86,3 +86,11 @@ void Feature::print(std::ostream &Out) {
   append(Emitter);
   Out << std::endl;
 }
+
+bool Feature::write(BinaryFeatureWriter &Writer) const {
+  return false;
+}
+
+bool Feature::read(const BinaryFeatureDump &Dump) {
+  return false;
+}
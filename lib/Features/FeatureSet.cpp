@@ -17,6 +17,15 @@ using namespace llvm;
 
 std::map<std::string, std::map<std::string, bool>> FeatureSet::EnabledFeatures;
 
+FeatureSet::FeatureSet() {
+  static uint64_t NextId = 0;
+  Id = ++NextId;
+}
+
+uint64_t FeatureSet::getId() const {
+  return Id;
+}
+
 std::unique_ptr<FeatureSet> FeatureSet::get() {
   FeatureSet *Set = new FeatureSet();
   for (auto &Pair : EnabledFeatures) {
@@ -39,6 +39,9 @@ namespace {
       void append(YAML::Emitter &Emitter) const override;
       void get(const YAML::Node &Node) override;
 
+      bool write(BinaryFeatureWriter &Writer) const override;
+      bool read(const BinaryFeatureDump &Dump) override;
+
   };
 
 }
@@ -259,6 +262,34 @@ void CFGBasicBlockStaticFeatures::get(const YAML::Node &Node) {
   }
 }
 
+bool CFGBasicBlockStaticFeatures::write(BinaryFeatureWriter &Writer) const {
+  MapVectorFeature<void*, uint64_t>::write(Writer);
+
+  // The index is written as two more sections, with the same keys.
+  std::map<void*, std::string> Functions;
+  std::map<void*, uint64_t> Positions;
+  for (auto &OrderPair : this->Order) {
+    Functions[OrderPair.first] = OrderPair.second.first;
+    Positions[OrderPair.first] = OrderPair.second.second;
+  }
+  Writer.appendMap(this->getName() + ".index.function", Functions);
+  Writer.appendMap(this->getName() + ".index.position", Positions);
+  return true;
+}
+
+bool CFGBasicBlockStaticFeatures::read(const BinaryFeatureDump &Dump) {
+  std::map<void*, std::string> Functions;
+  std::map<void*, uint64_t> Positions;
+  if (!MapVectorFeature<void*, uint64_t>::read(Dump) ||
+      !Dump.fillMap(this->getName() + ".index.function", Functions) ||
+      !Dump.fillMap(this->getName() + ".index.position", Positions))
+    return false;
+
+  for (auto &FunctionPair : Functions)
+    this->Order[FunctionPair.first] = std::make_pair(FunctionPair.second, Positions[FunctionPair.first]);
+  return true;
+}
+
 void pinhao::initializeCFGBasicBlockStaticFeatures(void) {
   // This function should be called in order not to
   // get optimized out of the executable.
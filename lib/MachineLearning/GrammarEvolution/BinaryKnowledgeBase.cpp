@@ -0,0 +1,640 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file BinaryKnowledgeBase.cpp
+ */
+
+#include "pinhao/MachineLearning/GrammarEvolution/BinaryKnowledgeBase.h"
+#include "pinhao/MachineLearning/GrammarEvolution/GrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/Formulas.h"
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaPool.h"
+#include "pinhao/Support/FileLock.h"
+#include "pinhao/Support/Hash.h"
+#include "pinhao/Support/SerialSet.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace pinhao;
+
+static const char Magic[8] = { 'P', 'I', 'N', 'H', 'A', 'O', 'K', 'B' };
+static const uint32_t Version = 1;
+
+namespace {
+  struct Header {
+    char Magic[8];
+    uint32_t Version;
+    /// @brief The number of journal marks, which follow the index.
+    uint32_t Journals;
+    uint64_t Entries;
+  };
+
+  /// @brief Reads the values encoded in a buffer, failing once it ends.
+  class Decoder {
+    private:
+      const char *Current;
+      const char *End;
+
+    public:
+      Decoder(const char *Data, uint64_t Size) : Current(Data), End(Data + Size) {}
+
+      template <class T>
+        bool get(T &Value) {
+          if (static_cast<uint64_t>(End - Current) < sizeof(T)) return false;
+          std::memcpy(&Value, Current, sizeof(T));
+          Current += sizeof(T);
+          return true;
+        }
+
+      bool get(std::string &Value) {
+        uint32_t Size;
+        if (!get(Size) || static_cast<uint64_t>(End - Current) < Size) return false;
+        Value.assign(Current, Size);
+        Current += Size;
+        return true;
+      }
+
+      bool atEnd() const {
+        return Current == End;
+      }
+  };
+}
+
+template <class T>
+static void put(std::string &Out, const T &Value) {
+  Out.append(reinterpret_cast<const char*>(&Value), sizeof(T));
+}
+
+static void put(std::string &Out, const std::string &Value) {
+  put<uint32_t>(Out, Value.size());
+  Out.append(Value);
+}
+
+/*
+ * ----------------------------------
+ *  Formula encoding
+ */
+
+/// @brief Gets the operator of the binary operation @a Form.
+static OperatorKind &getOperatorOf(FormulaBase &Form) {
+  if (Form.isArithBinOp()) {
+    if (Form.getType() == ValueType::Int)
+      return static_cast<ArithBinOpFormula<int>&>(Form).Operator;
+    return static_cast<ArithBinOpFormula<double>&>(Form).Operator;
+  }
+
+  switch (static_cast<Formula<bool>&>(Form).getOperandsType()) {
+    case ValueType::Int:    return static_cast<BoolBinOpFormula<int>&>(Form).Operator;
+    case ValueType::Float:  return static_cast<BoolBinOpFormula<double>&>(Form).Operator;
+    case ValueType::String: return static_cast<BoolBinOpFormula<std::string>&>(Form).Operator;
+    default:                return static_cast<BoolBinOpFormula<bool>&>(Form).Operator;
+  }
+}
+
+/// @brief Gets the feature (and sub-feature) of the feature formula @a Form.
+static std::pair<std::string, std::string> &getFeatureOf(FormulaBase &Form) {
+  switch (Form.getType()) {
+    case ValueType::Int:    return static_cast<FeatureFormula<int>&>(Form).FeaturePair;
+    case ValueType::Float:  return static_cast<FeatureFormula<double>&>(Form).FeaturePair;
+    case ValueType::String: return static_cast<FeatureFormula<std::string>&>(Form).FeaturePair;
+    default:                return static_cast<FeatureFormula<bool>&>(Form).FeaturePair;
+  }
+}
+
+template <class T>
+static void putLiteral(std::string &Out, FormulaBase &Form) {
+  put(Out, static_cast<LitFormula<T>&>(Form).getValue());
+}
+
+template <class T>
+static bool getLiteral(Decoder &In, FormulaBase &Form) {
+  T Value;
+  if (!In.get(Value)) return false;
+  static_cast<LitFormula<T>&>(Form).setValue(Value);
+  return true;
+}
+
+static void putFormula(std::string &Out, FormulaBase &Form) {
+  put<uint8_t>(Out, static_cast<uint8_t>(Form.getKind()));
+  put<uint8_t>(Out, static_cast<uint8_t>(Form.getType()));
+
+  switch (Form.getKind()) {
+    case FormulaKind::Literal:
+      switch (Form.getType()) {
+        case ValueType::Int:    putLiteral<int>(Out, Form);         break;
+        case ValueType::Float:  putLiteral<double>(Out, Form);      break;
+        case ValueType::Bool:   putLiteral<bool>(Out, Form);        break;
+        case ValueType::String: putLiteral<std::string>(Out, Form); break;
+      }
+      break;
+    case FormulaKind::BoolBinOp:
+      put<uint8_t>(Out, static_cast<uint8_t>(static_cast<Formula<bool>&>(Form).getOperandsType()));
+      // Falls through to the operator.
+    case FormulaKind::ArithBinOp:
+      put<uint8_t>(Out, static_cast<uint8_t>(getOperatorOf(Form)));
+      break;
+    case FormulaKind::Feature:
+      put(Out, getFeatureOf(Form).first);
+      put(Out, getFeatureOf(Form).second);
+      break;
+    case FormulaKind::If:
+      break;
+  }
+
+  for (auto *Operand : Form.getOperands())
+    putFormula(Out, **Operand);
+}
+
+static FormulaRef getFormula(Decoder &In) {
+  uint8_t Kind, Type, OpType = static_cast<uint8_t>(ValueType::Int);
+  if (!In.get(Kind) || !In.get(Type)) return nullptr;
+  if (Kind > static_cast<uint8_t>(FormulaKind::Feature) || Type > static_cast<uint8_t>(ValueType::String))
+    return nullptr;
+  if (Kind == static_cast<uint8_t>(FormulaKind::BoolBinOp) &&
+      (!In.get(OpType) || OpType > static_cast<uint8_t>(ValueType::String)))
+    return nullptr;
+
+  FormulaRef Form(createFormula(static_cast<FormulaKind>(Kind), static_cast<ValueType>(Type),
+        static_cast<ValueType>(OpType)).release());
+  if (!Form || Form->getType() != static_cast<ValueType>(Type)) return nullptr;
+
+  // The type each operand must have, so that the casts of the formulas hold.
+  std::vector<ValueType> OperandTypes;
+  switch (Form->getKind()) {
+    case FormulaKind::Literal:
+      {
+        bool Read = false;
+        switch (Form->getType()) {
+          case ValueType::Int:    Read = getLiteral<int>(In, *Form);         break;
+          case ValueType::Float:  Read = getLiteral<double>(In, *Form);      break;
+          case ValueType::Bool:   Read = getLiteral<bool>(In, *Form);        break;
+          case ValueType::String: Read = getLiteral<std::string>(In, *Form); break;
+        }
+        if (!Read) return nullptr;
+        break;
+      }
+    case FormulaKind::BoolBinOp:
+    case FormulaKind::ArithBinOp:
+      {
+        uint8_t Operator;
+        if (!In.get(Operator) || Operator > static_cast<uint8_t>(OperatorKind::OR)) return nullptr;
+        getOperatorOf(*Form) = static_cast<OperatorKind>(Operator);
+        ValueType Operands = Form->isArithBinOp() ? Form->getType() : static_cast<ValueType>(OpType);
+        OperandTypes = { Operands, Operands };
+        break;
+      }
+    case FormulaKind::If:
+      OperandTypes = { ValueType::Bool, Form->getType(), Form->getType() };
+      break;
+    case FormulaKind::Feature:
+      if (!In.get(getFeatureOf(*Form).first) || !In.get(getFeatureOf(*Form).second)) return nullptr;
+      break;
+  }
+
+  auto Operands = Form->getOperands();
+  for (uint64_t I = 0; I < Operands.size(); ++I) {
+    *Operands[I] = getFormula(In);
+    if (!*Operands[I] || (*Operands[I])->getType() != OperandTypes[I]) return nullptr;
+  }
+  return Form;
+}
+
+/*
+ * ----------------------------------
+ *  Class: BinaryKnowledgeBase
+ */
+pinhao::BinaryKnowledgeBase::BinaryKnowledgeBase() : Fd(-1), Data(nullptr), Length(0), Index(nullptr),
+  Entries(0) {}
+
+pinhao::BinaryKnowledgeBase::~BinaryKnowledgeBase() {
+  close();
+}
+
+bool pinhao::BinaryKnowledgeBase::open(std::string Filename) {
+  close();
+
+  Fd = ::open(Filename.c_str(), O_RDONLY);
+  if (Fd < 0) return false;
+
+  struct stat Stat;
+  if (fstat(Fd, &Stat) || static_cast<uint64_t>(Stat.st_size) < sizeof(Header)) {
+    close();
+    return false;
+  }
+
+  Length = Stat.st_size;
+  void *Mapped = mmap(nullptr, Length, PROT_READ, MAP_PRIVATE, Fd, 0);
+  if (Mapped == MAP_FAILED) {
+    close();
+    return false;
+  }
+  Data = static_cast<const char*>(Mapped);
+
+  Header H;
+  std::memcpy(&H, Data, sizeof(Header));
+  if (std::memcmp(H.Magic, Magic, sizeof(Magic)) || H.Version != Version ||
+      H.Entries > (Length - sizeof(Header)) / sizeof(Entry)) {
+    close();
+    return false;
+  }
+
+  Index = reinterpret_cast<const Entry*>(Data + sizeof(Header));
+  Entries = H.Entries;
+  for (uint64_t I = 0; I < Entries; ++I) {
+    const Entry &E = Index[I];
+    if (E.Offset > Length || Length - E.Offset < E.Objectives * sizeof(double) + E.Size) {
+      close();
+      return false;
+    }
+  }
+
+  uint64_t IndexEnd = sizeof(Header) + Entries * sizeof(Entry);
+  Decoder In(Data + IndexEnd, Length - IndexEnd);
+  for (uint32_t I = 0; I < H.Journals; ++I) {
+    std::string Journal;
+    JournalMark Mark;
+    if (!In.get(Journal) || !In.get(Mark.Instance) || !In.get(Mark.Sequence)) {
+      close();
+      return false;
+    }
+    Journals[Journal] = Mark;
+  }
+
+  // Only the index is read on startup, the payloads are read as they are decoded.
+  madvise(const_cast<char*>(Data), Length, MADV_RANDOM);
+  return true;
+}
+
+void pinhao::BinaryKnowledgeBase::close() {
+  if (Data) munmap(const_cast<char*>(Data), Length);
+  if (Fd >= 0) ::close(Fd);
+  Fd = -1;
+  Data = nullptr;
+  Length = 0;
+  Index = nullptr;
+  Entries = 0;
+  ByFormulas.clear();
+  Journals.clear();
+}
+
+bool pinhao::BinaryKnowledgeBase::isOpen() const {
+  return Data != nullptr;
+}
+
+uint64_t pinhao::BinaryKnowledgeBase::size() const {
+  return Entries;
+}
+
+const BinaryKnowledgeBase::Entry &pinhao::BinaryKnowledgeBase::getEntry(uint64_t N) const {
+  assert(N < Entries && "Out of BinaryKnowledgeBase bounds.");
+  return Index[N];
+}
+
+std::vector<double> pinhao::BinaryKnowledgeBase::getObjectives(uint64_t N) const {
+  const Entry &E = getEntry(N);
+  std::vector<double> Objectives(E.Objectives);
+  if (E.Objectives)
+    std::memcpy(Objectives.data(), Data + E.Offset, E.Objectives * sizeof(double));
+  return Objectives;
+}
+
+std::string pinhao::BinaryKnowledgeBase::getFormulas(uint64_t N) const {
+  const Entry &E = getEntry(N);
+  return std::string(Data + E.Offset + E.Objectives * sizeof(double), E.Size);
+}
+
+const JournalMarks &pinhao::BinaryKnowledgeBase::getJournalMarks() const {
+  return Journals;
+}
+
+uint64_t pinhao::BinaryKnowledgeBase::find(const std::string &Formulas) const {
+  if (ByFormulas.empty())
+    for (uint64_t I = 0; I < Entries; ++I) {
+      const Entry &E = Index[I];
+      ByFormulas.insert(std::make_pair(hashBytes(Data + E.Offset + E.Objectives * sizeof(double), E.Size), I));
+    }
+
+  auto Range = ByFormulas.equal_range(hashBytes(Formulas.data(), Formulas.size()));
+  for (auto It = Range.first; It != Range.second; ++It) {
+    const Entry &E = Index[It->second];
+    if (E.Size == Formulas.size() && 
+        !std::memcmp(Data + E.Offset + E.Objectives * sizeof(double), Formulas.data(), E.Size))
+      return It->second;
+  }
+  return Entries;
+}
+
+bool pinhao::BinaryKnowledgeBase::get(uint64_t N, Candidate &C) const {
+  const Entry &E = getEntry(N);
+  C.clear();
+  C.Score = E.Score;
+  C.Count = E.Count;
+  C.Objectives = getObjectives(N);
+  return decode(getFormulas(N), C);
+}
+
+std::string pinhao::BinaryKnowledgeBase::encode(const Candidate &C) {
+  std::string Out;
+  put<uint32_t>(Out, C.size());
+  for (auto &Pair : C) {
+    put(Out, Pair.first.Name);
+    put<uint8_t>(Out, static_cast<uint8_t>(Pair.first.Type));
+    putFormula(Out, *Pair.second);
+  }
+  return Out;
+}
+
+bool pinhao::BinaryKnowledgeBase::decode(const std::string &Formulas, Candidate &C) {
+  Decoder In(Formulas.data(), Formulas.size());
+
+  uint32_t Size;
+  if (!In.get(Size)) return false;
+  for (uint32_t I = 0; I < Size; ++I) {
+    std::string Name;
+    uint8_t Type;
+    if (!In.get(Name) || !In.get(Type)) return false;
+
+    FormulaRef Form = getFormula(In);
+    if (!Form || Form->getType() != static_cast<ValueType>(Type)) return false;
+    simplifyFormula(Form);
+    FormulaPool::get().intern(Form);
+    C.insert(std::make_pair(DecisionPoint(Name, static_cast<ValueType>(Type)), Form));
+  }
+  return In.atEnd();
+}
+
+bool pinhao::BinaryKnowledgeBase::write(std::string Filename, const std::set<Candidate> &KnowledgeBase,
+    const BinaryKnowledgeBase *Stored, const std::vector<bool> *Loaded, const JournalMarks &Journals) {
+  struct Record {
+    /// @brief The score, count and objectives only.
+    Candidate Stats;
+    const char *Formulas;
+    uint32_t Size;
+  };
+
+  std::vector<std::string> Encoded;
+  std::vector<Record> Records;
+  std::unordered_map<uint64_t, std::vector<uint64_t>> ByHash;
+  Encoded.reserve(KnowledgeBase.size());
+  for (auto &C : KnowledgeBase) {
+    Encoded.push_back(encode(C));
+    Record R;
+    R.Stats.Score = C.Score;
+    R.Stats.Count = C.Count;
+    R.Stats.Objectives = C.Objectives;
+    R.Formulas = Encoded.back().data();
+    R.Size = Encoded.back().size();
+    ByHash[hashBytes(R.Formulas, R.Size)].push_back(Records.size());
+    Records.push_back(R);
+  }
+
+  uint64_t InMemory = Records.size();
+  for (uint64_t I = 0; Stored && I < Stored->size(); ++I) {
+    if (Loaded && I < Loaded->size() && (*Loaded)[I]) continue;
+
+    const Entry &E = Stored->getEntry(I);
+    Record R;
+    R.Stats.Score = E.Score;
+    R.Stats.Count = E.Count;
+    R.Stats.Objectives = Stored->getObjectives(I);
+    R.Formulas = Stored->Data + E.Offset + E.Objectives * sizeof(double);
+    R.Size = E.Size;
+
+    bool Merged = false;
+    auto It = ByHash.find(hashBytes(R.Formulas, R.Size));
+    if (It != ByHash.end())
+      for (auto J : It->second) {
+        if (J >= InMemory || Records[J].Size != R.Size || std::memcmp(Records[J].Formulas, R.Formulas, R.Size))
+          continue;
+        Records[J].Stats.merge(R.Stats);
+        Merged = true;
+        break;
+      }
+    if (!Merged) Records.push_back(R);
+  }
+
+  std::stable_sort(Records.begin(), Records.end(), [](const Record &Lhs, const Record &Rhs) {
+      return Lhs.Stats.Score > Rhs.Stats.Score;
+      });
+
+  Header H;
+  std::memcpy(H.Magic, Magic, sizeof(Magic));
+  H.Version = Version;
+  H.Journals = Journals.size();
+  H.Entries = Records.size();
+
+  std::string Marks;
+  for (auto &Pair : Journals) {
+    put(Marks, Pair.first);
+    put<uint64_t>(Marks, Pair.second.Instance);
+    put<uint64_t>(Marks, Pair.second.Sequence);
+  }
+
+  std::vector<Entry> NewIndex(Records.size());
+  uint64_t Offset = sizeof(Header) + Records.size() * sizeof(Entry) + Marks.size();
+  for (uint64_t I = 0; I < Records.size(); ++I) {
+    auto &R = Records[I];
+    NewIndex[I] = { R.Stats.Score, R.Stats.Count, Offset, R.Size,
+      static_cast<uint32_t>(R.Stats.Objectives.size()) };
+    Offset += R.Stats.Objectives.size() * sizeof(double) + R.Size;
+  }
+
+  std::string Temporary = Filename + ".tmp";
+  {
+    std::ofstream Out(Temporary, std::ios::binary | std::ios::trunc);
+    Out.write(reinterpret_cast<const char*>(&H), sizeof(Header));
+    Out.write(reinterpret_cast<const char*>(NewIndex.data()), NewIndex.size() * sizeof(Entry));
+    Out.write(Marks.data(), Marks.size());
+    for (auto &R : Records) {
+      Out.write(reinterpret_cast<const char*>(R.Stats.Objectives.data()),
+          R.Stats.Objectives.size() * sizeof(double));
+      Out.write(R.Formulas, R.Size);
+    }
+    Out.flush();
+    if (!Out.good()) {
+      std::cerr << "Could not write the knowledge base " << Temporary << std::endl;
+      std::remove(Temporary.c_str());
+      return false;
+    }
+  }
+
+  if (std::rename(Temporary.c_str(), Filename.c_str())) {
+    std::cerr << "Could not replace the knowledge base " << Filename << std::endl;
+    std::remove(Temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool pinhao::BinaryKnowledgeBase::isBinary(std::string Filename) {
+  return Filename.size() > 3 && Filename.compare(Filename.size() - 3, 3, ".kb") == 0;
+}
+
+uint64_t pinhao::convertKnowledgeBase(std::string From, std::string To) {
+  SerialSet<Candidate> KnowledgeBase;
+  if (BinaryKnowledgeBase::isBinary(From)) {
+    BinaryKnowledgeBase Stored;
+    if (!Stored.open(From)) {
+      std::cerr << "Could not read the knowledge base " << From << std::endl;
+      return 0;
+    }
+
+    for (uint64_t I = 0; I < Stored.size(); ++I) {
+      Candidate C;
+      if (Stored.get(I, C)) KnowledgeBase.insert(C);
+      else std::cerr << "Skipping the malformed candidate " << I << " of " << From << std::endl;
+    }
+  } else {
+    auto Node = YAMLWrapper::loadFile(From);
+    YAMLWrapper::fill(KnowledgeBase, Node);
+  }
+
+  if (BinaryKnowledgeBase::isBinary(To)) {
+    if (!BinaryKnowledgeBase::write(To, KnowledgeBase.getSet())) return 0;
+  } else {
+    std::ofstream Of(To);
+    YAMLWrapper::print(KnowledgeBase, Of);
+  }
+  return KnowledgeBase.size();
+}
+
+/// @brief Reads the journal marks of a YAML knowledge base, which are in the documents
+/// that follow its candidates.
+static JournalMarks getJournalMarks(const std::vector<YAML::Node> &Documents) {
+  JournalMarks Marks;
+  for (uint64_t I = 1; I < Documents.size(); ++I) {
+    if (!Documents[I]["journals"]) continue;
+    for (auto Journal : Documents[I]["journals"])
+      Marks[Journal["name"].as<std::string>()] = JournalMark(
+          std::stoull(Journal["instance"].as<std::string>(), nullptr, 16),
+          Journal["sequence"].as<uint64_t>());
+  }
+  return Marks;
+}
+
+static void printJournalMarks(const JournalMarks &Marks, std::ostream &Out) {
+  if (Marks.empty()) return;
+
+  YAML::Emitter E;
+  E << YAML::BeginMap;
+  E << YAML::Key << "journals" << YAML::Value << YAML::BeginSeq;
+  for (auto &Pair : Marks) {
+    E << YAML::BeginMap;
+    E << YAML::Key << "name" << YAML::Value << Pair.first;
+    E << YAML::Key << "instance" << YAML::Value << toHexString(Pair.second.Instance);
+    E << YAML::Key << "sequence" << YAML::Value << Pair.second.Sequence;
+    E << YAML::EndMap;
+  }
+  E << YAML::EndSeq << YAML::EndMap;
+  Out << "---" << std::endl << E.c_str() << std::endl;
+}
+
+/// @brief Updates the @a Stored marks with the ones @a Merged, dropping the marks of the
+/// journals that were removed: nothing replays them anymore.
+static JournalMarks updateJournalMarks(const JournalMarks &Stored, const JournalMarks &Merged) {
+  JournalMarks Marks;
+  for (auto &Pair : Stored)
+    if (!access(Pair.first.c_str(), F_OK) || !access((Pair.first + ".old").c_str(), F_OK))
+      Marks.insert(Pair);
+  for (auto &Pair : Merged)
+    if (Pair.second.Instance) Marks[Pair.first] = Pair.second;
+  return Marks;
+}
+
+bool pinhao::mergeKnowledgeBase(std::string Filename, const std::set<Candidate> &KnowledgeBase,
+    const std::set<Candidate> &Evaluations, const JournalMarks &MergedJournals) {
+  FileLock Lock(Filename + ".lock");
+  if (!Lock.isLocked()) return false;
+
+  if (BinaryKnowledgeBase::isBinary(Filename)) {
+    BinaryKnowledgeBase Stored;
+    if (std::ifstream(Filename).good() && !Stored.open(Filename)) {
+      std::cerr << "Could not read the knowledge base " << Filename << std::endl;
+      return false;
+    }
+
+    auto isStored = [&Stored](const Candidate &C) {
+      return Stored.isOpen() && Stored.find(BinaryKnowledgeBase::encode(C)) < Stored.size();
+    };
+
+    // The evaluations of the stored candidates are averaged with them by write.
+    SerialSet<Candidate> Written;
+    for (auto &C : KnowledgeBase)
+      if (!isStored(C)) Written.insert(C);
+    for (auto &C : Evaluations)
+      if (isStored(C) || !KnowledgeBase.count(C)) Written.insert(C);
+    return BinaryKnowledgeBase::write(Filename, Written.getSet(), Stored.isOpen() ? &Stored : nullptr, nullptr,
+        updateJournalMarks(Stored.getJournalMarks(), MergedJournals));
+  }
+
+  SerialSet<Candidate> Merged;
+  JournalMarks StoredJournals;
+  if (std::ifstream(Filename).good()) {
+    try {
+      auto Documents = YAML::LoadAllFromFile(Filename);
+      if (!Documents.empty())
+        YAMLWrapper::fill(Merged, Documents[0]);
+      StoredJournals = getJournalMarks(Documents);
+    } catch (std::exception &E) {
+      std::cerr << "Could not read the knowledge base " << Filename << ": " << E.what() << std::endl;
+      return false;
+    }
+  }
+
+  // The evaluations first, so that only the stored candidates are averaged with them.
+  for (auto &C : Evaluations) {
+    auto It = Merged.find(C);
+    if (It != Merged.end()) {
+      Candidate Updated = *It;
+      Updated.merge(C);
+      Merged.update(Updated);
+    } else if (!KnowledgeBase.count(C)) {
+      Merged.insert(C);
+    }
+  }
+  for (auto &C : KnowledgeBase)
+    if (!Merged.has(C)) Merged.insert(C);
+
+  std::string Temporary = Filename + ".tmp";
+  {
+    std::ofstream Of(Temporary);
+    YAMLWrapper::print(Merged, Of);
+    printJournalMarks(updateJournalMarks(StoredJournals, MergedJournals), Of);
+    Of.flush();
+    if (!Of.good()) {
+      std::cerr << "Could not write the knowledge base " << Temporary << std::endl;
+      return false;
+    }
+  }
+  return !std::rename(Temporary.c_str(), Filename.c_str());
+}
+
+bool pinhao::readJournalMarks(std::string Filename, JournalMarks &Marks) {
+  Marks.clear();
+  if (!std::ifstream(Filename).good()) return true;
+
+  if (BinaryKnowledgeBase::isBinary(Filename)) {
+    BinaryKnowledgeBase Stored;
+    if (!Stored.open(Filename)) return false;
+    Marks = Stored.getJournalMarks();
+    return true;
+  }
+
+  try {
+    Marks = getJournalMarks(YAML::LoadAllFromFile(Filename));
+  } catch (std::exception &E) {
+    std::cerr << "Could not read the knowledge base " << Filename << ": " << E.what() << std::endl;
+    return false;
+  }
+  return true;
+}
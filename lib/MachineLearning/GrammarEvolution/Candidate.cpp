@@ -7,9 +7,11 @@
 #include "pinhao/MachineLearning/GrammarEvolution/Candidate.h"
 #include "pinhao/MachineLearning/GrammarEvolution/GrammarEvolution.h"
 #include "pinhao/MachineLearning/GrammarEvolution/Formula.h"
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaPool.h"
 #include "pinhao/MachineLearning/GrammarEvolution/Evolution.h"
 
 #include "pinhao/Optimizer/OptimizationSet.h"
+#include "pinhao/Support/Hash.h"
 
 using namespace pinhao;
 
@@ -36,8 +38,10 @@ void pinhao::Candidate::evolve(double E, Evolution *GEvo) {
     if (Processed[Hi]) continue;
 
     auto &Form = this->get(Hi);
+    makeFormulaUnique(Form);
     Form->evolve(GEvo);
     simplifyFormula(Form);
+    FormulaPool::get().intern(Form);
 
     --Quantity;
   }
@@ -47,8 +51,9 @@ void pinhao::Candidate::generateMissing(std::vector<DecisionPoint> DPVector, Fea
   if (DPVector.size() == size()) return;
   for (auto DP : DPVector) {
     if (count(DP) > 0) continue; 
-    auto Form = generateFormula(Set, DP.Type).release();
+    FormulaRef Form = generateFormula(Set, DP.Type);
     simplifyFormula(Form);
+    FormulaPool::get().intern(Form);
     insert(std::make_pair(DP, Form));
   }
 }
@@ -57,23 +62,54 @@ Candidate *pinhao::Candidate::clone() const {
   Candidate *Clone = new Candidate();
   Clone->Score = Score;
   Clone->Count = Count;
-  for (auto &Pair : *this)
-    Clone->insert(std::make_pair(Pair.first, Pair.second->clone().release()));
+  Clone->Objectives = Objectives;
+  Clone->insert(begin(), end());
   return Clone;
 }
 
-FormulaBase* &pinhao::Candidate::get(uint64_t N) {
+FormulaRef &pinhao::Candidate::get(uint64_t N) {
   assert(N < size() && "Candidate heuristic out of bounds.");
   auto Pair = begin();
   while (N--) ++Pair;
   return Pair->second;
 }
 
+void pinhao::Candidate::merge(const Candidate &Other) {
+  uint64_t Total = Count + Other.Count;
+  if (!Total) return;
+
+  Score = ((Count * Score) + (Other.Count * Other.Score)) / Total;
+  if (Objectives.empty())
+    Objectives = Other.Objectives;
+  else if (Objectives.size() == Other.Objectives.size())
+    for (uint64_t I = 0; I < Objectives.size(); ++I)
+      Objectives[I] = ((Count * Objectives[I]) + (Other.Count * Other.Objectives[I])) / Total;
+  Count = Total;
+}
+
+uint64_t pinhao::Candidate::getHash() const {
+  // The decision points are ordered by their names only.
+  uint64_t Hash = FNVOffsetBasis;
+  for (auto &Pair : *this) {
+    Hash = hashString(Pair.first.Name, Hash);
+    Hash = combineHashes(Hash, Pair.second->getHash());
+  }
+  return Hash;
+}
+
 bool pinhao::Candidate::operator<(const Candidate &Rhs) const {
   if (size() != Rhs.size()) return size() < Rhs.size();
-  for (auto &Pair : *this) {
-    auto &ThisFB = *Pair.second;
-    auto &RhsFB = *Rhs.at(Pair.first);
+  for (auto I = begin(), RI = Rhs.begin(), E = end(); I != E; ++I, ++RI) {
+    if (I->first < RI->first || RI->first < I->first)
+      return I->first < RI->first;
+
+    // The formulas are interned, so the equal ones are usually the same object.
+    auto &ThisFB = *I->second;
+    auto &RhsFB = *RI->second;
+    if (&ThisFB == &RhsFB) continue;
+
+    uint64_t ThisHash = ThisFB.getHash(), RhsHash = RhsFB.getHash();
+    if (ThisHash != RhsHash) return ThisHash < RhsHash;
     if (ThisFB != RhsFB)
       return ThisFB < RhsFB;
   }
@@ -84,6 +120,8 @@ template<> void pinhao::YAMLWrapper::append(const Candidate &Cand, Emitter &E) {
   E << YAML::BeginMap;
   E << YAML::Key << "score" << YAML::Value << (double) Cand.Score;
   E << YAML::Key << "count" << YAML::Value << (int) Cand.Count;
+  if (!Cand.Objectives.empty())
+    E << YAML::Key << "objectives" << YAML::Value << YAML::Flow << Cand.Objectives;
   E << YAML::Key << "formulas" << YAML::Value;
   E << YAML::BeginSeq;
   for (auto &Pair : Cand) {
@@ -102,9 +140,13 @@ template<> void pinhao::YAMLWrapper::append(const Candidate &Cand, Emitter &E) {
 template<> void pinhao::YAMLWrapper::fill(Candidate &Cand, ConstNode &Node) {
   Cand.Score = Node["score"].as<double>();
   Cand.Count = Node["count"].as<int>();
+  if (Node["objectives"])
+    Cand.Objectives = Node["objectives"].as<std::vector<double>>();
   for (auto I = Node["formulas"].begin(), E = Node["formulas"].end(); I != E; ++I) {
     DecisionPoint DP((*I)["name"].as<std::string>(), (ValueType)(*I)["type"].as<int>());
-    auto Form = YAMLWrapper::get<FormulaBase>((*I)["formula"]).release();
+    FormulaRef Form = YAMLWrapper::get<FormulaBase>((*I)["formula"]);
+    simplifyFormula(Form);
+    FormulaPool::get().intern(Form);
     Cand.insert(std::make_pair(DP, Form));
   }
 }
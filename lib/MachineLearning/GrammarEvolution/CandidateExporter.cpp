@@ -0,0 +1,512 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file CandidateExporter.cpp
+ */
+
+#include "pinhao/MachineLearning/GrammarEvolution/CandidateExporter.h"
+#include "pinhao/MachineLearning/GrammarEvolution/GrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaBytecode.h"
+#include "pinhao/MachineLearning/GrammarEvolution/Formula.h"
+
+#include "pinhao/Optimizer/OptimizationInfo.h"
+#include "pinhao/Optimizer/Optimizations.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+
+using namespace pinhao;
+
+namespace {
+
+  enum class CountLevel { Function, Block, Instruction };
+
+  /**
+   * @brief How a sub-feature of cfg_md_static is counted by the CFG*StaticFeatures: the
+   * @a Statement is run for each function, basic block, or instruction with one of the
+   * @a Opcodes (any, if there is none). The '$' of the statement is the counter.
+   */
+  struct SubFeatureCount {
+    CountLevel Level;
+    std::vector<std::string> Opcodes;
+    std::string Statement;
+  };
+
+}
+
+static std::vector<std::string> concat(std::initializer_list<std::vector<std::string>> Lists) {
+  std::vector<std::string> All;
+  for (auto &List : Lists)
+    All.insert(All.end(), List.begin(), List.end());
+  return All;
+}
+
+static const std::vector<std::string> IntBinOps = { "Add", "Sub", "Mul", "UDiv", "SDiv", "URem", "SRem" };
+static const std::vector<std::string> FltBinOps = { "FAdd", "FSub", "FMul", "FDiv", "FRem" };
+static const std::vector<std::string> BitwBinOps = { "Shl", "LShr", "AShr", "And", "Or", "Xor" };
+static const std::vector<std::string> VectorOps = { "ExtractElement", "InsertElement", "ShuffleVector" };
+static const std::vector<std::string> AggregateOps = { "ExtractValue", "InsertValue" };
+static const std::vector<std::string> MemoryOps = { "Alloca", "AtomicRMW", "AtomicCmpXchg" };
+static const std::vector<std::string> ConvIntOps = { "Trunc", "ZExt", "SExt", "UIToFP", "SIToFP",
+  "PtrToInt", "IntToPtr", "BitCast", "AddrSpaceCast" };
+static const std::vector<std::string> ConvFltOps = { "FPTrunc", "FPExt", "FPToUI", "FPToSI" };
+static const std::vector<std::string> OtherAssignOps = { "ICmp", "FCmp", "Select", "VAArg", "LandingPad" };
+
+static const std::string CallReturn = "cast<CallInst>(I).getFunctionType()->getReturnType()";
+
+/// @brief The sub-features of cfg_md_static. The sub-features of the basic blocks with
+/// 1 or 2 predecessors (successors) also count the ones with less, as the fall through
+/// cases of @a CFGFunctionStaticFeatures do, and the ones of the number of instructions
+/// are never counted.
+static const std::map<std::string, SubFeatureCount> SubFeatureCounts = {
+  { "nof_inst", { CountLevel::Instruction, {}, "++$;" } },
+  { "nof_assign_inst", { CountLevel::Instruction, concat({ IntBinOps, FltBinOps, BitwBinOps, VectorOps,
+      AggregateOps, { "Load" }, MemoryOps, { "GetElementPtr" }, ConvIntOps, ConvFltOps, OtherAssignOps,
+      { "PHI", "Call" } }), "++$;" } },
+  { "nof_binop_int_inst", { CountLevel::Instruction, IntBinOps, "++$;" } },
+  { "nof_binop_flt_inst", { CountLevel::Instruction, FltBinOps, "++$;" } },
+  { "nof_terminator_inst", { CountLevel::Instruction, { "Ret", "Invoke", "Resume", "Unreachable" }, "++$;" } },
+  { "nof_binop_bitw_inst", { CountLevel::Instruction, BitwBinOps, "++$;" } },
+  { "nof_vector_inst", { CountLevel::Instruction, VectorOps, "++$;" } },
+  { "nof_memory_adress_inst", { CountLevel::Instruction, concat({ { "Fence" }, MemoryOps }), "++$;" } },
+  { "nof_aggregate_inst", { CountLevel::Instruction, AggregateOps, "++$;" } },
+  { "nof_conv_int_inst", { CountLevel::Instruction, ConvIntOps, "++$;" } },
+  { "nof_conv_flt_inst", { CountLevel::Instruction, ConvFltOps, "++$;" } },
+  { "nof_call_inst", { CountLevel::Instruction, { "Call" }, "++$;" } },
+  { "nof_callarg_ptr_inst", { CountLevel::Instruction, { "Call" },
+    "for (unsigned O = 0; O < cast<CallInst>(I).getNumArgOperands(); ++O)\n"
+    "  if (cast<CallInst>(I).getArgOperand(O)->getType()->isPointerTy()) ++$;" } },
+  { "nof_callarg_g4_inst", { CountLevel::Instruction, { "Call" },
+    "if (cast<CallInst>(I).getNumArgOperands() > 4) ++$;" } },
+  { "nof_callret_int_inst", { CountLevel::Instruction, { "Call" }, "if (" + CallReturn + "->isIntegerTy()) ++$;" } },
+  { "nof_callret_flt_inst", { CountLevel::Instruction, { "Call" }, "if (" + CallReturn + "->isFloatingPointTy()) ++$;" } },
+  { "nof_callret_ptr_inst", { CountLevel::Instruction, { "Call" }, "if (" + CallReturn + "->isPointerTy()) ++$;" } },
+  { "nof_switch_inst", { CountLevel::Instruction, { "Switch" }, "++$;" } },
+  { "nof_indirectbr_inst", { CountLevel::Instruction, { "IndirectBr" }, "++$;" } },
+  { "nof_condbr_inst", { CountLevel::Instruction, { "Br" }, "if (cast<BranchInst>(I).isConditional()) ++$;" } },
+  { "nof_uncondbr_inst", { CountLevel::Instruction, { "Br" }, "if (!cast<BranchInst>(I).isConditional()) ++$;" } },
+  { "nof_load_inst", { CountLevel::Instruction, { "Load" }, "++$;" } },
+  { "nof_store_inst", { CountLevel::Instruction, { "Store" }, "++$;" } },
+  { "nof_getelemptr_inst", { CountLevel::Instruction, { "GetElementPtr" }, "++$;" } },
+  { "nof_phinode_inst", { CountLevel::Instruction, { "PHI" }, "++$;" } },
+  { "nof_functions", { CountLevel::Function, {}, "++$;" } },
+  { "nof_cfg_edges", { CountLevel::Block, {}, "$ += Succs;" } },
+  { "nof_cfg_crit_edges", { CountLevel::Block, {},
+    "for (unsigned S = 0; S < Succs; ++S)\n"
+    "  if (isCriticalEdge(BB.getTerminator(), S, true)) ++$;" } },
+  { "nof_bb", { CountLevel::Block, {}, "++$;" } },
+  { "nof_1suc_bb", { CountLevel::Block, {}, "if (Succs == 1) ++$;" } },
+  { "nof_2suc_bb", { CountLevel::Block, {}, "if (Succs == 1 || Succs == 2) ++$;" } },
+  { "nof_g2suc_bb", { CountLevel::Block, {}, "if (Succs > 0) ++$;" } },
+  { "nof_1pred_bb", { CountLevel::Block, {}, "if (Preds == 1) ++$;" } },
+  { "nof_2pred_bb", { CountLevel::Block, {}, "if (Preds == 1 || Preds == 2) ++$;" } },
+  { "nof_g2pred_bb", { CountLevel::Block, {}, "if (Preds > 0) ++$;" } },
+  { "nof_1pred_1suc_bb", { CountLevel::Block, {}, "if (Succs == 1 && Preds == 1) ++$;" } },
+  { "nof_1pred_2suc_bb", { CountLevel::Block, {}, "if (Succs == 1 && Preds == 2) ++$;" } },
+  { "nof_2pred_1suc_bb", { CountLevel::Block, {}, "if (Succs == 2 && Preds == 1) ++$;" } },
+  { "nof_2pred_2suc_bb", { CountLevel::Block, {}, "if (Succs == 2 && Preds == 2) ++$;" } },
+  { "nof_g2pred_g2suc_bb", { CountLevel::Block, {}, "if (Succs > 2 && Preds > 2) ++$;" } },
+  { "nof_l15inst_bb", { CountLevel::Block, {}, "" } },
+  { "nof_ge15le500inst_bb", { CountLevel::Block, {}, "" } },
+  { "nof_g500inst_bb", { CountLevel::Block, {}, "" } }
+};
+
+/// @brief The optimizations created with arguments, by @a OptimizationInfo::createPass.
+static const std::map<Optimization, std::string> PassCreators = {
+  { Optimization::gvn, "createGVNPass" },
+  { Optimization::jumpThreading, "createJumpThreadingPass" },
+  { Optimization::loopRotate, "createLoopRotatePass" },
+  { Optimization::loopUnroll, "createLoopUnrollPass" },
+  { Optimization::loopUnswitch, "createLoopUnswitchPass" },
+  { Optimization::scalarrepl, "createScalarReplAggregatesPass" },
+  { Optimization::simplifycfg, "createCFGSimplificationPass" }
+};
+
+static const std::map<Opcode, std::string> Operators = {
+  { Opcode::AddInt, "+" }, { Opcode::SubInt, "-" }, { Opcode::MulInt, "*" },
+  { Opcode::AddFloat, "+" }, { Opcode::SubFloat, "-" }, { Opcode::MulFloat, "*" },
+  { Opcode::LtInt, "<" }, { Opcode::GtInt, ">" }, { Opcode::LeqInt, "<=" },
+  { Opcode::GeqInt, ">=" }, { Opcode::EqInt, "==" }, { Opcode::NeqInt, "!=" },
+  { Opcode::LtFloat, "<" }, { Opcode::GtFloat, ">" }, { Opcode::LeqFloat, "<=" },
+  { Opcode::GeqFloat, ">=" }, { Opcode::EqFloat, "==" }, { Opcode::NeqFloat, "!=" },
+  { Opcode::EqBool, "==" }, { Opcode::NeqBool, "!=" }, { Opcode::And, "&&" }, { Opcode::Or, "||" }
+};
+
+static std::string getTypeName(ValueType Type) {
+  switch (Type) {
+    case ValueType::Int: return "int";
+    case ValueType::Float: return "double";
+    default: return "bool";
+  }
+}
+
+static std::string getRegister(uint32_t N) {
+  return "R" + std::to_string(N);
+}
+
+static std::string getLiteral(BytecodeValue Value, ValueType Type) {
+  std::ostringstream Literal;
+  switch (Type) {
+    case ValueType::Int:
+      Literal << Value.Int;
+      break;
+    case ValueType::Float:
+      if (std::isnan(Value.Float)) Literal << "__builtin_nan(\"\")";
+      else if (std::isinf(Value.Float)) Literal << (Value.Float < 0 ? "-" : "") << "__builtin_inf()";
+      else {
+        Literal.precision(std::numeric_limits<double>::max_digits10);
+        Literal << Value.Float;
+      }
+      break;
+    default:
+      Literal << (Value.Bool ? "true" : "false");
+      break;
+  }
+  return Literal.str();
+}
+
+/// @brief Writes @a Statement, with its counter replaced by @a Counter, indented by @a Indent.
+static void writeStatement(std::string Statement, const std::string &Counter, const std::string &Indent,
+    std::ostream &Out) {
+  std::string::size_type Pos;
+  while ((Pos = Statement.find('$')) != std::string::npos)
+    Statement.replace(Pos, 1, Counter);
+
+  std::istringstream Lines(Statement);
+  std::string Line;
+  while (std::getline(Lines, Line))
+    Out << Indent << Line << "\n";
+}
+
+/*
+ * -------------------------------------
+ *  Class: CandidateExporter
+ */
+CandidateExporter::CandidateExporter(std::string PassArg, std::string Description) :
+  PassArg(PassArg), Description(Description) {}
+
+bool pinhao::CandidateExporter::writeFeatures(const FeatureLayout &Layout, std::ostream &Out) {
+  std::map<CountLevel, std::vector<std::pair<std::string, std::string>>> Statements;
+  // The statements of the instructions of each opcode, in the order they are found.
+  std::map<std::string, std::vector<std::string>> OpcodeStatements;
+  std::vector<std::string> Opcodes;
+
+  for (uint32_t Slot = 0; Slot < Layout.size(); ++Slot) {
+    auto &Pair = Layout.getPair(Slot);
+    auto It = SubFeatureCounts.find(Pair.second);
+    if (Pair.first != "cfg_md_static" || It == SubFeatureCounts.end() ||
+        Layout.getType(Slot) != ValueType::Int) {
+      std::cerr << "The feature " << Pair.first << "." << Pair.second << " can not be exported." << std::endl;
+      return false;
+    }
+
+    auto &Count = It->second;
+    std::string Counter = "F[" + std::to_string(Slot) + "]";
+    if (Count.Statement.empty()) continue;
+
+    if (!Count.Opcodes.empty()) {
+      for (auto &Op : Count.Opcodes) {
+        if (!OpcodeStatements.count(Op)) Opcodes.push_back(Op);
+        std::ostringstream Statement;
+        writeStatement(Count.Statement, Counter, "", Statement);
+        OpcodeStatements[Op].push_back(Statement.str());
+      }
+    } else {
+      Statements[Count.Level].push_back(std::make_pair(Count.Statement, Counter));
+    }
+  }
+
+  bool CountsInstructions = Statements.count(CountLevel::Instruction) || !Opcodes.empty();
+  bool CountsBlocks = CountsInstructions || Statements.count(CountLevel::Block);
+  bool CountsFunctions = CountsBlocks || Statements.count(CountLevel::Function);
+
+  bool UsesPreds = false, UsesSuccs = false;
+  for (auto &Pair : Statements[CountLevel::Block]) {
+    UsesPreds = UsesPreds || Pair.first.find("Preds") != std::string::npos;
+    UsesSuccs = UsesSuccs || Pair.first.find("Succs") != std::string::npos;
+  }
+
+  Out << "/// @brief Counts the sub-features of cfg_md_static read by the formulas.\n";
+  Out << "static void countFeatures(Module &M, uint64_t *F) {\n";
+  if (CountsFunctions) {
+    Out << "  for (auto &Function : M) {\n";
+    Out << "    if (Function.empty()) continue;\n";
+    for (auto &Pair : Statements[CountLevel::Function])
+      writeStatement(Pair.first, Pair.second, "    ", Out);
+  }
+
+  if (CountsBlocks) {
+    Out << "\n    for (auto &BB : Function) {\n";
+    if (UsesPreds) Out << "      unsigned Preds = std::distance(pred_begin(&BB), pred_end(&BB));\n";
+    if (UsesSuccs) Out << "      unsigned Succs = BB.getTerminator()->getNumSuccessors();\n";
+    for (auto &Pair : Statements[CountLevel::Block])
+      writeStatement(Pair.first, Pair.second, "      ", Out);
+  }
+
+  if (CountsInstructions) {
+    Out << "\n      for (auto &I : BB) {\n";
+    for (auto &Pair : Statements[CountLevel::Instruction])
+      writeStatement(Pair.first, Pair.second, "        ", Out);
+
+    // The opcodes with the same statements share their case.
+    std::map<std::vector<std::string>, std::vector<std::string>> Cases;
+    for (auto &Op : Opcodes)
+      Cases[OpcodeStatements[Op]].push_back(Op);
+
+    if (!Cases.empty()) {
+      Out << "        switch (I.getOpcode()) {\n";
+      for (auto &Case : Cases) {
+        for (auto &Op : Case.second)
+          Out << "          case Instruction::" << Op << ":\n";
+        for (auto &Statement : Case.first)
+          writeStatement(Statement, "", "            ", Out);
+        Out << "            break;\n";
+      }
+      Out << "          default: break;\n";
+      Out << "        }\n";
+    }
+    Out << "      }\n";
+  }
+
+  if (CountsBlocks) Out << "    }\n";
+  if (CountsFunctions) Out << "  }\n";
+  Out << "}\n\n";
+  return true;
+}
+
+void pinhao::CandidateExporter::writeFormulas(const FormulaProgram &Program, std::ostream &Out) {
+  std::set<uint32_t> Written, Read(Program.Results.begin(), Program.Results.end());
+  for (auto &I : Program.Code) {
+    Written.insert(I.Dest);
+    if (I.Op == Opcode::Feature) continue;
+    Read.insert(I.One);
+    Read.insert(I.Two);
+    if (I.Op == Opcode::Select) Read.insert(I.Three);
+  }
+
+  Out << "/// @brief Evaluates the formula of each optimization.\n";
+  Out << "static void evaluateFormulas(const uint64_t *F, bool *Enabled) {\n";
+
+  // The literals are the registers that are never written.
+  for (auto Register : Read)
+    if (!Written.count(Register))
+      Out << "  const " << getTypeName(Program.Types[Register]) << " " << getRegister(Register) << " = " <<
+        getLiteral(Program.Registers[Register], Program.Types[Register]) << ";\n";
+
+  for (auto &I : Program.Code) {
+    std::string One = getRegister(I.One), Two = getRegister(I.Two);
+    ValueType Type = Program.Types[I.Dest];
+    Out << "  const " << getTypeName(Type) << " " << getRegister(I.Dest) << " = ";
+
+    switch (I.Op) {
+      case Opcode::Feature:
+        Out << "(" << getTypeName(Type) << ") F[" << I.One << "]";
+        break;
+      case Opcode::Select:
+        Out << One << " ? " << Two << " : " << getRegister(I.Three);
+        break;
+      case Opcode::DivInt:
+      case Opcode::DivFloat:
+        Out << Two << " ? " << One << " / " << Two << " : 0";
+        break;
+      default:
+        Out << One << " " << Operators.at(I.Op) << " " << Two;
+        break;
+    }
+    Out << ";\n";
+  }
+
+  for (uint64_t N = 0; N < Program.Results.size(); ++N)
+    Out << "  Enabled[" << N << "] = " << getRegister(Program.Results[N]) << ";\n";
+  Out << "}\n\n";
+}
+
+void pinhao::CandidateExporter::writeOptimizations(const std::vector<int> &Sequence,
+    const std::vector<int> &Decisions, OptLevel OLevel, std::ostream &Out) {
+  // The target machine and the OLevel passes are set up as in pinhao::runOptimizations,
+  // with the default CPU and features of pinhao's code generation flags.
+  std::string CodeGenLevel = "None";
+  if (OLevel == OptLevel::O1) CodeGenLevel = "Less";
+  if (OLevel == OptLevel::O2) CodeGenLevel = "Default";
+  if (OLevel == OptLevel::O3) CodeGenLevel = "Aggressive";
+
+  Out << "/// @brief Creates the target machine of @a M, or null if it has no target.\n";
+  Out << "static TargetMachine *createTargetMachine(Module &M) {\n";
+  Out << "  Triple TheTriple(M.getTargetTriple());\n";
+  Out << "  if (!TheTriple.getArch()) return nullptr;\n\n";
+  Out << "  std::string Error;\n";
+  Out << "  const Target *TheTarget = TargetRegistry::lookupTarget(\"\", TheTriple, Error);\n";
+  Out << "  if (!TheTarget) return nullptr;\n";
+  Out << "  return TheTarget->createTargetMachine(TheTriple.getTriple(), \"\", \"\", TargetOptions(),\n";
+  Out << "      Reloc::Default, CodeModel::JITDefault, CodeGenOpt::" << CodeGenLevel << ");\n";
+  Out << "}\n\n";
+
+  Out << "/// @brief Adds the pass registered as @a Name to @a PM.\n";
+  Out << "static void addPass(legacy::PassManager &PM, const char *Name) {\n";
+  Out << "  const PassInfo *PI = PassRegistry::getPassRegistry()->getPassInfo(Name);\n";
+  Out << "  if (PI) PM.add(PI->createPass());\n";
+  Out << "  else errs() << \"Failed creating pass: \" << Name << \"\\n\";\n";
+  Out << "}\n\n";
+
+  Out << "/// @brief Runs the optimizations enabled, in the order of the sequence.\n";
+  Out << "static bool runOptimizations(Module &M, const bool *Enabled) {\n";
+  Out << "  std::unique_ptr<TargetMachine> TM(createTargetMachine(M));\n";
+  Out << "  TargetIRAnalysis TIRA = TM ? TM->getTargetIRAnalysis() : TargetIRAnalysis();\n";
+  Out << "  legacy::PassManager PM;\n";
+  Out << "  TargetLibraryInfoImpl TLII(Triple(M.getTargetTriple()));\n";
+  Out << "  PM.add(new TargetLibraryInfoWrapperPass(TLII));\n";
+  Out << "  PM.add(createTargetTransformInfoWrapperPass(TIRA));\n";
+  Out << "  bool Changed = false;\n\n";
+
+  if (OLevel != OptLevel::None) {
+    // As in OptimizationSequence::populateWithOLevel.
+    bool SizeLevel = OLevel == OptLevel::Os || OLevel == OptLevel::Oz;
+    bool Vectorize = OLevel > OptLevel::O1 && OLevel < OptLevel::Oz;
+
+    Out << "  legacy::FunctionPassManager FPM(&M);\n";
+    Out << "  FPM.add(createTargetTransformInfoWrapperPass(TIRA));\n";
+    Out << "  PassManagerBuilder Builder;\n";
+    Out << "  Builder.OptLevel = " << (SizeLevel ? 2 : static_cast<int>(OLevel)) << ";\n";
+    Out << "  Builder.SizeLevel = " <<
+      (SizeLevel ? static_cast<int>(OLevel) - static_cast<int>(OptLevel::O3) : 0) << ";\n";
+    if (OLevel > OptLevel::O1)
+      Out << "  Builder.Inliner = createFunctionInliningPass(" << static_cast<int>(OLevel) << ", 0);\n";
+    else
+      Out << "  Builder.Inliner = createAlwaysInlinerPass();\n";
+    Out << "  Builder.DisableUnitAtATime = false;\n";
+    Out << "  Builder.DisableUnrollLoops = false;\n";
+    if (Vectorize) Out << "  Builder.LoopVectorize = true;\n";
+    Out << "  Builder.SLPVectorize = " << (Vectorize ? "true" : "false") << ";\n";
+    Out << "  Builder.populateFunctionPassManager(FPM);\n";
+    Out << "  Builder.populateModulePassManager(PM);\n\n";
+    Out << "  FPM.doInitialization();\n";
+    Out << "  for (auto &F : M)\n";
+    Out << "    Changed |= FPM.run(F);\n";
+    Out << "  FPM.doFinalization();\n\n";
+  }
+
+  for (uint64_t I = 0; I < Sequence.size(); ++I) {
+    if (Decisions[I] < 0) continue;
+    OptimizationInfo Info(static_cast<Optimization>(Sequence[I]));
+    Out << "  if (Enabled[" << Decisions[I] << "]) ";
+
+    auto It = PassCreators.find(Info.getOptimization());
+    if (It == PassCreators.end()) {
+      Out << "addPass(PM, \"" << Info.getName() << "\");\n";
+      continue;
+    }
+
+    Out << "PM.add(" << It->second << "(";
+    for (uint64_t N = 0; N < Info.getNumberOfArguments(); ++N) {
+      BytecodeValue Arg;
+      switch (Info.getArgType(N)) {
+        case ValueType::Int: Arg.Int = Info.getArg<int>(N); break;
+        case ValueType::Float: Arg.Float = Info.getArg<double>(N); break;
+        default: Arg.Bool = Info.getArg<bool>(N); break;
+      }
+      Out << (N ? ", " : "") << getLiteral(Arg, Info.getArgType(N));
+    }
+    Out << "));\n";
+  }
+
+  Out << "\n  PM.add(createVerifierPass());\n";
+  Out << "  Changed |= PM.run(M);\n";
+  Out << "  return Changed;\n";
+  Out << "}\n\n";
+}
+
+bool pinhao::CandidateExporter::exportPass(const Candidate &C, const std::vector<int> &Sequence,
+    std::ostream &Out, OptLevel OLevel) {
+  FeatureLayout Layout;
+  FormulaProgram Program(Layout);
+
+  // The formula of each optimization, as in SimpleGrammarEvolution::getOptimizationSequence.
+  std::map<std::string, int> Formulas;
+  for (auto &Pair : C) {
+    if (std::find(Optimizations.begin(), Optimizations.end(), Pair.first.Name) == Optimizations.end())
+      continue;
+    if (Pair.second->getType() != ValueType::Bool) {
+      std::cerr << "The formula of " << Pair.first.Name << " is not boolean." << std::endl;
+      return false;
+    }
+    Formulas[Pair.first.Name] = Program.add(Pair.second.get());
+  }
+
+  if (!Program.isValid()) {
+    std::cerr << "The formulas of the candidate can not be compiled." << std::endl;
+    return false;
+  }
+
+  std::vector<int> Decisions;
+  for (auto O : Sequence) {
+    auto It = Formulas.find(getOptimizationName(static_cast<Optimization>(O)));
+    Decisions.push_back(It == Formulas.end() ? -1 : It->second);
+  }
+
+  std::ostringstream Source;
+  Source << "// This file was generated by the pinhao CandidateExporter, from a candidate with\n";
+  Source << "// score " << C.Score << " over " << C.Count << " evaluations. Build it as a shared library\n";
+  Source << "// (e.g. by configuring pinhao with -DPINHAO_CANDIDATE_PASS=<this file>), and run:\n";
+  Source << "//   opt -load <library> -" << PassArg << "\n\n";
+
+  Source << "#include \"llvm/Pass.h\"\n";
+  Source << "#include \"llvm/PassInfo.h\"\n";
+  Source << "#include \"llvm/PassRegistry.h\"\n";
+  Source << "#include \"llvm/ADT/Triple.h\"\n";
+  Source << "#include \"llvm/Analysis/CFG.h\"\n";
+  Source << "#include \"llvm/Analysis/TargetLibraryInfo.h\"\n";
+  Source << "#include \"llvm/Analysis/TargetTransformInfo.h\"\n";
+  Source << "#include \"llvm/IR/CFG.h\"\n";
+  Source << "#include \"llvm/IR/Instructions.h\"\n";
+  Source << "#include \"llvm/IR/LegacyPassManager.h\"\n";
+  Source << "#include \"llvm/IR/Module.h\"\n";
+  Source << "#include \"llvm/IR/Verifier.h\"\n";
+  Source << "#include \"llvm/Support/CommandLine.h\"\n";
+  Source << "#include \"llvm/Support/TargetRegistry.h\"\n";
+  Source << "#include \"llvm/Support/raw_ostream.h\"\n";
+  Source << "#include \"llvm/Target/TargetMachine.h\"\n";
+  Source << "#include \"llvm/Target/TargetOptions.h\"\n";
+  Source << "#include \"llvm/Transforms/IPO.h\"\n";
+  Source << "#include \"llvm/Transforms/IPO/PassManagerBuilder.h\"\n";
+  Source << "#include \"llvm/Transforms/Scalar.h\"\n\n";
+  Source << "#include <iterator>\n";
+  Source << "#include <memory>\n\n";
+  Source << "using namespace llvm;\n\n";
+  Source << "static cl::opt<bool> PrintDecisions(\"" << PassArg << "-print-decisions\",\n";
+  Source << "    cl::desc(\"Prints whether each optimization is enabled.\"));\n\n";
+
+  if (!writeFeatures(Layout, Source)) return false;
+  writeFormulas(Program, Source);
+  writeOptimizations(Sequence, Decisions, OLevel, Source);
+
+  Source << "namespace {\n\n";
+  Source << "  class CandidatePass : public ModulePass {\n";
+  Source << "    public:\n";
+  Source << "      static char ID;\n";
+  Source << "      CandidatePass() : ModulePass(ID) {}\n\n";
+  Source << "      bool runOnModule(Module &M) override {\n";
+  Source << "        uint64_t Features[" << std::max<uint64_t>(Layout.size(), 1) << "] = {};\n";
+  Source << "        bool Enabled[" << std::max<uint64_t>(Program.Results.size(), 1) << "] = {};\n";
+  Source << "        countFeatures(M, Features);\n";
+  Source << "        evaluateFormulas(Features, Enabled);\n";
+  if (!Formulas.empty()) {
+    Source << "        if (PrintDecisions) {\n";
+    for (auto &Pair : Formulas)
+      Source << "          outs() << \"" << Pair.first << " \" << Enabled[" << Pair.second << "] << \"\\n\";\n";
+    Source << "        }\n";
+  }
+  Source << "        return runOptimizations(M, Enabled);\n";
+  Source << "      }\n";
+  Source << "  };\n\n";
+  Source << "}\n\n";
+  Source << "char CandidatePass::ID = 0;\n";
+  Source << "static RegisterPass<CandidatePass> X(\"" << PassArg << "\", \"" << Description <<
+    "\", false, false);\n";
+
+  Out << Source.str();
+  return true;
+}
@@ -7,6 +7,7 @@
 #include "pinhao/MachineLearning/GrammarEvolution/Candidate.h"
 #include "pinhao/MachineLearning/GrammarEvolution/GrammarEvolution.h"
 #include "pinhao/MachineLearning/GrammarEvolution/Formula.h"
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaPool.h"
 
 using namespace pinhao;
 
@@ -14,6 +15,8 @@ template<> void pinhao::YAMLWrapper::append(const Candidate &Cand, Emitter &E) {
   E << YAML::BeginMap;
   E << YAML::Key << "score" << YAML::Value << (double) Cand.Score;
   E << YAML::Key << "count" << YAML::Value << (int) Cand.Count;
+  if (!Cand.Objectives.empty())
+    E << YAML::Key << "objectives" << YAML::Value << YAML::Flow << Cand.Objectives;
   E << YAML::Key << "formulas" << YAML::Value;
   E << YAML::BeginSeq;
   for (auto &Pair : Cand) {
@@ -32,9 +35,13 @@ template<> void pinhao::YAMLWrapper::append(const Candidate &Cand, Emitter &E) {
 template<> void pinhao::YAMLWrapper::fill(Candidate &Cand, ConstNode &Node) {
   Cand.Score = Node["score"].as<double>();
   Cand.Count = Node["count"].as<int>();
+  if (Node["objectives"])
+    Cand.Objectives = Node["objectives"].as<std::vector<double>>();
   for (auto I = Node["formulas"].begin(), E = Node["formulas"].end(); I != E; ++I) {
     DecisionPoint DP((*I)["name"].as<std::string>(), (ValueType)(*I)["type"].as<int>());
-    auto Form = YAMLWrapper::get<FormulaBase>((*I)["formula"]).release();
+    FormulaRef Form = YAMLWrapper::get<FormulaBase>((*I)["formula"]);
+    simplifyFormula(Form);
+    FormulaPool::get().intern(Form);
     Cand.insert(std::make_pair(DP, Form));
   }
 }
@@ -0,0 +1,242 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file CorpusKnowledgeBase.cpp
+ */
+
+#include "pinhao/MachineLearning/GrammarEvolution/CorpusKnowledgeBase.h"
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaBytecode.h"
+#include "pinhao/MachineLearning/GrammarEvolution/GrammarEvolution.h"
+#include "pinhao/Features/FeatureSet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <set>
+
+using namespace pinhao;
+
+/// @brief The feature that describes the modules.
+static const std::string CorpusFeature = "cfg_md_static";
+
+/// @brief Scales the counts down, so that the big modules are not all far from each other.
+static double scaleFeature(double Value) {
+  return std::log1p(std::max(Value, 0.0));
+}
+
+/*
+ * ----------------------------------
+ *  Class: CorpusKnowledgeBase
+ */
+CorpusKnowledgeBase::FeatureVector pinhao::CorpusKnowledgeBase::getFeatures(FeatureSet *Set) {
+  FeatureVector Features;
+  if (!Set || !FeatureSet::isEnabled(CorpusFeature)) return Features;
+
+  for (auto I = Set->begin(CorpusFeature), E = Set->end(CorpusFeature); I != E; ++I)
+    Features[I->second] = Set->getFeature<int>(*I);
+  return Features;
+}
+
+bool pinhao::CorpusKnowledgeBase::load(std::string Filename) {
+  Modules.clear();
+  if (std::ifstream(Filename).good()) {
+    try {
+      auto Node = YAMLWrapper::loadFile(Filename);
+      for (auto I = Node.begin(), E = Node.end(); I != E; ++I) {
+        Module M;
+        M.Name = (*I)["module"].as<std::string>();
+        M.Features = (*I)["features"].as<FeatureVector>();
+        for (auto CI = (*I)["candidates"].begin(), CE = (*I)["candidates"].end(); CI != CE; ++CI) {
+          Candidate C;
+          YAMLWrapper::fill(C, *CI);
+          M.Candidates.push_back(C);
+        }
+        Modules.push_back(M);
+      }
+    } catch (YAML::Exception &E) {
+      std::cerr << "Could not read the corpus " << Filename << ": " << E.what() << std::endl;
+      Modules.clear();
+      reindex();
+      return false;
+    }
+  }
+
+  reindex();
+  return true;
+}
+
+bool pinhao::CorpusKnowledgeBase::save(std::string Filename) const {
+  YAMLWrapper::Emitter E;
+  E << YAML::BeginSeq;
+  for (auto &M : Modules) {
+    E << YAML::BeginMap;
+    E << YAML::Key << "module" << YAML::Value << M.Name;
+    E << YAML::Key << "features" << YAML::Value << YAML::Flow << M.Features;
+    E << YAML::Key << "candidates" << YAML::Value << YAML::BeginSeq;
+    for (auto &C : M.Candidates)
+      YAMLWrapper::append(C, E);
+    E << YAML::EndSeq;
+    E << YAML::EndMap;
+  }
+  E << YAML::EndSeq;
+
+  std::string Temporary = Filename + ".tmp";
+  {
+    std::ofstream Of(Temporary);
+    Of << E.c_str() << std::endl;
+    Of.flush();
+    if (!Of.good()) {
+      std::cerr << "Could not write the corpus " << Temporary << std::endl;
+      return false;
+    }
+  }
+  return !std::rename(Temporary.c_str(), Filename.c_str());
+}
+
+uint64_t pinhao::CorpusKnowledgeBase::size() const {
+  return Modules.size();
+}
+
+const CorpusKnowledgeBase::Module &pinhao::CorpusKnowledgeBase::getModule(uint64_t N) const {
+  return Modules[N];
+}
+
+bool pinhao::CorpusKnowledgeBase::getFeatureRow(uint64_t N, const FeatureLayout &Layout,
+    std::vector<BytecodeValue> &Row) const {
+  Row.assign(Layout.size(), BytecodeValue());
+  for (uint32_t Slot = 0; Slot < Layout.size(); ++Slot) {
+    auto &Pair = Layout.getPair(Slot);
+    if (Pair.first != CorpusFeature) return false;
+
+    auto It = Modules[N].Features.find(Pair.second);
+    double Value = It != Modules[N].Features.end() ? It->second : 0;
+    switch (Layout.getType(Slot)) {
+      case ValueType::Int:
+        Row[Slot].Int = Value;
+        break;
+      case ValueType::Float:
+        Row[Slot].Float = Value;
+        break;
+      default:
+        Row[Slot].Bool = Value != 0;
+        break;
+    }
+  }
+  return true;
+}
+
+void pinhao::CorpusKnowledgeBase::addModule(std::string Name, const FeatureVector &Features,
+    const std::vector<Candidate> &Candidates) {
+  Module M;
+  M.Name = Name;
+  M.Features = Features;
+  M.Candidates = Candidates;
+  std::stable_sort(M.Candidates.begin(), M.Candidates.end(), CompareByScore());
+
+  auto It = std::find_if(Modules.begin(), Modules.end(),
+      [&Name] (const Module &Other) { return Other.Name == Name; });
+  if (It != Modules.end()) *It = M;
+  else Modules.push_back(M);
+
+  reindex();
+}
+
+void pinhao::CorpusKnowledgeBase::reindex() {
+  std::set<std::string> Names;
+  for (auto &M : Modules)
+    for (auto &Pair : M.Features)
+      Names.insert(Pair.first);
+  Dimensions.assign(Names.begin(), Names.end());
+
+  Mean.assign(Dimensions.size(), 0);
+  Deviation.assign(Dimensions.size(), 1);
+  if (Modules.empty()) {
+    Index.clear();
+    return;
+  }
+
+  // The log-scaled values of each module, before they are standardized.
+  std::vector<double> Scaled;
+  for (auto &M : Modules) {
+    for (uint64_t D = 0; D < Dimensions.size(); ++D) {
+      auto It = M.Features.find(Dimensions[D]);
+      double Value = scaleFeature(It == M.Features.end() ? 0 : It->second);
+      Scaled.push_back(Value);
+      Mean[D] += Value;
+    }
+  }
+
+  std::vector<double> Variance(Dimensions.size(), 0);
+  for (uint64_t D = 0; D < Dimensions.size(); ++D)
+    Mean[D] /= Modules.size();
+  for (uint64_t I = 0; I < Scaled.size(); ++I) {
+    double Difference = Scaled[I] - Mean[I % Dimensions.size()];
+    Variance[I % Dimensions.size()] += Difference * Difference;
+  }
+  // The features that do not vary do not distinguish the modules.
+  for (uint64_t D = 0; D < Dimensions.size(); ++D)
+    Deviation[D] = Variance[D] > 0 ? std::sqrt(Variance[D] / Modules.size()) : 0;
+
+  Index.clear();
+  for (auto &M : Modules)
+    normalize(M.Features, Index);
+}
+
+void pinhao::CorpusKnowledgeBase::normalize(const FeatureVector &Features, std::vector<double> &Row) const {
+  for (uint64_t D = 0; D < Dimensions.size(); ++D) {
+    if (!(Deviation[D] > 0)) {
+      Row.push_back(0);
+      continue;
+    }
+    auto It = Features.find(Dimensions[D]);
+    double Value = scaleFeature(It == Features.end() ? 0 : It->second);
+    Row.push_back((Value - Mean[D]) / Deviation[D]);
+  }
+}
+
+std::vector<uint64_t> pinhao::CorpusKnowledgeBase::findNearest(const FeatureVector &Features, uint64_t K,
+    std::string Except) const {
+  std::vector<double> Query;
+  normalize(Features, Query);
+
+  std::vector<std::pair<double, uint64_t>> Distances;
+  for (uint64_t N = 0; N < Modules.size(); ++N) {
+    if (Modules[N].Name == Except) continue;
+
+    const double *Row = Index.data() + N * Dimensions.size();
+    double Distance = 0;
+    for (uint64_t D = 0; D < Dimensions.size(); ++D)
+      Distance += (Row[D] - Query[D]) * (Row[D] - Query[D]);
+    Distances.push_back(std::make_pair(Distance, N));
+  }
+
+  K = std::min<uint64_t>(K, Distances.size());
+  std::partial_sort(Distances.begin(), Distances.begin() + K, Distances.end());
+
+  std::vector<uint64_t> Nearest;
+  for (uint64_t I = 0; I < K; ++I)
+    Nearest.push_back(Distances[I].second);
+  return Nearest;
+}
+
+std::vector<Candidate> pinhao::CorpusKnowledgeBase::getSeeds(const FeatureVector &Features, uint64_t K,
+    uint64_t N, std::string Except) const {
+  auto Nearest = findNearest(Features, K, Except);
+
+  std::set<Candidate> Taken;
+  std::vector<Candidate> Seeds;
+  for (uint64_t Rank = 0; Seeds.size() < N; ++Rank) {
+    bool Found = false;
+    for (auto M : Nearest) {
+      auto &Candidates = Modules[M].Candidates;
+      if (Rank >= Candidates.size() || Seeds.size() >= N) continue;
+      Found = true;
+      if (Taken.insert(Candidates[Rank]).second)
+        Seeds.push_back(Candidates[Rank]);
+    }
+    if (!Found) break;
+  }
+  return Seeds;
+}
@@ -6,6 +6,9 @@
 
 #include "pinhao/MachineLearning/GrammarEvolution/Formulas.h"
 #include "pinhao/Support/FormulaYAMLWrapper.h"
+#include "pinhao/Support/Hash.h"
+
+#include <stdexcept>
 
 using namespace pinhao;
 
@@ -18,7 +21,7 @@ FormulaKind pinhao::getFormulaKind(std::string String) {
     if (Pair.second.first == String) 
       return Pair.first;
   }
-  assert(false && "There is no such FormulaKind.");
+  throw std::invalid_argument("There is no such FormulaKind: " + String);
 }
 
 std::string pinhao::getFormulaKindString(FormulaKind K) {
@@ -32,7 +35,7 @@ OperatorKind pinhao::getOperatorKind(std::string String) {
       return static_cast<OperatorKind>(Count);
     ++Count;
   }
-  assert(false && "There is no such OperatorKindString.");
+  throw std::invalid_argument("There is no such OperatorKindString: " + String);
 }
 
 std::string pinhao::getOperatorKindString(OperatorKind K) {
@@ -191,24 +194,89 @@ std::unique_ptr<FormulaBase> pinhao::generateFormula(FeatureSet *Set, ValueType
   return std::unique_ptr<FormulaBase>(nullptr);
 }
 
-void pinhao::simplifyFormula(FormulaBase* &Form) {
-  FormulaBase *Simplified = Form->simplify();
+void pinhao::simplifyFormula(FormulaRef &Form) {
+  // The interned formulas were simplified before.
+  if (Form->isInterned()) return;
+  FormulaRef Simplified = Form->simplify();
   if (Simplified != nullptr) {
-    delete Form;
+    // The formula that has it as an operand changes with it.
+    Form->changed();
     Form = Simplified;
   }
 }
 
 void pinhao::simplifyFormula(std::unique_ptr<FormulaBase> &Form) {
-  FormulaBase *Simplified = Form->simplify();
+  FormulaRef Simplified = Form->simplify();
   if (Simplified != nullptr)
-    Form.reset(Simplified); 
+    Form = Simplified->clone(); 
+}
+
+void pinhao::makeFormulaUnique(FormulaRef &Form) {
+  if (Form.use_count() > 1 || Form->isInterned())
+    Form = Form->copy();
 }
 
 /*
  * ----------------------------------=
  * Class: FomulaBase
  */
+static uint64_t AllocatedFormulas = 0;
+static uint64_t LiveFormulas = 0;
+
+FormulaBase::FormulaBase() : Interned(false), Dirty(true), Hash(0), Parent(nullptr) {
+  ++AllocatedFormulas;
+  ++LiveFormulas;
+}
+
+FormulaBase::~FormulaBase() {
+  --LiveFormulas;
+}
+
+uint64_t FormulaBase::getNumberOfAllocated() {
+  return AllocatedFormulas;
+}
+
+uint64_t FormulaBase::getNumberOfLive() {
+  return LiveFormulas;
+}
+
+bool FormulaBase::isInterned() const {
+  return Interned;
+}
+
+void FormulaBase::changed() {
+  // The formulas above one that is dirty already are dirty too.
+  for (FormulaBase *Form = this; Form && !Form->Dirty; Form = Form->Parent)
+    Form->Dirty = true;
+}
+
+void FormulaBase::unlinkOperands() {
+  for (auto Operand : getOperands())
+    if (*Operand && (*Operand)->Parent == this)
+      (*Operand)->Parent = nullptr;
+}
+
+std::vector<FormulaRef*> FormulaBase::getOperands() {
+  return std::vector<FormulaRef*>();
+}
+
+uint64_t FormulaBase::getHash() {
+  if (Interned || !Dirty) return Hash;
+
+  uint64_t Structural = combineHashes(FNVOffsetBasis, static_cast<uint64_t>(getKind()));
+  Structural = combineHashes(Structural, static_cast<uint64_t>(getType()));
+  Structural = combineHashes(Structural, getLocalHash());
+  for (auto Operand : getOperands()) {
+    // The interned operands never change, so they do not need to know their parents.
+    if (!(*Operand)->Interned) (*Operand)->Parent = this;
+    Structural = combineHashes(Structural, (*Operand)->getHash());
+  }
+
+  Hash = Structural;
+  Dirty = false;
+  return Hash;
+}
+
 bool FormulaBase::isLiteral() const {
   return getKind() == FormulaKind::Literal;
 }
@@ -0,0 +1,300 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file FormulaBatch.cpp
+ */
+
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaBatch.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace pinhao;
+
+/*
+ * -------------------------------------
+ *  Struct: BatchColumn
+ */
+BatchColumn::BatchColumn(ValueType Type, uint64_t Size) : Type(Type) {
+  switch (Type) {
+    case ValueType::Int: Int.resize(Size); break;
+    case ValueType::Float: Float.resize(Size); break;
+    default: Bool.resize(Size); break;
+  }
+}
+
+uint64_t pinhao::BatchColumn::size() const {
+  switch (Type) {
+    case ValueType::Int: return Int.size();
+    case ValueType::Float: return Float.size();
+    default: return Bool.size();
+  }
+}
+
+void pinhao::BatchColumn::push_back(BytecodeValue Value) {
+  switch (Type) {
+    case ValueType::Int: Int.push_back(Value.Int); break;
+    case ValueType::Float: Float.push_back(Value.Float); break;
+    default: Bool.push_back(Value.Bool); break;
+  }
+}
+
+const void *pinhao::BatchColumn::getData(uint64_t N) const {
+  switch (Type) {
+    case ValueType::Int: return Int.data() + N;
+    case ValueType::Float: return Float.data() + N;
+    default: return Bool.data() + N;
+  }
+}
+
+void *pinhao::BatchColumn::getData(uint64_t N) {
+  return const_cast<void*>(static_cast<const BatchColumn*>(this)->getData(N));
+}
+
+/*
+ * -------------------------------------
+ *  Class: FeatureMatrix
+ */
+FeatureMatrix::FeatureMatrix(const FeatureLayout &Layout) : Rows(0) {
+  for (uint32_t Slot = 0; Slot < Layout.size(); ++Slot)
+    Columns.push_back(BatchColumn(Layout.getType(Slot)));
+}
+
+void pinhao::FeatureMatrix::addRow(const std::vector<BytecodeValue> &Values) {
+  assert(Values.size() >= Columns.size() && "The row has less features than the matrix.");
+  for (uint64_t I = 0; I < Columns.size(); ++I)
+    Columns[I].push_back(Values[I]);
+  ++Rows;
+}
+
+void pinhao::FeatureMatrix::addRow(const FeatureLayout &Layout, FeatureSet *Set) {
+  addRow(Layout.fetchValues(Set));
+}
+
+uint64_t pinhao::FeatureMatrix::getNumberOfRows() const {
+  return Rows;
+}
+
+uint64_t pinhao::FeatureMatrix::getNumberOfColumns() const {
+  return Columns.size();
+}
+
+const BatchColumn &pinhao::FeatureMatrix::getColumn(uint32_t Slot) const {
+  return Columns[Slot];
+}
+
+/*
+ * -------------------------------------
+ *  Class: DecisionMatrix
+ */
+uint64_t pinhao::DecisionMatrix::getNumberOfRows() const {
+  return Columns.empty() ? 0 : Columns.front().size();
+}
+
+uint64_t pinhao::DecisionMatrix::getNumberOfColumns() const {
+  return Columns.size();
+}
+
+ValueType pinhao::DecisionMatrix::getType(uint64_t Col) const {
+  return Columns[Col].Type;
+}
+
+template<>
+int pinhao::DecisionMatrix::get<int>(uint64_t Row, uint64_t Col) const {
+  if (Columns[Col].Type == ValueType::Float) return Columns[Col].Float[Row];
+  return Columns[Col].Int[Row];
+}
+
+template<>
+double pinhao::DecisionMatrix::get<double>(uint64_t Row, uint64_t Col) const {
+  if (Columns[Col].Type == ValueType::Int) return Columns[Col].Int[Row];
+  return Columns[Col].Float[Row];
+}
+
+template<>
+bool pinhao::DecisionMatrix::get<bool>(uint64_t Row, uint64_t Col) const {
+  return Columns[Col].Bool[Row];
+}
+
+/*
+ * -------------------------------------
+ *  Class: BatchEvaluator
+ */
+
+/// @brief Applies @a Op to each pair of values of @a One and @a Two.
+template <class T, class R, class OpT>
+static void applyKernel(const void *One, const void *Two, void *Dest, uint64_t N, OpT Op) {
+  const T *__restrict__ A = static_cast<const T*>(One);
+  const T *__restrict__ B = static_cast<const T*>(Two);
+  R *__restrict__ D = static_cast<R*>(Dest);
+  for (uint64_t I = 0; I < N; ++I)
+    D[I] = Op(A[I], B[I]);
+}
+
+template <class T>
+static void selectKernel(const void *Condition, const void *Then, const void *Else, void *Dest, uint64_t N) {
+  const uint8_t *__restrict__ C = static_cast<const uint8_t*>(Condition);
+  const T *__restrict__ A = static_cast<const T*>(Then);
+  const T *__restrict__ B = static_cast<const T*>(Else);
+  T *__restrict__ D = static_cast<T*>(Dest);
+  // Both values are loaded, so that the loop has no branches.
+  for (uint64_t I = 0; I < N; ++I) {
+    T Then = A[I], Else = B[I];
+    D[I] = C[I] ? Then : Else;
+  }
+}
+
+BatchEvaluator::BatchEvaluator(uint64_t BlockSize) : BlockSize(std::max<uint64_t>(BlockSize, 1)) {}
+
+BatchEvaluator::BlockRegisters pinhao::BatchEvaluator::createRegisters(const FormulaProgram &Program) {
+  BlockRegisters Registers;
+  std::vector<bool> IsFeature(Program.Registers.size(), false);
+  for (auto &I : Program.Code)
+    if (I.Op == Opcode::Feature) IsFeature[I.Dest] = true;
+
+  for (uint64_t R = 0; R < Program.Registers.size(); ++R) {
+    // The features are read from the matrix.
+    uint64_t Size = IsFeature[R] ? 0 : BlockSize;
+    Registers.Columns.push_back(BatchColumn(Program.Types[R], Size));
+  }
+
+  // The literals are broadcast, and the other registers are overwritten.
+  for (uint64_t R = 0; R < Program.Registers.size(); ++R) {
+    auto &Column = Registers.Columns[R];
+    BytecodeValue Value = Program.Registers[R];
+    switch (Column.Type) {
+      case ValueType::Int: std::fill(Column.Int.begin(), Column.Int.end(), Value.Int); break;
+      case ValueType::Float: std::fill(Column.Float.begin(), Column.Float.end(), Value.Float); break;
+      default: std::fill(Column.Bool.begin(), Column.Bool.end(), Value.Bool); break;
+    }
+    Registers.Data.push_back(Column.getData());
+  }
+
+  return Registers;
+}
+
+void pinhao::BatchEvaluator::runBlock(const FormulaProgram &Program, const FeatureMatrix &Matrix,
+    BlockRegisters &Registers, uint64_t Begin, uint64_t Size, DecisionMatrix &Decisions) {
+  auto &Data = Registers.Data;
+  for (uint64_t R = 0; R < Data.size(); ++R)
+    if (Registers.Columns[R].size()) Data[R] = Registers.Columns[R].getData();
+
+  for (const auto &I : Program.Code) {
+    const void *One = Data[I.One];
+    const void *Two = Data[I.Two];
+    void *Dest = Registers.Columns[I.Dest].getData();
+
+    switch (I.Op) {
+      case Opcode::Feature:
+        assert(I.One < Matrix.getNumberOfColumns() && "The program was compiled after the matrix.");
+        Data[I.Dest] = Matrix.getColumn(I.One).getData(Begin);
+        break;
+
+      case Opcode::Select:
+        switch (Registers.Columns[I.Dest].Type) {
+          case ValueType::Int: selectKernel<int>(One, Two, Data[I.Three], Dest, Size); break;
+          case ValueType::Float: selectKernel<double>(One, Two, Data[I.Three], Dest, Size); break;
+          default: selectKernel<uint8_t>(One, Two, Data[I.Three], Dest, Size); break;
+        }
+        break;
+
+      case Opcode::AddInt:
+        applyKernel<int, int>(One, Two, Dest, Size, [] (int A, int B) { return A + B; }); break;
+      case Opcode::SubInt:
+        applyKernel<int, int>(One, Two, Dest, Size, [] (int A, int B) { return A - B; }); break;
+      case Opcode::MulInt:
+        applyKernel<int, int>(One, Two, Dest, Size, [] (int A, int B) { return A * B; }); break;
+      case Opcode::DivInt:
+        applyKernel<int, int>(One, Two, Dest, Size, [] (int A, int B) { return B ? A / B : 0; }); break;
+
+      case Opcode::AddFloat:
+        applyKernel<double, double>(One, Two, Dest, Size, [] (double A, double B) { return A + B; }); break;
+      case Opcode::SubFloat:
+        applyKernel<double, double>(One, Two, Dest, Size, [] (double A, double B) { return A - B; }); break;
+      case Opcode::MulFloat:
+        applyKernel<double, double>(One, Two, Dest, Size, [] (double A, double B) { return A * B; }); break;
+      case Opcode::DivFloat:
+        applyKernel<double, double>(One, Two, Dest, Size,
+            [] (double A, double B) { double Quotient = A / B; return B ? Quotient : 0.0; });
+        break;
+
+      case Opcode::LtInt:
+        applyKernel<int, uint8_t>(One, Two, Dest, Size, [] (int A, int B) { return A < B; }); break;
+      case Opcode::GtInt:
+        applyKernel<int, uint8_t>(One, Two, Dest, Size, [] (int A, int B) { return A > B; }); break;
+      case Opcode::LeqInt:
+        applyKernel<int, uint8_t>(One, Two, Dest, Size, [] (int A, int B) { return A <= B; }); break;
+      case Opcode::GeqInt:
+        applyKernel<int, uint8_t>(One, Two, Dest, Size, [] (int A, int B) { return A >= B; }); break;
+      case Opcode::EqInt:
+        applyKernel<int, uint8_t>(One, Two, Dest, Size, [] (int A, int B) { return A == B; }); break;
+      case Opcode::NeqInt:
+        applyKernel<int, uint8_t>(One, Two, Dest, Size, [] (int A, int B) { return A != B; }); break;
+
+      case Opcode::LtFloat:
+        applyKernel<double, uint8_t>(One, Two, Dest, Size, [] (double A, double B) { return A < B; }); break;
+      case Opcode::GtFloat:
+        applyKernel<double, uint8_t>(One, Two, Dest, Size, [] (double A, double B) { return A > B; }); break;
+      case Opcode::LeqFloat:
+        applyKernel<double, uint8_t>(One, Two, Dest, Size, [] (double A, double B) { return A <= B; }); break;
+      case Opcode::GeqFloat:
+        applyKernel<double, uint8_t>(One, Two, Dest, Size, [] (double A, double B) { return A >= B; }); break;
+      case Opcode::EqFloat:
+        applyKernel<double, uint8_t>(One, Two, Dest, Size, [] (double A, double B) { return A == B; }); break;
+      case Opcode::NeqFloat:
+        applyKernel<double, uint8_t>(One, Two, Dest, Size, [] (double A, double B) { return A != B; }); break;
+
+      // The booleans are 0 or 1, so they are combined bitwise.
+      case Opcode::EqBool:
+        applyKernel<uint8_t, uint8_t>(One, Two, Dest, Size, [] (uint8_t A, uint8_t B) { return A == B; }); break;
+      case Opcode::NeqBool:
+        applyKernel<uint8_t, uint8_t>(One, Two, Dest, Size, [] (uint8_t A, uint8_t B) { return A != B; }); break;
+      case Opcode::And:
+        applyKernel<uint8_t, uint8_t>(One, Two, Dest, Size, [] (uint8_t A, uint8_t B) { return A & B; }); break;
+      case Opcode::Or:
+        applyKernel<uint8_t, uint8_t>(One, Two, Dest, Size, [] (uint8_t A, uint8_t B) { return A | B; }); break;
+    }
+  }
+
+  for (uint64_t N = 0; N < Program.Results.size(); ++N) {
+    auto &Column = Decisions.Columns[N];
+    const void *Result = Data[Program.Results[N]];
+    switch (Column.Type) {
+      case ValueType::Int:
+        std::copy_n(static_cast<const int*>(Result), Size, Column.Int.begin() + Begin);
+        break;
+      case ValueType::Float:
+        std::copy_n(static_cast<const double*>(Result), Size, Column.Float.begin() + Begin);
+        break;
+      default:
+        std::copy_n(static_cast<const uint8_t*>(Result), Size, Column.Bool.begin() + Begin);
+        break;
+    }
+  }
+}
+
+DecisionMatrix pinhao::BatchEvaluator::evaluate(const FormulaProgram &Program, const FeatureMatrix &Matrix) {
+  return evaluate(std::vector<const FormulaProgram*>({ &Program }), Matrix).front();
+}
+
+std::vector<DecisionMatrix> pinhao::BatchEvaluator::evaluate(const std::vector<const FormulaProgram*> &Population,
+    const FeatureMatrix &Matrix) {
+  uint64_t Rows = Matrix.getNumberOfRows();
+
+  std::vector<DecisionMatrix> Decisions(Population.size());
+  std::vector<BlockRegisters> Registers;
+  for (uint64_t P = 0; P < Population.size(); ++P) {
+    assert(Population[P]->isValid() && "The program is not valid.");
+    for (auto R : Population[P]->Results)
+      Decisions[P].Columns.push_back(BatchColumn(Population[P]->Types[R], Rows));
+    Registers.push_back(createRegisters(*Population[P]));
+  }
+
+  for (uint64_t Begin = 0; Begin < Rows; Begin += BlockSize) {
+    uint64_t Size = std::min(BlockSize, Rows - Begin);
+    for (uint64_t P = 0; P < Population.size(); ++P)
+      runBlock(*Population[P], Matrix, Registers[P], Begin, Size, Decisions[P]);
+  }
+
+  return Decisions;
+}
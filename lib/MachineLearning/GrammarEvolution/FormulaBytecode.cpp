@@ -0,0 +1,362 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file FormulaBytecode.cpp
+ */
+
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaBytecode.h"
+#include "pinhao/MachineLearning/GrammarEvolution/Formulas.h"
+#include "pinhao/Features/FeatureSet.h"
+
+#include <type_traits>
+
+using namespace pinhao;
+
+/*
+ * -------------------------------------
+ *  Class: FeatureLayout
+ */
+FeatureLayout::FeatureLayout() : Fetched(0) {}
+
+uint32_t pinhao::FeatureLayout::getSlot(const FeaturePair &Pair, ValueType Type) {
+  auto It = Slots.find(Pair);
+  if (It != Slots.end()) return It->second;
+
+  uint32_t Slot = Pairs.size();
+  Slots.insert(std::make_pair(Pair, Slot));
+  Pairs.push_back(Pair);
+  Types.push_back(Type);
+  return Slot;
+}
+
+uint64_t pinhao::FeatureLayout::size() const {
+  return Pairs.size();
+}
+
+ValueType pinhao::FeatureLayout::getType(uint32_t Slot) const {
+  return Types[Slot];
+}
+
+const std::pair<std::string, std::string> &pinhao::FeatureLayout::getPair(uint32_t Slot) const {
+  return Pairs[Slot];
+}
+
+/// @brief Looks up the value of the feature @a Pair, of type @a Type, in @a Set.
+static BytecodeValue getFeatureValue(FeatureSet *Set, const std::pair<std::string, std::string> &Pair,
+    ValueType Type) {
+  BytecodeValue Value;
+  switch (Type) {
+    case ValueType::Int:
+      Value.Int = Set->getFeature<int>(Pair);
+      break;
+    case ValueType::Float:
+      Value.Float = Set->getFeature<double>(Pair);
+      break;
+    default:
+      Value.Bool = Set->getFeature<bool>(Pair);
+      break;
+  }
+  return Value;
+}
+
+std::vector<BytecodeValue> pinhao::FeatureLayout::fetchValues(FeatureSet *Set) const {
+  std::vector<BytecodeValue> Fetched;
+  for (uint64_t I = 0; I < Pairs.size(); ++I)
+    Fetched.push_back(getFeatureValue(Set, Pairs[I], Types[I]));
+  return Fetched;
+}
+
+const std::vector<BytecodeValue> &pinhao::FeatureLayout::getValues(FeatureSet *Set) {
+  if (Set->getId() != Fetched) {
+    Values.clear();
+    Fetched = Set->getId();
+  }
+
+  for (uint64_t I = Values.size(); I < Pairs.size(); ++I)
+    Values.push_back(getFeatureValue(Set, Pairs[I], Types[I]));
+
+  return Values;
+}
+
+/*
+ * -------------------------------------
+ *  Class: FormulaProgram
+ */
+FormulaProgram::FormulaProgram(FeatureLayout &Layout) : Layout(&Layout), Valid(true) {}
+
+uint32_t pinhao::FormulaProgram::addRegister(ValueType Type) {
+  return addConstant(BytecodeValue(), Type);
+}
+
+uint32_t pinhao::FormulaProgram::addConstant(BytecodeValue Value, ValueType Type) {
+  Registers.push_back(Value);
+  Types.push_back(Type);
+  return Registers.size() - 1;
+}
+
+uint32_t pinhao::FormulaProgram::addInstruction(Opcode Op, ValueType Type, uint32_t One, uint32_t Two,
+    uint32_t Three) {
+  uint32_t Dest = addRegister(Type);
+  Code.push_back({ Op, Dest, One, Two, Three });
+  return Dest;
+}
+
+void pinhao::FormulaProgram::checkType(uint32_t Register, ValueType Type) {
+  if (Types[Register] != Type) Valid = false;
+}
+
+static BytecodeValue getLiteral(FormulaBase *Form) {
+  BytecodeValue Value;
+  switch (Form->getType()) {
+    case ValueType::Int: Value.Int = getFormulaValue<int>(Form); break;
+    case ValueType::Float: Value.Float = getFormulaValue<double>(Form); break;
+    default: Value.Bool = getFormulaValue<bool>(Form); break;
+  }
+  return Value;
+}
+
+/// @brief Gets the opcode of a comparison between @a OpT values, which is decoded as
+/// in @a BoolBinOpFormula::doOperation. Returns false if it always yields false.
+template <class OpT>
+static bool getComparison(int OperatorId, Opcode &Op) {
+  static_assert(std::is_same<OpT, int>::value || std::is_same<OpT, double>::value, "Not a number.");
+  bool IsInt = std::is_same<OpT, int>::value;
+  switch (static_cast<OperatorKind>(OperatorId + static_cast<int>(OperatorKind::DIV))) {
+    case OperatorKind::LT:  Op = IsInt ? Opcode::LtInt : Opcode::LtFloat; return true;
+    case OperatorKind::GT:  Op = IsInt ? Opcode::GtInt : Opcode::GtFloat; return true;
+    case OperatorKind::LEQ: Op = IsInt ? Opcode::LeqInt : Opcode::LeqFloat; return true;
+    case OperatorKind::GEQ: Op = IsInt ? Opcode::GeqInt : Opcode::GeqFloat; return true;
+    case OperatorKind::EQ:  Op = IsInt ? Opcode::EqInt : Opcode::EqFloat; return true;
+    case OperatorKind::NEQ: Op = IsInt ? Opcode::NeqInt : Opcode::NeqFloat; return true;
+    default: return false;
+  }
+}
+
+template <>
+bool getComparison<bool>(int OperatorId, Opcode &Op) {
+  switch (static_cast<OperatorKind>(OperatorId + static_cast<int>(OperatorKind::DIV))) {
+    case OperatorKind::EQ:  Op = Opcode::EqBool; return true;
+    case OperatorKind::NEQ: Op = Opcode::NeqBool; return true;
+    case OperatorKind::AND: Op = Opcode::And; return true;
+    case OperatorKind::OR:  Op = Opcode::Or; return true;
+    default: return false;
+  }
+}
+
+uint32_t pinhao::FormulaProgram::compileBinOp(FormulaBase *Form) {
+  auto Operands = Form->getOperands();
+  Opcode Op;
+  bool Yields = true;
+
+  if (Form->isArithBinOp()) {
+    bool IsInt = Form->getType() == ValueType::Int;
+    int OperatorId = IsInt ? static_cast<ArithBinOpFormula<int>*>(Form)->getOperatorId() :
+      static_cast<ArithBinOpFormula<double>*>(Form)->getOperatorId();
+    switch (static_cast<OperatorKind>(OperatorId)) {
+      case OperatorKind::PLUS: Op = IsInt ? Opcode::AddInt : Opcode::AddFloat; break;
+      case OperatorKind::MIN:  Op = IsInt ? Opcode::SubInt : Opcode::SubFloat; break;
+      case OperatorKind::MUL:  Op = IsInt ? Opcode::MulInt : Opcode::MulFloat; break;
+      default: Op = IsInt ? Opcode::DivInt : Opcode::DivFloat; break;
+    }
+  } else {
+    switch (static_cast<Formula<bool>*>(Form)->getOperandsType()) {
+      case ValueType::Int:
+        Yields = getComparison<int>(static_cast<BoolBinOpFormula<int>*>(Form)->getOperatorId(), Op);
+        break;
+      case ValueType::Float:
+        Yields = getComparison<double>(static_cast<BoolBinOpFormula<double>*>(Form)->getOperatorId(), Op);
+        break;
+      case ValueType::Bool:
+        Yields = getComparison<bool>(static_cast<BoolBinOpFormula<bool>*>(Form)->getOperatorId(), Op);
+        break;
+      default:
+        Valid = false;
+        return addRegister(ValueType::Bool);
+    }
+  }
+
+  if (!Yields) {
+    BytecodeValue False;
+    False.Bool = false;
+    return addConstant(False, ValueType::Bool);
+  }
+
+  uint32_t Lhs = compile(Operands[0]->get());
+  uint32_t Rhs = compile(Operands[1]->get());
+  ValueType OperandsType = Form->isArithBinOp() ? Form->getType() :
+    static_cast<Formula<bool>*>(Form)->getOperandsType();
+  checkType(Lhs, OperandsType);
+  checkType(Rhs, OperandsType);
+  return addInstruction(Op, Form->getType(), Lhs, Rhs);
+}
+
+uint32_t pinhao::FormulaProgram::compile(FormulaBase *Form) {
+  auto It = Compiled.find(Form);
+  if (It != Compiled.end()) return It->second;
+
+  if (Form->getType() == ValueType::String) {
+    Valid = false;
+    return addRegister(ValueType::Bool);
+  }
+
+  uint32_t Register = 0;
+  switch (Form->getKind()) {
+    case FormulaKind::Literal:
+      Register = addConstant(getLiteral(Form), Form->getType());
+      break;
+
+    case FormulaKind::Feature: {
+      std::pair<std::string, std::string> Pair;
+      switch (Form->getType()) {
+        case ValueType::Int: Pair = static_cast<FeatureFormula<int>*>(Form)->FeaturePair; break;
+        case ValueType::Float: Pair = static_cast<FeatureFormula<double>*>(Form)->FeaturePair; break;
+        default: Pair = static_cast<FeatureFormula<bool>*>(Form)->FeaturePair; break;
+      }
+      uint32_t Slot = Layout->getSlot(Pair, Form->getType());
+      if (Layout->getType(Slot) != Form->getType()) Valid = false;
+      Register = addInstruction(Opcode::Feature, Form->getType(), Slot);
+      break;
+    }
+
+    case FormulaKind::If: {
+      auto Operands = Form->getOperands();
+      uint32_t Condition = compile(Operands[0]->get());
+      uint32_t Then = compile(Operands[1]->get());
+      uint32_t Else = compile(Operands[2]->get());
+      checkType(Condition, ValueType::Bool);
+      checkType(Then, Form->getType());
+      checkType(Else, Form->getType());
+      Register = addInstruction(Opcode::Select, Form->getType(), Condition, Then, Else);
+      break;
+    }
+
+    default:
+      Register = compileBinOp(Form);
+      break;
+  }
+
+  Compiled.insert(std::make_pair(Form, Register));
+  return Register;
+}
+
+uint64_t pinhao::FormulaProgram::add(FormulaBase *Form) {
+  Results.push_back(compile(Form));
+  ResultTypes.push_back(Form->getType());
+  return Results.size() - 1;
+}
+
+bool pinhao::FormulaProgram::isValid() const {
+  return Valid;
+}
+
+uint64_t pinhao::FormulaProgram::size() const {
+  return Code.size();
+}
+
+void pinhao::FormulaProgram::run(const std::vector<BytecodeValue> &Features) {
+  BytecodeValue *R = Registers.data();
+  const BytecodeValue *F = Features.data();
+
+  for (const auto &I : Code) {
+    BytecodeValue &Dest = R[I.Dest];
+    const BytecodeValue &One = R[I.One];
+    const BytecodeValue &Two = R[I.Two];
+
+    switch (I.Op) {
+      case Opcode::Feature:  Dest = F[I.One]; break;
+      case Opcode::Select:   Dest = One.Bool ? Two : R[I.Three]; break;
+
+      case Opcode::AddInt:   Dest.Int = One.Int + Two.Int; break;
+      case Opcode::SubInt:   Dest.Int = One.Int - Two.Int; break;
+      case Opcode::MulInt:   Dest.Int = One.Int * Two.Int; break;
+      case Opcode::DivInt:   Dest.Int = Two.Int ? One.Int / Two.Int : 0; break;
+
+      case Opcode::AddFloat: Dest.Float = One.Float + Two.Float; break;
+      case Opcode::SubFloat: Dest.Float = One.Float - Two.Float; break;
+      case Opcode::MulFloat: Dest.Float = One.Float * Two.Float; break;
+      case Opcode::DivFloat: Dest.Float = Two.Float ? One.Float / Two.Float : 0; break;
+
+      case Opcode::LtInt:    Dest.Bool = One.Int < Two.Int; break;
+      case Opcode::GtInt:    Dest.Bool = One.Int > Two.Int; break;
+      case Opcode::LeqInt:   Dest.Bool = One.Int <= Two.Int; break;
+      case Opcode::GeqInt:   Dest.Bool = One.Int >= Two.Int; break;
+      case Opcode::EqInt:    Dest.Bool = One.Int == Two.Int; break;
+      case Opcode::NeqInt:   Dest.Bool = One.Int != Two.Int; break;
+
+      case Opcode::LtFloat:  Dest.Bool = One.Float < Two.Float; break;
+      case Opcode::GtFloat:  Dest.Bool = One.Float > Two.Float; break;
+      case Opcode::LeqFloat: Dest.Bool = One.Float <= Two.Float; break;
+      case Opcode::GeqFloat: Dest.Bool = One.Float >= Two.Float; break;
+      case Opcode::EqFloat:  Dest.Bool = One.Float == Two.Float; break;
+      case Opcode::NeqFloat: Dest.Bool = One.Float != Two.Float; break;
+
+      case Opcode::EqBool:   Dest.Bool = One.Bool == Two.Bool; break;
+      case Opcode::NeqBool:  Dest.Bool = One.Bool != Two.Bool; break;
+      case Opcode::And:      Dest.Bool = One.Bool && Two.Bool; break;
+      case Opcode::Or:       Dest.Bool = One.Bool || Two.Bool; break;
+    }
+  }
+}
+
+void pinhao::FormulaProgram::run(FeatureSet *Set) {
+  run(Layout->getValues(Set));
+}
+
+template<>
+int pinhao::FormulaProgram::getResult<int>(uint64_t N) const {
+  if (ResultTypes[N] == ValueType::Float) return Registers[Results[N]].Float;
+  return Registers[Results[N]].Int;
+}
+
+template<>
+double pinhao::FormulaProgram::getResult<double>(uint64_t N) const {
+  if (ResultTypes[N] == ValueType::Int) return Registers[Results[N]].Int;
+  return Registers[Results[N]].Float;
+}
+
+template<>
+bool pinhao::FormulaProgram::getResult<bool>(uint64_t N) const {
+  return Registers[Results[N]].Bool;
+}
+
+/*
+ * -------------------------------------
+ *  Class: FormulaProgramCache
+ */
+FormulaProgramCache::FormulaProgramCache(uint64_t Capacity) : Capacity(Capacity), Hits(0), Misses(0) {}
+
+FormulaProgram &pinhao::FormulaProgramCache::get(const FormulaVector &Formulas) {
+  std::vector<const FormulaBase*> Key;
+  bool Interned = true;
+  for (auto &Form : Formulas) {
+    Key.push_back(Form.get());
+    Interned = Interned && Form->isInterned();
+  }
+
+  if (!Interned) {
+    Uncached.reset(new FormulaProgram(Layout));
+    for (auto &Form : Formulas)
+      Uncached->add(Form.get());
+    return *Uncached;
+  }
+
+  auto It = Entries.find(Key);
+  if (It != Entries.end()) {
+    ++Hits;
+    return It->second.Program;
+  }
+
+  ++Misses;
+  if (Entries.size() >= Capacity)
+    Entries.clear();
+
+  Entry New = { Formulas, FormulaProgram(Layout) };
+  for (auto &Form : Formulas)
+    New.Program.add(Form.get());
+  return Entries.insert(std::make_pair(Key, New)).first->second.Program;
+}
+
+void pinhao::FormulaProgramCache::printStatistics(std::ostream &Out) const {
+  Out << "Formula programs: " << Entries.size() << " Hits: " << Hits <<
+    " Misses: " << Misses << std::endl;
+}
@@ -0,0 +1,74 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file FormulaPool.cpp
+ */
+
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaPool.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <sys/resource.h>
+
+using namespace pinhao;
+
+FormulaPool::FormulaPool() : Hits(0), Misses(0), PurgeAt(1024) {}
+
+FormulaPool &FormulaPool::get() {
+  static FormulaPool Pool;
+  return Pool;
+}
+
+void FormulaPool::purge() {
+  for (auto I = Formulas.begin(); I != Formulas.end(); ) {
+    if (I->second.expired()) I = Formulas.erase(I);
+    else ++I;
+  }
+  PurgeAt = std::max<uint64_t>(1024, 2 * Formulas.size());
+}
+
+void FormulaPool::intern(FormulaRef &Form) {
+  if (!Form || Form->isInterned()) return;
+
+  for (auto Operand : Form->getOperands())
+    intern(*Operand);
+
+  // The operands are interned, so only the hash of this formula is computed.
+  uint64_t Hash = Form->getHash();
+  auto Range = Formulas.equal_range(Hash);
+  for (auto I = Range.first; I != Range.second; ++I) {
+    FormulaRef Interned = I->second.lock();
+    // The operands are the same objects, so this does not go deep.
+    if (Interned && Interned->getKind() == Form->getKind() && *Interned == *Form) {
+      Form = Interned;
+      ++Hits;
+      return;
+    }
+  }
+
+  Form->Hash = Hash;
+  Form->Interned = true;
+  // It never changes again, so it has nothing to mark.
+  Form->Parent = nullptr;
+  Formulas.insert(std::make_pair(Hash, std::weak_ptr<FormulaBase>(Form)));
+  ++Misses;
+
+  if (Formulas.size() >= PurgeAt) purge();
+}
+
+uint64_t FormulaPool::getNumberOfFormulas() {
+  uint64_t Alive = 0;
+  for (auto &Pair : Formulas)
+    if (!Pair.second.expired()) ++Alive;
+  return Alive;
+}
+
+void FormulaPool::printStatistics() {
+  struct rusage Usage;
+  getrusage(RUSAGE_SELF, &Usage);
+
+  std::cerr << "FormulaPool: " << getNumberOfFormulas() << " formulas, " << Hits << " shared, " <<
+    Misses << " interned. Formulas: " << FormulaBase::getNumberOfLive() << " alive, " << 
+    FormulaBase::getNumberOfAllocated() << " allocated. Peak RSS: " << Usage.ru_maxrss << "KB" << std::endl;
+}
@@ -25,9 +25,34 @@ static config::YamlOpt<std::string> SequenceFile
 GEOSSimpleGrammarEvolution::GEOSSimpleGrammarEvolution(std::shared_ptr<llvm::Module> Module, std::string KBFilename,
     double EvolveProb, double MaxEvolutionRate, double MutateProb) : 
   SimpleGrammarEvolution(Module, KBFilename, EvolveProb, MaxEvolutionRate, MutateProb) {
+    FailureScore = 0.3;
     GEOSWrapper::loadCallCostFile(*Module);
   }
 
+double pinhao::GEOSSimpleGrammarEvolution::measureCost(llvm::Module &Compiled) {
+  double Cost = GEOSWrapper::repairAndAnalyse(Compiled).back();
+  if (Cost > 0.01) return Cost;
+  return 0;
+}
+
+std::string pinhao::GEOSSimpleGrammarEvolution::getMeasurementBackend() {
+  return "geos";
+}
+
+RepetitionPolicy pinhao::GEOSSimpleGrammarEvolution::getRepetitionPolicy() {
+  return RepetitionPolicy(1, 1);
+}
+
+std::vector<double> pinhao::GEOSSimpleGrammarEvolution::measureCostRepeatedly(llvm::Module &Compiled) {
+  return repeatMeasureCost(Compiled);
+}
+
+std::vector<double> pinhao::GEOSSimpleGrammarEvolution::
+compileAndMeasure(OptimizationSequence &OptSequence, std::shared_ptr<llvm::Module> *Compiled,
+    uint64_t *Fingerprint) {
+  return compileThenMeasure(OptSequence, Compiled, Fingerprint);
+}
+
 void pinhao::GEOSSimpleGrammarEvolution::run(int CandidatesNumber, int GenerationsNumber, 
     std::shared_ptr<FeatureSet> Set) {
   typedef std::pair<double, Candidate> RankingPair;
@@ -38,34 +63,24 @@ void pinhao::GEOSSimpleGrammarEvolution::run(int CandidatesNumber, int Generatio
   SimpleEvolution EvolutionStrategy(MutateProbability, Set.get());
 
   addPreDefinedDecisionPoints();
+
+  GEOSWrapper::getFrequencies(*Module, Argv);
+  BaseLine = measureBaseLine();
+  if (!(BaseLine > 0)) return;
+
   importKnowledgeBase();
+  warmStart(Set.get());
 
   std::set<RankingPair, DecendantOrder> Ranking;
 
-  GEOSWrapper::getFrequencies(*Module, Argv);
-  double BaseLine = GEOSWrapper::repairAndAnalyse(*Module).back();
-
   //uint64_t RealBaseLine = PAPIWrapper::getTotalCycles(*Module, Argv).second;
 
   for (int I = 0; I < GenerationsNumber; ++I) {
-    std::set<RankingPair, DecendantOrder> RankingTmp;
-
-    std::set<Candidate, CompareByScore> ScoreSet;
-    for (auto &C : KnowledgeBase)
-      ScoreSet.insert(C); 
+    loadBestCandidates(CandidatesNumber);
+    std::vector<Candidate> BestCandidates = KnowledgeBase.getFirst(std::max(CandidatesNumber, 0));
+    bool HasElite = BestCandidates.size() > 0;
 
-    int Count = 0;
-    std::vector<Candidate> BestCandidates;
-    for (auto &C : ScoreSet) {
-      if (Count >= CandidatesNumber) break;
-      Candidate *Clone = C.clone();
-      BestCandidates.push_back(*Clone); 
-      ++Count;
-
-      delete Clone;
-    }
-
-    if (BestCandidates.size() > 0) {
+    if (HasElite) {
       for (auto &C : BestCandidates) {
         double EvolveDie = UniformRandom::getRandomReal();
         if (EvolveDie < EvolveProbability) {
@@ -73,43 +88,21 @@ void pinhao::GEOSSimpleGrammarEvolution::run(int CandidatesNumber, int Generatio
         }
       }
 
-      BestCandidates.push_back(*ScoreSet.begin());
+      BestCandidates.push_back(KnowledgeBase.get(0));
     } else {
-      BestCandidates = std::vector<Candidate>(CandidatesNumber, Candidate()); 
+      BestCandidates = getInitialPopulation(CandidatesNumber);
     }
 
-    for (auto &C : BestCandidates) {
+    for (auto &C : BestCandidates)
       C.generateMissing(DecisionPoints, Set.get());
 
-      auto Compiled = compileWithCandidate(Module.get(), C, Set.get());
-      if (Compiled) {
-        double Cost = GEOSWrapper::repairAndAnalyse(*Compiled).back();
-        if (Cost > 0.01) {
-          double SpeedUp = BaseLine / Cost;
-          RankingTmp.insert(std::make_pair(SpeedUp, C));
-          std::cerr << "SpeedUp: " << SpeedUp << std::endl;
-          continue;
-        }
-      }
-      std::cerr << "SpeedUp: 0.3" << std::endl;
-      RankingTmp.insert(std::make_pair(0.3, C));
-    }
-
-    for (auto RPair : RankingTmp) {
-      Candidate C = RPair.second;
-
-      if (KnowledgeBase.has(C)) {
-        C.Score = ((C.Count * C.Score) + RPair.first) / (C.Count + 1); 
-        ++C.Count;
-      } else {
-        C.Score = RPair.first;
-        C.Count = 1;
-      }
-
-      KnowledgeBase.update(C);
-      Ranking.insert(RPair);
-    }
+    std::vector<bool> Fresh;
+    auto Scores = evaluateCandidates(BestCandidates, Set.get(), HasElite, &Fresh);
+    addScores(BestCandidates, Scores, Fresh);
+    for (uint64_t J = 0; J < BestCandidates.size(); ++J)
+      Ranking.insert(std::make_pair(Scores[J], BestCandidates[J]));
 
+    migrateCandidates(I);
   }
 
   /*
@@ -0,0 +1,359 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file KnowledgeBaseJournal.cpp
+ */
+
+#include "pinhao/MachineLearning/GrammarEvolution/KnowledgeBaseJournal.h"
+#include "pinhao/MachineLearning/GrammarEvolution/BinaryKnowledgeBase.h"
+#include "pinhao/MachineLearning/GrammarEvolution/GrammarEvolution.h"
+#include "pinhao/Support/Hash.h"
+#include "pinhao/Support/IPC.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace pinhao;
+
+/// @brief The size and the hash that precede the payload of each record.
+static const uint64_t RecordHeaderSize = sizeof(uint32_t) + sizeof(uint64_t);
+/// @brief The mark that starts the payload of each record.
+static const uint64_t RecordMarkSize = 2 * sizeof(uint64_t);
+
+template <class T>
+static void appendValue(std::string &Out, const T &Value) {
+  Out.append(reinterpret_cast<const char*>(&Value), sizeof(T));
+}
+
+static std::string encodeRecord(const Candidate &C, const JournalMark &Mark) {
+  std::string Payload;
+  appendValue<uint64_t>(Payload, Mark.Instance);
+  appendValue<uint64_t>(Payload, Mark.Sequence);
+  appendValue<double>(Payload, C.Score);
+  appendValue<uint64_t>(Payload, C.Count);
+  appendValue<uint32_t>(Payload, C.Objectives.size());
+  for (auto Objective : C.Objectives)
+    appendValue<double>(Payload, Objective);
+  Payload += BinaryKnowledgeBase::encode(C);
+
+  std::string Record;
+  appendValue<uint32_t>(Record, Payload.size());
+  appendValue<uint64_t>(Record, hashBytes(Payload.data(), Payload.size()));
+  return Record + Payload;
+}
+
+static bool decodeRecord(const char *Payload, uint32_t Size, Candidate &C, JournalMark &Mark) {
+  if (Size < RecordMarkSize) return false;
+  std::memcpy(&Mark.Instance, Payload, sizeof(uint64_t));
+  std::memcpy(&Mark.Sequence, Payload + sizeof(uint64_t), sizeof(uint64_t));
+  Payload += RecordMarkSize;
+  Size -= RecordMarkSize;
+
+  const uint64_t Fixed = sizeof(double) + sizeof(uint64_t) + sizeof(uint32_t);
+  if (Size < Fixed) return false;
+
+  uint32_t Objectives;
+  std::memcpy(&C.Score, Payload, sizeof(double));
+  std::memcpy(&C.Count, Payload + sizeof(double), sizeof(uint64_t));
+  std::memcpy(&Objectives, Payload + sizeof(double) + sizeof(uint64_t), sizeof(uint32_t));
+  if ((Size - Fixed) / sizeof(double) < Objectives) return false;
+
+  C.Objectives.resize(Objectives);
+  if (Objectives)
+    std::memcpy(C.Objectives.data(), Payload + Fixed, Objectives * sizeof(double));
+
+  uint64_t Start = Fixed + Objectives * sizeof(double);
+  return BinaryKnowledgeBase::decode(std::string(Payload + Start, Size - Start), C);
+}
+
+/// @brief Replays the records of @a Filename that are not covered by @a Merged, up to the
+/// first torn one.
+/// @return The number of records replayed. @a Valid is the size of the intact records, and
+/// @a Last the mark of the last one, if there is any.
+static uint64_t replayFile(std::string Filename, std::function<void(const Candidate&)> Restore,
+    const JournalMark &Merged, uint64_t &Valid, JournalMark &Last) {
+  Valid = 0;
+  std::ifstream In(Filename, std::ios::binary);
+  if (!In.good()) return 0;
+
+  std::stringstream Buffer;
+  Buffer << In.rdbuf();
+  std::string Data = Buffer.str();
+
+  uint64_t Replayed = 0;
+  while (Data.size() - Valid >= RecordHeaderSize) {
+    uint32_t Size;
+    uint64_t Hash;
+    std::memcpy(&Size, Data.data() + Valid, sizeof(uint32_t));
+    std::memcpy(&Hash, Data.data() + Valid + sizeof(uint32_t), sizeof(uint64_t));
+
+    const char *Payload = Data.data() + Valid + RecordHeaderSize;
+    if (Data.size() - Valid - RecordHeaderSize < Size || hashBytes(Payload, Size) != Hash)
+      break;
+
+    Candidate C;
+    JournalMark Mark;
+    if (!decodeRecord(Payload, Size, C, Mark)) break;
+    if (!Merged.covers(Mark)) {
+      Restore(C);
+      ++Replayed;
+    }
+
+    Valid += RecordHeaderSize + Size;
+    Last = Mark;
+  }
+
+  if (Valid < Data.size())
+    std::cerr << "Dropping " << Data.size() - Valid << " torn bytes of the journal " << Filename << std::endl;
+  return Replayed;
+}
+
+static bool fileExists(std::string Filename) {
+  return access(Filename.c_str(), F_OK) == 0;
+}
+
+/// @brief Creates the instance of a new journal, which is never 0 (no instance).
+static uint64_t createInstance() {
+  std::random_device Device;
+  uint64_t Instance = 0;
+  while (!Instance)
+    Instance = (static_cast<uint64_t>(Device()) << 32) | Device();
+  return Instance;
+}
+
+/*
+ * ----------------------------------
+ *  Struct: JournalMark
+ */
+bool pinhao::JournalMark::covers(const JournalMark &Record) const {
+  return Instance && Instance == Record.Instance && Record.Sequence <= Sequence;
+}
+
+/*
+ * ----------------------------------
+ *  Class: KnowledgeBaseJournal
+ */
+pinhao::KnowledgeBaseJournal::KnowledgeBaseJournal(std::string Filename, uint64_t SyncEvery) :
+  Filename(Filename), Fd(-1), SyncEvery(std::max<uint64_t>(SyncEvery, 1)), Unsynced(0), Records(0),
+  Compactor(0) {}
+
+pinhao::KnowledgeBaseJournal::~KnowledgeBaseJournal() {
+  wait();
+  sync();
+  if (Fd >= 0) close(Fd);
+}
+
+std::string pinhao::KnowledgeBaseJournal::getOldFilename() const {
+  return Filename + ".old";
+}
+
+uint64_t pinhao::KnowledgeBaseJournal::open(std::function<void(const Candidate&)> Restore,
+    JournalMark Merged) {
+  if (Fd >= 0) close(Fd);
+  Fd = -1;
+
+  // The journal of a run that is still going on is not touched.
+  Lock.reset(new FileLock(Filename + ".lock", false));
+  if (!Lock->isLocked()) {
+    Lock.reset();
+    return 0;
+  }
+
+  uint64_t Replayed = 0, Valid = 0;
+  Last = JournalMark();
+  if (fileExists(getOldFilename())) {
+    Replayed += replayFile(getOldFilename(), Restore, Merged, Valid, Last);
+
+    // The next rotation appends to it, so its torn bytes would hide the records after them.
+    if (truncate(getOldFilename().c_str(), Valid))
+      std::cerr << "Could not truncate the journal " << getOldFilename() << ": " << strerror(errno) << std::endl;
+  }
+  Replayed += replayFile(Filename, Restore, Merged, Valid, Last);
+
+  // The records appended go on after the ones left, if any.
+  if (!Last.Instance) Last = JournalMark(createInstance(), 0);
+
+  Fd = ::open(Filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (Fd < 0 || ftruncate(Fd, Valid))
+    std::cerr << "Could not open the journal " << Filename << ": " << strerror(errno) << std::endl;
+
+  Records = Replayed;
+  return Replayed;
+}
+
+bool pinhao::KnowledgeBaseJournal::isOpen() const {
+  return Fd >= 0;
+}
+
+std::string pinhao::KnowledgeBaseJournal::getFilename() const {
+  return Filename;
+}
+
+uint64_t pinhao::KnowledgeBaseJournal::replayCompacting(std::function<void(const Candidate&)> Restore,
+    JournalMark Merged, JournalMark *LastCompacting) const {
+  uint64_t Valid;
+  JournalMark Mark;
+  uint64_t Replayed = 0;
+  if (fileExists(getOldFilename()))
+    Replayed = replayFile(getOldFilename(), Restore, Merged, Valid, Mark);
+  if (LastCompacting) *LastCompacting = Mark;
+  return Replayed;
+}
+
+bool pinhao::KnowledgeBaseJournal::append(const Candidate &C) {
+  if (Fd < 0) return false;
+
+  JournalMark Mark(Last.Instance, Last.Sequence + 1);
+  std::string Record = encodeRecord(C, Mark);
+  if (!writeAll(Fd, Record.data(), Record.size())) {
+    std::cerr << "Could not append to the journal " << Filename << std::endl;
+    return false;
+  }
+
+  Last = Mark;
+  ++Records;
+  if (++Unsynced >= SyncEvery) sync();
+  return true;
+}
+
+void pinhao::KnowledgeBaseJournal::sync() {
+  if (Fd < 0 || !Unsynced) return;
+  fdatasync(Fd);
+  Unsynced = 0;
+}
+
+uint64_t pinhao::KnowledgeBaseJournal::size() const {
+  return Records;
+}
+
+JournalMark pinhao::KnowledgeBaseJournal::getLastMark() const {
+  return Last;
+}
+
+bool pinhao::KnowledgeBaseJournal::rotate() {
+  sync();
+
+  if (!fileExists(getOldFilename())) {
+    if (std::rename(Filename.c_str(), getOldFilename().c_str())) return false;
+  } else {
+    // The last compaction failed, so its records must be kept as well.
+    std::ifstream In(Filename, std::ios::binary);
+    std::stringstream Buffer;
+    Buffer << In.rdbuf();
+    std::string Data = Buffer.str();
+
+    int OldFd = ::open(getOldFilename().c_str(), O_WRONLY | O_APPEND);
+    off_t OldSize = OldFd >= 0 ? lseek(OldFd, 0, SEEK_END) : -1;
+    bool Moved = OldSize >= 0 && writeAll(OldFd, Data.data(), Data.size()) && !fdatasync(OldFd);
+
+    // A partial append is dropped, so that the next one is not written after torn bytes.
+    if (!Moved && OldSize >= 0 && ftruncate(OldFd, OldSize))
+      std::cerr << "Could not truncate the journal " << getOldFilename() << std::endl;
+    if (OldFd >= 0) close(OldFd);
+    if (!Moved) return false;
+  }
+
+  if (Fd >= 0) close(Fd);
+  Fd = ::open(Filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  return Fd >= 0;
+}
+
+bool pinhao::KnowledgeBaseJournal::compact(std::function<bool()> WriteSnapshot) {
+  if (Compactor > 0) {
+    int Status;
+    if (waitpid(Compactor, &Status, WNOHANG) == 0) return false;
+    Compactor = 0;
+  }
+
+  if (!rotate()) {
+    std::cerr << "Could not rotate the journal " << Filename << std::endl;
+    return false;
+  }
+  Records = 0;
+
+  std::cerr.flush();
+  fflush(stdout);
+
+  pid_t Pid = fork();
+  if (Pid < 0) {
+    std::cerr << "Could not fork the compaction. Compacting in place." << std::endl;
+    if (WriteSnapshot()) unlink(getOldFilename().c_str());
+    return true;
+  }
+
+  if (Pid == 0) {
+    bool Written = WriteSnapshot();
+    if (Written) unlink(getOldFilename().c_str());
+    std::cerr.flush();
+    _exit(Written ? 0 : 1);
+  }
+
+  Compactor = Pid;
+  return true;
+}
+
+void pinhao::KnowledgeBaseJournal::wait() {
+  if (Compactor <= 0) return;
+
+  int Status;
+  while (waitpid(Compactor, &Status, 0) < 0 && errno == EINTR);
+  Compactor = 0;
+}
+
+void pinhao::KnowledgeBaseJournal::clear() {
+  wait();
+  unlink(getOldFilename().c_str());
+  if (Fd >= 0 && ftruncate(Fd, 0))
+    std::cerr << "Could not clear the journal " << Filename << std::endl;
+  Unsynced = 0;
+  Records = 0;
+}
+
+void pinhao::KnowledgeBaseJournal::remove() {
+  wait();
+  unlink(getOldFilename().c_str());
+  unlink(Filename.c_str());
+  if (Fd >= 0) close(Fd);
+  Fd = -1;
+  Lock.reset();
+  Unsynced = 0;
+  Records = 0;
+}
+
+std::vector<std::string> pinhao::KnowledgeBaseJournal::list(std::string Prefix) {
+  auto Slash = Prefix.rfind('/');
+  std::string Directory = Slash == std::string::npos ? "." : Prefix.substr(0, Slash + 1);
+  std::string Name = Slash == std::string::npos ? Prefix : Prefix.substr(Slash + 1);
+
+  std::set<std::string> Journals;
+  if (DIR *Dir = opendir(Directory.c_str())) {
+    while (struct dirent *Entry = readdir(Dir)) {
+      std::string Journal = Entry->d_name;
+      if (Journal.compare(0, Name.size(), Name)) continue;
+
+      // The locks are left behind by the journals removed, so only the records count. A
+      // crash may leave only the journal being compacted.
+      auto HasSuffix = [&Journal](const std::string &Suffix) {
+        return Journal.size() > Suffix.size() &&
+          !Journal.compare(Journal.size() - Suffix.size(), Suffix.size(), Suffix);
+      };
+      if (HasSuffix(".lock")) continue;
+      if (HasSuffix(".old")) Journal.resize(Journal.size() - 4);
+      Journals.insert(Slash == std::string::npos ? Journal : Directory + Journal);
+    }
+    closedir(Dir);
+  }
+  return std::vector<std::string>(Journals.begin(), Journals.end());
+}
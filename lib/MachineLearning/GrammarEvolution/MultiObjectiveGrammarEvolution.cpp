@@ -0,0 +1,279 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file MultiObjectiveGrammarEvolution.cpp
+ */
+
+#include "pinhao/MachineLearning/GrammarEvolution/MultiObjectiveGrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/Candidate.h"
+#include "pinhao/MachineLearning/GrammarEvolution/Formula.h"
+
+#include "pinhao/Optimizer/OptimizationSequence.h"
+#include "pinhao/Support/Pareto.h"
+#include "pinhao/Support/Random.h"
+#include "pinhao/Support/WorkerPool.h"
+#include "pinhao/Support/YamlOptions.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace pinhao;
+
+/*
+ * -------------------------------------
+ *  Class: MultiObjectiveGrammarEvolution
+ */
+static config::YamlOpt<std::string> SequenceFile
+("sequence", "The file which contains a sequence of optimization.", false, ".sequence.yaml");
+
+static config::YamlOpt<int> CompileTimeSamples
+("compile-time-samples", "The number of times each candidate is compiled to time it.", false, 3);
+
+static double getSecondsSince(std::chrono::steady_clock::time_point Start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+}
+
+static void printObjectives(const std::vector<double> &Objectives) {
+  std::cerr << "Objectives:";
+  for (auto O : Objectives)
+    std::cerr << " " << O;
+  std::cerr << std::endl;
+}
+
+MultiObjectiveGrammarEvolution::MultiObjectiveGrammarEvolution(std::shared_ptr<llvm::Module> Module, std::string KBFilename,
+    double EvolveProb, double MaxEvolutionRate, double MutateProb) :
+  SimpleGrammarEvolution(Module, KBFilename, EvolveProb, MaxEvolutionRate, MutateProb),
+  BaseSize(0), BaseTime(0) {}
+
+double pinhao::MultiObjectiveGrammarEvolution::measureCompileTime(OptimizationSequence &OptSequence,
+    OptimizedModule &Compiled, double &Size) {
+  // The compile time is much less noisy than the run time, so it gets its own budget.
+  unsigned Samples = std::max(CompileTimeSamples.get(), 1);
+  RobustEstimate Estimate;
+  bool Measured = measureRepeatedly([this, &OptSequence, &Compiled] (double &Time) {
+        auto Start = std::chrono::steady_clock::now();
+        Compiled.reset(applyOptimizations(*Module, &OptSequence));
+        Time = getSecondsSince(Start);
+        return (bool) Compiled;
+      }, RepetitionPolicy(Samples, Samples), Estimate);
+  if (!Measured) return 0;
+
+  // The code generation is the same work the JIT does before running it. It is done
+  // once, for the size, and its time added to the median.
+  auto Start = std::chrono::steady_clock::now();
+  Size = getObjectSize(*Compiled, &OptSequence);
+  return Estimate.Median + getSecondsSince(Start);
+}
+
+std::vector<double> pinhao::MultiObjectiveGrammarEvolution::
+compileAndMeasureAll(OptimizationSequence &OptSequence) {
+  OptimizedModule Compiled;
+  double Size = 0;
+  double Time = measureCompileTime(OptSequence, Compiled, Size);
+  if (!Compiled || !(Time > 0)) return std::vector<double>();
+
+  auto Samples = measureCostRepeatedly(*Compiled);
+  if (Samples.empty()) return Samples;
+
+  std::vector<double> Values = { Size, Time };
+  Values.insert(Values.end(), Samples.begin(), Samples.end());
+  appendFingerprint(Values, MeasurementDatabase::hashModule(*Compiled));
+  return Values;
+}
+
+std::vector<std::vector<double>> pinhao::MultiObjectiveGrammarEvolution::
+evaluateObjectives(std::vector<Candidate> &Candidates, FeatureSet *Set, bool HasElite,
+    std::vector<bool> *Fresh) {
+  if (Fresh) Fresh->assign(Candidates.size(), false);
+  std::vector<OptimizationSequence> Sequences;
+  std::vector<Phenotype> Phenotypes;
+  std::map<Phenotype, uint64_t> Pending;
+
+  for (uint64_t J = 0; J < Candidates.size(); ++J) {
+    OptimizationSequence OptSequence = getOptimizationSequence(Candidates[J], Set);
+    Phenotype P(OptSequence);
+    Phenotypes.push_back(P);
+
+    auto *Cached = Cache.peek(P);
+    bool Remeasure = HasElite && J + 1 == Candidates.size() && Cached &&
+      Cached->Evaluations < getEliteEvaluations();
+    if ((Evaluated.count(P) && !Remeasure) || Pending.count(P)) continue;
+    if (Fresh) (*Fresh)[J] = true;
+    Pending[P] = Sequences.size();
+    Sequences.push_back(OptSequence);
+  }
+
+  std::vector<WorkerPool::Task> Tasks;
+  for (uint64_t I = 0; I < Sequences.size(); ++I)
+    Tasks.push_back([this, &Sequences, I] () -> WorkerPool::Values {
+          return compileAndMeasureAll(Sequences[I]);
+        });
+
+  WorkerPool Pool(getEvaluationWorkers());
+  auto Results = Pool.map(Tasks);
+
+  // The objectives measured in this call, which are the ones returned even if an older
+  // measurement is kept in Evaluated.
+  std::map<Phenotype, std::vector<double>> Measured;
+  for (auto &Pair : Pending) {
+    auto &Values = Results[Pair.second];
+    auto &Objectives = Measured[Pair.first];
+    uint64_t Fingerprint = takeFingerprint(Values);
+
+    std::vector<double> Samples;
+    if (Values.size() > 2) Samples.assign(Values.begin() + 2, Values.end());
+
+    double SpeedUp = storeEvaluation(Sequences[Pair.second], Pair.first, Samples, nullptr, Fingerprint);
+    if (SpeedUp > 0) {
+      Objectives.push_back(1 / SpeedUp);
+      Objectives.push_back(BaseSize > 0 ? Values[0] / BaseSize : 1);
+      Objectives.push_back(BaseTime > 0 ? Values[1] / BaseTime : 1);
+    }
+
+    // A failure does not replace a phenotype that was measured before.
+    if (!Objectives.empty() || !Evaluated.count(Pair.first))
+      Evaluated[Pair.first] = Objectives;
+  }
+
+  std::vector<std::vector<double>> AllObjectives;
+  for (auto &P : Phenotypes) {
+    auto It = Measured.find(P);
+    AllObjectives.push_back(It != Measured.end() ? It->second : Evaluated[P]);
+    printObjectives(AllObjectives.back());
+  }
+
+  return AllObjectives;
+}
+
+void pinhao::MultiObjectiveGrammarEvolution::addObjectives(const Candidate &C, 
+    const std::vector<double> &Objectives, bool Fresh) {
+  if (!Fresh) {
+    addCachedScore(C, Objectives.empty() ? FailureScore : 1 / Objectives[0], Objectives);
+    return;
+  }
+
+  if (!Objectives.empty()) {
+    addEvaluation(C, 1 / Objectives[0], Objectives);
+    return;
+  }
+
+  // The objectives measured before are not averaged with a failure, which has none.
+  loadStoredEntryOf(C);
+  auto It = KnowledgeBase.find(C);
+  if (It != KnowledgeBase.end() && !It->Objectives.empty()) {
+    std::cerr << "Skipping a failed evaluation of a candidate with objectives." << std::endl;
+    return;
+  }
+
+  addEvaluation(C, FailureScore);
+}
+
+std::vector<std::vector<double>> pinhao::MultiObjectiveGrammarEvolution::
+getObjectivePoints(std::vector<Candidate> &Population, std::vector<uint64_t> &Stored) {
+  std::vector<std::vector<double>> Points;
+  for (auto &C : KnowledgeBase)
+    if (C.Objectives.size() == 3) {
+      Population.push_back(C);
+      Points.push_back(C.Objectives);
+    }
+
+  // The objectives of the entries are read from the index, without their formulas.
+  for (uint64_t N = 0; StoredKnowledgeBase.isOpen() && N < StoredKnowledgeBase.size(); ++N) {
+    if (LoadedEntries[N] || StoredKnowledgeBase.getEntry(N).Objectives != 3) continue;
+    Stored.push_back(N);
+    Points.push_back(StoredKnowledgeBase.getObjectives(N));
+  }
+  return Points;
+}
+
+std::vector<Candidate> pinhao::MultiObjectiveGrammarEvolution::getParetoRanking(uint64_t N) {
+  std::vector<Candidate> Population;
+  std::vector<uint64_t> Stored;
+  auto Points = getObjectivePoints(Population, Stored);
+
+  std::vector<Candidate> Ranking;
+  for (auto I : getParetoOrder(Points)) {
+    if (Ranking.size() >= N) break;
+    if (I < Population.size()) {
+      Ranking.push_back(Population[I]);
+      continue;
+    }
+
+    Candidate C;
+    if (loadStoredCandidate(Stored[I - Population.size()], &C))
+      Ranking.push_back(C);
+  }
+  return Ranking;
+}
+
+void pinhao::MultiObjectiveGrammarEvolution::run(int CandidatesNumber, int GenerationsNumber, 
+    std::shared_ptr<FeatureSet> Set) {
+  getSequence(SequenceFile.get());
+
+  SimpleEvolution EvolutionStrategy(MutateProbability, Set.get());
+
+  addPreDefinedDecisionPoints();
+
+  BaseLine = measureBaseLine();
+  if (!(BaseLine > 0)) return;
+
+  importKnowledgeBase();
+  warmStart(Set.get());
+
+  OptimizationSequence Empty;
+  OptimizedModule Original;
+  BaseTime = measureCompileTime(Empty, Original, BaseSize);
+  std::cerr << "Object size: " << BaseSize << " Compile time: " << BaseTime << "s" << std::endl;
+
+  for (int I = 0; I < GenerationsNumber; ++I) {
+    auto Ranking = getParetoRanking(std::max(CandidatesNumber, 0));
+    std::vector<Candidate> BestCandidates = Ranking;
+
+    bool HasElite = BestCandidates.size() > 0;
+    if (HasElite) {
+      for (auto &C : BestCandidates) {
+        double EvolveDie = UniformRandom::getRandomReal();
+        if (EvolveDie < EvolveProbability) {
+          C.evolve(MaxEvolutionRate, &EvolutionStrategy);
+        }
+      }
+
+      // The least crowded point of the first front is measured again.
+      BestCandidates.push_back(Ranking.front());
+    } else {
+      BestCandidates = getInitialPopulation(CandidatesNumber);
+    }
+
+    for (auto &C : BestCandidates)
+      C.generateMissing(DecisionPoints, Set.get());
+
+    std::vector<bool> Fresh;
+    auto AllObjectives = evaluateObjectives(BestCandidates, Set.get(), HasElite, &Fresh);
+
+    for (uint64_t J = 0; J < BestCandidates.size(); ++J)
+      addObjectives(BestCandidates[J], AllObjectives[J], Fresh[J]);
+
+    migrateCandidates(I);
+  }
+
+  std::vector<Candidate> Population;
+  std::vector<uint64_t> Stored;
+  auto Points = getObjectivePoints(Population, Stored);
+
+  auto Fronts = getParetoFronts(Points);
+  std::cerr << "Pareto front: " << (Fronts.empty() ? 0 : Fronts[0].size()) << " candidates." << std::endl;
+  if (!Fronts.empty())
+    for (auto J : Fronts[0])
+      printObjectives(Points[J]);
+
+  double Best = 0;
+  for (auto &C : Population)
+    Best = std::max(Best, C.Score);
+  for (auto N : Stored)
+    Best = std::max(Best, StoredKnowledgeBase.getEntry(N).Score);
+  std::cerr << "Best:" << Best << std::endl;
+  if (Best > 0) std::cerr << "Cycles:" << (uint64_t)(BaseLine/Best) << std::endl;
+
+  stop();
+}
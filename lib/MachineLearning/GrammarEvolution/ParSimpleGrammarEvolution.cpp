@@ -30,21 +30,33 @@ void pinhao::ParSimpleGrammarEvolution::addPreDefinedDecisionPoints() {
   }
 }
 
-llvm::Module *pinhao::ParSimpleGrammarEvolution::
-compileWithCandidate(llvm::Module *Module, Candidate &C, FeatureSet *Set) {
+OptimizationSequence pinhao::ParSimpleGrammarEvolution::
+getOptimizationSequence(Candidate &C, FeatureSet *Set) {
 
   OptimizationSet OptSet;
   OptimizationSequence OptSequence;
 
+  std::vector<DecisionPoint> DPs;
+  std::vector<std::shared_ptr<FormulaBase>> Formulas;
   for (auto &Pair : C) {
-    DecisionPoint DP(Pair.first);
-    FormulaBase *Form = Pair.second;
-    Form->solveFor(Set);
+    DPs.push_back(Pair.first);
+    Formulas.push_back(Pair.second);
+  }
+
+  // All the formulas are evaluated at once, unless they could not be compiled.
+  FormulaProgram &Program = Programs.get(Formulas);
+  bool Compiled = Program.isValid();
+  if (Compiled) Program.run(Set);
+
+  for (uint64_t I = 0; I < Formulas.size(); ++I) {
+    DecisionPoint &DP = DPs[I];
+    FormulaBase *Form = Formulas[I].get();
+    if (!Compiled) Form->solveFor(Set);
     if (DP.Name[0] != '~') {
 
-      std::string OptName = Pair.first.Name;
+      std::string OptName = DP.Name;
 
-      bool EnableOpt = getFormulaValue<bool>(Form);
+      bool EnableOpt = Compiled ? Program.getResult<bool>(I) : getFormulaValue<bool>(Form);
       if (EnableOpt)
         OptSet.addOptimization(getOptimization(OptName));
 
@@ -58,13 +70,13 @@ compileWithCandidate(llvm::Module *Module, Candidate &C, FeatureSet *Set) {
         switch (OptInfo.getArgType(N)) {
 
           case ValueType::Int:
-            OptInfo.setArg<int>(N, getFormulaValue<int>(Form));
+            OptInfo.setArg<int>(N, Compiled ? Program.getResult<int>(I) : getFormulaValue<int>(Form));
             break;
           case ValueType::Bool:
-            OptInfo.setArg<bool>(N, getFormulaValue<bool>(Form));
+            OptInfo.setArg<bool>(N, Compiled ? Program.getResult<bool>(I) : getFormulaValue<bool>(Form));
             break;
           case ValueType::Float:
-            OptInfo.setArg<double>(N, getFormulaValue<double>(Form));
+            OptInfo.setArg<double>(N, Compiled ? Program.getResult<double>(I) : getFormulaValue<double>(Form));
             break;
 
           default:
@@ -83,6 +95,6 @@ compileWithCandidate(llvm::Module *Module, Candidate &C, FeatureSet *Set) {
     OptSequence.push_back(Info);
   }
 
-  return applyOptimizations(*Module, &OptSet);
+  return OptSequence;
 }
 
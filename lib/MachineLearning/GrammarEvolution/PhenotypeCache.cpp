@@ -0,0 +1,90 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file PhenotypeCache.cpp
+ */
+
+#include "pinhao/MachineLearning/GrammarEvolution/PhenotypeCache.h"
+
+using namespace pinhao;
+
+PhenotypeCache::PhenotypeCache() : Hits(0), Misses(0) {}
+
+const PhenotypeCache::Entry *PhenotypeCache::find(const Phenotype &P) {
+  auto It = Entries.find(P);
+  if (It == Entries.end()) {
+    ++Misses;
+    return nullptr;
+  }
+
+  ++Hits;
+  return It->second.get();
+}
+
+const PhenotypeCache::Entry *PhenotypeCache::peek(const Phenotype &P) const {
+  auto It = Entries.find(P);
+  if (It == Entries.end()) return nullptr;
+  return It->second.get();
+}
+
+void PhenotypeCache::countHit() {
+  ++Hits;
+}
+
+void PhenotypeCache::insert(const Phenotype &P, double Fitness, std::shared_ptr<llvm::Module> Compiled,
+    uint64_t Fingerprint) {
+  auto E = std::make_shared<Entry>(Entry { Fitness, 1, Compiled, Fingerprint });
+  Entries[P] = E;
+  if (Fingerprint) Fingerprints[Fingerprint] = E;
+}
+
+void PhenotypeCache::add(const Phenotype &P, double Fitness, std::shared_ptr<llvm::Module> Compiled,
+    uint64_t Fingerprint) {
+  std::shared_ptr<Entry> E;
+  auto It = Entries.find(P);
+  if (It != Entries.end()) {
+    E = It->second;
+  } else if (Fingerprint) {
+    auto FIt = Fingerprints.find(Fingerprint);
+    if (FIt != Fingerprints.end()) E = Entries[P] = FIt->second;
+  }
+
+  if (!E) {
+    insert(P, Fitness, Compiled, Fingerprint);
+    return;
+  }
+
+  if (Fingerprint && !E->Fingerprint) {
+    E->Fingerprint = Fingerprint;
+    Fingerprints[Fingerprint] = E;
+  }
+
+  if (!(E->Fitness > 0)) {
+    E->Fitness = Fitness;
+    E->Evaluations = 1;
+    E->Compiled = Compiled;
+    return;
+  }
+  if (!(Fitness > 0)) return;
+
+  E->Fitness = (E->Fitness * E->Evaluations + Fitness) / (E->Evaluations + 1);
+  ++E->Evaluations;
+  if (Compiled) E->Compiled = Compiled;
+}
+
+uint64_t PhenotypeCache::getNumberOfHits() const {
+  return Hits;
+}
+
+uint64_t PhenotypeCache::getNumberOfMisses() const {
+  return Misses;
+}
+
+uint64_t PhenotypeCache::size() const {
+  return Entries.size();
+}
+
+void PhenotypeCache::printStatistics(std::ostream &Out) const {
+  Out << "PhenotypeCache: " << Hits << " hits, " << Misses << " misses, " 
+    << Entries.size() << " entries." << std::endl;
+}
@@ -7,12 +7,26 @@
 #include "pinhao/MachineLearning/GrammarEvolution/SimpleGrammarEvolution.h"
 #include "pinhao/MachineLearning/GrammarEvolution/Candidate.h"
 #include "pinhao/MachineLearning/GrammarEvolution/Formula.h"
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaBatch.h"
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaPool.h"
 
 #include "pinhao/Optimizer/OptimizationSet.h"
+#include "pinhao/Optimizer/OptimizationTrie.h"
 #include "pinhao/PerformanceAnalyser/PAPIWrapper.h"
+#include "pinhao/Support/FileLock.h"
+#include "pinhao/Support/Hash.h"
 #include "pinhao/Support/YamlOptions.h"
+#include "pinhao/Support/WorkerPool.h"
+#include "pinhao/Support/YAMLWrapper.h"
+
+#include "llvm/Transforms/Utils/Cloning.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include <unistd.h>
 
 using namespace pinhao;
 
@@ -20,16 +34,19 @@ using namespace pinhao;
  * -------------------------------------
  *  Class: SimpleEvolution
  */
-void SimpleEvolution::mutate(std::unique_ptr<FormulaBase>* Form) {
+void SimpleEvolution::mutate(FormulaRef* Form) {
   ValueType Type = (*Form)->getType();
-  (*Form).reset(generateFormula(Set, Type).release());
+  (*Form) = generateFormula(Set, Type);
 }
 
-void SimpleEvolution::evolve(std::vector<std::unique_ptr<FormulaBase>*> Vector) {
+void SimpleEvolution::evolve(std::vector<FormulaRef*> Vector) {
   int Chosen = UniformRandom::getRandomInt(0, Vector.size()-1);
   double Die = UniformRandom::getRandomReal();
   if (Die <= M) mutate(Vector[Chosen]);
-  else (*Vector[Chosen])->evolve(this);
+  else {
+    makeFormulaUnique(*Vector[Chosen]);
+    (*Vector[Chosen])->evolve(this);
+  }
 } 
 
 void SimpleEvolution::evolve(std::pair<std::string, std::string> &Pair) {
@@ -55,32 +72,431 @@ void SimpleEvolution::evolve(bool &Value) {
 static config::YamlOpt<std::string> SequenceFile
 ("sequence", "The file which contains a sequence of optimization.", false, ".sequence.yaml");
 
+static config::YamlOpt<int> EvaluationWorkers
+("eval-workers", "The number of candidates compiled and measured at the same time.", false, 1);
+
+static config::YamlOpt<int> HelperProcesses
+("helper-processes", "The number of long-lived processes that compile and measure the candidates. If zero, each candidate is evaluated in a new process.", false, 0);
+
+static config::YamlOpt<double> HelperTimeout
+("helper-timeout", "Kills the helper processes that take more than this many seconds to answer, failing their candidate. If zero, they are never killed for it.", false, 600);
+
+static config::YamlOpt<bool> CacheModules
+("cache-modules", "Keeps the modules compiled in this process, together with their fitness.", false, false);
+
+static config::YamlOpt<int> EliteEvaluations
+("elite-evaluations", "The number of times the phenotype of the best candidate is measured before its cached fitness is reused. Averaging them keeps a lucky measurement from holding it on top.", false, 3);
+
+static config::YamlOpt<std::string> MeasurementDatabaseFile
+("measurement-db", "The file where the measurements are stored, and reused across runs. If empty, they are not stored.", false, "");
+
+static config::YamlOpt<int> MinSamples
+("min-samples", "The minimum number of times each module is measured.", false, 3);
+
+static config::YamlOpt<int> MaxSamples
+("max-samples", "The maximum number of times each module is measured.", false, 10);
+
+static config::YamlOpt<double> MaxIntervalWidth
+("ci-width", "Stops measuring a module when the confidence interval of its median cost is narrower than this fraction of the median.", false, 0.02);
+
+static config::YamlOpt<double> IntervalConfidence
+("confidence", "The confidence level of the interval of the median cost.", false, 0.95);
+
+static config::YamlOpt<double> BudgetFactor
+("budget-factor", "Kills the measurements that take more than this many times the baseline cycles. If zero, they are never killed for it.", false, 3);
+
+static config::YamlOpt<double> MeasurementTimeout
+("timeout", "Kills the measurements that take more than this many seconds. If zero, they are never killed for it.", false, 0);
+
+static config::YamlOpt<std::vector<std::string>> IslandAddresses
+("islands", "The addresses (unix:<path> or tcp:<host>:<port>) of all the islands that evolve together. If empty, this process evolves alone.", false, std::vector<std::string>());
+
+static config::YamlOpt<int> IslandId
+("island-id", "The position of this island in the list of islands.", false, 0);
+
+static config::YamlOpt<std::string> MigrationTopology
+("migration-topology", "Where each island sends its emigrants: ring or complete.", false, "ring");
+
+static config::YamlOpt<int> MigrationInterval
+("migration-interval", "The number of generations between two migrations.", false, 1);
+
+static config::YamlOpt<int> MigrationSize
+("migration-size", "The number of best candidates that emigrate.", false, 2);
+
+static config::YamlOpt<double> MigrationTimeout
+("migration-timeout", "How many seconds an island waits for the emigrants of another one.", false, 60);
+
+static config::YamlOpt<bool> FusedMeasurement
+("fused-measurement", "Optimizes each candidate in the same process that JIT compiles and measures it, so the optimized module never leaves that process. Needs the fork server, and is not used for the modules kept by cache-modules.", false, true);
+
+static config::YamlOpt<bool> SharePrefixes
+("share-prefixes", "Compiles the candidates of a generation in this process, applying each prefix common to their sequences only once. Only when they are not evaluated by helper processes.", false, false);
+
+static config::YamlOpt<bool> ForkServer
+("fork-server", "JIT compiles each module once, and forks a copy of it for each run measured.", false, true);
+
+static config::YamlOpt<int> ResidentCandidates
+("kb-resident", "The number of best candidates of a binary knowledge base (.kb) loaded on startup. The others are loaded when they rank among the candidates evolved.", false, 1000);
+
+static config::YamlOpt<bool> JournalKnowledgeBase
+("kb-journal", "Appends each evaluation to a journal beside the knowledge base, so that it survives a crash. The journals left by crashed runs are merged by the next run.", false, true);
+
+static config::YamlOpt<int> JournalSyncEvery
+("kb-journal-sync", "The number of candidates appended to the journal between two syncs to the disk.", false, 16);
+
+static config::YamlOpt<int> CompactEvery
+("kb-compact-every", "The number of candidates appended to the journal before it is folded into the knowledge base, in the background. If zero, only at the end of the run.", false, 1000);
+
+static config::YamlOpt<std::string> CorpusFile
+("kb-corpus", "The knowledge base shared by the modules of a corpus. A module evolved for the first time starts from the best candidates of its nearest modules (by their static features), and its own are added at the end of the run.", false, "");
+
+static config::YamlOpt<int> CorpusNeighbours
+("kb-corpus-neighbours", "The number of nearest modules of the corpus whose candidates start the evolution.", false, 3);
+
+static config::YamlOpt<int> CorpusCandidates
+("kb-corpus-best", "The number of best candidates of each module stored in the corpus.", false, 8);
+
 SimpleGrammarEvolution::~SimpleGrammarEvolution() {
 
 }
 
 SimpleGrammarEvolution::SimpleGrammarEvolution(std::shared_ptr<llvm::Module> Module, std::string KBFilename,
     double EvolveProb, double MaxEvolutionRate, double MutateProb) : 
-  GrammarEvolution(Module, KBFilename, EvolveProb, MaxEvolutionRate, MutateProb) {
+  GrammarEvolution(Module, KBFilename, EvolveProb, MaxEvolutionRate, MutateProb),
+  BaseLine(0), FailureScore(0.7), ModuleHash(0), Reused(0), Loaded(0), SeedsUsed(0) {
 
   }
 
-llvm::Module *pinhao::SimpleGrammarEvolution::
-compileWithCandidate(llvm::Module *Module, Candidate &C, FeatureSet *Set) {
+/// @brief Averages @a Evaluation with its candidate in @a Evaluations, or inserts it.
+template <class Compare, class Order>
+static void mergeInto(SerialSet<Candidate, Compare, Order> &Evaluations, const Candidate &Evaluation) {
+  auto It = Evaluations.find(Evaluation);
+  if (It == Evaluations.end()) {
+    Evaluations.insert(Evaluation);
+    return;
+  }
+
+  Candidate Merged = *It;
+  Merged.merge(Evaluation);
+  Evaluations.update(Merged);
+}
+
+void pinhao::SimpleGrammarEvolution::importKnowledgeBase() {
+  if (JournalKnowledgeBase.get()) recoverJournals();
+
+  Loaded = 0;
+  LoadedEntries.clear();
+  if (!BinaryKnowledgeBase::isBinary(KnowledgeBaseFile)) {
+    GrammarEvolution::importKnowledgeBase();
+  } else if (StoredKnowledgeBase.open(KnowledgeBaseFile)) {
+    LoadedEntries.assign(StoredKnowledgeBase.size(), false);
+    loadBestCandidates(std::max(ResidentCandidates.get(), 0));
+    std::cerr << "KnowledgeBase: " << Loaded << " of " << StoredKnowledgeBase.size() << 
+      " candidates loaded." << std::endl;
+  } else if (std::ifstream(KnowledgeBaseFile).good()) {
+    std::cerr << "Could not read the knowledge base " << KnowledgeBaseFile << std::endl;
+  }
+
+  if (!JournalKnowledgeBase.get()) return;
+
+  char Host[256] = "";
+  gethostname(Host, sizeof(Host) - 1);
+  Journal.reset(new KnowledgeBaseJournal(getJournalPrefix() + Host + "." + std::to_string(getpid()),
+        JournalSyncEvery.get()));
+  Journal->open([](const Candidate&) {});
+}
+
+std::string pinhao::SimpleGrammarEvolution::getJournalPrefix() const {
+  return KnowledgeBaseFile + ".journal.";
+}
+
+void pinhao::SimpleGrammarEvolution::recoverJournals() {
+  // A crash may have left journals that were merged already, but not removed.
+  JournalMarks Merged;
+  if (!readJournalMarks(KnowledgeBaseFile, Merged)) {
+    std::cerr << "Could not read the journals merged into " << KnowledgeBaseFile <<
+      ". They are left for the next run." << std::endl;
+    return;
+  }
+
+  SerialSet<Candidate> Recovered;
+  JournalMarks Recovering;
+  std::vector<std::unique_ptr<KnowledgeBaseJournal>> Crashed;
+  uint64_t Replayed = 0;
+  for (auto &Name : KnowledgeBaseJournal::list(getJournalPrefix())) {
+    std::unique_ptr<KnowledgeBaseJournal> Orphan(new KnowledgeBaseJournal(Name));
+    Replayed += Orphan->open([&Recovered](const Candidate &C) { mergeInto(Recovered, C); }, Merged[Name]);
+    if (!Orphan->isOpen()) continue;
+    Recovering[Name] = Orphan->getLastMark();
+    Crashed.push_back(std::move(Orphan));
+  }
+
+  if (!Recovered.empty() && !mergeKnowledgeBase(KnowledgeBaseFile, KnowledgeBase.getSet(), Recovered.getSet(), Recovering)) {
+    std::cerr << "Could not merge the journals of the runs that crashed. They are left for the next run." << std::endl;
+    return;
+  }
+
+  if (Replayed)
+    std::cerr << "KnowledgeBase: " << Replayed << " evaluations recovered from " << Crashed.size() <<
+      " journals." << std::endl;
+  for (auto &Orphan : Crashed)
+    Orphan->remove();
+}
+
+void pinhao::SimpleGrammarEvolution::exportKnowledgeBase() {
+  if (Journal) Journal->wait();
+  if (!writeKnowledgeBase()) return;
+
+  Unsaved.clear();
+  if (Journal) Journal->clear();
+}
+
+bool pinhao::SimpleGrammarEvolution::writeKnowledgeBase() {
+  SerialSet<Candidate> Evaluations = Unsaved;
+  JournalMarks Merged;
+  if (Journal) {
+    // The compaction may have merged the ".old" journal, but not removed it.
+    JournalMarks Stored;
+    if (!readJournalMarks(KnowledgeBaseFile, Stored)) return false;
+    Journal->replayCompacting([&Evaluations](const Candidate &C) { mergeInto(Evaluations, C); },
+        Stored[Journal->getFilename()]);
+    Merged[Journal->getFilename()] = Journal->getLastMark();
+  }
+  return mergeKnowledgeBase(KnowledgeBaseFile, KnowledgeBase.getSet(), Evaluations.getSet(), Merged);
+}
+
+bool pinhao::SimpleGrammarEvolution::loadStoredCandidate(uint64_t N, Candidate *Decoded) {
+  if (LoadedEntries[N]) return false;
+  LoadedEntries[N] = true;
+
+  Candidate C;
+  if (!StoredKnowledgeBase.get(N, C)) {
+    std::cerr << "Skipping the malformed candidate " << N << " of " << KnowledgeBaseFile << std::endl;
+    return false;
+  }
+
+  auto It = KnowledgeBase.find(C);
+  if (It != KnowledgeBase.end()) {
+    Candidate Merged = *It;
+    Merged.merge(C);
+    KnowledgeBase.update(Merged);
+    if (Decoded) *Decoded = Merged;
+  } else {
+    KnowledgeBase.insert(C);
+    if (Decoded) *Decoded = C;
+  }
+  return true;
+}
+
+void pinhao::SimpleGrammarEvolution::loadBestCandidates(uint64_t N) {
+  if (!StoredKnowledgeBase.isOpen() || !N) return;
+
+  // The N best scores of the knowledge base, in decreasing order.
+  std::multiset<double, std::greater<double>> Best;
+  for (uint64_t I = 0, E = std::min<uint64_t>(N, KnowledgeBase.size()); I < E; ++I)
+    Best.insert(KnowledgeBase.get(I).Score);
+
+  // The index is sorted, so the next entry is the best one that may not be loaded yet.
+  for (; Loaded < StoredKnowledgeBase.size(); ++Loaded) {
+    if (LoadedEntries[Loaded]) continue;
+
+    double Score = StoredKnowledgeBase.getEntry(Loaded).Score;
+    if (Best.size() == N && !(Score > *Best.rbegin())) break;
+
+    loadStoredCandidate(Loaded);
+    Best.insert(Score);
+    if (Best.size() > N) Best.erase(std::prev(Best.end()));
+  }
+}
+
+void pinhao::SimpleGrammarEvolution::loadStoredEntryOf(const Candidate &C) {
+  if (!StoredKnowledgeBase.isOpen() || KnowledgeBase.has(C)) return;
+
+  uint64_t N = StoredKnowledgeBase.find(BinaryKnowledgeBase::encode(C));
+  if (N < StoredKnowledgeBase.size()) loadStoredCandidate(N);
+}
+
+void pinhao::SimpleGrammarEvolution::mergeEvaluation(const Candidate &Evaluation) {
+  loadStoredEntryOf(Evaluation);
+  // Like the journal and the knowledge base file, so an evaluation without objectives
+  // keeps the ones of its candidate.
+  mergeInto(KnowledgeBase, Evaluation);
+}
+
+void pinhao::SimpleGrammarEvolution::warmStart(FeatureSet *Set) {
+  if (CorpusFile.get().empty()) return;
+
+  ModuleFeatures = CorpusKnowledgeBase::getFeatures(Set);
+  if (!KnowledgeBase.empty() || ModuleFeatures.empty()) return;
+
+  CorpusKnowledgeBase Corpus;
+  Corpus.load(CorpusFile.get());
+  Seeds = Corpus.getSeeds(ModuleFeatures, std::max(CorpusNeighbours.get(), 0),
+      std::max(CorpusCandidates.get(), 0) * std::max(CorpusNeighbours.get(), 0),
+      Module->getModuleIdentifier());
+  SeedsUsed = 0;
+
+  std::cerr << "CorpusKnowledgeBase: " << Seeds.size() << " seeds from the " << Corpus.size()
+    << " modules of the corpus." << std::endl;
+}
+
+std::vector<Candidate> pinhao::SimpleGrammarEvolution::getInitialPopulation(uint64_t N) {
+  std::vector<Candidate> Population;
+  while (Population.size() < N && SeedsUsed < Seeds.size())
+    Population.push_back(Seeds[SeedsUsed++]);
+  Population.resize(N, Candidate());
+  return Population;
+}
+
+void pinhao::SimpleGrammarEvolution::updateCorpus() {
+  if (CorpusFile.get().empty() || ModuleFeatures.empty() || KnowledgeBase.empty()) return;
+
+  loadBestCandidates(std::max(CorpusCandidates.get(), 0));
+  // The runs of the other modules update it as well.
+  FileLock Lock(CorpusFile.get() + ".lock");
+  CorpusKnowledgeBase Corpus;
+  if (!Lock.isLocked() || !Corpus.load(CorpusFile.get())) return;
+  printGeneralization(Corpus);
+  Corpus.addModule(Module->getModuleIdentifier(), ModuleFeatures,
+      KnowledgeBase.getFirst(std::max(CorpusCandidates.get(), 0)));
+  if (!Corpus.save(CorpusFile.get()))
+    std::cerr << "Could not update the corpus " << CorpusFile.get() << std::endl;
+}
+
+/// @brief Adds the formulas of the decisions @a Points of @a C to @a Program.
+/// @return False if @a C does not have them all, or they could not be compiled.
+static bool compileDecisions(const Candidate &C, const std::vector<DecisionPoint> &Points,
+    FormulaProgram &Program) {
+  for (auto &DP : Points) {
+    auto It = C.find(DP);
+    if (It == C.end()) return false;
+    Program.add(It->second.get());
+  }
+  return Program.isValid();
+}
+
+void pinhao::SimpleGrammarEvolution::printGeneralization(const CorpusKnowledgeBase &Corpus) {
+  if (KnowledgeBase.empty()) return;
+
+  // Only the optimizations of the sequence are decided.
+  std::vector<DecisionPoint> Points;
+  for (auto O : Sequence)
+    Points.push_back(DecisionPoint(getOptimizationName((Optimization) O), ValueType::Bool));
+
+  FeatureLayout Layout;
+  FormulaProgram Best(Layout);
+  if (!compileDecisions(KnowledgeBase.get(0), Points, Best)) return;
+
+  std::vector<std::unique_ptr<FormulaProgram>> Own;
+  std::vector<uint64_t> Modules;
+  for (uint64_t N = 0; N < Corpus.size(); ++N) {
+    auto &M = Corpus.getModule(N);
+    if (M.Name == Module->getModuleIdentifier() || M.Candidates.empty()) continue;
+
+    std::unique_ptr<FormulaProgram> Program(new FormulaProgram(Layout));
+    if (!compileDecisions(M.Candidates.front(), Points, *Program)) continue;
+    Own.push_back(std::move(Program));
+    Modules.push_back(N);
+  }
+  if (Modules.empty()) return;
+
+  // The matrix has the columns of every feature used by the programs.
+  FeatureMatrix Matrix(Layout);
+  std::vector<std::vector<BytecodeValue>> Rows(Modules.size());
+  for (uint64_t R = 0; R < Modules.size(); ++R) {
+    if (!Corpus.getFeatureRow(Modules[R], Layout, Rows[R])) return;
+    Matrix.addRow(Rows[R]);
+  }
+
+  DecisionMatrix Decisions = BatchEvaluator().evaluate(Best, Matrix);
+  uint64_t Same = 0;
+  for (uint64_t R = 0; R < Modules.size(); ++R) {
+    Own[R]->run(Rows[R]);
+    bool Equal = true;
+    for (uint64_t I = 0; I < Points.size() && Equal; ++I)
+      Equal = Decisions.get<bool>(R, I) == Own[R]->getResult<bool>(I);
+    Same += Equal;
+  }
+
+  std::cerr << "Generalization: the best candidate decides as the best one of " << Same << " of "
+    << Modules.size() << " modules of the corpus." << std::endl;
+}
+
+void pinhao::SimpleGrammarEvolution::addEvaluation(const Candidate &C, double Score,
+    const std::vector<double> &Objectives) {
+  Candidate Evaluation = C;
+  Evaluation.Score = Score;
+  Evaluation.Count = 1;
+  Evaluation.Objectives = Objectives;
+  mergeEvaluation(Evaluation);
+  mergeInto(Unsaved, Evaluation);
+
+  if (!Journal) return;
+  Journal->append(Evaluation);
+  if (CompactEvery.get() <= 0 || Journal->size() < static_cast<uint64_t>(CompactEvery.get()))
+    return;
+
+  // The compaction moves every unsaved evaluation to the ".old" journal, which the
+  // child merges into the knowledge base file.
+  bool Started = Journal->compact([this]() {
+      JournalMarks Stored, Merged;
+      if (!readJournalMarks(KnowledgeBaseFile, Stored)) return false;
+
+      SerialSet<Candidate> Evaluations;
+      JournalMark &Last = Merged[Journal->getFilename()];
+      Journal->replayCompacting([&Evaluations](const Candidate &C) { mergeInto(Evaluations, C); },
+          Stored[Journal->getFilename()], &Last);
+      return mergeKnowledgeBase(KnowledgeBaseFile, KnowledgeBase.getSet(), Evaluations.getSet(), Merged);
+      });
+  if (Started) Unsaved.clear();
+}
+
+void pinhao::SimpleGrammarEvolution::addCachedScore(const Candidate &C, double Score,
+    const std::vector<double> &Objectives) {
+  Candidate Hit = C;
+  Hit.Score = Score;
+  Hit.Count = 0;
+  Hit.Objectives = Objectives;
+  mergeEvaluation(Hit);
+}
+
+void pinhao::SimpleGrammarEvolution::addScores(const std::vector<Candidate> &Candidates,
+    const std::vector<double> &Scores, const std::vector<bool> &Fresh) {
+  for (uint64_t J = 0; J < Candidates.size(); ++J) {
+    if (Fresh[J]) addEvaluation(Candidates[J], Scores[J]);
+    else addCachedScore(Candidates[J], Scores[J]);
+  }
+}
+
+OptimizationSequence pinhao::SimpleGrammarEvolution::
+getOptimizationSequence(Candidate &C, FeatureSet *Set) {
 
   OptimizationSet OptSet;
   OptimizationSequence OptSequence;
 
+  std::vector<std::string> OptNames;
+  std::vector<std::shared_ptr<FormulaBase>> Formulas;
   for (auto &Pair : C) {
     if (std::find(Optimizations.begin(), Optimizations.end(), Pair.first.Name) == Optimizations.end())
       continue;
-    FormulaBase *Form = Pair.second;
-    std::string OptName = Pair.first.Name;
+    OptNames.push_back(Pair.first.Name);
+    Formulas.push_back(Pair.second);
+  }
+
+  // All the formulas are evaluated at once, unless they could not be compiled.
+  FormulaProgram &Program = Programs.get(Formulas);
+  if (Program.isValid()) Program.run(Set);
+
+  for (uint64_t I = 0; I < Formulas.size(); ++I) {
+    bool EnableOpt = false;
+    if (Program.isValid()) EnableOpt = Program.getResult<bool>(I);
+    else {
+      Formulas[I]->solveFor(Set);
+      EnableOpt = getFormulaValue<bool>(Formulas[I].get());
+    }
 
-    Form->solveFor(Set);
-    bool EnableOpt = getFormulaValue<bool>(Form);
     if (EnableOpt)
-      OptSet.addOptimization(getOptimization(OptName));
+      OptSet.addOptimization(getOptimization(OptNames[I]));
   }
 
   for (auto O : Sequence) {
@@ -91,9 +507,467 @@ compileWithCandidate(llvm::Module *Module, Candidate &C, FeatureSet *Set) {
     OptSequence.push_back(Info);
   }
 
+  return OptSequence;
+}
+
+llvm::Module *pinhao::SimpleGrammarEvolution::
+compileWithCandidate(llvm::Module *Module, Candidate &C, FeatureSet *Set) {
+  OptimizationSequence OptSequence = getOptimizationSequence(C, Set);
+
+  auto *Entry = Cache.peek(Phenotype(OptSequence));
+  if (Entry && Entry->Compiled)
+    return cloneModule(*Entry->Compiled);
+
   return applyOptimizations(*Module, &OptSequence);
 }
 
+PAPIWrapper::Budget pinhao::SimpleGrammarEvolution::getBudget() {
+  // The baseline itself is measured without a budget.
+  if (!(BaseLine > 0)) return PAPIWrapper::Budget();
+  return PAPIWrapper::Budget(BaseLine * BudgetFactor.get(), MeasurementTimeout.get());
+}
+
+MeasurementDatabase::Budget pinhao::SimpleGrammarEvolution::getDatabaseBudget() {
+  PAPIWrapper::Budget B = getBudget();
+  return MeasurementDatabase::Budget(B.Cycles, B.Seconds);
+}
+
+double pinhao::SimpleGrammarEvolution::measureCost(llvm::Module &Compiled) {
+  auto PAPIPair = PAPIWrapper::getTotalCycles(Compiled, Argv, getBudget());
+  if (PAPIPair.first == PAPIWrapper::BudgetExceeded) 
+    return std::numeric_limits<double>::infinity();
+  if (PAPIPair.first != 0) return 0;
+  return PAPIPair.second;
+}
+
+std::string pinhao::SimpleGrammarEvolution::getMeasurementBackend() {
+  return "papi-cycles";
+}
+
+RepetitionPolicy pinhao::SimpleGrammarEvolution::getRepetitionPolicy() {
+  return RepetitionPolicy(std::max(MinSamples.get(), 1), std::max(MaxSamples.get(), 1),
+      MaxIntervalWidth.get(), IntervalConfidence.get());
+}
+
+std::vector<double> pinhao::SimpleGrammarEvolution::measureCostRepeatedly(llvm::Module &Compiled) {
+  if (!ForkServer.get()) return repeatMeasureCost(Compiled);
+
+  auto PAPIPair = PAPIWrapper::getTotalCyclesRepeatedly(Compiled, Argv, getRepetitionPolicy(), getBudget());
+  if (PAPIPair.first == PAPIWrapper::BudgetExceeded)
+    return { std::numeric_limits<double>::infinity() };
+  if (PAPIPair.first != 0) return std::vector<double>();
+  return PAPIPair.second.Samples;
+}
+
+std::vector<double> pinhao::SimpleGrammarEvolution::repeatMeasureCost(llvm::Module &Compiled) {
+  RobustEstimate Estimate;
+  bool Exceeded = false;
+  bool Measured = measureRepeatedly([this, &Compiled, &Exceeded] (double &Cost) {
+        Cost = measureCost(Compiled);
+        Exceeded = std::isinf(Cost);
+        return Cost > 0 && !Exceeded;
+      }, getRepetitionPolicy(), Estimate);
+
+  // A single run over the budget is enough to tell it is too slow.
+  if (Exceeded) return { std::numeric_limits<double>::infinity() };
+  if (!Measured) return std::vector<double>();
+  return Estimate.Samples;
+}
+
+double pinhao::SimpleGrammarEvolution::getSpeedUp(const std::vector<double> &Samples) {
+  if (Samples.empty()) return 0;
+
+  double Cost = getMedian(Samples);
+  if (std::isinf(Cost)) {
+    // It ran for at least the budget, so it is scored as if it took exactly that.
+    if (BudgetFactor.get() > 0) return std::min(FailureScore, 1 / BudgetFactor.get());
+    return FailureScore;
+  }
+
+  return BaseLine / Cost;
+}
+
+static void printEstimate(const std::vector<double> &Samples) {
+  RobustEstimate Estimate(Samples, IntervalConfidence.get());
+  std::cerr << "Median: " << Estimate.Median << " MAD: " << Estimate.MAD <<
+    " CI: [" << Estimate.Lower << ", " << Estimate.Upper << "] N: " << Samples.size() << std::endl;
+}
+
+double pinhao::SimpleGrammarEvolution::measureSpeedUp(llvm::Module &Compiled) {
+  return getSpeedUp(measureCostRepeatedly(Compiled));
+}
+
+MeasurementDatabase *pinhao::SimpleGrammarEvolution::getDatabase() {
+  if (MeasurementDatabaseFile.get().empty()) return nullptr;
+
+  if (!Database) {
+    Database.reset(new MeasurementDatabase(MeasurementDatabaseFile.get()));
+    ModuleHash = MeasurementDatabase::hashModule(*Module);
+    HostFingerprint = MeasurementDatabase::getHostFingerprint();
+  }
+
+  return Database.get();
+}
+
+MeasurementDatabase::Key pinhao::SimpleGrammarEvolution::getMeasurementKey(const std::string &Sequence) {
+  return { ModuleHash, Sequence, Argv, getMeasurementBackend(), HostFingerprint };
+}
+
+double pinhao::SimpleGrammarEvolution::measureBaseLine() {
+  MeasurementDatabase *DB = getDatabase();
+  // No sequence in YAML is a plain scalar, so this key is never taken by a candidate.
+  std::string BaseLineKey = "baseline";
+
+  if (DB && DB->has(getMeasurementKey(BaseLineKey))) 
+    return getMedian(DB->getSamples(getMeasurementKey(BaseLineKey)));
+
+  auto Samples = measureCostRepeatedly(*Module);
+  if (Samples.empty() || !(getMedian(Samples) > 0) || std::isinf(getMedian(Samples))) {
+    std::cerr << "Could not measure the base line of the module, so no candidate is evaluated." << std::endl;
+    return 0;
+  }
+
+  std::cerr << "BaseLine ";
+  printEstimate(Samples);
+  if (DB) DB->addSamples(getMeasurementKey(BaseLineKey), Samples);
+  return getMedian(Samples);
+}
+
+static std::string getSequenceString(const OptimizationSequence &OptSequence) {
+  YAMLWrapper::Emitter E;
+  YAMLWrapper::append(OptSequence, E);
+  return E.c_str();
+}
+
+/// @brief Whether the candidates are compiled together with an @a OptimizationTrie.
+static bool sharesPrefixes() {
+  return HelperProcesses.get() <= 0 && SharePrefixes.get();
+}
+
+/// @brief Gets the sequence under which the measurements of @a OptSequence are stored. A
+/// module compiled by an @a OptimizationTrie may differ from the one compiled at once, so
+/// its measurements are kept apart.
+static std::string getStoredSequenceString(const OptimizationSequence &OptSequence) {
+  if (sharesPrefixes()) return "share-prefixes:" + getSequenceString(OptSequence);
+  return getSequenceString(OptSequence);
+}
+
+static double getSecondsSince(std::chrono::steady_clock::time_point Start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+}
+
+std::vector<double> pinhao::SimpleGrammarEvolution::
+compileThenMeasure(OptimizationSequence &OptSequence, std::shared_ptr<llvm::Module> *Compiled,
+    uint64_t *Fingerprint) {
+  std::shared_ptr<llvm::Module> M(applyOptimizations(*Module, &OptSequence), ModuleDeleter());
+  if (!M) return std::vector<double>();
+
+  if (Fingerprint) *Fingerprint = MeasurementDatabase::hashModule(*M);
+  auto Samples = measureCostRepeatedly(*M);
+  if (Compiled) *Compiled = M;
+  return Samples;
+}
+
+std::vector<double> pinhao::SimpleGrammarEvolution::
+compileAndMeasure(OptimizationSequence &OptSequence, std::shared_ptr<llvm::Module> *Compiled,
+    uint64_t *Fingerprint) {
+  if (Compiled || !FusedMeasurement.get() || !ForkServer.get())
+    return compileThenMeasure(OptSequence, Compiled, Fingerprint);
+
+  auto PAPIPair = PAPIWrapper::getTotalCyclesRepeatedly(*Module, 
+      [&OptSequence] (llvm::Module &M) { runOptimizations(M, &OptSequence); },
+      Argv, getRepetitionPolicy(), getBudget(), Fingerprint);
+  if (PAPIPair.first == PAPIWrapper::BudgetExceeded)
+    return { std::numeric_limits<double>::infinity() };
+  if (PAPIPair.first != 0) return std::vector<double>();
+  return PAPIPair.second.Samples;
+}
+
+WorkerPool::Values pinhao::SimpleGrammarEvolution::
+compileAndMeasureInWorker(OptimizationSequence &OptSequence, std::shared_ptr<llvm::Module> *Compiled) {
+  uint64_t Fingerprint = 0;
+  WorkerPool::Values Values = compileAndMeasure(OptSequence, Compiled, &Fingerprint);
+  appendFingerprint(Values, Fingerprint);
+  return Values;
+}
+
+void pinhao::SimpleGrammarEvolution::appendFingerprint(WorkerPool::Values &Values, uint64_t Fingerprint) {
+  Values.push_back(Fingerprint >> 32);
+  Values.push_back(Fingerprint & 0xffffffff);
+}
+
+uint64_t pinhao::SimpleGrammarEvolution::takeFingerprint(WorkerPool::Values &Values) {
+  if (Values.size() < 2) {
+    Values.clear();
+    return 0;
+  }
+
+  uint64_t High = Values[Values.size() - 2], Low = Values.back();
+  Values.resize(Values.size() - 2);
+  return (High << 32) | Low;
+}
+
+std::string pinhao::SimpleGrammarEvolution::serveEvaluation(const std::string &Request) {
+  OptimizationSequence OptSequence;
+  YAMLWrapper::fill(OptSequence, YAML::Load(Request));
+
+  auto Start = std::chrono::steady_clock::now();
+  uint64_t Fingerprint = 0;
+  std::vector<double> Samples = compileAndMeasure(OptSequence, nullptr, &Fingerprint);
+  double Time = getSecondsSince(Start);
+
+  int Status = 0;
+  if (Samples.empty()) Status = 1;
+  else if (std::isinf(Samples.front())) Status = 2;
+
+  YAMLWrapper::Emitter E;
+  E << YAML::BeginMap;
+  E << YAML::Key << "status" << YAML::Value << Status;
+  E << YAML::Key << "samples" << YAML::Value << YAML::Flow << Samples;
+  E << YAML::Key << "time" << YAML::Value << Time;
+  E << YAML::Key << "fingerprint" << YAML::Value << toHexString(Fingerprint);
+  E << YAML::EndMap;
+  return E.c_str();
+}
+
+bool pinhao::SimpleGrammarEvolution::parseEvaluation(const std::string &Reply,
+    std::vector<double> &Samples, uint64_t &Fingerprint) {
+  try {
+    YAML::Node Node = YAML::Load(Reply);
+    if (!Node.IsMap() || !Node["status"] || !Node["samples"] || !Node["time"] || !Node["fingerprint"])
+      return false;
+
+    Samples = Node["samples"].as<std::vector<double>>();
+    Fingerprint = std::stoull(Node["fingerprint"].as<std::string>(), nullptr, 16);
+    std::cerr << "Status: " << Node["status"].as<int>() << 
+      " Time: " << Node["time"].as<double>() << std::endl;
+  } catch (std::exception &E) {
+    return false;
+  }
+  return true;
+}
+
+int pinhao::SimpleGrammarEvolution::getEvaluationWorkers() {
+  return EvaluationWorkers.get();
+}
+
+uint64_t pinhao::SimpleGrammarEvolution::getEliteEvaluations() {
+  return std::max(EliteEvaluations.get(), 1);
+}
+
+std::vector<std::vector<double>> pinhao::SimpleGrammarEvolution::
+evaluateSequences(std::vector<OptimizationSequence> &Sequences,
+    std::vector<std::shared_ptr<llvm::Module>> &Compiled, std::vector<uint64_t> &Fingerprints) {
+  std::vector<std::vector<double>> Costs;
+  Compiled.assign(Sequences.size(), nullptr);
+  Fingerprints.assign(Sequences.size(), 0);
+
+  if (HelperProcesses.get() > 0) {
+    if (!Helpers) 
+      Helpers.reset(new HelperPool(HelperProcesses.get(), 
+            [this] (const std::string &Request) { return serveEvaluation(Request); },
+            [] () { PAPIWrapper::initialize(); }, std::max(HelperTimeout.get(), 0.0)));
+
+    std::vector<std::string> Requests;
+    for (auto &OptSequence : Sequences)
+      Requests.push_back(getSequenceString(OptSequence));
+
+    auto Replies = Helpers->map(Requests);
+    for (uint64_t I = 0; I < Replies.size(); ++I) {
+      auto &R = Replies[I];
+      if (!R.Ok) {
+        Costs.push_back(std::vector<double>());
+        continue;
+      }
+
+      std::vector<double> Samples;
+      if (!parseEvaluation(R.Reply, Samples, Fingerprints[I])) {
+        std::cerr << "Skipping a malformed reply of a helper process." << std::endl;
+        Samples.clear();
+        Fingerprints[I] = 0;
+      }
+      Costs.push_back(Samples);
+    }
+  } else if (sharesPrefixes()) {
+    OptimizationTrie Trie(Sequences);
+    auto Start = std::chrono::steady_clock::now();
+    auto Modules = Trie.compile(*Module);
+    std::cerr << "OptimizationTrie: " << Trie.getNumberOfSharedPasses() << " of " <<
+      Trie.getNumberOfPasses() << " passes applied in " << getSecondsSince(Start) << "s." << std::endl;
+
+    for (uint64_t I = 0; I < Sequences.size(); ++I)
+      if (Modules[I]) Fingerprints[I] = MeasurementDatabase::hashModule(*Modules[I]);
+
+    // The workers are forked after the compilation, so they see the compiled modules.
+    std::vector<WorkerPool::Task> Tasks;
+    for (uint64_t I = 0; I < Sequences.size(); ++I) {
+      Tasks.push_back([this, &Modules, I] () -> WorkerPool::Values {
+        if (!Modules[I]) return WorkerPool::Values();
+        return measureCostRepeatedly(*Modules[I]);
+      });
+    }
+
+    WorkerPool Pool(EvaluationWorkers.get());
+    Costs = Pool.map(Tasks);
+    if (CacheModules.get()) Compiled = Modules;
+  } else {
+    std::vector<WorkerPool::Task> Tasks;
+    for (uint64_t I = 0; I < Sequences.size(); ++I) {
+      Tasks.push_back([this, &Sequences, &Compiled, I] () -> WorkerPool::Values {
+        // Only has effect when the task runs in this process.
+        return compileAndMeasureInWorker(Sequences[I], CacheModules.get() ? &Compiled[I] : nullptr);
+      });
+    }
+
+    WorkerPool Pool(EvaluationWorkers.get());
+    Costs = Pool.map(Tasks);
+    for (uint64_t I = 0; I < Costs.size(); ++I)
+      Fingerprints[I] = takeFingerprint(Costs[I]);
+  }
+
+  return Costs;
+}
+
+void pinhao::SimpleGrammarEvolution::migrateCandidates(int Generation) {
+  if (IslandAddresses.get().empty()) return;
+  if ((Generation + 1) % std::max(MigrationInterval.get(), 1) != 0) return;
+
+  if (!Archipelago)
+    Archipelago.reset(new Island(IslandId.get(), IslandAddresses.get(), 
+          Island::getTopology(MigrationTopology.get()), MigrationTimeout.get()));
+
+  auto Emigrants = KnowledgeBase.getFirst(std::max(MigrationSize.get(), 0));
+  YAMLWrapper::Emitter E;
+  E << YAML::BeginSeq;
+  for (auto &C : Emigrants)
+    YAMLWrapper::append(C, E);
+  E << YAML::EndSeq;
+
+  uint64_t Immigrants = 0, Dropped = 0;
+  for (auto &Message : Archipelago->migrate(E.c_str())) {
+    YAML::Node Node;
+    try {
+      Node = YAML::Load(Message);
+    } catch (YAML::Exception &Error) {
+      std::cerr << "Dropping a malformed migration: " << Error.what() << std::endl;
+      continue;
+    }
+    if (!Node.IsSequence()) {
+      std::cerr << "Dropping a migration that is not a list of candidates." << std::endl;
+      continue;
+    }
+
+    for (auto I = Node.begin(), IE = Node.end(); I != IE; ++I) {
+      Candidate C;
+      try {
+        YAMLWrapper::fill(C, *I);
+      } catch (std::exception &Error) {
+        ++Dropped;
+        continue;
+      }
+      // They keep the score given by their island, unless we have evaluated them already.
+      loadStoredEntryOf(C);
+      if (KnowledgeBase.has(C)) continue;
+      KnowledgeBase.insert(C);
+      ++Immigrants;
+    }
+  }
+
+  std::cerr << "Migration: " << Emigrants.size() << " sent, " << 
+    Immigrants << " new received, " << Dropped << " malformed dropped." << std::endl;
+}
+
+bool pinhao::SimpleGrammarEvolution::findScore(const OptimizationSequence &OptSequence, 
+    const Phenotype &P, double &Score) {
+  if (auto *Entry = Cache.find(P)) {
+    Score = Entry->Fitness;
+    return true;
+  }
+
+  MeasurementDatabase *DB = getDatabase();
+  if (!DB) return false;
+
+  auto Samples = DB->getSamples(getMeasurementKey(getStoredSequenceString(OptSequence)), getDatabaseBudget());
+  if (Samples.empty()) return false;
+
+  Score = getSpeedUp(Samples);
+  Cache.insert(P, Score);
+  ++Reused;
+  return true;
+}
+
+double pinhao::SimpleGrammarEvolution::storeEvaluation(const OptimizationSequence &OptSequence, 
+    const Phenotype &P, const std::vector<double> &Samples, std::shared_ptr<llvm::Module> Compiled,
+    uint64_t Fingerprint) {
+  double SpeedUp = 0;
+  MeasurementDatabase *DB = getDatabase();
+
+  // No samples if the worker died, or any measurement failed.
+  if (!Samples.empty()) {
+    printEstimate(Samples);
+    SpeedUp = getSpeedUp(Samples);
+    if (DB) DB->addSamples(getMeasurementKey(getStoredSequenceString(OptSequence)), Samples, getDatabaseBudget());
+  }
+
+  Cache.add(P, SpeedUp, Compiled, Fingerprint);
+  return SpeedUp;
+}
+
+std::vector<double> pinhao::SimpleGrammarEvolution::evaluateCandidates(std::vector<Candidate> &Candidates,
+    FeatureSet *Set, bool HasElite, std::vector<bool> *Fresh) {
+  std::vector<double> Scores(Candidates.size(), 0);
+  if (Fresh) Fresh->assign(Candidates.size(), false);
+
+  std::vector<OptimizationSequence> Sequences;
+  std::vector<Phenotype> Phenotypes;
+  std::map<Phenotype, uint64_t> Pending;
+  // The index in Sequences of each candidate that is not in the cache.
+  std::vector<int64_t> Evaluation(Candidates.size(), -1);
+
+  for (uint64_t J = 0; J < Candidates.size(); ++J) {
+    OptimizationSequence OptSequence = getOptimizationSequence(Candidates[J], Set);
+    Phenotype P(OptSequence);
+
+    auto It = Pending.find(P);
+    if (It != Pending.end()) {
+      Cache.countHit();
+      Evaluation[J] = It->second;
+      continue;
+    }
+
+    auto *Cached = Cache.peek(P);
+    bool Remeasure = HasElite && J + 1 == Candidates.size() && Cached &&
+      Cached->Evaluations < getEliteEvaluations();
+    if (!Remeasure && findScore(OptSequence, P, Scores[J]))
+      continue;
+
+    if (Fresh) (*Fresh)[J] = true;
+    Evaluation[J] = Sequences.size();
+    Pending[P] = Sequences.size();
+    Sequences.push_back(OptSequence);
+    Phenotypes.push_back(P);
+  }
+
+  std::vector<std::shared_ptr<llvm::Module>> Compiled;
+  std::vector<uint64_t> Fingerprints;
+  auto Costs = evaluateSequences(Sequences, Compiled, Fingerprints);
+
+  std::vector<double> SpeedUps(Sequences.size(), 0);
+  for (uint64_t I = 0; I < Sequences.size(); ++I)
+    SpeedUps[I] = storeEvaluation(Sequences[I], Phenotypes[I], Costs[I], Compiled[I], Fingerprints[I]);
+
+  for (uint64_t J = 0; J < Candidates.size(); ++J) {
+    if (Evaluation[J] >= 0) Scores[J] = SpeedUps[Evaluation[J]];
+    if (!(Scores[J] > 0)) Scores[J] = FailureScore;
+    std::cerr << "SpeedUp: " << Scores[J] << std::endl;
+  }
+
+  Cache.printStatistics();
+  if (getDatabase()) 
+    std::cerr << "MeasurementDatabase: " << Reused << " reused so far, " << Sequences.size() << " measured." << std::endl;
+  return Scores;
+}
+
 void pinhao::SimpleGrammarEvolution::run(int CandidatesNumber, int GenerationsNumber, 
     std::shared_ptr<FeatureSet> Set) {
   typedef std::pair<double, Candidate> RankingPair;
@@ -104,31 +978,21 @@ void pinhao::SimpleGrammarEvolution::run(int CandidatesNumber, int GenerationsNu
   SimpleEvolution EvolutionStrategy(MutateProbability, Set.get());
 
   addPreDefinedDecisionPoints();
+
+  BaseLine = measureBaseLine();
+  if (!(BaseLine > 0)) return;
+
   importKnowledgeBase();
+  warmStart(Set.get());
 
   std::set<RankingPair, DecendantOrder> Ranking;
 
-  uint64_t BaseLine = PAPIWrapper::getTotalCycles(*Module, Argv).second;
-
   for (int I = 0; I < GenerationsNumber; ++I) {
-    std::set<RankingPair, DecendantOrder> RankingTmp;
-
-    std::set<Candidate, CompareByScore> ScoreSet;
-    for (auto &C : KnowledgeBase)
-      ScoreSet.insert(C); 
-
-    int Count = 0;
-    std::vector<Candidate> BestCandidates;
-    for (auto &C : ScoreSet) {
-      if (Count >= CandidatesNumber) break;
-      Candidate *Clone = C.clone();
-      BestCandidates.push_back(*Clone); 
-      ++Count;
-
-      delete Clone;
-    }
+    loadBestCandidates(CandidatesNumber);
+    std::vector<Candidate> BestCandidates = KnowledgeBase.getFirst(std::max(CandidatesNumber, 0));
+    bool HasElite = BestCandidates.size() > 0;
 
-    if (BestCandidates.size() > 0) {
+    if (HasElite) {
       for (auto &C : BestCandidates) {
         double EvolveDie = UniformRandom::getRandomReal();
         if (EvolveDie < EvolveProbability) {
@@ -136,43 +1000,21 @@ void pinhao::SimpleGrammarEvolution::run(int CandidatesNumber, int GenerationsNu
         }
       }
 
-      BestCandidates.push_back(*ScoreSet.begin());
+      BestCandidates.push_back(KnowledgeBase.get(0));
     } else {
-      BestCandidates = std::vector<Candidate>(CandidatesNumber, Candidate()); 
+      BestCandidates = getInitialPopulation(CandidatesNumber);
     }
 
-    for (auto &C : BestCandidates) {
+    for (auto &C : BestCandidates)
       C.generateMissing(DecisionPoints, Set.get());
 
-      auto Compiled = compileWithCandidate(Module.get(), C, Set.get());
-      if (Compiled) {
-        auto PAPIPair = PAPIWrapper::getTotalCycles(*Compiled, Argv);
-        if (PAPIPair.first == 0) {
-          double SpeedUp = (double) BaseLine / PAPIPair.second;
-          RankingTmp.insert(std::make_pair(SpeedUp, C));
-          std::cerr << "SpeedUp: " << SpeedUp << std::endl;
-          continue;
-        }
-      }
-      std::cerr << "SpeedUp: 0.7" << std::endl;
-      RankingTmp.insert(std::make_pair(0.7, C));
-    }
-
-    for (auto RPair : RankingTmp) {
-      Candidate C = RPair.second;
-
-      if (KnowledgeBase.has(C)) {
-        C.Score = ((C.Count * C.Score) + RPair.first) / (C.Count + 1); 
-        ++C.Count;
-      } else {
-        C.Score = RPair.first;
-        C.Count = 1;
-      }
-
-      KnowledgeBase.update(C);
-      Ranking.insert(RPair);
-    }
+    std::vector<bool> Fresh;
+    auto Scores = evaluateCandidates(BestCandidates, Set.get(), HasElite, &Fresh);
+    addScores(BestCandidates, Scores, Fresh);
+    for (uint64_t J = 0; J < BestCandidates.size(); ++J)
+      Ranking.insert(std::make_pair(Scores[J], BestCandidates[J]));
 
+    migrateCandidates(I);
   }
 
   std::cerr << "Best:" << (*Ranking.begin()).first << std::endl;
@@ -181,5 +1023,8 @@ void pinhao::SimpleGrammarEvolution::run(int CandidatesNumber, int GenerationsNu
 }
 
 void pinhao::SimpleGrammarEvolution::stop() {
+  FormulaPool::get().printStatistics();
+  Programs.printStatistics();
   exportKnowledgeBase();
+  updateCorpus();
 }
@@ -0,0 +1,156 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file SteadyStateGrammarEvolution.cpp
+ */
+
+#include "pinhao/MachineLearning/GrammarEvolution/SteadyStateGrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/Candidate.h"
+#include "pinhao/MachineLearning/GrammarEvolution/Formula.h"
+
+#include "pinhao/Support/Random.h"
+#include "pinhao/Support/WorkerPool.h"
+#include "pinhao/Support/YamlOptions.h"
+
+#include <chrono>
+#include <map>
+
+using namespace pinhao;
+
+/*
+ * -------------------------------------
+ *  Class: SteadyStateGrammarEvolution
+ */
+static config::YamlOpt<std::string> SequenceFile
+("sequence", "The file which contains a sequence of optimization.", false, ".sequence.yaml");
+
+static double getSecondsSince(std::chrono::steady_clock::time_point Start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+}
+
+SteadyStateGrammarEvolution::SteadyStateGrammarEvolution(std::shared_ptr<llvm::Module> Module, std::string KBFilename,
+    double EvolveProb, double MaxEvolutionRate, double MutateProb) :
+  SimpleGrammarEvolution(Module, KBFilename, EvolveProb, MaxEvolutionRate, MutateProb) {}
+
+Candidate pinhao::SteadyStateGrammarEvolution::breedCandidate(int CandidatesNumber, 
+    SimpleEvolution *EvolutionStrategy, FeatureSet *Set) {
+  loadBestCandidates(std::max(CandidatesNumber, 1));
+  Candidate Offspring;
+  if (SeedsUsed < Seeds.size()) {
+    // The seeds of the corpus are measured before anything is bred.
+    Offspring = getInitialPopulation(1).front();
+  } else if (!KnowledgeBase.empty()) {
+    int Best = std::min<int>(std::max(CandidatesNumber, 1), KnowledgeBase.size());
+    Offspring = KnowledgeBase.get(UniformRandom::getRandomInt(0, Best - 1));
+
+    // There is no elite to measure again, so the offspring always evolves.
+    Offspring.evolve(MaxEvolutionRate, EvolutionStrategy);
+  }
+
+  Offspring.generateMissing(DecisionPoints, Set);
+  return Offspring;
+}
+
+void pinhao::SteadyStateGrammarEvolution::mergeCandidate(Candidate C, double Score, bool Fresh) {
+  if (!(Score > 0)) Score = FailureScore;
+  std::cerr << "SpeedUp: " << Score << std::endl;
+
+  if (Fresh) addEvaluation(C, Score);
+  else addCachedScore(C, Score);
+}
+
+void pinhao::SteadyStateGrammarEvolution::run(int CandidatesNumber, int GenerationsNumber, 
+    std::shared_ptr<FeatureSet> Set) {
+  struct Evaluation {
+    OptimizationSequence Sequence;
+    Phenotype P;
+    std::chrono::steady_clock::time_point Start;
+  };
+
+  getSequence(SequenceFile.get());
+
+  SimpleEvolution EvolutionStrategy(MutateProbability, Set.get());
+
+  addPreDefinedDecisionPoints();
+
+  BaseLine = measureBaseLine();
+  if (!(BaseLine > 0)) return;
+
+  importKnowledgeBase();
+  warmStart(Set.get());
+
+  // As many evaluations as in the generational run, the elite included.
+  uint64_t PerGeneration = CandidatesNumber + 1;
+  uint64_t Budget = GenerationsNumber * PerGeneration;
+  uint64_t Bred = 0, Merged = 0, Round = 0;
+  double BestScore = 0, Busy = 0;
+
+  WorkerPool Pool(getEvaluationWorkers());
+  std::map<uint64_t, Evaluation> Running;
+  // The offspring waiting for the evaluation of their phenotype.
+  std::map<Phenotype, std::vector<Candidate>> Waiting;
+
+  auto Start = std::chrono::steady_clock::now();
+  auto Merge = [&] (const Candidate &C, double Score, bool Fresh) {
+    mergeCandidate(C, Score, Fresh);
+    BestScore = std::max(BestScore, Score);
+    ++Merged;
+  };
+
+  while (Merged < Budget) {
+    while (Bred < Budget && Pool.getNumberOfPending() < Pool.getNumberOfWorkers()) {
+      Candidate C = breedCandidate(CandidatesNumber, &EvolutionStrategy, Set.get());
+      ++Bred;
+
+      OptimizationSequence OptSequence = getOptimizationSequence(C, Set.get());
+      Phenotype P(OptSequence);
+
+      auto It = Waiting.find(P);
+      if (It != Waiting.end()) {
+        Cache.countHit();
+        It->second.push_back(C);
+        continue;
+      }
+
+      double Score = 0;
+      if (findScore(OptSequence, P, Score)) {
+        Merge(C, Score, false);
+        continue;
+      }
+
+      uint64_t Id = Pool.submit([this, OptSequence] () mutable -> WorkerPool::Values {
+            return compileAndMeasureInWorker(OptSequence);
+          });
+      Running.insert(std::make_pair(Id, Evaluation { OptSequence, P, std::chrono::steady_clock::now() }));
+      Waiting[P].push_back(C);
+    }
+
+    if (Pool.getNumberOfPending() == 0) break;
+
+    auto Result = Pool.wait();
+    auto &E = Running.find(Result.first)->second;
+    Busy += getSecondsSince(E.Start);
+
+    uint64_t Fingerprint = takeFingerprint(Result.second);
+    double Score = storeEvaluation(E.Sequence, E.P, Result.second, nullptr, Fingerprint);
+    // Only the first offspring was measured, and the others are cache hits.
+    auto &Offspring = Waiting[E.P];
+    for (uint64_t I = 0; I < Offspring.size(); ++I)
+      Merge(Offspring[I], Score, I == 0);
+
+    Waiting.erase(E.P);
+    Running.erase(Result.first);
+
+    while (Merged >= (Round + 1) * PerGeneration)
+      migrateCandidates(Round++);
+  }
+
+  double Elapsed = getSecondsSince(Start);
+  Cache.printStatistics();
+  std::cerr << "Evaluations: " << Merged << " in " << Elapsed << "s. Utilization: " << 
+    (Elapsed > 0 ? Busy / (Elapsed * Pool.getNumberOfWorkers()) : 0) << std::endl;
+
+  std::cerr << "Best:" << BestScore << std::endl;
+  if (BestScore > 0) std::cerr << "Cycles:" << (uint64_t)(BaseLine/BestScore) << std::endl;
+  stop();
+}
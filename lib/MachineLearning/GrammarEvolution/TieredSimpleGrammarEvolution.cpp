@@ -0,0 +1,198 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file TieredSimpleGrammarEvolution.cpp
+ */
+
+#include "pinhao/MachineLearning/GrammarEvolution/TieredSimpleGrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/Candidate.h"
+#include "pinhao/MachineLearning/GrammarEvolution/Formula.h"
+
+#include "pinhao/PerformanceAnalyser/GEOSWrapper.h"
+#include "pinhao/PerformanceAnalyser/SProfWrapper.h"
+#include "pinhao/Support/Statistics.h"
+#include "pinhao/Support/WorkerPool.h"
+#include "pinhao/Support/YamlOptions.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace pinhao;
+
+/*
+ * -------------------------------------
+ *  Class: TieredSimpleGrammarEvolution
+ */
+static config::YamlOpt<std::string> SequenceFile
+("sequence", "The file which contains a sequence of optimization.", false, ".sequence.yaml");
+
+static config::YamlOpt<std::string> ScreenModel
+("screen-model", "The static cost model that screens the candidates: sprof or geos.", false, "sprof");
+
+static config::YamlOpt<int> ScreenFactor
+("screen-factor", "How many times more candidates are screened than in a plain generation.", false, 5);
+
+static config::YamlOpt<double> ScreenFraction
+("screen-fraction", "The fraction of the screened candidates that is measured.", false, 0.2);
+
+TieredSimpleGrammarEvolution::TieredSimpleGrammarEvolution(std::shared_ptr<llvm::Module> Module, std::string KBFilename,
+    double EvolveProb, double MaxEvolutionRate, double MutateProb) :
+  SimpleGrammarEvolution(Module, KBFilename, EvolveProb, MaxEvolutionRate, MutateProb),
+  StaticBaseLine(0) {
+    if (ScreenModel.get() == "geos")
+      GEOSWrapper::loadCallCostFile(*Module);
+  }
+
+double pinhao::TieredSimpleGrammarEvolution::measureStaticCost(llvm::Module &Compiled) {
+  double Cost = 0;
+  if (ScreenModel.get() == "geos") {
+    // GEOS gives no cost for the modules it can not analyse, which are unscreenable.
+    auto Costs = GEOSWrapper::repairAndAnalyse(Compiled);
+    if (!Costs.empty()) Cost = Costs.back();
+  } else Cost = SProfWrapper::getModuleCost(Compiled);
+
+  if (Cost > 0.01) return Cost;
+  return 0;
+}
+
+std::vector<double> pinhao::TieredSimpleGrammarEvolution::
+screenCandidates(std::vector<Candidate> &Candidates, FeatureSet *Set) {
+  std::vector<Phenotype> Phenotypes;
+  std::vector<OptimizationSequence> Sequences;
+  std::map<Phenotype, uint64_t> Pending;
+
+  for (auto &C : Candidates) {
+    OptimizationSequence OptSequence = getOptimizationSequence(C, Set);
+    Phenotype P(OptSequence);
+    Phenotypes.push_back(P);
+
+    if (Screened.count(P) || Pending.count(P)) continue;
+    Pending[P] = Sequences.size();
+    Sequences.push_back(OptSequence);
+  }
+
+  std::vector<WorkerPool::Task> Tasks;
+  for (uint64_t I = 0; I < Sequences.size(); ++I) {
+    Tasks.push_back([this, &Sequences, I] () -> WorkerPool::Values {
+      OptimizedModule Compiled(applyOptimizations(*Module, &Sequences[I]));
+      if (!Compiled) return WorkerPool::Values();
+      return { measureStaticCost(*Compiled) };
+    });
+  }
+
+  WorkerPool Pool(getEvaluationWorkers());
+  auto Costs = Pool.map(Tasks);
+  for (auto &Pair : Pending)
+    Screened[Pair.first] = Costs[Pair.second].empty() ? 0 : Costs[Pair.second].front();
+
+  std::vector<double> Predictions;
+  for (auto &P : Phenotypes) {
+    double Cost = Screened[P];
+    Predictions.push_back(Cost > 0 ? StaticBaseLine / Cost : 0);
+  }
+
+  return Predictions;
+}
+
+void pinhao::TieredSimpleGrammarEvolution::printCorrelation(const std::vector<double> &Predictions,
+    const std::vector<double> &Scores) {
+  Predicted.insert(Predicted.end(), Predictions.begin(), Predictions.end());
+  Measured.insert(Measured.end(), Scores.begin(), Scores.end());
+
+  std::cerr << "Spearman: " << getSpearmanCorrelation(Predictions, Scores) <<
+    " Overall: " << getSpearmanCorrelation(Predicted, Measured) <<
+    " (" << Measured.size() << " measured)" << std::endl;
+}
+
+void pinhao::TieredSimpleGrammarEvolution::run(int CandidatesNumber, int GenerationsNumber,
+    std::shared_ptr<FeatureSet> Set) {
+  typedef std::pair<double, Candidate> RankingPair;
+  typedef std::greater<RankingPair> DecendantOrder;
+
+  getSequence(SequenceFile.get());
+
+  SimpleEvolution EvolutionStrategy(MutateProbability, Set.get());
+
+  addPreDefinedDecisionPoints();
+
+  BaseLine = measureBaseLine();
+  if (!(BaseLine > 0)) return;
+
+  importKnowledgeBase();
+  warmStart(Set.get());
+
+  std::set<RankingPair, DecendantOrder> Ranking;
+
+  if (ScreenModel.get() == "geos")
+    GEOSWrapper::getFrequencies(*Module, Argv);
+  StaticBaseLine = measureStaticCost(*Module);
+  if (!(StaticBaseLine > 0)) {
+    // The ranking, and so the Spearman correlation, are the same with any baseline.
+    std::cerr << "The " << ScreenModel.get() << " model could not analyse the original module. " <<
+      "The predictions are relative to a baseline of 1." << std::endl;
+    StaticBaseLine = 1;
+  }
+
+  int Factor = std::max(ScreenFactor.get(), 1);
+
+  for (int I = 0; I < GenerationsNumber; ++I) {
+    loadBestCandidates(CandidatesNumber);
+    std::vector<Candidate> Parents = KnowledgeBase.getFirst(std::max(CandidatesNumber, 0));
+
+    std::vector<Candidate> Explored;
+    for (int K = 0; K < Factor; ++K) {
+      for (auto &C : Parents) {
+        Explored.push_back(C);
+
+        // The first copies evolve as in a plain generation, and the others always do.
+        double EvolveDie = UniformRandom::getRandomReal();
+        if (K > 0 || EvolveDie < EvolveProbability)
+          Explored.back().evolve(MaxEvolutionRate, &EvolutionStrategy);
+      }
+    }
+
+    bool HasElite = !KnowledgeBase.empty();
+    if (HasElite) Explored.push_back(KnowledgeBase.get(0));
+    else Explored = getInitialPopulation(CandidatesNumber * Factor);
+
+    for (auto &C : Explored)
+      C.generateMissing(DecisionPoints, Set.get());
+
+    auto Predictions = screenCandidates(Explored, Set.get());
+
+    std::vector<uint64_t> Order;
+    for (uint64_t J = 0; J < Explored.size(); ++J)
+      if (!HasElite || J + 1 < Explored.size())
+        Order.push_back(J);
+    std::stable_sort(Order.begin(), Order.end(),
+        [&Predictions] (uint64_t L, uint64_t R) { return Predictions[L] > Predictions[R]; });
+
+    uint64_t Chosen = std::ceil(Order.size() * ScreenFraction.get());
+    Order.resize(std::min<uint64_t>(std::max<uint64_t>(Chosen, 1), Order.size()));
+    // The elite is always measured again.
+    if (HasElite) Order.push_back(Explored.size() - 1);
+
+    std::vector<Candidate> BestCandidates;
+    std::vector<double> ChosenPredictions;
+    for (auto J : Order) {
+      BestCandidates.push_back(Explored[J]);
+      ChosenPredictions.push_back(Predictions[J]);
+    }
+
+    std::cerr << "Screened: " << Explored.size() << " Measured: " << BestCandidates.size() << std::endl;
+
+    std::vector<bool> Fresh;
+    auto Scores = evaluateCandidates(BestCandidates, Set.get(), HasElite, &Fresh);
+    printCorrelation(ChosenPredictions, Scores);
+
+    addScores(BestCandidates, Scores, Fresh);
+    for (uint64_t J = 0; J < BestCandidates.size(); ++J)
+      Ranking.insert(std::make_pair(Scores[J], BestCandidates[J]));
+
+    migrateCandidates(I);
+  }
+
+  std::cerr << "Best:" << (*Ranking.begin()).first << std::endl;
+  std::cerr << "Cycles:" << (uint64_t)(BaseLine/(*Ranking.begin()).first) << std::endl;
+  stop();
+}
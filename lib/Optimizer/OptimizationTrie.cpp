@@ -0,0 +1,90 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file OptimizationTrie.cpp
+ */
+
+#include "pinhao/Optimizer/OptimizationTrie.h"
+
+#include <cassert>
+
+using namespace pinhao;
+
+OptimizationTrie::OptimizationTrie(const std::vector<OptimizationSequence> &Sequences) :
+  OLevel(Sequences.empty() ? OptLevel::None : Sequences.front().OLevel),
+  NumberOfSequences(Sequences.size()), NumberOfPasses(0), NumberOfNodes(0) {
+
+  for (uint64_t I = 0; I < Sequences.size(); ++I) {
+    assert(Sequences[I].OLevel == OLevel && "All sequences of a trie must have the same OLevel.");
+
+    Node *N = &Root;
+    for (auto &Info : Sequences[I]) {
+      auto &Child = N->Children[Info];
+      if (!Child) {
+        Child.reset(new Node());
+        ++NumberOfNodes;
+      }
+      N = Child.get();
+    }
+
+    N->Ends.push_back(I);
+    NumberOfPasses += Sequences[I].size();
+  }
+}
+
+uint64_t OptimizationTrie::getNumberOfPasses() const {
+  return NumberOfPasses;
+}
+
+uint64_t OptimizationTrie::getNumberOfSharedPasses() const {
+  return NumberOfNodes;
+}
+
+void OptimizationTrie::compile(const Node *N, OptimizedModule Module,
+    OptimizationSequence Pending, std::vector<std::shared_ptr<llvm::Module>> &Compiled) const {
+  // Nothing diverges along a chain, so it is applied at once.
+  while (N->Ends.empty() && N->Children.size() == 1) {
+    auto &Child = *N->Children.begin();
+    Pending.push_back(Child.first);
+    N = Child.second.get();
+  }
+
+  // The OLevel passes were applied by the first copy, but the target machine is still the
+  // one for the OLevel.
+  if (!Pending.empty())
+    runOptimizations(*Module, &Pending, false);
+
+  if (!N->Ends.empty()) {
+    std::shared_ptr<llvm::Module> Shared;
+    if (N->Children.empty()) Shared.reset(Module.release(), ModuleDeleter());
+    else Shared.reset(cloneModule(*Module), ModuleDeleter());
+
+    for (auto I : N->Ends)
+      Compiled[I] = Shared;
+  }
+
+  uint64_t Remaining = N->Children.size();
+  for (auto &Child : N->Children) {
+    OptimizedModule Copy;
+    // The last child takes the module itself.
+    if (--Remaining == 0) Copy = std::move(Module);
+    else Copy.reset(cloneModule(*Module));
+
+    OptimizationSequence Next(OLevel);
+    Next.push_back(Child.first);
+    compile(Child.second.get(), std::move(Copy), Next, Compiled);
+  }
+}
+
+std::vector<std::shared_ptr<llvm::Module>> OptimizationTrie::compile(llvm::Module &Module) const {
+  std::vector<std::shared_ptr<llvm::Module>> Compiled(NumberOfSequences);
+  if (NumberOfSequences == 0) return Compiled;
+
+  // Only the OLevel passes run in the copy, as they come before any sequence.
+  OptimizationSequence Empty(OLevel);
+  OptimizedModule Start(applyOptimizations(Module, &Empty));
+  if (!Start) return Compiled;
+
+  compile(&Root, std::move(Start), OptimizationSequence(OLevel), Compiled);
+  return Compiled;
+}
@@ -8,18 +8,20 @@
 #include "pinhao/Optimizer/Optimizations.h"
 #include "pinhao/Optimizer/OptimizationSet.h"
 #include "pinhao/Optimizer/OptimizationSequence.h"
+#include "pinhao/Support/YamlOptions.h"
+#include "pinhao/Support/IPC.h"
 
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
-#include "llvm/IRReader/IRReader.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Target/TargetOptions.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Support/TargetRegistry.h"
-#include "llvm/Support/SourceMgr.h"
-#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
@@ -29,9 +31,16 @@
 #include <unistd.h>
 #include <sys/wait.h>
 #include <algorithm>
+#include <functional>
+#include <tuple>
+#include <map>
+#include <mutex>
 
 using namespace pinhao;
 
+static config::YamlOpt<bool>
+ForkIsolation("opt-fork", "Applies the optimizations in a forked process, isolating passes that crash.", false, false);
+
 void pinhao::initializeOptimizer() {
   llvm::InitializeAllTargets();
   llvm::InitializeAllTargetMCs();
@@ -83,18 +92,19 @@ int pinhao::getPassKind(Optimization Opt) {
   return PassKind;
 }
 
-static void printModule(llvm::Module *Module, std::string Path) {
-  std::error_code Err;
-  llvm::raw_fd_ostream *Out = new llvm::raw_fd_ostream(Path, Err, llvm::sys::fs::OpenFlags::F_RW);
-  llvm::WriteBitcodeToFile(Module, *Out);   
-  Out->flush();
-  delete Out;
+static std::string writeBitcode(llvm::Module &Module) {
+  llvm::SmallVector<char, 0> Buffer;
+  llvm::raw_svector_ostream Out(Buffer);
+  llvm::WriteBitcodeToFile(&Module, Out);
+  return Out.str().str();
 }
 
-static llvm::Module *readModule(std::string Path) {
-  llvm::LLVMContext &Context = llvm::getGlobalContext();
-  llvm::SMDiagnostic Error;
-  return llvm::parseIRFile(Path, Error, Context).release();
+static std::unique_ptr<llvm::Module> parseBitcode(const std::string &Bitcode, std::string Name,
+    llvm::LLVMContext &Context) {
+  llvm::MemoryBufferRef Ref(Bitcode, Name);
+  auto Parsed = llvm::parseBitcodeFile(Ref, Context);
+  if (!Parsed) return nullptr;
+  return std::move(Parsed.get());
 }
 
 llvm::Module *pinhao::applyOptimizations(llvm::Module &Module, OptimizationSet *Set) {
@@ -137,134 +147,211 @@ static TargetMachine* GetTargetMachine(Triple TheTriple, StringRef CPUStr,
 
 }
 
-llvm::Module *pinhao::applyOptimizations(llvm::Module &Module, OptimizationSequence *Sequence) {
-  std::string TmpName = ".tmp-" + std::to_string(time(0));
+/// @brief Gets a target machine for @a Module, and sets its functions' attributes. The
+/// target machines are built once per thread, and kept for the next modules.
+static llvm::TargetMachine *getTargetMachine(llvm::Module &Module, OptimizationSequence *Sequence) {
+  typedef std::tuple<std::string, std::string, std::string, int> TargetKey;
+  static thread_local std::map<TargetKey, std::unique_ptr<llvm::TargetMachine>> Machines;
+
+  llvm::Triple ModuleTriple(Module.getTargetTriple());
+  std::string CPUStr, FeaturesStr;
+  llvm::TargetMachine *Machine = nullptr;
+
+  if (ModuleTriple.getArch()) {
+    CPUStr = getCPUStr();
+    FeaturesStr = getFeaturesStr();
+
+    TargetKey Key(ModuleTriple.getTriple(), CPUStr, FeaturesStr, static_cast<int>(Sequence->OLevel));
+    auto &Cached = Machines[Key];
+    if (!Cached) {
+      const llvm::TargetOptions Options = InitTargetOptionsFromCodeGenFlags();
+      Cached.reset(GetTargetMachine(ModuleTriple, CPUStr, FeaturesStr, 
+            Options, Sequence->OLevel));
+    }
+    Machine = Cached.get();
+  }
 
-  fflush(stdout);
-  pid_t Pid = fork();
+  setFunctionAttributes(CPUStr, FeaturesStr, Module);
+  return Machine;
+}
 
-  if (Pid == 0) {
-    llvm::legacy::PassManager PM; 
-    llvm::legacy::FunctionPassManager FPM(&Module);
-
-    // Populating with target machine analysis pass.
-    llvm::Triple ModuleTriple(Module.getTargetTriple());
-    std::string CPUStr, FeaturesStr;
-    llvm::TargetMachine *Machine = nullptr;
-    const llvm::TargetOptions Options = InitTargetOptionsFromCodeGenFlags();
-
-    if (ModuleTriple.getArch()) {
-      CPUStr = getCPUStr();
-      FeaturesStr = getFeaturesStr();
-      Machine = GetTargetMachine(ModuleTriple, CPUStr, FeaturesStr, 
-          Options, Sequence->OLevel);
-    }
+void pinhao::runOptimizations(llvm::Module &Module, OptimizationSequence *Sequence, bool WithOLevel) {
+  llvm::legacy::PassManager PM; 
+  llvm::legacy::FunctionPassManager FPM(&Module);
 
-    std::unique_ptr<llvm::TargetMachine> TM(Machine);
-    setFunctionAttributes(CPUStr, FeaturesStr, Module);
+  // Populating with target machine analysis pass.
+  llvm::TargetMachine *TM = getTargetMachine(Module, Sequence);
 
-    llvm::TargetLibraryInfoImpl TLII(ModuleTriple);
-    PM.add(new llvm::TargetLibraryInfoWrapperPass(TLII));
+  llvm::TargetLibraryInfoImpl TLII(llvm::Triple(Module.getTargetTriple()));
+  PM.add(new llvm::TargetLibraryInfoWrapperPass(TLII));
 
-    if (TM) {
-      PM.add(llvm::createTargetTransformInfoWrapperPass(TM->getTargetIRAnalysis()));
-      FPM.add(llvm::createTargetTransformInfoWrapperPass(TM->getTargetIRAnalysis()));
-    } else {
-      PM.add(llvm::createTargetTransformInfoWrapperPass(llvm::TargetIRAnalysis()));
-      FPM.add(llvm::createTargetTransformInfoWrapperPass(llvm::TargetIRAnalysis()));
-    }
+  if (TM) {
+    PM.add(llvm::createTargetTransformInfoWrapperPass(TM->getTargetIRAnalysis()));
+    FPM.add(llvm::createTargetTransformInfoWrapperPass(TM->getTargetIRAnalysis()));
+  } else {
+    PM.add(llvm::createTargetTransformInfoWrapperPass(llvm::TargetIRAnalysis()));
+    FPM.add(llvm::createTargetTransformInfoWrapperPass(llvm::TargetIRAnalysis()));
+  }
 
-    // Populating OLevel specific optimizations.
-    Sequence->populateWithOLevel(PM, FPM);
+  // Populating OLevel specific optimizations.
+  if (WithOLevel) Sequence->populateWithOLevel(PM, FPM);
 
-    FPM.doInitialization();
-    for (auto &F : Module)
-      FPM.run(F);
-    FPM.doFinalization();
+  FPM.doInitialization();
+  for (auto &F : Module)
+    FPM.run(F);
+  FPM.doFinalization();
 
-    // Populating with Sequence.
-    Sequence->populatePassManager(PM);
-    PM.run(Module);
+  // Populating with Sequence.
+  Sequence->populatePassManager(PM);
+  PM.run(Module);
+}
 
-    printModule(&Module, TmpName);
+void pinhao::runOptimizations(llvm::Function &Function, OptimizationSequence *Sequence) {
+  llvm::Module &Module = *Function.getParent();
+  llvm::legacy::FunctionPassManager FPM(&Module);
 
-    auto ReadCheck = readModule(TmpName);
-    if (!ReadCheck)
-      exit(1);
+  // Populating with target machine analysis pass.
+  llvm::TargetMachine *TM = getTargetMachine(Module, Sequence);
 
-    exit(0);
+  if (TM) {
+    FPM.add(llvm::createTargetTransformInfoWrapperPass(TM->getTargetIRAnalysis()));
+  } else {
+    FPM.add(llvm::createTargetTransformInfoWrapperPass(llvm::TargetIRAnalysis()));
   }
 
-  int Return;
-  waitpid(Pid, &Return, 0); 
-  if (Return != 0) {
-    std::cerr << "Failed when applying optimizations." << std::endl;
-    return nullptr;
+  Sequence->populateFunctionPassManager(FPM);
+
+  FPM.doInitialization();
+  FPM.run(Function);
+  FPM.doFinalization();
+}
+
+uint64_t pinhao::getObjectSize(llvm::Module &Module, OptimizationSequence *Sequence) {
+  std::unique_ptr<llvm::Module> Clone(llvm::CloneModule(&Module));
+  llvm::TargetMachine *TM = getTargetMachine(*Clone, Sequence);
+  if (!TM) return 0;
+
+  llvm::SmallVector<char, 0> Buffer;
+  llvm::raw_svector_ostream OS(Buffer);
+
+  llvm::legacy::PassManager PM;
+  llvm::TargetLibraryInfoImpl TLII(llvm::Triple(Clone->getTargetTriple()));
+  PM.add(new llvm::TargetLibraryInfoWrapperPass(TLII));
+
+  if (TM->addPassesToEmitFile(PM, OS, llvm::TargetMachine::CGFT_ObjectFile)) {
+    std::cerr << "The target can not emit object files." << std::endl;
+    return 0;
   }
 
-  llvm::Module *OptModule = readModule(TmpName);
-  remove(TmpName.c_str());
-  return OptModule;
+  PM.run(*Clone);
+  return Buffer.size();
 }
 
-llvm::Module *pinhao::applyOptimizations(llvm::Module &Module, std::string FunctionName, OptimizationSequence *Sequence) {
-  return applyOptimizations(Module, Module.getFunction(FunctionName), Sequence);
+/// @brief The contexts created for the modules optimized in-process, with the number of
+/// modules that still live in each one. A context is deleted with its last module, so the
+/// types and constants of old modules do not pile up.
+static std::mutex ContextsMutex;
+static std::map<llvm::LLVMContext*, std::pair<std::unique_ptr<llvm::LLVMContext>, uint64_t>> Contexts;
+
+/// @brief Copies @a Module into @a Context, through an in-memory bitcode buffer.
+static std::unique_ptr<llvm::Module> cloneIntoContext(llvm::Module &Module, llvm::LLVMContext &Context) {
+  return parseBitcode(writeBitcode(Module), Module.getModuleIdentifier(), Context);
 }
 
-llvm::Module *pinhao::applyOptimizations(llvm::Module &Module, llvm::Function *Function, OptimizationSequence *Sequence) {
-  std::string TmpName = ".tmp-" + std::to_string(time(0));
+typedef std::function<void(llvm::Module&)> ModuleTransform;
 
-  fflush(stdout);
-  pid_t Pid = fork();
-  if (Pid == 0) {
-    llvm::legacy::PassManager PM;
-    llvm::legacy::FunctionPassManager FPM(&Module);
-
-    // Populating with target machine analysis pass.
-    llvm::Triple ModuleTriple(Module.getTargetTriple());
-    std::string CPUStr, FeaturesStr;
-    llvm::TargetMachine *Machine = nullptr;
-    const llvm::TargetOptions Options = InitTargetOptionsFromCodeGenFlags();
-
-    if (ModuleTriple.getArch()) {
-      CPUStr = getCPUStr();
-      FeaturesStr = getFeaturesStr();
-      Machine = GetTargetMachine(ModuleTriple, CPUStr, FeaturesStr, 
-          Options, Sequence->OLevel);
-    }
+static llvm::Module *applyInProcess(llvm::Module &Module, ModuleTransform Transform) {
+  std::unique_ptr<llvm::LLVMContext> Context(new llvm::LLVMContext());
+  std::unique_ptr<llvm::Module> Clone = cloneIntoContext(Module, *Context);
+  if (!Clone) {
+    std::cerr << "Failed when cloning the module to apply optimizations." << std::endl;
+    return nullptr;
+  }
 
-    std::unique_ptr<llvm::TargetMachine> TM(Machine);
-    setFunctionAttributes(CPUStr, FeaturesStr, Module);
+  Transform(*Clone);
 
-    if (TM) {
-      FPM.add(llvm::createTargetTransformInfoWrapperPass(TM->getTargetIRAnalysis()));
-    } else {
-      FPM.add(llvm::createTargetTransformInfoWrapperPass(llvm::TargetIRAnalysis()));
-    }
+  std::lock_guard<std::mutex> Lock(ContextsMutex);
+  llvm::LLVMContext *Key = Context.get();
+  Contexts[Key] = std::make_pair(std::move(Context), 1);
+  return Clone.release();
+}
 
-    Sequence->populateFunctionPassManager(FPM);
+static llvm::Module *applyInFork(llvm::Module &Module, ModuleTransform Transform) {
+  int Fds[2];
+  if (pipe(Fds) != 0) {
+    std::cerr << "Could not create the pipe to apply optimizations." << std::endl;
+    return nullptr;
+  }
 
-    FPM.doInitialization();
-    FPM.run(*Function);
-    FPM.doFinalization();
+  fflush(stdout);
+  pid_t Pid = fork();
 
-    printModule(&Module, TmpName);
+  if (Pid == 0) {
+    close(Fds[0]);
+    Transform(Module);
 
-    auto ReadCheck = readModule(TmpName);
-    if (!ReadCheck)
+    std::string Bitcode = writeBitcode(Module);
+    llvm::LLVMContext CheckContext;
+    if (!parseBitcode(Bitcode, Module.getModuleIdentifier(), CheckContext))
       exit(1);
 
+    writeMessage(Fds[1], Bitcode);
     exit(0);
   }
 
+  close(Fds[1]);
+  std::string Bitcode;
+  bool Received = readMessage(Fds[0], Bitcode);
+  close(Fds[0]);
+
   int Return;
-  waitpid(Pid, &Return, 0);
-  if (Return != 0) {
+  waitpid(Pid, &Return, 0); 
+  if (Return != 0 || !Received) {
     std::cerr << "Failed when applying optimizations." << std::endl;
     return nullptr;
   }
 
-  llvm::Module *OptModule = readModule(TmpName);
-  remove(TmpName.c_str());
-  return OptModule;
+  return parseBitcode(Bitcode, Module.getModuleIdentifier(), llvm::getGlobalContext()).release();
+}
+
+static llvm::Module *apply(llvm::Module &Module, ModuleTransform Transform) {
+  if (ForkIsolation.get())
+    return applyInFork(Module, Transform);
+  return applyInProcess(Module, Transform);
+}
+
+llvm::Module *pinhao::applyOptimizations(llvm::Module &Module, OptimizationSequence *Sequence) {
+  return apply(Module, [Sequence] (llvm::Module &M) { runOptimizations(M, Sequence); });
+}
+
+llvm::Module *pinhao::applyOptimizations(llvm::Module &Module, std::string FunctionName, OptimizationSequence *Sequence) {
+  return applyOptimizations(Module, Module.getFunction(FunctionName), Sequence);
+}
+
+llvm::Module *pinhao::applyOptimizations(llvm::Module &Module, llvm::Function *Function, OptimizationSequence *Sequence) {
+  std::string FunctionName = Function->getName().str();
+  return apply(Module, [Sequence, FunctionName] (llvm::Module &M) { 
+        runOptimizations(*M.getFunction(FunctionName), Sequence); 
+      });
+}
+
+llvm::Module *pinhao::cloneModule(llvm::Module &Module) {
+  std::lock_guard<std::mutex> Lock(ContextsMutex);
+  auto It = Contexts.find(&Module.getContext());
+  if (It != Contexts.end()) ++It->second.second;
+  return llvm::CloneModule(&Module);
+}
+
+void pinhao::deleteModule(llvm::Module *Module) {
+  if (!Module) return;
+  llvm::LLVMContext *Context = &Module->getContext();
+  delete Module;
+
+  // The context is deleted after the lock is released.
+  std::unique_ptr<llvm::LLVMContext> Unused;
+  std::lock_guard<std::mutex> Lock(ContextsMutex);
+  auto It = Contexts.find(Context);
+  if (It == Contexts.end() || --It->second.second > 0) return;
+  Unused = std::move(It->second.first);
+  Contexts.erase(It);
 }
@@ -0,0 +1,76 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file Phenotype.cpp
+ */
+
+#include "pinhao/Optimizer/Phenotype.h"
+#include "pinhao/Optimizer/OptimizationSequence.h"
+
+using namespace pinhao;
+
+template <class T>
+static void appendBytes(std::string &Bytes, const T &Value) {
+  Bytes.append((const char*) &Value, sizeof(T));
+}
+
+static void appendArg(std::string &Bytes, const OptimizationInfo &Info, uint64_t N) {
+  switch (Info.getArgType(N)) {
+    case ValueType::Int:
+      appendBytes(Bytes, Info.getArg<int>(N));
+      break;
+    case ValueType::Float:
+      appendBytes(Bytes, Info.getArg<double>(N));
+      break;
+    case ValueType::Bool:
+      appendBytes(Bytes, Info.getArg<bool>(N));
+      break;
+    case ValueType::String: {
+      std::string Value = Info.getArg<std::string>(N);
+      appendBytes(Bytes, (uint64_t) Value.size());
+      Bytes.append(Value);
+      break;
+    }
+  }
+}
+
+Phenotype::Phenotype() : Enabled((Optimizations.size() + 63) / 64, 0) {}
+
+Phenotype::Phenotype(const OptimizationSequence &Sequence) : Phenotype() {
+  for (auto &Info : Sequence) {
+    uint64_t Opt = static_cast<uint64_t>(Info.getOptimization());
+    Enabled[Opt / 64] |= (uint64_t) 1 << (Opt % 64);
+
+    for (uint64_t I = 0, E = Info.getNumberOfArguments(); I < E; ++I)
+      appendArg(Args, Info, I);
+  }
+}
+
+bool Phenotype::isEnabled(Optimization Opt) const {
+  uint64_t N = static_cast<uint64_t>(Opt);
+  return (Enabled[N / 64] >> (N % 64)) & 1;
+}
+
+uint64_t Phenotype::getNumberOfEnabled() const {
+  uint64_t Count = 0;
+  for (auto Word : Enabled)
+    Count += __builtin_popcountll(Word);
+  return Count;
+}
+
+std::string Phenotype::getKey() const {
+  std::string Key;
+  for (auto Word : Enabled)
+    appendBytes(Key, Word);
+  return Key + Args;
+}
+
+bool Phenotype::operator<(const Phenotype &Rhs) const {
+  if (Enabled != Rhs.Enabled)
+    return Enabled < Rhs.Enabled;
+  return Args < Rhs.Args;
+}
+
+bool Phenotype::operator==(const Phenotype &Rhs) const {
+  return Enabled == Rhs.Enabled && Args == Rhs.Args;
+}
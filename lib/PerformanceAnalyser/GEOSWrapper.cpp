@@ -72,7 +72,7 @@ void GEOSWrapper::propagateToInstructions(ProfileModule &PModule) {
 
 void GEOSWrapper::getFrequencies(std::shared_ptr<ProfileModule> PModule, std::vector<std::string> Args) {
   llvm::SMDiagnostic Error;
-  llvm::LLVMContext &Context = llvm::getGlobalContext();
+  llvm::LLVMContext &Context = PModule->getLLVMModule()->getContext();
   llvm::Module *GEOSProfLib = parseIRFile(GEOSProfLibFile.get(), Error, Context).release();
 
   std::unique_ptr<GEOSProfiler> GProfiler(new GEOSProfiler());
@@ -0,0 +1,217 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file MeasurementDatabase.cpp
+ */
+
+#include "pinhao/PerformanceAnalyser/MeasurementDatabase.h"
+#include "pinhao/Support/Hash.h"
+
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "yaml-cpp/yaml.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <tuple>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+using namespace pinhao;
+
+uint64_t MeasurementDatabase::Key::getHash() const {
+  uint64_t Hash = combineHashes(FNVOffsetBasis, ModuleHash);
+  Hash = combineHashes(Hash, hashString(Sequence));
+  for (auto &Arg : Argv)
+    Hash = combineHashes(Hash, hashString(Arg));
+  Hash = combineHashes(Hash, hashString(Backend));
+  return combineHashes(Hash, hashString(Host));
+}
+
+bool MeasurementDatabase::Key::operator<(const Key &Rhs) const {
+  return std::tie(ModuleHash, Sequence, Argv, Backend, Host) <
+    std::tie(Rhs.ModuleHash, Rhs.Sequence, Rhs.Argv, Rhs.Backend, Rhs.Host);
+}
+
+bool MeasurementDatabase::Key::operator==(const Key &Rhs) const {
+  return std::tie(ModuleHash, Sequence, Argv, Backend, Host) ==
+    std::tie(Rhs.ModuleHash, Rhs.Sequence, Rhs.Argv, Rhs.Backend, Rhs.Host);
+}
+
+bool MeasurementDatabase::Budget::covers(const Budget &Other) const {
+  bool CoversCost = Cost == 0 || (Other.Cost != 0 && Other.Cost <= Cost);
+  bool CoversSeconds = Seconds == 0 || (Other.Seconds != 0 && Other.Seconds <= Seconds);
+  return CoversCost && CoversSeconds;
+}
+
+MeasurementDatabase::MeasurementDatabase(std::string Filename) : Filename(Filename) {
+  load();
+}
+
+bool MeasurementDatabase::loadDocument(const std::string &Text, bool &Torn) {
+  YAML::Node Document;
+  try {
+    Document = YAML::Load(Text);
+  } catch (YAML::Exception &E) {
+    Torn = true;
+    return false;
+  }
+
+  // The documents without their whole key (only its hash) can not be told apart.
+  if (!Document.IsMap() || !Document["samples"] || !Document["sequence"] || !Document["argv"])
+    return false;
+
+  Key K;
+  Budget B;
+  std::vector<double> NewSamples;
+  try {
+    K.ModuleHash = std::stoull(Document["module"].as<std::string>(), nullptr, 16);
+    K.Sequence = Document["sequence"].as<std::string>();
+    K.Argv = Document["argv"].as<std::vector<std::string>>();
+    K.Backend = Document["backend"].as<std::string>();
+    K.Host = Document["host"].as<std::string>();
+    if (Document["budget"]) {
+      B.Cost = Document["budget"]["cost"].as<double>();
+      B.Seconds = Document["budget"]["seconds"].as<double>();
+    }
+    NewSamples = Document["samples"].as<std::vector<double>>();
+  } catch (std::exception &E) {
+    return false;
+  }
+
+  insert(K, NewSamples, B);
+  return true;
+}
+
+void MeasurementDatabase::load() {
+  std::ifstream In(Filename, std::ios::binary);
+  if (!In.good()) return;
+  std::string Content((std::istreambuf_iterator<char>(In)), std::istreambuf_iterator<char>());
+  In.close();
+
+  // Each document starts at a "---" line, so one of them that is malformed does not
+  // hide the others.
+  std::vector<uint64_t> Starts;
+  for (uint64_t Offset = 0; Offset < Content.size(); ) {
+    uint64_t End = std::min<uint64_t>(Content.find('\n', Offset), Content.size());
+    if (Offset == 0 || !Content.compare(Offset, End - Offset, "---"))
+      Starts.push_back(Offset);
+    Offset = End + 1;
+  }
+
+  uint64_t Skipped = 0, Length = Content.size();
+  for (uint64_t I = 0; I < Starts.size(); ++I) {
+    uint64_t End = I + 1 < Starts.size() ? Starts[I + 1] : Content.size();
+    bool Torn = End == Content.size() && Content.back() != '\n';
+    if (!Torn && loadDocument(Content.substr(Starts[I], End - Starts[I]), Torn)) continue;
+
+    ++Skipped;
+    // An append that was interrupted leaves the last document torn.
+    if (Torn && End == Content.size()) Length = Starts[I];
+  }
+
+  if (Length < Content.size()) {
+    --Skipped;
+    // Unless another run appended to it since it was read.
+    struct stat Stat;
+    if (stat(Filename.c_str(), &Stat) || static_cast<uint64_t>(Stat.st_size) != Content.size() ||
+        truncate(Filename.c_str(), Length))
+      std::cerr << "Could not drop the torn measurement at the end of " << Filename << std::endl;
+    else
+      std::cerr << "Dropped the torn measurement at the end of " << Filename << std::endl;
+  }
+
+  if (Skipped)
+    std::cerr << "Skipping " << Skipped << " malformed measurements of " << Filename <<
+      ", or without their key." << std::endl;
+}
+
+void MeasurementDatabase::insert(const Key &K, const std::vector<double> &NewSamples, const Budget &B) {
+  auto &E = Samples[K];
+  for (auto Sample : NewSamples) {
+    // The budget of the older versions is unknown, so what exceeded it is not kept.
+    if (!std::isinf(Sample)) E.Samples.push_back(Sample);
+    else if (B.Cost != 0 || B.Seconds != 0) E.Exceeded.push_back(B);
+  }
+}
+
+bool MeasurementDatabase::has(const Key &K) const {
+  return Samples.count(K);
+}
+
+std::vector<double> MeasurementDatabase::getSamples(const Key &K, const Budget &B) const {
+  auto It = Samples.find(K);
+  if (It == Samples.end()) return std::vector<double>();
+
+  std::vector<double> KeySamples = It->second.Samples;
+  for (auto &Exceeded : It->second.Exceeded) {
+    if (Exceeded.covers(B)) {
+      KeySamples.push_back(std::numeric_limits<double>::infinity());
+      break;
+    }
+  }
+
+  return KeySamples;
+}
+
+void MeasurementDatabase::addSamples(const Key &K, const std::vector<double> &NewSamples, const Budget &B) {
+  if (NewSamples.empty()) return;
+  insert(K, NewSamples, B);
+
+  YAML::Emitter E;
+  E << YAML::BeginMap;
+  E << YAML::Key << "key" << YAML::Value << toHexString(K.getHash());
+  E << YAML::Key << "module" << YAML::Value << toHexString(K.ModuleHash);
+  E << YAML::Key << "sequence" << YAML::Value << K.Sequence;
+  E << YAML::Key << "argv" << YAML::Value << YAML::Flow << K.Argv;
+  E << YAML::Key << "backend" << YAML::Value << K.Backend;
+  E << YAML::Key << "host" << YAML::Value << K.Host;
+  E << YAML::Key << "budget" << YAML::Value << YAML::Flow << YAML::BeginMap;
+  E << YAML::Key << "cost" << YAML::Value << B.Cost;
+  E << YAML::Key << "seconds" << YAML::Value << B.Seconds;
+  E << YAML::EndMap;
+  E << YAML::Key << "samples" << YAML::Value << YAML::Flow << NewSamples;
+  E << YAML::EndMap;
+
+  // In a single write, so an interrupted one tears only this document.
+  std::string Document = std::string("---\n") + E.c_str() + "\n";
+  std::ofstream Out(Filename, std::ios::app | std::ios::binary);
+  Out.write(Document.data(), Document.size());
+}
+
+uint64_t MeasurementDatabase::size() const {
+  return Samples.size();
+}
+
+std::string MeasurementDatabase::getHostFingerprint() {
+  std::string Fingerprint;
+
+  struct utsname Name;
+  if (uname(&Name) == 0)
+    Fingerprint = std::string(Name.sysname) + " " + Name.release + " " + Name.machine + " " + Name.nodename;
+
+  std::ifstream CPUInfo("/proc/cpuinfo");
+  std::string Line;
+  while (std::getline(CPUInfo, Line)) {
+    if (Line.compare(0, 10, "model name") != 0) continue;
+    Fingerprint += " " + Line.substr(Line.find(':') + 2);
+    break;
+  }
+
+  return Fingerprint;
+}
+
+uint64_t MeasurementDatabase::hashModule(llvm::Module &Module) {
+  llvm::SmallVector<char, 0> Buffer;
+  llvm::raw_svector_ostream Out(Buffer);
+  llvm::WriteBitcodeToFile(&Module, Out);
+  llvm::StringRef Bitcode = Out.str();
+  return hashBytes(Bitcode.data(), Bitcode.size());
+}
@@ -5,15 +5,21 @@
  */
 
 #include "pinhao/PerformanceAnalyser/PAPIWrapper.h"
+#include "pinhao/PerformanceAnalyser/MeasurementDatabase.h"
+#include "pinhao/Support/IPC.h"
 
 #include <unistd.h>
+#include <sys/time.h>
 #include <sys/wait.h>
-#include <fstream>
+#include <csignal>
+#include <climits>
 #include <iostream>
 
 using namespace pinhao;
 
 void PAPIWrapper::initialize() {
+  // Processes forked after the initialization inherit it.
+  if (PAPI_is_initialized() != PAPI_NOT_INITED) return;
   assert(PAPI_library_init(PAPI_VER_CURRENT) == PAPI_VER_CURRENT
       && "Error: PAPI library failed on initialization.");
 }
@@ -50,57 +56,110 @@ bool PAPIWrapper::addEvents(int EventSet, EventCodeVector Codes) {
   return true;
 }
 
-int PAPIWrapper::run(llvm::Module &Module, std::vector<std::string> Args, 
-    char* const* Envp, EventCodeVector CodeVector, long long *Values) {
+/// @brief How many more cycle overflows the measured child may take.
+static PAPIWrapper::LLong RemainingOverflows = 0;
+
+static void handleCycleOverflow(int, void*, long long, void*) {
+  if (--RemainingOverflows <= 0) raise(SIGALRM);
+}
+
+void PAPIWrapper::armBudget(int EventSet, const Budget &B) {
+  // Both limits end the process with SIGALRM, which is how the parent tells them apart
+  // from a crash.
+  signal(SIGALRM, SIG_DFL);
+
+  if (B.Cycles > 0) {
+    // The threshold is an int, so large budgets take several overflows.
+    RemainingOverflows = (B.Cycles + INT_MAX - 1) / INT_MAX;
+    int Threshold = (B.Cycles + RemainingOverflows - 1) / RemainingOverflows;
+    if (PAPI_overflow(EventSet, PAPI_TOT_CYC, Threshold, 0, handleCycleOverflow) != PAPI_OK)
+      std::cerr << "Could not set the cycle budget. Only the time budget is used." << std::endl;
+  }
+
+  if (B.Seconds > 0) {
+    struct itimerval Timer;
+    Timer.it_interval.tv_sec = Timer.it_interval.tv_usec = 0;
+    Timer.it_value.tv_sec = (time_t) B.Seconds;
+    Timer.it_value.tv_usec = (suseconds_t) ((B.Seconds - (time_t) B.Seconds) * 1e6);
+    setitimer(ITIMER_REAL, &Timer, nullptr);
+  }
+}
+
+int PAPIWrapper::runInFork(JITExecutor *JIT, llvm::Module *Module, std::vector<std::string> Args, 
+    char* const* Envp, EventCodeVector CodeVector, long long *Values, const Budget &B) {
   int EventSet = 0;
   int ExitStatus = 0;
-  std::string TmpName = ".papi-" + std::to_string(time(0));
+
+  int Fds[2];
+  if (pipe(Fds) != 0) {
+    std::cerr << "Could not create the counters pipe." << std::endl;
+    return 1;
+  }
 
   pid_t Pid = fork();
 
   if (Pid == 0) {
     std::cerr << "ChildPid: " << getpid() << std::endl;
+    close(Fds[0]);
 
     initialize();
     EventSet = createEventSet();
     if (!addEvents(EventSet, CodeVector))
-      return 1;
+      _exit(1);
 
-    std::ofstream TmpOut(TmpName);
+    std::unique_ptr<JITExecutor> Owned;
+    if (!JIT) {
+      Owned.reset(new JITExecutor(*Module));
+      JIT = Owned.get();
+    }
+    JIT->flushCache();
 
-    JITExecutor JIT(Module);
-    JIT.flushCache();
+    bool CountsCycles = false;
+    for (auto Code : CodeVector)
+      CountsCycles |= Code == PAPI_TOT_CYC;
+    armBudget(EventSet, Budget(CountsCycles ? B.Cycles : 0, B.Seconds));
 
     assert(PAPI_start(EventSet) == PAPI_OK &&  
         "Error: PAPI library failed to start.");
 
-    ExitStatus = JIT.run(Args, Envp);
+    ExitStatus = JIT->run(Args, Envp);
 
     assert(PAPI_stop(EventSet, Values) == PAPI_OK &&  
         "Error: PAPI library failed to stop counters.");
 
-    for (unsigned I = 0; I < CodeVector.size(); ++I) {
-      TmpOut << Values[I] << std::endl;
+    for (unsigned I = 0; I < CodeVector.size(); ++I)
       std::cout << "Values[" << I << "]: " << Values[I] << std::endl;
-    }
+    writeAll(Fds[1], Values, CodeVector.size() * sizeof(long long));
 
-    exit(ExitStatus);
+    // The static objects and buffers copied from the parent are not destroyed or flushed again.
+    std::cout.flush();
+    _exit(ExitStatus);
   }
+
+  close(Fds[1]);
+  bool Received = readAll(Fds[0], Values, CodeVector.size() * sizeof(long long));
+  close(Fds[0]);
   
   waitpid(Pid, &ExitStatus, 0);
-  if (ExitStatus != 0) {
+  if (WIFSIGNALED(ExitStatus) && WTERMSIG(ExitStatus) == SIGALRM) {
+    std::cerr << "Module killed after exceeding its budget." << std::endl; 
+    ExitStatus = BudgetExceeded;
+  } else if (ExitStatus != 0) {
     std::cerr << "Error while executing module." << std::endl; 
-  } else {
-    std::ifstream TmpIn(TmpName); 
-    for (unsigned I = 0; I < CodeVector.size(); ++I)
-      TmpIn >> Values[I];
+  } else if (!Received) {
+    std::cerr << "Could not read the counters of the module." << std::endl; 
+    ExitStatus = 1;
   }
-  remove(TmpName.c_str());
 
   return ExitStatus;
 
 }
 
+int PAPIWrapper::run(llvm::Module &Module, std::vector<std::string> Args, 
+    char* const* Envp, EventCodeVector CodeVector, long long *Values, const Budget &B) {
+  return runInFork(nullptr, &Module, Args, Envp, CodeVector, Values, B);
+}
+
 std::pair<int, PAPIWrapper::CounterVector> PAPIWrapper::countEvents(llvm::Module &Module,
     EventCodeVector Codes) {
   ArgVector Args = { "papi-profiling" };
@@ -127,9 +186,14 @@ std::pair<int, PAPIWrapper::LLong> PAPIWrapper::getTotalCycles(llvm::Module &Mod
 
 std::pair<int, PAPIWrapper::LLong> PAPIWrapper::getTotalCycles(llvm::Module &Module, 
     PAPIWrapper::ArgVector Args) {
+  return getTotalCycles(Module, Args, Budget());
+}
+
+std::pair<int, PAPIWrapper::LLong> PAPIWrapper::getTotalCycles(llvm::Module &Module, 
+    PAPIWrapper::ArgVector Args, const Budget &B) {
   long long Value;
 
-  int ExitStatus = run(Module, Args, nullptr, { PAPI_TOT_CYC }, &Value);
+  int ExitStatus = run(Module, Args, nullptr, { PAPI_TOT_CYC }, &Value, B);
 
   return std::make_pair(ExitStatus, Value);
 }
@@ -147,3 +211,77 @@ std::pair<int, PAPIWrapper::LLong> PAPIWrapper::getTotalInstructions(llvm::Modul
 
   return std::make_pair(ExitStatus, Value);
 }
+
+std::pair<int, RobustEstimate> PAPIWrapper::getTotalCyclesRepeatedly(llvm::Module &Module,
+    PAPIWrapper::ArgVector Args, const RepetitionPolicy &Policy, const Budget &B) {
+  return getTotalCyclesRepeatedly(Module, nullptr, Args, Policy, B, nullptr);
+}
+
+std::pair<int, RobustEstimate> PAPIWrapper::getTotalCyclesRepeatedly(llvm::Module &Module,
+    ModuleTransform Transform, PAPIWrapper::ArgVector Args, const RepetitionPolicy &Policy, 
+    const Budget &B, uint64_t *Fingerprint) {
+  int Fds[2];
+  if (pipe(Fds) != 0) {
+    std::cerr << "Could not create the fork server pipe." << std::endl;
+    return std::make_pair(1, RobustEstimate());
+  }
+
+  std::cout.flush();
+  std::cerr.flush();
+  pid_t Pid = fork();
+
+  if (Pid == 0) {
+    close(Fds[0]);
+
+    // This process has its own copy of the module, so it is transformed in place.
+    uint64_t Hash = 0;
+    if (Transform) Transform(Module);
+    if (Fingerprint) Hash = MeasurementDatabase::hashModule(Module);
+
+    // The module is JIT compiled only once, and each run is a copy-on-write fork of it.
+    JITExecutor JIT(Module);
+
+    int ExitStatus = 0;
+    RobustEstimate Estimate;
+    measureRepeatedly([&] (double &Sample) {
+          long long Value;
+          ExitStatus = runInFork(&JIT, nullptr, Args, nullptr, { PAPI_TOT_CYC }, &Value, B);
+          Sample = Value;
+          return ExitStatus == 0;
+        }, Policy, Estimate);
+
+    uint64_t Size = Estimate.Samples.size();
+    if (writeAll(Fds[1], &ExitStatus, sizeof(int)) && writeAll(Fds[1], &Hash, sizeof(uint64_t)) &&
+        writeAll(Fds[1], &Size, sizeof(uint64_t)))
+      writeAll(Fds[1], Estimate.Samples.data(), Size * sizeof(double));
+
+    // The static objects and buffers copied from the parent are not destroyed or flushed again.
+    std::cout.flush();
+    _exit(0);
+  }
+
+  close(Fds[1]);
+  int ExitStatus = 1;
+  uint64_t Hash = 0;
+  uint64_t Size = 0;
+  std::vector<double> Samples;
+
+  bool Received = Pid > 0 && readAll(Fds[0], &ExitStatus, sizeof(int)) && 
+    readAll(Fds[0], &Hash, sizeof(uint64_t)) && readAll(Fds[0], &Size, sizeof(uint64_t));
+  if (Received) {
+    Samples.resize(Size);
+    Received = readAll(Fds[0], Samples.data(), Size * sizeof(double));
+  }
+  close(Fds[0]);
+
+  int ServerStatus = 0;
+  if (Pid > 0) waitpid(Pid, &ServerStatus, 0);
+  if (!Received || ServerStatus != 0) {
+    std::cerr << "The fork server died before sending its samples." << std::endl; 
+    return std::make_pair(1, RobustEstimate());
+  }
+
+  if (Fingerprint) *Fingerprint = Hash;
+  if (Samples.empty()) return std::make_pair(ExitStatus, RobustEstimate());
+  return std::make_pair(ExitStatus, RobustEstimate(Samples, Policy.Confidence));
+}
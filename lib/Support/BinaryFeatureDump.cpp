@@ -0,0 +1,417 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file BinaryFeatureDump.cpp
+ */
+
+#include "pinhao/Support/BinaryFeatureDump.h"
+#include "pinhao/Support/YAMLWrapper.h"
+
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace pinhao;
+
+static const char Magic[8] = { 'P', 'I', 'N', 'H', 'A', 'O', 'F', 'T' };
+static const uint32_t Version = 1;
+
+namespace {
+  struct SectionHeader {
+    char Magic[8];
+    uint32_t Version;
+    uint8_t Layout;
+    uint8_t KeyType;
+    uint8_t ValueType;
+    uint8_t Reserved;
+    uint32_t Columns;
+    /// @brief The size of the names that follow, padded.
+    uint32_t Schema;
+  };
+}
+
+static uint64_t getPadded(uint64_t Size) {
+  return (Size + 7) & ~static_cast<uint64_t>(7);
+}
+
+/// @brief Gets the width of the values of type @a Type, or zero if they have no fixed width.
+static uint64_t getWidth(ColumnType Type) {
+  switch (Type) {
+    case ColumnType::UInt64:  return sizeof(uint64_t);
+    case ColumnType::Int:     return sizeof(int);
+    case ColumnType::Double:  return sizeof(double);
+    case ColumnType::Bool:    return sizeof(bool);
+    case ColumnType::Pointer: return sizeof(void*);
+    default:                  return 0;
+  }
+}
+
+/// @brief Gets the size of a column of @a Rows values of type @a Type, which starts at
+/// @a Column, checking that it ends before @a End.
+/// @return Zero if the column is malformed.
+static uint64_t getColumnSize(ColumnType Type, uint64_t Rows, const char *Column, const char *End) {
+  uint64_t Available = End - Column;
+  // The number of rows comes from the file, so it is checked before it is multiplied.
+  if (Type != ColumnType::String) {
+    uint64_t Width = getWidth(Type);
+    if (Rows > Available / Width) return 0;
+    uint64_t Size = getPadded(Rows * Width);
+    return Size <= Available ? Size : 0;
+  }
+
+  if (Rows >= Available / sizeof(uint64_t)) return 0;
+  uint64_t Offsets = (Rows + 1) * sizeof(uint64_t);
+  uint64_t Previous = 0;
+  for (uint64_t Row = 0; Row <= Rows; ++Row) {
+    uint64_t Offset;
+    std::memcpy(&Offset, Column + Row * sizeof(uint64_t), sizeof(uint64_t));
+    if (Offset < Previous) return 0;
+    Previous = Offset;
+  }
+  if (Previous > Available - Offsets) return 0;
+  uint64_t Size = Offsets + getPadded(Previous);
+  return Size <= Available ? Size : 0;
+}
+
+/*
+ * ----------------------------------
+ *  Class: BinaryFeatureDump
+ */
+uint64_t pinhao::BinaryFeatureDump::Section::getColumn(std::string Name) const {
+  uint64_t N = 0;
+  while (N < Columns.size() && Columns[N] != Name) ++N;
+  return N;
+}
+
+uint64_t pinhao::BinaryFeatureDump::Section::getRows() const {
+  uint64_t Rows = 0;
+  for (auto &B : Blocks)
+    Rows += B.Rows;
+  return Rows;
+}
+
+pinhao::BinaryFeatureDump::BinaryFeatureDump() : Fd(-1), Data(nullptr), Length(0) {}
+
+pinhao::BinaryFeatureDump::~BinaryFeatureDump() {
+  close();
+}
+
+bool pinhao::BinaryFeatureDump::open(std::string Filename) {
+  close();
+
+  Fd = ::open(Filename.c_str(), O_RDONLY);
+  if (Fd < 0) return false;
+
+  struct stat Stat;
+  if (fstat(Fd, &Stat) || Stat.st_size < static_cast<off_t>(sizeof(SectionHeader))) {
+    close();
+    return false;
+  }
+
+  Length = Stat.st_size;
+  void *Mapped = mmap(nullptr, Length, PROT_READ, MAP_PRIVATE, Fd, 0);
+  if (Mapped == MAP_FAILED) {
+    close();
+    return false;
+  }
+  Data = static_cast<const char*>(Mapped);
+
+  if (!parse()) {
+    std::cerr << "Could not read the feature dump " << Filename << std::endl;
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool pinhao::BinaryFeatureDump::parse() {
+  const char *Current = Data, *End = Data + Length;
+
+  while (Current < End) {
+    SectionHeader Header;
+    if (static_cast<uint64_t>(End - Current) < sizeof(SectionHeader)) return false;
+    std::memcpy(&Header, Current, sizeof(SectionHeader));
+    Current += sizeof(SectionHeader);
+
+    if (std::memcmp(Header.Magic, Magic, sizeof(Magic)) || Header.Version != Version) return false;
+    if (Header.Layout > static_cast<uint8_t>(Layout::MapVector) ||
+        Header.ValueType > static_cast<uint8_t>(ColumnType::String) ||
+        Header.KeyType > static_cast<uint8_t>(ColumnType::String)) return false;
+    if (static_cast<uint64_t>(End - Current) < Header.Schema) return false;
+
+    Section S;
+    S.TheLayout = static_cast<Layout>(Header.Layout);
+    S.KeyType = static_cast<ColumnType>(Header.KeyType);
+    S.ValueType = static_cast<ColumnType>(Header.ValueType);
+    if (S.ValueType == ColumnType::None || (S.KeyType == ColumnType::None) != (S.TheLayout == Layout::Vector))
+      return false;
+    // A map has the column of the feature itself, the others at least one sub-feature.
+    if (S.TheLayout == Layout::Map ? Header.Columns != 1 : Header.Columns == 0)
+      return false;
+
+    // The name of the feature, followed by the names of its columns.
+    const char *Name = Current, *SchemaEnd = Current + Header.Schema;
+    for (uint64_t N = 0; N <= Header.Columns; ++N) {
+      uint32_t Size;
+      if (static_cast<uint64_t>(SchemaEnd - Name) < sizeof(uint32_t)) return false;
+      std::memcpy(&Size, Name, sizeof(uint32_t));
+      Name += sizeof(uint32_t);
+      if (static_cast<uint64_t>(SchemaEnd - Name) < Size) return false;
+
+      if (N == 0) S.Name.assign(Name, Size);
+      else S.Columns.push_back(std::string(Name, Size));
+      Name += Size;
+    }
+    Current = SchemaEnd;
+
+    while (true) {
+      Block B;
+      if (static_cast<uint64_t>(End - Current) < sizeof(uint64_t)) return false;
+      std::memcpy(&B.Rows, Current, sizeof(uint64_t));
+      Current += sizeof(uint64_t);
+      if (B.Rows == 0) break;
+
+      B.Keys = nullptr;
+      if (S.KeyType != ColumnType::None) {
+        uint64_t Size = getColumnSize(S.KeyType, B.Rows, Current, End);
+        if (!Size) return false;
+        B.Keys = Current;
+        Current += Size;
+      }
+
+      for (uint64_t N = 0; N < S.Columns.size(); ++N) {
+        uint64_t Size = getColumnSize(S.ValueType, B.Rows, Current, End);
+        if (!Size) return false;
+        B.Columns.push_back(Current);
+        Current += Size;
+      }
+      S.Blocks.push_back(B);
+    }
+
+    Sections.push_back(S);
+  }
+
+  return true;
+}
+
+void pinhao::BinaryFeatureDump::close() {
+  if (Data) munmap(const_cast<char*>(Data), Length);
+  if (Fd >= 0) ::close(Fd);
+
+  Fd = -1;
+  Data = nullptr;
+  Length = 0;
+  Sections.clear();
+}
+
+bool pinhao::BinaryFeatureDump::isOpen() const {
+  return Data != nullptr;
+}
+
+uint64_t pinhao::BinaryFeatureDump::size() const {
+  return Sections.size();
+}
+
+const BinaryFeatureDump::Section &pinhao::BinaryFeatureDump::getSection(uint64_t N) const {
+  return Sections[N];
+}
+
+const BinaryFeatureDump::Section *pinhao::BinaryFeatureDump::find(std::string Name) const {
+  for (auto I = Sections.rbegin(), E = Sections.rend(); I != E; ++I)
+    if (I->Name == Name) return &*I;
+  return nullptr;
+}
+
+bool pinhao::BinaryFeatureDump::check(const Section *S, Layout Expected, ColumnType Key, ColumnType Value) {
+  return S && S->TheLayout == Expected && S->KeyType == Key && S->ValueType == Value;
+}
+
+template <> std::string pinhao::BinaryFeatureDump::getValue<std::string>(const Block &B, const char *Column,
+    uint64_t Row) {
+  uint64_t Begin, End;
+  std::memcpy(&Begin, Column + Row * sizeof(uint64_t), sizeof(uint64_t));
+  std::memcpy(&End, Column + (Row + 1) * sizeof(uint64_t), sizeof(uint64_t));
+  const char *Characters = Column + (B.Rows + 1) * sizeof(uint64_t);
+  return std::string(Characters + Begin, End - Begin);
+}
+
+/// @brief Appends the value in the @a Row of a @a Column of type @a Type.
+static void appendValue(YAMLWrapper::Emitter &E, ColumnType Type, const BinaryFeatureDump::Block &B,
+    const char *Column, uint64_t Row) {
+  switch (Type) {
+    case ColumnType::UInt64:
+      E << BinaryFeatureDump::getValue<uint64_t>(B, Column, Row);
+      break;
+    case ColumnType::Int:
+      E << BinaryFeatureDump::getValue<int>(B, Column, Row);
+      break;
+    case ColumnType::Double:
+      E << BinaryFeatureDump::getValue<double>(B, Column, Row);
+      break;
+    case ColumnType::Bool:
+      E << BinaryFeatureDump::getValue<bool>(B, Column, Row);
+      break;
+    case ColumnType::Pointer:
+      YAMLWrapper::append(BinaryFeatureDump::getValue<void*>(B, Column, Row), E);
+      break;
+    case ColumnType::String:
+      E << BinaryFeatureDump::getValue<std::string>(B, Column, Row);
+      break;
+    default:
+      E << YAML::Null;
+  }
+}
+
+void pinhao::BinaryFeatureDump::print(std::ostream &Out) const {
+  for (auto &S : Sections) {
+    YAMLWrapper::Emitter E(Out);
+    E << YAML::BeginMap;
+    E << YAML::Key << "feature-name" << YAML::Value << S.Name;
+    E << YAML::Key << (S.TheLayout == Layout::Vector ? "features" : "values");
+    E << YAML::Value << YAML::BeginMap;
+    for (auto &B : S.Blocks) {
+      for (uint64_t Row = 0; Row < B.Rows; ++Row) {
+        if (S.TheLayout != Layout::Vector) {
+          E << YAML::Key;
+          appendValue(E, S.KeyType, B, B.Keys, Row);
+          E << YAML::Value;
+        }
+
+        if (S.TheLayout == Layout::Map) {
+          appendValue(E, S.ValueType, B, B.Columns[0], Row);
+          continue;
+        }
+
+        if (S.TheLayout == Layout::MapVector) E << YAML::BeginMap;
+        for (uint64_t N = 0; N < S.Columns.size(); ++N) {
+          E << YAML::Key << S.Columns[N] << YAML::Value;
+          appendValue(E, S.ValueType, B, B.Columns[N], Row);
+        }
+        if (S.TheLayout == Layout::MapVector) E << YAML::EndMap;
+      }
+    }
+    E << YAML::EndMap;
+    E << YAML::EndMap;
+    Out << std::endl;
+  }
+}
+
+bool pinhao::BinaryFeatureDump::isBinary(std::string Filename) {
+  char Start[sizeof(Magic)];
+  std::ifstream In(Filename, std::ios::binary);
+  return In.read(Start, sizeof(Start)) && !std::memcmp(Start, Magic, sizeof(Magic));
+}
+
+/*
+ * ----------------------------------
+ *  Class: BinaryFeatureWriter
+ */
+pinhao::BinaryFeatureWriter::BinaryFeatureWriter(std::ostream &Out, uint64_t BlockRows) :
+  Out(Out), BlockRows(BlockRows ? BlockRows : 1), Written(0),
+  KeyType(ColumnType::None), ValueType(ColumnType::None), Rows(0) {}
+
+template <> void pinhao::BinaryFeatureWriter::put<std::string>(std::string &Column, const std::string &Value) {
+  put<uint64_t>(Column, Value.size());
+  Column.append(Value);
+}
+
+void pinhao::BinaryFeatureWriter::write(const std::string &Bytes) {
+  Out.write(Bytes.data(), Bytes.size());
+  Written += Bytes.size();
+}
+
+void pinhao::BinaryFeatureWriter::writeColumn(const std::string &Column, ColumnType Type) {
+  std::string Bytes;
+  if (Type != ColumnType::String) {
+    Bytes = Column;
+  } else {
+    // The strings are kept with their sizes, which become the offsets of their ends.
+    std::string Characters;
+    uint64_t Offset = 0;
+    put<uint64_t>(Bytes, Offset);
+    for (uint64_t Position = 0; Position < Column.size(); ) {
+      uint64_t Size;
+      std::memcpy(&Size, Column.data() + Position, sizeof(uint64_t));
+      Characters.append(Column, Position + sizeof(uint64_t), Size);
+      Position += sizeof(uint64_t) + Size;
+      Offset += Size;
+      put<uint64_t>(Bytes, Offset);
+    }
+    Bytes.append(Characters);
+  }
+
+  Bytes.resize(getPadded(Bytes.size()), 0);
+  write(Bytes);
+}
+
+void pinhao::BinaryFeatureWriter::beginSection(std::string Name, BinaryFeatureDump::Layout TheLayout,
+    ColumnType KeyType, ColumnType ValueType, const std::vector<std::string> &ColumnNames) {
+  std::string Schema;
+  put<uint32_t>(Schema, Name.size());
+  Schema.append(Name);
+  for (auto &Column : ColumnNames) {
+    put<uint32_t>(Schema, Column.size());
+    Schema.append(Column);
+  }
+  Schema.resize(getPadded(Schema.size()), 0);
+
+  SectionHeader Header;
+  std::memcpy(Header.Magic, Magic, sizeof(Magic));
+  Header.Version = Version;
+  Header.Layout = static_cast<uint8_t>(TheLayout);
+  Header.KeyType = static_cast<uint8_t>(KeyType);
+  Header.ValueType = static_cast<uint8_t>(ValueType);
+  Header.Reserved = 0;
+  Header.Columns = ColumnNames.size();
+  Header.Schema = Schema.size();
+
+  std::string Bytes;
+  put(Bytes, Header);
+  write(Bytes + Schema);
+
+  this->KeyType = KeyType;
+  this->ValueType = ValueType;
+  Columns.assign(ColumnNames.size(), std::string());
+  Keys.clear();
+  Rows = 0;
+}
+
+void pinhao::BinaryFeatureWriter::flush() {
+  if (!Rows) return;
+
+  std::string Bytes;
+  put<uint64_t>(Bytes, Rows);
+  write(Bytes);
+
+  if (KeyType != ColumnType::None)
+    writeColumn(Keys, KeyType);
+  for (auto &Column : Columns) {
+    writeColumn(Column, ValueType);
+    Column.clear();
+  }
+  Keys.clear();
+  Rows = 0;
+}
+
+void pinhao::BinaryFeatureWriter::endRow() {
+  if (++Rows >= BlockRows) flush();
+}
+
+void pinhao::BinaryFeatureWriter::endSection() {
+  flush();
+  std::string Bytes;
+  put<uint64_t>(Bytes, 0);
+  write(Bytes);
+  Out.flush();
+}
+
+uint64_t pinhao::BinaryFeatureWriter::size() const {
+  return Written;
+}
+
+bool pinhao::BinaryFeatureWriter::good() const {
+  return Out.good();
+}
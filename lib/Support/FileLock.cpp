@@ -0,0 +1,42 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file FileLock.cpp
+ */
+
+#include "pinhao/Support/FileLock.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+using namespace pinhao;
+
+pinhao::FileLock::FileLock(std::string Filename, bool Wait) {
+  Fd = open(Filename.c_str(), O_RDWR | O_CREAT, 0644);
+  if (Fd < 0) {
+    std::cerr << "Could not open the lock " << Filename << ": " << strerror(errno) << std::endl;
+    return;
+  }
+
+  int Status;
+  while ((Status = flock(Fd, Wait ? LOCK_EX : LOCK_EX | LOCK_NB)) < 0 && errno == EINTR);
+  if (Status < 0) {
+    if (errno != EWOULDBLOCK)
+      std::cerr << "Could not lock " << Filename << ": " << strerror(errno) << std::endl;
+    close(Fd);
+    Fd = -1;
+  }
+}
+
+pinhao::FileLock::~FileLock() {
+  if (Fd >= 0) close(Fd);
+}
+
+bool pinhao::FileLock::isLocked() const {
+  return Fd >= 0;
+}
@@ -0,0 +1,34 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file Hash.cpp
+ */
+
+#include "pinhao/Support/Hash.h"
+
+#include <cstdio>
+
+using namespace pinhao;
+
+uint64_t pinhao::hashBytes(const void *Data, uint64_t Size, uint64_t Hash) {
+  const unsigned char *Bytes = (const unsigned char*) Data;
+  for (uint64_t I = 0; I < Size; ++I) {
+    Hash ^= Bytes[I];
+    Hash *= FNVPrime;
+  }
+  return Hash;
+}
+
+uint64_t pinhao::hashString(const std::string &Str, uint64_t Hash) {
+  return hashBytes(Str.data(), Str.size(), Hash);
+}
+
+uint64_t pinhao::combineHashes(uint64_t Seed, uint64_t Value) {
+  return hashBytes(&Value, sizeof(uint64_t), Seed);
+}
+
+std::string pinhao::toHexString(uint64_t Hash) {
+  char Buffer[17];
+  snprintf(Buffer, sizeof(Buffer), "%016llx", (unsigned long long) Hash);
+  return Buffer;
+}
@@ -0,0 +1,234 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file HelperPool.cpp
+ */
+
+#include "pinhao/Support/HelperPool.h"
+#include "pinhao/Support/IPC.h"
+
+#include <algorithm>
+#include <map>
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <csignal>
+#include <iostream>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace pinhao;
+
+HelperPool::HelperPool(unsigned N, Handler Serve, Initializer Init, double Timeout) :
+  Serve(Serve), Init(Init), Owner(getpid()), Timeout(Timeout), NextId(0), Restarts(0) {
+  // A helper may die between two requests: writeMessage then fails, without SIGPIPE.
+  Helpers.resize(N > 0 ? N : 1, { -1, -1, -1, false, 0, std::chrono::steady_clock::time_point() });
+  for (auto &H : Helpers)
+    spawn(H);
+}
+
+HelperPool::~HelperPool() {
+  if (getpid() != Owner) return;
+  for (auto &H : Helpers)
+    shutdown(H);
+}
+
+unsigned HelperPool::getNumberOfHelpers() const {
+  return Helpers.size();
+}
+
+uint64_t HelperPool::getNumberOfRestarts() const {
+  return Restarts;
+}
+
+bool HelperPool::spawn(Helper &H) {
+  int Request[2], Reply[2];
+  if (pipe(Request) != 0) return false;
+  if (pipe(Reply) != 0) {
+    close(Request[0]);
+    close(Request[1]);
+    return false;
+  }
+
+  std::cout.flush();
+  std::cerr.flush();
+  fflush(stdout);
+
+  pid_t Pid = fork();
+
+  if (Pid < 0) {
+    close(Request[0]); close(Request[1]);
+    close(Reply[0]); close(Reply[1]);
+    return false;
+  }
+
+  if (Pid == 0) {
+    close(Request[1]);
+    close(Reply[0]);
+    // Otherwise, the other helpers would never see the end of their requests.
+    for (auto &Other : Helpers)
+      if (&Other != &H && Other.Pid > 0) {
+        close(Other.In);
+        close(Other.Out);
+      }
+
+    serve(Request[0], Reply[1]);
+
+    std::cout.flush();
+    fflush(stdout);
+    _exit(0);
+  }
+
+  close(Request[0]);
+  close(Reply[1]);
+  H = { Pid, Request[1], Reply[0], false, 0, std::chrono::steady_clock::time_point() };
+  return true;
+}
+
+void HelperPool::serve(int In, int Out) {
+  if (Init) Init();
+
+  std::string Request;
+  while (readMessage(In, Request))
+    if (!writeMessage(Out, Serve(Request)))
+      break;
+}
+
+void HelperPool::shutdown(Helper &H) {
+  if (H.Pid <= 0) return;
+
+  close(H.In);
+  close(H.Out);
+
+  int Status;
+  while (waitpid(H.Pid, &Status, 0) < 0 && errno == EINTR);
+  H.Pid = -1;
+}
+
+void HelperPool::restart(Helper &H) {
+  if (H.Pid > 0) kill(H.Pid, SIGKILL);
+  shutdown(H);
+  ++Restarts;
+
+  if (!spawn(H))
+    std::cerr << "Could not restart a helper process." << std::endl;
+}
+
+HelperPool::Result HelperPool::collect(Helper &H) {
+  Result R = { H.Id, true, "" };
+  H.Busy = false;
+
+  if (!readMessage(H.Out, R.Reply)) {
+    std::cerr << "Helper " << H.Pid << " died while serving a request." << std::endl;
+    R.Ok = false;
+    R.Reply.clear();
+    restart(H);
+  }
+
+  return R;
+}
+
+HelperPool::Result HelperPool::expire(Helper &H) {
+  std::cerr << "Helper " << H.Pid << " did not answer within " << Timeout << "s." << std::endl;
+  Result R = { H.Id, false, "" };
+  H.Busy = false;
+  restart(H);
+  return R;
+}
+
+uint64_t HelperPool::submit(const std::string &Request) {
+  uint64_t Id = NextId++;
+
+  Helper *Idle = nullptr;
+  while (!Idle) {
+    for (auto &H : Helpers)
+      if (!H.Busy) {
+        Idle = &H;
+        break;
+      }
+    if (!Idle) Finished.push_back(waitBusy());
+  }
+
+  // The helper may have died while it was idle, so we give it a second chance.
+  for (unsigned Try = 0; Try < 2; ++Try) {
+    if (Idle->Pid <= 0 && !spawn(*Idle))
+      break;
+
+    if (writeMessage(Idle->In, Request)) {
+      Idle->Busy = true;
+      Idle->Id = Id;
+      Idle->Start = std::chrono::steady_clock::now();
+      return Id;
+    }
+
+    restart(*Idle);
+  }
+
+  std::cerr << "Could not send the request to a helper. Serving it in place." << std::endl;
+  if (Init) Init();
+  Finished.push_back({ Id, true, Serve(Request) });
+  return Id;
+}
+
+HelperPool::Result HelperPool::waitBusy() {
+  std::vector<struct pollfd> Fds;
+  std::vector<Helper*> Busy;
+  for (auto &H : Helpers)
+    if (H.Busy) {
+      Fds.push_back({ H.Out, POLLIN, 0 });
+      Busy.push_back(&H);
+    }
+
+  assert(!Busy.empty() && "Waiting on a HelperPool without requests.");
+
+  while (true) {
+    int Wait = -1;
+    if (Timeout > 0) {
+      // Until the request sent first runs out of time.
+      auto Now = std::chrono::steady_clock::now();
+      double Remaining = Timeout;
+      for (auto *H : Busy) {
+        double Left = Timeout - std::chrono::duration<double>(Now - H->Start).count();
+        if (Left <= 0) return expire(*H);
+        Remaining = std::min(Remaining, Left);
+      }
+      Wait = static_cast<int>(std::ceil(Remaining * 1000));
+    }
+
+    int Ready = poll(Fds.data(), Fds.size(), Wait);
+    if (Ready < 0 && errno == EINTR) continue;
+    assert(Ready >= 0 && "Error: poll failed while waiting for helpers.");
+
+    for (uint64_t I = 0; I < Fds.size(); ++I)
+      if (Fds[I].revents)
+        return collect(*Busy[I]);
+  }
+}
+
+HelperPool::Result HelperPool::wait() {
+  if (!Finished.empty()) {
+    Result R = Finished.front();
+    Finished.pop_front();
+    return R;
+  }
+
+  return waitBusy();
+}
+
+std::vector<HelperPool::Result> HelperPool::map(const std::vector<std::string> &Requests) {
+  std::map<uint64_t, uint64_t> Position;
+  for (uint64_t I = 0; I < Requests.size(); ++I)
+    Position[submit(Requests[I])] = I;
+
+  std::vector<Result> Results(Requests.size());
+  for (uint64_t I = 0; I < Requests.size(); ++I) {
+    Result R = wait();
+    assert(Position.count(R.Id) && "HelperPool::map called with pending requests.");
+    Results[Position[R.Id]] = R;
+  }
+
+  return Results;
+}
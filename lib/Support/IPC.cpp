@@ -0,0 +1,101 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file IPC.cpp
+ */
+
+#include "pinhao/Support/IPC.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+
+#include <pthread.h>
+#include <unistd.h>
+
+using namespace pinhao;
+
+namespace {
+  /// @brief Blocks SIGPIPE in the calling thread while it lives, so that writing to a pipe
+  /// or socket whose reader is gone fails with EPIPE instead of killing the process. The
+  /// SIGPIPE raised meanwhile is discarded, and the signal mask is restored, so nothing
+  /// changes for the rest of the process, nor for its children.
+  class SigPipeBlocker {
+    private:
+      sigset_t Pipe;
+      sigset_t Old;
+      bool WasPending;
+
+      bool isPending() {
+        sigset_t Pending;
+        sigpending(&Pending);
+        return sigismember(&Pending, SIGPIPE);
+      }
+
+    public:
+      SigPipeBlocker() {
+        sigemptyset(&Pipe);
+        sigaddset(&Pipe, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &Pipe, &Old);
+        WasPending = isPending();
+      }
+
+      ~SigPipeBlocker() {
+        int Error = errno;
+        if (!WasPending && isPending()) {
+          struct timespec Zero = { 0, 0 };
+          while (sigtimedwait(&Pipe, nullptr, &Zero) < 0 && errno == EINTR);
+        }
+        pthread_sigmask(SIG_SETMASK, &Old, nullptr);
+        errno = Error;
+      }
+  };
+}
+
+bool pinhao::writeAll(int Fd, const void *Buffer, uint64_t Size) {
+  SigPipeBlocker Blocker;
+  const char *Bytes = (const char*) Buffer;
+  uint64_t Written = 0;
+  while (Written < Size) {
+    ssize_t W = write(Fd, Bytes + Written, Size - Written);
+    if (W < 0 && errno == EINTR) continue;
+    if (W <= 0) return false;
+    Written += W;
+  }
+  return true;
+}
+
+bool pinhao::readAll(int Fd, void *Buffer, uint64_t Size) {
+  char *Bytes = (char*) Buffer;
+  uint64_t Read = 0;
+  while (Read < Size) {
+    ssize_t R = read(Fd, Bytes + Read, Size - Read);
+    if (R < 0 && errno == EINTR) continue;
+    if (R <= 0) return false;
+    Read += R;
+  }
+  return true;
+}
+
+bool pinhao::writeMessage(int Fd, const std::string &Message) {
+  uint64_t Size = Message.size();
+  return writeAll(Fd, &Size, sizeof(uint64_t)) && writeAll(Fd, Message.data(), Size);
+}
+
+bool pinhao::readMessage(int Fd, std::string &Message, uint64_t MaxSize) {
+  const uint64_t ChunkSize = UINT64_C(1) << 20;
+
+  uint64_t Size;
+  if (!readAll(Fd, &Size, sizeof(uint64_t)) || Size > MaxSize)
+    return false;
+
+  Message.clear();
+  while (Message.size() < Size) {
+    uint64_t Read = Message.size();
+    Message.resize(Read + std::min(ChunkSize, Size - Read));
+    if (!readAll(Fd, &Message[Read], Message.size() - Read))
+      return false;
+  }
+  return true;
+}
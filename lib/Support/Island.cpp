@@ -0,0 +1,120 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file Island.cpp
+ */
+
+#include "pinhao/Support/Island.h"
+#include "pinhao/Support/IPC.h"
+#include "pinhao/Support/Socket.h"
+
+#include <chrono>
+#include <algorithm>
+#include <cassert>
+#include <thread>
+#include <iostream>
+
+using namespace pinhao;
+
+Island::Topology Island::getTopology(const std::string &Name) {
+  if (Name == "complete") return Topology::Complete;
+  if (Name != "ring")
+    std::cerr << "Unknown topology " << Name << ". Using a ring." << std::endl;
+  return Topology::Ring;
+}
+
+Island::Island(unsigned Id, std::vector<std::string> Addresses, Topology Kind, double Timeout) :
+  Id(Id), Addresses(Addresses), Kind(Kind), Timeout(Timeout), Round(0) {
+  assert(Id < Addresses.size() && "The island has no address.");
+  Socket = listenOn(Addresses[Id]);
+}
+
+Island::~Island() {
+  closeSocket(Socket, Addresses[Id]);
+}
+
+unsigned Island::getId() const {
+  return Id;
+}
+
+unsigned Island::getNumberOfIslands() const {
+  return Addresses.size();
+}
+
+std::vector<unsigned> Island::getDestinations() const {
+  unsigned N = Addresses.size();
+  std::vector<unsigned> Destinations;
+  if (N < 2) return Destinations;
+
+  if (Kind == Topology::Ring) Destinations.push_back((Id + 1) % N);
+  else
+    for (unsigned I = 0; I < N; ++I)
+      if (I != Id) Destinations.push_back(I);
+
+  return Destinations;
+}
+
+std::vector<unsigned> Island::getSources() const {
+  unsigned N = Addresses.size();
+  std::vector<unsigned> Sources;
+  if (N < 2) return Sources;
+
+  if (Kind == Topology::Ring) Sources.push_back((Id + N - 1) % N);
+  else
+    for (unsigned I = 0; I < N; ++I)
+      if (I != Id) Sources.push_back(I);
+
+  return Sources;
+}
+
+std::vector<std::string> Island::migrate(const std::string &Emigrants) {
+  ++Round;
+
+  // The emigrants are sent while we receive, otherwise two islands sending large
+  // messages to each other would block forever.
+  std::thread Sender([this, &Emigrants] () {
+        for (auto Destination : getDestinations()) {
+          int Connection = connectTo(Addresses[Destination], Timeout);
+          if (Connection < 0) continue;
+
+          // A neighbour that stops reading must not hold us past the migration.
+          setTimeout(Connection, Timeout);
+          bool Sent = writeAll(Connection, &Round, sizeof(uint64_t)) &&
+            writeMessage(Connection, Emigrants);
+          if (!Sent) std::cerr << "Could not send the emigrants to island " << Destination << "." << std::endl;
+          closeSocket(Connection);
+        }
+      });
+
+  std::vector<std::string> Immigrants;
+  uint64_t Expected = getSources().size();
+  auto Deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(Timeout);
+
+  while (Socket >= 0 && Immigrants.size() < Expected) {
+    double Remaining = std::chrono::duration<double>(Deadline - std::chrono::steady_clock::now()).count();
+    int Connection = acceptConnection(Socket, Remaining);
+    if (Connection < 0) {
+      std::cerr << "Island " << Id << " received " << Immigrants.size() << " of " <<
+        Expected << " migrations." << std::endl;
+      break;
+    }
+
+    // Anyone may connect to the address: a peer that stalls or announces a huge message
+    // is dropped instead of hanging or exhausting the island.
+    uint64_t SourceRound = 0;
+    std::string Message;
+    bool Received = setTimeout(Connection, std::max(Remaining, 0.0)) &&
+      readAll(Connection, &SourceRound, sizeof(uint64_t)) &&
+      readMessage(Connection, Message, MaxMigrationSize);
+    if (!Received)
+      std::cerr << "Island " << Id << " dropped a bad or late migration." << std::endl;
+    closeSocket(Connection);
+
+    // Late emigrants of a migration that timed out are dropped.
+    if (Received && SourceRound >= Round)
+      Immigrants.push_back(Message);
+  }
+
+  Sender.join();
+  return Immigrants;
+}
@@ -0,0 +1,107 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file Pareto.cpp
+ */
+
+#include "pinhao/Support/Pareto.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+using namespace pinhao;
+
+bool pinhao::dominates(const std::vector<double> &Lhs, const std::vector<double> &Rhs) {
+  assert(Lhs.size() == Rhs.size() && "Points with different number of objectives.");
+
+  bool Better = false;
+  for (uint64_t I = 0; I < Lhs.size(); ++I) {
+    if (Lhs[I] > Rhs[I]) return false;
+    if (Lhs[I] < Rhs[I]) Better = true;
+  }
+  return Better;
+}
+
+std::vector<std::vector<uint64_t>> pinhao::getParetoFronts(const std::vector<std::vector<double>> &Points) {
+  uint64_t N = Points.size();
+  // The points each one dominates, and the number of points that dominate it.
+  std::vector<std::vector<uint64_t>> Dominated(N);
+  std::vector<uint64_t> DominatedBy(N, 0);
+
+  for (uint64_t I = 0; I < N; ++I)
+    for (uint64_t J = I + 1; J < N; ++J) {
+      if (dominates(Points[I], Points[J])) {
+        Dominated[I].push_back(J);
+        ++DominatedBy[J];
+      } else if (dominates(Points[J], Points[I])) {
+        Dominated[J].push_back(I);
+        ++DominatedBy[I];
+      }
+    }
+
+  std::vector<std::vector<uint64_t>> Fronts;
+  std::vector<uint64_t> Front;
+  for (uint64_t I = 0; I < N; ++I)
+    if (!DominatedBy[I]) Front.push_back(I);
+
+  while (!Front.empty()) {
+    std::vector<uint64_t> Next;
+    for (auto I : Front)
+      for (auto J : Dominated[I])
+        if (--DominatedBy[J] == 0) Next.push_back(J);
+
+    std::sort(Next.begin(), Next.end());
+    Fronts.push_back(Front);
+    Front.swap(Next);
+  }
+
+  return Fronts;
+}
+
+std::vector<double> pinhao::getCrowdingDistances(const std::vector<std::vector<double>> &Points,
+    const std::vector<uint64_t> &Front) {
+  std::vector<double> Distances(Front.size(), 0);
+  if (Front.empty()) return Distances;
+
+  double Infinity = std::numeric_limits<double>::infinity();
+  std::vector<uint64_t> Order(Front.size());
+
+  for (uint64_t K = 0, E = Points[Front[0]].size(); K < E; ++K) {
+    for (uint64_t I = 0; I < Order.size(); ++I)
+      Order[I] = I;
+    std::stable_sort(Order.begin(), Order.end(), [&Points, &Front, K] (uint64_t L, uint64_t R) {
+          return Points[Front[L]][K] < Points[Front[R]][K];
+        });
+
+    double Min = Points[Front[Order.front()]][K];
+    double Max = Points[Front[Order.back()]][K];
+    Distances[Order.front()] = Distances[Order.back()] = Infinity;
+    if (Max <= Min) continue;
+
+    for (uint64_t I = 1; I + 1 < Order.size(); ++I)
+      Distances[Order[I]] += (Points[Front[Order[I + 1]]][K] - Points[Front[Order[I - 1]]][K]) / (Max - Min);
+  }
+
+  return Distances;
+}
+
+std::vector<uint64_t> pinhao::getParetoOrder(const std::vector<std::vector<double>> &Points) {
+  std::vector<uint64_t> Order;
+
+  for (auto &Front : getParetoFronts(Points)) {
+    auto Distances = getCrowdingDistances(Points, Front);
+
+    std::vector<uint64_t> Positions(Front.size());
+    for (uint64_t I = 0; I < Positions.size(); ++I)
+      Positions[I] = I;
+    std::stable_sort(Positions.begin(), Positions.end(), [&Distances] (uint64_t L, uint64_t R) {
+          return Distances[L] > Distances[R];
+        });
+
+    for (auto I : Positions)
+      Order.push_back(Front[I]);
+  }
+
+  return Order;
+}
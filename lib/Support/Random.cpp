@@ -31,12 +31,22 @@ double UniformRandom::getRandomReal() {
   return Unif.getReal();
 }
 
+void UniformRandom::setSeed(unsigned Seed) {
+  UniformRandom &Unif = getUniformRandom();
+  Unif.seed(Seed);
+}
+
 int UniformRandom::getInt(int From, int To) {
   double Die = getReal();
   int RandomNumber = floor(Die * (To - From + 1)) + From;
   return RandomNumber;
 }
 
+void UniformRandom::seed(unsigned Seed) {
+  Rng.seed(Seed);
+  Unif.reset();
+}
+
 double UniformRandom::getReal() {
   return Unif(Rng);
 }
@@ -0,0 +1,189 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file Socket.cpp
+ */
+
+#include "pinhao/Support/Socket.h"
+
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <iostream>
+
+#include <poll.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+
+using namespace pinhao;
+
+static bool isTCP(const std::string &Address) {
+  return Address.compare(0, 4, "tcp:") == 0;
+}
+
+static std::string getUnixPath(const std::string &Address) {
+  if (Address.compare(0, 5, "unix:") == 0) return Address.substr(5);
+  return Address;
+}
+
+static bool fillUnixAddress(const std::string &Address, struct sockaddr_un &Unix) {
+  std::string Path = getUnixPath(Address);
+  if (Path.size() >= sizeof(Unix.sun_path)) {
+    std::cerr << "The socket path " << Path << " is too long." << std::endl;
+    return false;
+  }
+
+  memset(&Unix, 0, sizeof(Unix));
+  Unix.sun_family = AF_UNIX;
+  strncpy(Unix.sun_path, Path.c_str(), sizeof(Unix.sun_path) - 1);
+  return true;
+}
+
+/// @brief Resolves a "tcp:<host>:<port>" address. The result must be freed with freeaddrinfo.
+static struct addrinfo *resolveTCPAddress(const std::string &Address, bool Passive) {
+  std::string HostPort = Address.substr(4);
+  auto Colon = HostPort.rfind(':');
+  if (Colon == std::string::npos) {
+    std::cerr << "The address " << Address << " has no port." << std::endl;
+    return nullptr;
+  }
+
+  std::string Host = HostPort.substr(0, Colon);
+  std::string Port = HostPort.substr(Colon + 1);
+
+  struct addrinfo Hints, *Result = nullptr;
+  memset(&Hints, 0, sizeof(Hints));
+  Hints.ai_family = AF_UNSPEC;
+  Hints.ai_socktype = SOCK_STREAM;
+  if (Passive) Hints.ai_flags = AI_PASSIVE;
+
+  int Error = getaddrinfo(Host.empty() ? nullptr : Host.c_str(), Port.c_str(), &Hints, &Result);
+  if (Error != 0) {
+    std::cerr << "Could not resolve " << Address << ": " << gai_strerror(Error) << std::endl;
+    return nullptr;
+  }
+
+  return Result;
+}
+
+int pinhao::listenOn(const std::string &Address) {
+  int Socket = -1;
+
+  if (isTCP(Address)) {
+    struct addrinfo *Info = resolveTCPAddress(Address, true);
+    if (!Info) return -1;
+
+    Socket = socket(Info->ai_family, Info->ai_socktype, Info->ai_protocol);
+    int Reuse = 1;
+    if (Socket >= 0) setsockopt(Socket, SOL_SOCKET, SO_REUSEADDR, &Reuse, sizeof(Reuse));
+    if (Socket >= 0 && bind(Socket, Info->ai_addr, Info->ai_addrlen) != 0) {
+      close(Socket);
+      Socket = -1;
+    }
+    freeaddrinfo(Info);
+  } else {
+    struct sockaddr_un Unix;
+    if (!fillUnixAddress(Address, Unix)) return -1;
+    unlink(Unix.sun_path);
+
+    Socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (Socket >= 0 && bind(Socket, (struct sockaddr*) &Unix, sizeof(Unix)) != 0) {
+      close(Socket);
+      Socket = -1;
+    }
+  }
+
+  if (Socket < 0 || listen(Socket, 64) != 0) {
+    std::cerr << "Could not listen on " << Address << ": " << strerror(errno) << std::endl;
+    if (Socket >= 0) close(Socket);
+    return -1;
+  }
+
+  return Socket;
+}
+
+/// @brief Makes a single attempt to connect to @a Address.
+static int tryConnect(const std::string &Address) {
+  int Socket = -1;
+
+  if (isTCP(Address)) {
+    struct addrinfo *Info = resolveTCPAddress(Address, false);
+    if (!Info) return -1;
+
+    for (auto *I = Info; I && Socket < 0; I = I->ai_next) {
+      Socket = socket(I->ai_family, I->ai_socktype, I->ai_protocol);
+      if (Socket >= 0 && connect(Socket, I->ai_addr, I->ai_addrlen) != 0) {
+        close(Socket);
+        Socket = -1;
+      }
+    }
+    freeaddrinfo(Info);
+  } else {
+    struct sockaddr_un Unix;
+    if (!fillUnixAddress(Address, Unix)) return -1;
+
+    Socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (Socket >= 0 && connect(Socket, (struct sockaddr*) &Unix, sizeof(Unix)) != 0) {
+      close(Socket);
+      Socket = -1;
+    }
+  }
+
+  return Socket;
+}
+
+int pinhao::connectTo(const std::string &Address, double Timeout) {
+  auto Deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(Timeout);
+
+  while (true) {
+    int Socket = tryConnect(Address);
+    if (Socket >= 0) return Socket;
+    if (std::chrono::steady_clock::now() >= Deadline) break;
+    // The other side may not be listening yet.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+
+  std::cerr << "Could not connect to " << Address << "." << std::endl;
+  return -1;
+}
+
+int pinhao::acceptConnection(int Socket, double Timeout) {
+  auto Deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(Timeout);
+
+  while (true) {
+    auto Remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        Deadline - std::chrono::steady_clock::now()).count();
+    if (Remaining < 0) return -1;
+
+    struct pollfd Fd = { Socket, POLLIN, 0 };
+    int Ready = poll(&Fd, 1, Remaining);
+    if (Ready < 0 && errno == EINTR) continue;
+    if (Ready <= 0) return -1;
+
+    int Connection = accept(Socket, nullptr, nullptr);
+    if (Connection < 0 && errno == EINTR) continue;
+    return Connection;
+  }
+}
+
+bool pinhao::setTimeout(int Socket, double Timeout) {
+  // A zero timeval would mean no timeout at all.
+  auto Micro = std::max<long long>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::duration<double>(Timeout)).count(), 1000);
+  struct timeval Time;
+  Time.tv_sec = Micro / 1000000;
+  Time.tv_usec = Micro % 1000000;
+  return setsockopt(Socket, SOL_SOCKET, SO_RCVTIMEO, &Time, sizeof(Time)) == 0 &&
+    setsockopt(Socket, SOL_SOCKET, SO_SNDTIMEO, &Time, sizeof(Time)) == 0;
+}
+
+void pinhao::closeSocket(int Socket, const std::string &Address) {
+  if (Socket >= 0) close(Socket);
+  if (!Address.empty() && !isTCP(Address))
+    unlink(getUnixPath(Address).c_str());
+}
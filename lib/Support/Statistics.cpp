@@ -0,0 +1,184 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file Statistics.cpp
+ */
+
+#include "pinhao/Support/Statistics.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+using namespace pinhao;
+
+double pinhao::getMedian(std::vector<double> Samples) {
+  assert(!Samples.empty() && "Median of no samples.");
+
+  uint64_t Middle = Samples.size() / 2;
+  std::nth_element(Samples.begin(), Samples.begin() + Middle, Samples.end());
+  double Median = Samples[Middle];
+
+  if (Samples.size() % 2 == 0) {
+    double Lower = *std::max_element(Samples.begin(), Samples.begin() + Middle);
+    Median = (Median + Lower) / 2;
+  }
+
+  return Median;
+}
+
+double pinhao::getMAD(const std::vector<double> &Samples) {
+  double Median = getMedian(Samples);
+
+  std::vector<double> Deviations;
+  for (auto Sample : Samples)
+    Deviations.push_back(std::fabs(Sample - Median));
+
+  return getMedian(Deviations);
+}
+
+std::vector<double> pinhao::getRanks(const std::vector<double> &Values) {
+  std::vector<uint64_t> Order(Values.size());
+  for (uint64_t I = 0; I < Order.size(); ++I)
+    Order[I] = I;
+  std::sort(Order.begin(), Order.end(), 
+      [&Values] (uint64_t L, uint64_t R) { return Values[L] < Values[R]; });
+
+  std::vector<double> Ranks(Values.size());
+  for (uint64_t I = 0; I < Order.size();) {
+    uint64_t J = I;
+    while (J + 1 < Order.size() && Values[Order[J + 1]] == Values[Order[I]]) ++J;
+
+    // Positions I to J are tied, so they all get the mean of ranks I+1 to J+1.
+    double Rank = (I + J) / 2.0 + 1;
+    for (uint64_t K = I; K <= J; ++K)
+      Ranks[Order[K]] = Rank;
+    I = J + 1;
+  }
+
+  return Ranks;
+}
+
+double pinhao::getSpearmanCorrelation(const std::vector<double> &X, const std::vector<double> &Y) {
+  assert(X.size() == Y.size() && "Correlation between vectors of different sizes.");
+  if (X.size() < 2) return 0;
+
+  // The Pearson correlation of the ranks, which also accounts for ties.
+  std::vector<double> RX = getRanks(X), RY = getRanks(Y);
+  double Mean = (X.size() + 1) / 2.0;
+
+  double Covariance = 0, VarianceX = 0, VarianceY = 0;
+  for (uint64_t I = 0; I < X.size(); ++I) {
+    Covariance += (RX[I] - Mean) * (RY[I] - Mean);
+    VarianceX += (RX[I] - Mean) * (RX[I] - Mean);
+    VarianceY += (RY[I] - Mean) * (RY[I] - Mean);
+  }
+
+  if (VarianceX == 0 || VarianceY == 0) return 0;
+  return Covariance / std::sqrt(VarianceX * VarianceY);
+}
+
+double pinhao::getNormalQuantile(double P) {
+  assert(P > 0 && P < 1 && "Normal quantile out of (0, 1).");
+
+  // Abramowitz and Stegun, 26.2.23 (absolute error below 4.5e-4).
+  double Q = P < 0.5 ? P : 1 - P;
+  double T = std::sqrt(-2 * std::log(Q));
+  double Z = T - (2.515517 + 0.802853 * T + 0.010328 * T * T) / 
+    (1 + 1.432788 * T + 0.189269 * T * T + 0.001308 * T * T * T);
+
+  return P < 0.5 ? -Z : Z;
+}
+
+double pinhao::getStudentQuantile(double P, unsigned Freedom) {
+  assert(P > 0 && P < 1 && "Student quantile out of (0, 1).");
+  assert(Freedom > 0 && "Student quantile without degrees of freedom.");
+
+  // Exact with one and two degrees of freedom.
+  if (Freedom == 1) return std::tan(M_PI * (P - 0.5));
+  if (Freedom == 2) return (2 * P - 1) / std::sqrt(2 * P * (1 - P));
+
+  // Abramowitz and Stegun, 26.7.5 (Cornish-Fisher expansion around the normal quantile).
+  double Z = getNormalQuantile(P), Z2 = Z * Z, V = Freedom;
+  return Z + 
+    Z * (Z2 + 1) / (4 * V) + 
+    Z * ((5 * Z2 + 16) * Z2 + 3) / (96 * V * V) + 
+    Z * (((3 * Z2 + 19) * Z2 + 17) * Z2 - 15) / (384 * V * V * V) + 
+    Z * ((((79 * Z2 + 776) * Z2 + 1482) * Z2 - 1920) * Z2 - 945) / (92160 * V * V * V * V);
+}
+
+std::pair<double, double> pinhao::getMedianConfidenceInterval(std::vector<double> Samples, 
+    double Confidence) {
+  assert(!Samples.empty() && "Confidence interval of no samples.");
+  std::sort(Samples.begin(), Samples.end());
+
+  double N = Samples.size();
+  double Z = getNormalQuantile(0.5 + Confidence / 2);
+
+  // Ranks starting from 1.
+  int64_t Lower = std::floor(N / 2 - Z * std::sqrt(N) / 2);
+  int64_t Upper = std::ceil(1 + N / 2 + Z * std::sqrt(N) / 2);
+  if (Lower > 1 && Upper < static_cast<int64_t>(Samples.size()))
+    return std::make_pair(Samples[Lower - 1], Samples[Upper - 1]);
+
+  if (Samples.size() == 1)
+    return std::make_pair(-std::numeric_limits<double>::infinity(), 
+        std::numeric_limits<double>::infinity());
+
+  double Mean = 0;
+  for (auto Sample : Samples)
+    Mean += Sample;
+  Mean /= N;
+
+  double Variance = 0;
+  for (auto Sample : Samples)
+    Variance += (Sample - Mean) * (Sample - Mean);
+  Variance /= N - 1;
+
+  // The standard error of the median of normal samples is sqrt(pi / 2) times the one of the mean.
+  double Median = getMedian(Samples);
+  double Error = std::sqrt(M_PI / 2 * Variance / N);
+  double T = getStudentQuantile(0.5 + Confidence / 2, Samples.size() - 1);
+  return std::make_pair(Median - T * Error, Median + T * Error);
+}
+
+RobustEstimate::RobustEstimate() : Median(0), MAD(0), Lower(0), Upper(0) {}
+
+RobustEstimate::RobustEstimate(const std::vector<double> &Samples, double Confidence) : 
+  Samples(Samples) {
+  Median = getMedian(Samples);
+  MAD = getMAD(Samples);
+
+  auto Interval = getMedianConfidenceInterval(Samples, Confidence);
+  Lower = Interval.first;
+  Upper = Interval.second;
+}
+
+double RobustEstimate::getRelativeWidth() const {
+  if (Median == 0) return std::numeric_limits<double>::infinity();
+  return (Upper - Lower) / std::fabs(Median);
+}
+
+bool pinhao::measureRepeatedly(std::function<bool(double&)> Sampler, const RepetitionPolicy &Policy,
+    RobustEstimate &Estimate) {
+  std::vector<double> Samples;
+  unsigned MaxSamples = std::max(std::max(Policy.MaxSamples, Policy.MinSamples), 1u);
+
+  while (Samples.size() < MaxSamples) {
+    double Sample;
+    if (!Sampler(Sample)) {
+      if (!Samples.empty()) Estimate = RobustEstimate(Samples, Policy.Confidence);
+      return false;
+    }
+    Samples.push_back(Sample);
+
+    if (Samples.size() < Policy.MinSamples) continue;
+    if (RobustEstimate(Samples, Policy.Confidence).getRelativeWidth() <= Policy.MaxRelativeWidth) 
+      break;
+  }
+
+  Estimate = RobustEstimate(Samples, Policy.Confidence);
+  return true;
+}
@@ -0,0 +1,156 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file WorkerPool.cpp
+ */
+
+#include "pinhao/Support/WorkerPool.h"
+#include "pinhao/Support/IPC.h"
+
+#include <map>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace pinhao;
+
+WorkerPool::WorkerPool(unsigned Workers) : MaxWorkers(Workers), NextId(0) {
+  if (MaxWorkers == 0) MaxWorkers = 1;
+}
+
+WorkerPool::~WorkerPool() {
+  while (!Running.empty())
+    collect(0);
+}
+
+unsigned WorkerPool::getNumberOfWorkers() const {
+  return MaxWorkers;
+}
+
+uint64_t WorkerPool::getNumberOfPending() const {
+  return Running.size() + Finished.size();
+}
+
+bool WorkerPool::hasIdleWorker() const {
+  return MaxWorkers == 1 || Running.size() < MaxWorkers;
+}
+
+WorkerPool::Result WorkerPool::collect(uint64_t N) {
+  Worker W = Running[N];
+  Running.erase(Running.begin() + N);
+
+  Values Value;
+  uint64_t Size;
+  bool Received = readAll(W.Fd, &Size, sizeof(uint64_t));
+  if (Received) {
+    Value.resize(Size);
+    Received = readAll(W.Fd, Value.data(), Size * sizeof(double));
+  }
+  close(W.Fd);
+
+  if (!Received) {
+    std::cerr << "Worker " << W.Pid << " died without a result." << std::endl;
+    Value.clear();
+  }
+
+  int Status;
+  while (waitpid(W.Pid, &Status, 0) < 0 && errno == EINTR);
+
+  return std::make_pair(W.Id, Value);
+}
+
+uint64_t WorkerPool::submit(Task T) {
+  uint64_t Id = NextId++;
+
+  if (MaxWorkers == 1) {
+    Finished.push_back(std::make_pair(Id, T()));
+    return Id;
+  }
+
+  while (Running.size() >= MaxWorkers)
+    Finished.push_back(waitRunning());
+
+  int Fds[2];
+  if (pipe(Fds) != 0) {
+    std::cerr << "Could not create the worker pipe. Running task in place." << std::endl;
+    Finished.push_back(std::make_pair(Id, T()));
+    return Id;
+  }
+
+  std::cout.flush();
+  std::cerr.flush();
+  fflush(stdout);
+
+  pid_t Pid = fork();
+
+  if (Pid < 0) {
+    std::cerr << "Could not fork the worker. Running task in place." << std::endl;
+    close(Fds[0]);
+    close(Fds[1]);
+    Finished.push_back(std::make_pair(Id, T()));
+    return Id;
+  }
+
+  if (Pid == 0) {
+    close(Fds[0]);
+    Values Value = T();
+    uint64_t Size = Value.size();
+    if (writeAll(Fds[1], &Size, sizeof(uint64_t)))
+      writeAll(Fds[1], Value.data(), Size * sizeof(double));
+
+    std::cout.flush();
+    fflush(stdout);
+    _exit(0);
+  }
+
+  close(Fds[1]);
+  Running.push_back({ Id, Pid, Fds[0] });
+  return Id;
+}
+
+WorkerPool::Result WorkerPool::waitRunning() {
+  std::vector<struct pollfd> Fds;
+  for (auto &W : Running)
+    Fds.push_back({ W.Fd, POLLIN, 0 });
+
+  while (true) {
+    int Ready = poll(Fds.data(), Fds.size(), -1);
+    if (Ready < 0 && errno == EINTR) continue;
+    assert(Ready > 0 && "Error: poll failed while waiting for workers.");
+
+    for (uint64_t I = 0; I < Fds.size(); ++I)
+      if (Fds[I].revents)
+        return collect(I);
+  }
+}
+
+WorkerPool::Result WorkerPool::wait() {
+  if (!Finished.empty()) {
+    Result R = Finished.front();
+    Finished.pop_front();
+    return R;
+  }
+
+  assert(!Running.empty() && "Waiting on a WorkerPool without tasks.");
+  return waitRunning();
+}
+
+std::vector<WorkerPool::Values> WorkerPool::map(std::vector<Task> Tasks) {
+  std::map<uint64_t, uint64_t> Position;
+  for (uint64_t I = 0; I < Tasks.size(); ++I)
+    Position[submit(Tasks[I])] = I;
+
+  std::vector<Values> Results(Tasks.size());
+  for (uint64_t I = 0; I < Tasks.size(); ++I) {
+    Result R = wait();
+    assert(Position.count(R.first) && "WorkerPool::map called with pending tasks.");
+    Results[Position[R.first]] = R.second;
+  }
+
+  return Results;
+}
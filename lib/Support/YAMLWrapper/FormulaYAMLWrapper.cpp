@@ -9,6 +9,8 @@
 
 #include "pinhao/MachineLearning/GrammarEvolution/Formula.h"
 
+#include <stdexcept>
+
 using namespace pinhao;
 
 /*
@@ -24,10 +26,14 @@ std::unique_ptr<FormulaBase> YAMLWrapper::get(ConstNode &Node) {
   Type = static_cast<ValueType>(Node["type"].as<int>());
   Kind = getFormulaKind(Node["kind"].as<std::string>());
 
+  OpType = Type;
   if (Node["op-type"])
     OpType = static_cast<ValueType>(Node["op-type"].as<int>());
 
   FormulaBase *FB = createFormula(Kind, Type, OpType).release();
+  if (!FB)
+    throw std::invalid_argument("There is no " + Node["kind"].as<std::string>() +
+        " formula of type " + std::to_string(static_cast<int>(Type)) + ".");
   switch (Type) {
     case ValueType::Int:    YAMLWrapper::fill(static_cast<Formula<int>&>(*FB), Node);         break;
     case ValueType::Float:  YAMLWrapper::fill(static_cast<Formula<double>&>(*FB), Node);      break;
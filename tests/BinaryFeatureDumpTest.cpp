@@ -0,0 +1,218 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/Features/Feature.h"
+#include "pinhao/Features/FeatureRegistry.h"
+#include "pinhao/Features/MapFeature.h"
+#include "pinhao/Support/BinaryFeatureDump.h"
+
+#include "ModuleReader.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+using namespace pinhao;
+
+static std::string printFeature(Feature &F) {
+  std::ostringstream Out;
+  F.print(Out);
+  return Out.str();
+}
+
+/// @brief Writes the features processed from 2mm in @a Filename, and reads them again.
+static void testRoundTrip(std::string Name, std::string Filename) {
+  std::string Benchmark("../../benchmark/polybench-ll/2mm/2mm.bc");
+  ModuleReader Reader(Benchmark);
+  std::unique_ptr<Feature> Written = FeatureRegistry::get(Name);
+  Written->processModule(*(Reader.getModule().get()));
+  {
+    std::ofstream Of(Filename, std::ios::binary);
+    BinaryFeatureWriter Writer(Of, 16);
+    ASSERT_TRUE(Written->write(Writer));
+    ASSERT_TRUE(Writer.good());
+  }
+
+  BinaryFeatureDump Dump;
+  ASSERT_TRUE(Dump.open(Filename));
+  std::unique_ptr<Feature> Read = FeatureRegistry::get(Name);
+  ASSERT_TRUE(Read->read(Dump));
+  ASSERT_EQ(printFeature(*Written), printFeature(*Read));
+}
+
+TEST(BinaryFeatureDumpTest, CFGModuleStaticFeatureTest) {
+  testRoundTrip("cfg_md_static", "2mm-md.bin");
+}
+
+TEST(BinaryFeatureDumpTest, CFGFunctionStaticFeatureTest) {
+  testRoundTrip("cfg_fn_static", "2mm-fn.bin");
+}
+
+TEST(BinaryFeatureDumpTest, CFGBasicBlockStaticFeatureTest) {
+  testRoundTrip("cfg_bb_static", "2mm-bb.bin");
+}
+
+TEST(BinaryFeatureDumpTest, MapFeatureTest) {
+  const std::string Filename("static-cost.bin");
+  std::unique_ptr<Feature> Written = FeatureRegistry::get("static-cost");
+  auto *Cost = static_cast<MapFeature<std::string, double>*>(Written.get());
+  for (int I = 0; I < 10; ++I)
+    Cost->setValueOfKey("static-cost", I * 1.5, "function" + std::to_string(I));
+  {
+    std::ofstream Of(Filename, std::ios::binary);
+    BinaryFeatureWriter Writer(Of, 3);
+    ASSERT_TRUE(Written->write(Writer));
+  }
+
+  ASSERT_TRUE(BinaryFeatureDump::isBinary(Filename));
+  BinaryFeatureDump Dump;
+  ASSERT_TRUE(Dump.open(Filename));
+  ASSERT_EQ(1u, Dump.size());
+  ASSERT_EQ(4u, Dump.getSection(0).Blocks.size());
+  ASSERT_EQ(10u, Dump.getSection(0).getRows());
+  ASSERT_EQ(nullptr, Dump.find("cfg_md_static"));
+
+  std::unique_ptr<Feature> Read = FeatureRegistry::get("static-cost");
+  ASSERT_TRUE(Read->read(Dump));
+  ASSERT_EQ(printFeature(*Written), printFeature(*Read));
+
+  // The YAML of the dump is the one of the feature.
+  std::ostringstream Out;
+  Dump.print(Out);
+  ASSERT_EQ(printFeature(*Written), Out.str());
+
+  // The sections with other types are not read.
+  std::map<std::string, uint64_t> Other;
+  ASSERT_FALSE(Dump.fillMap("static-cost", Other));
+}
+
+/// @brief Gets the dump of a static-cost feature with one key.
+static std::string writeStaticCost() {
+  std::unique_ptr<Feature> Written = FeatureRegistry::get("static-cost");
+  static_cast<MapFeature<std::string, double>*>(Written.get())->setValueOfKey("static-cost", 1, "main");
+  std::ostringstream Out;
+  BinaryFeatureWriter Writer(Out);
+  Written->write(Writer);
+  EXPECT_EQ(Out.str().size(), Writer.size());
+  return Out.str();
+}
+
+TEST(BinaryFeatureDumpTest, MalformedTest) {
+  const std::string Filename("static-cost-malformed.bin");
+  std::string Bytes = writeStaticCost();
+
+  // Without the block that ends the section.
+  std::ofstream(Filename, std::ios::binary) << Bytes.substr(0, Bytes.size() - 8);
+  BinaryFeatureDump Dump;
+  ASSERT_FALSE(Dump.open(Filename));
+  ASSERT_FALSE(Dump.isOpen());
+
+  std::ofstream(Filename, std::ios::binary) << Bytes;
+  ASSERT_TRUE(Dump.open(Filename));
+}
+
+template <class T>
+static void appendValue(std::string &Out, T Value) {
+  Out.append(reinterpret_cast<const char*>(&Value), sizeof(T));
+}
+
+/// @brief Writes @a Section followed by @a Blocks, and opens it.
+static bool openBlocks(std::string Filename, std::string Section, std::string Blocks) {
+  std::ofstream(Filename, std::ios::binary) << Section + Blocks;
+  BinaryFeatureDump Dump;
+  return Dump.open(Filename);
+}
+
+TEST(BinaryFeatureDumpTest, OverflowTest) {
+  const std::string Filename("static-cost-overflow.bin");
+  const std::string Bytes = writeStaticCost();
+
+  // The section header (24 bytes) and its schema, which the blocks follow.
+  uint32_t Schema;
+  std::memcpy(&Schema, Bytes.data() + 20, sizeof(uint32_t));
+  std::string Section = Bytes.substr(0, 24 + Schema);
+  const uint64_t Wrapping = (UINT64_C(1) << 61) + 1;
+
+  // So many keys that the size of their offsets wraps around. The offsets never decrease.
+  std::string Blocks;
+  appendValue<uint64_t>(Blocks, Wrapping);
+  Blocks.append(64, '\0');
+  ASSERT_FALSE(openBlocks(Filename, Section, Blocks));
+
+  // A key that ends so far that its padded size wraps around.
+  for (uint64_t End : { ~UINT64_C(0), UINT64_C(0) }) {
+    Blocks.clear();
+    appendValue<uint64_t>(Blocks, 1);
+    appendValue<uint64_t>(Blocks, 0);
+    appendValue<uint64_t>(Blocks, End);
+    appendValue<double>(Blocks, 1);
+    appendValue<uint64_t>(Blocks, 0);
+    ASSERT_EQ(openBlocks(Filename, Section, Blocks), End == 0);
+  }
+
+  // So many values of a fixed width (a vector, without keys) that their size wraps around.
+  Section[12] = static_cast<char>(BinaryFeatureDump::Layout::Vector);
+  Section[13] = static_cast<char>(ColumnType::None);
+  for (uint64_t Rows : { Wrapping, UINT64_C(1) }) {
+    Blocks.clear();
+    appendValue<uint64_t>(Blocks, Rows);
+    appendValue<double>(Blocks, 1);
+    appendValue<uint64_t>(Blocks, 0);
+    ASSERT_EQ(openBlocks(Filename, Section, Blocks), Rows == 1);
+  }
+}
+
+/// @brief Gets a section like the one of @a writeStaticCost, with @a TheLayout, @a KeyType
+/// and @a Columns.
+static std::string getSection(BinaryFeatureDump::Layout TheLayout, ColumnType KeyType,
+    std::vector<std::string> Columns) {
+  std::string Schema;
+  Columns.insert(Columns.begin(), "static-cost");
+  for (auto &Name : Columns) {
+    appendValue<uint32_t>(Schema, Name.size());
+    Schema.append(Name);
+  }
+  Schema.resize((Schema.size() + 7) & ~7, '\0');
+
+  std::string Section = writeStaticCost().substr(0, 16);
+  Section[12] = static_cast<char>(TheLayout);
+  Section[13] = static_cast<char>(KeyType);
+  appendValue<uint32_t>(Section, Columns.size() - 1);
+  appendValue<uint32_t>(Section, Schema.size());
+  return Section + Schema;
+}
+
+/// @brief Gets a block of one row, with an empty key if @a Keyed, and @a Values columns.
+static std::string getRow(bool Keyed, uint64_t Values) {
+  std::string Blocks;
+  appendValue<uint64_t>(Blocks, 1);
+  if (Keyed) {
+    appendValue<uint64_t>(Blocks, 0);
+    appendValue<uint64_t>(Blocks, 0);
+  }
+  for (uint64_t N = 0; N < Values; ++N)
+    appendValue<double>(Blocks, 1);
+  appendValue<uint64_t>(Blocks, 0);
+  return Blocks;
+}
+
+TEST(BinaryFeatureDumpTest, ColumnsTest) {
+  const std::string Filename("static-cost-columns.bin");
+  typedef BinaryFeatureDump::Layout Layout;
+
+  ASSERT_TRUE(openBlocks(Filename, getSection(Layout::Map, ColumnType::String, { "static-cost" }),
+        getRow(true, 1)));
+  ASSERT_TRUE(openBlocks(Filename, getSection(Layout::Vector, ColumnType::None, { "a" }), getRow(false, 1)));
+
+  // A map has exactly one column, and the other layouts at least one.
+  ASSERT_FALSE(openBlocks(Filename, getSection(Layout::Map, ColumnType::String, {}), getRow(true, 0)));
+  ASSERT_FALSE(openBlocks(Filename, getSection(Layout::Map, ColumnType::String, { "a", "b" }),
+        getRow(true, 2)));
+  ASSERT_FALSE(openBlocks(Filename, getSection(Layout::MapVector, ColumnType::String, {}), getRow(true, 0)));
+  ASSERT_FALSE(openBlocks(Filename, getSection(Layout::Vector, ColumnType::None, {}), getRow(false, 0)));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
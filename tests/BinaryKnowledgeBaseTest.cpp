@@ -0,0 +1,199 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/MachineLearning/GrammarEvolution/BinaryKnowledgeBase.h"
+#include "pinhao/MachineLearning/GrammarEvolution/GrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/Formulas.h"
+
+#include <fstream>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace pinhao;
+
+static SerialSet<Candidate> generateKnowledgeBase(uint64_t Size) {
+  FeatureSet::disableAll();
+  FeatureSet::enable("cfg_md_static");
+  auto Set = FeatureSet::get();
+
+  std::vector<DecisionPoint> DecisionPoints;
+  for (auto &Name : Optimizations)
+    DecisionPoints.push_back(DecisionPoint(Name, ValueType::Bool));
+
+  SerialSet<Candidate> KnowledgeBase;
+  while (KnowledgeBase.size() < Size) {
+    Candidate C;
+    C.generateMissing(DecisionPoints, Set.get());
+    C.Score = UniformRandom::getRandomReal();
+    C.Count = KnowledgeBase.size() + 1;
+    KnowledgeBase.insert(C);
+  }
+  return KnowledgeBase;
+}
+
+TEST(BinaryKnowledgeBaseTest, RoundTripTest) {
+  auto KnowledgeBase = generateKnowledgeBase(50);
+  ASSERT_TRUE(BinaryKnowledgeBase::write("round-trip.kb", KnowledgeBase.getSet()));
+
+  BinaryKnowledgeBase Stored;
+  ASSERT_TRUE(Stored.open("round-trip.kb"));
+  ASSERT_EQ(Stored.size(), KnowledgeBase.size());
+
+  for (uint64_t I = 0; I < Stored.size(); ++I) {
+    if (I) ASSERT_GE(Stored.getEntry(I - 1).Score, Stored.getEntry(I).Score);
+
+    Candidate C;
+    ASSERT_TRUE(Stored.get(I, C));
+    auto It = KnowledgeBase.find(C);
+    ASSERT_NE(It, KnowledgeBase.end());
+    ASSERT_EQ(It->Score, C.Score);
+    ASSERT_EQ(It->Count, C.Count);
+    ASSERT_EQ(BinaryKnowledgeBase::encode(*It), Stored.getFormulas(I));
+    ASSERT_EQ(Stored.find(Stored.getFormulas(I)), I);
+  }
+
+  Candidate Other = *generateKnowledgeBase(1).begin();
+  if (!KnowledgeBase.has(Other))
+    ASSERT_EQ(Stored.find(BinaryKnowledgeBase::encode(Other)), Stored.size());
+}
+
+TEST(BinaryKnowledgeBaseTest, ConvertTest) {
+  auto KnowledgeBase = generateKnowledgeBase(20);
+  {
+    std::ofstream Of("convert.yaml");
+    YAMLWrapper::print(KnowledgeBase, Of);
+  }
+
+  ASSERT_EQ(convertKnowledgeBase("convert.yaml", "convert.kb"), KnowledgeBase.size());
+  ASSERT_EQ(convertKnowledgeBase("convert.kb", "convert-back.yaml"), KnowledgeBase.size());
+
+  SerialSet<Candidate> Converted;
+  auto Node = YAMLWrapper::loadFile("convert-back.yaml");
+  YAMLWrapper::fill(Converted, Node);
+  ASSERT_EQ(Converted.size(), KnowledgeBase.size());
+  for (auto &C : KnowledgeBase) {
+    auto It = Converted.find(C);
+    ASSERT_NE(It, Converted.end());
+    ASSERT_EQ(It->Score, C.Score);
+    ASSERT_EQ(It->Count, C.Count);
+  }
+}
+
+TEST(BinaryKnowledgeBaseTest, MergeTest) {
+  auto KnowledgeBase = generateKnowledgeBase(10);
+  ASSERT_TRUE(BinaryKnowledgeBase::write("merge.kb", KnowledgeBase.getSet()));
+
+  BinaryKnowledgeBase Stored;
+  ASSERT_TRUE(Stored.open("merge.kb"));
+
+  // The best entry was loaded, and the last one was evaluated again without being loaded.
+  Candidate Best, Last;
+  ASSERT_TRUE(Stored.get(0, Best));
+  ASSERT_TRUE(Stored.get(Stored.size() - 1, Last));
+  Best.Score = 2;
+  Last.Score = 0.5;
+  Last.Count = 2;
+
+  std::set<Candidate> Resident = { Best, Last };
+  std::vector<bool> Loaded(Stored.size(), false);
+  Loaded[0] = true;
+  ASSERT_TRUE(BinaryKnowledgeBase::write("merge.kb", Resident, &Stored, &Loaded));
+
+  BinaryKnowledgeBase Merged;
+  ASSERT_TRUE(Merged.open("merge.kb"));
+  ASSERT_EQ(Merged.size(), KnowledgeBase.size());
+  ASSERT_EQ(Merged.getEntry(0).Score, 2);
+  ASSERT_EQ(Merged.getFormulas(0), BinaryKnowledgeBase::encode(Best));
+
+  uint64_t LastCount = Stored.getEntry(Stored.size() - 1).Count;
+  double LastScore = Stored.getEntry(Stored.size() - 1).Score;
+  bool Found = false;
+  for (uint64_t I = 0; I < Merged.size(); ++I) {
+    if (Merged.getFormulas(I) != BinaryKnowledgeBase::encode(Last)) continue;
+    ASSERT_EQ(Merged.getEntry(I).Count, LastCount + 2);
+    ASSERT_DOUBLE_EQ(Merged.getEntry(I).Score, (LastCount * LastScore + 2 * 0.5) / (LastCount + 2));
+    Found = true;
+  }
+  ASSERT_TRUE(Found);
+}
+
+/// @brief Runs as many processes, each merging @a Rounds times one evaluation of every
+/// candidate of @a Shared, with its own score, and a candidate only it has.
+static void mergeConcurrently(std::string Filename, const std::set<Candidate> &Shared,
+    const std::set<Candidate> &Own, int Rounds) {
+  std::vector<pid_t> Pids;
+  uint64_t Process = 0;
+  for (auto &C : Own) {
+    pid_t Pid = fork();
+    if (Pid == 0) {
+      std::set<Candidate> Evaluations;
+      for (auto E : Shared) {
+        E.Score = Process + 1;
+        E.Count = 1;
+        Evaluations.insert(E);
+      }
+
+      bool Merged = true;
+      for (int R = 0; R < Rounds; ++R)
+        Merged = mergeKnowledgeBase(Filename, std::set<Candidate>({ C }), Evaluations) && Merged;
+      _exit(Merged ? 0 : 1);
+    }
+    Pids.push_back(Pid);
+    ++Process;
+  }
+
+  for (auto Pid : Pids) {
+    int Status;
+    waitpid(Pid, &Status, 0);
+    ASSERT_TRUE(WIFEXITED(Status) && WEXITSTATUS(Status) == 0);
+  }
+}
+
+TEST(BinaryKnowledgeBaseTest, ConcurrentMergeTest) {
+  auto KnowledgeBase = generateKnowledgeBase(8);
+  std::set<Candidate> Shared(KnowledgeBase.begin(), std::next(KnowledgeBase.begin(), 4));
+  std::set<Candidate> Own(std::next(KnowledgeBase.begin(), 4), KnowledgeBase.end());
+  const int Rounds = 5;
+
+  for (std::string Filename : { "concurrent.yaml", "concurrent.kb" }) {
+    unlink(Filename.c_str());
+    mergeConcurrently(Filename, Shared, Own, Rounds);
+
+    SerialSet<Candidate> Merged;
+    ASSERT_EQ(convertKnowledgeBase(Filename, "concurrent-check.yaml"), KnowledgeBase.size());
+    YAMLWrapper::fill(Merged, YAMLWrapper::loadFile("concurrent-check.yaml"));
+
+    // No evaluation is lost, and the scores are averaged by count: 1, 2, 3 and 4 each
+    // as many times.
+    for (auto &C : Shared) {
+      auto It = Merged.find(C);
+      ASSERT_NE(It, Merged.end());
+      ASSERT_EQ(It->Count, Own.size() * Rounds);
+      ASSERT_DOUBLE_EQ(It->Score, 2.5);
+    }
+    for (auto &C : Own) {
+      auto It = Merged.find(C);
+      ASSERT_NE(It, Merged.end());
+      ASSERT_EQ(It->Count, C.Count);
+    }
+  }
+}
+
+TEST(BinaryKnowledgeBaseTest, MalformedTest) {
+  {
+    std::ofstream Of("malformed.kb");
+    Of << "This is not a knowledge base.";
+  }
+
+  BinaryKnowledgeBase Stored;
+  ASSERT_FALSE(Stored.open("malformed.kb"));
+  ASSERT_FALSE(Stored.open("missing.kb"));
+
+  Candidate C;
+  ASSERT_FALSE(BinaryKnowledgeBase::decode(std::string("\x01\x00\x00\x00", 4), C));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
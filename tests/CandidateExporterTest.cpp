@@ -0,0 +1,177 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/MachineLearning/GrammarEvolution/CandidateExporter.h"
+#include "pinhao/MachineLearning/GrammarEvolution/GrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaBytecode.h"
+#include "pinhao/MachineLearning/GrammarEvolution/Formulas.h"
+
+#include "ModuleReader.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+using namespace pinhao;
+
+static const std::string Benchmark("../../benchmark/polybench-ll/2mm/2mm.bc");
+
+static std::shared_ptr<FeatureSet> getFeatureSet() {
+  ModuleReader Reader(Benchmark);
+
+  FeatureSet::disableAll();
+  FeatureSet::enable("cfg_md_static");
+  std::shared_ptr<FeatureSet> Set = FeatureSet::get();
+  FeatureSetWrapperPass SetPass(&Set);
+  SetPass.runOnModule(*Reader.getModule());
+  return Set;
+}
+
+/// @brief Creates the formula Feature.SubFeature < Value.
+static FormulaRef createLess(std::string Feature, std::string SubFeature, int Value) {
+  auto Less = new BoolBinOpFormula<int>();
+  Less->setOperatorId(1);
+  auto Lhs = new FeatureFormula<int>();
+  Lhs->FeaturePair = std::make_pair(Feature, SubFeature);
+  auto Rhs = new LitFormula<int>();
+  Rhs->setValue(Value);
+  Less->Lhs.reset(Lhs);
+  Less->Rhs.reset(Rhs);
+  return FormulaRef(Less);
+}
+
+static std::vector<int> getSequence(std::vector<Optimization> Opts) {
+  std::vector<int> Sequence;
+  for (auto Opt : Opts)
+    Sequence.push_back(static_cast<int>(Opt));
+  return Sequence;
+}
+
+TEST(CandidateExporterTest, ExportTest) {
+  auto Enabled = new LitFormula<bool>();
+  Enabled->setValue(true);
+
+  Candidate C;
+  C.Score = 1.5;
+  C.Count = 1;
+  C[DecisionPoint("gvn", ValueType::Bool)] = createLess("cfg_md_static", "nof_bb", 10);
+  C[DecisionPoint("licm", ValueType::Bool)] = FormulaRef(Enabled);
+
+  std::ostringstream Out;
+  CandidateExporter Exporter("tuned");
+  auto Sequence = getSequence({ Optimization::licm, Optimization::adce, Optimization::gvn, Optimization::licm });
+  ASSERT_TRUE(Exporter.exportPass(C, Sequence, Out));
+
+  std::string Source = Out.str();
+  // Only the basic blocks are counted.
+  ASSERT_NE(Source.find("for (auto &BB : Function)"), std::string::npos);
+  ASSERT_EQ(Source.find("for (auto &I : BB)"), std::string::npos);
+  ASSERT_EQ(Source.find("Preds"), std::string::npos);
+
+  // The optimizations are in the order of the sequence, and adce has no formula.
+  auto LICM = Source.find("addPass(PM, \"licm\")");
+  auto GVN = Source.find("createGVNPass(");
+  ASSERT_NE(LICM, std::string::npos);
+  ASSERT_NE(GVN, std::string::npos);
+  ASSERT_LT(LICM, GVN);
+  ASSERT_NE(Source.find("addPass(PM, \"licm\")", GVN), std::string::npos);
+  ASSERT_EQ(Source.find("\"adce\""), std::string::npos);
+
+  ASSERT_NE(Source.find("RegisterPass<CandidatePass> X(\"tuned\""), std::string::npos);
+
+  // The target analyses are always added, the OLevel passes only when there is one.
+  ASSERT_NE(Source.find("createTargetTransformInfoWrapperPass(TIRA)"), std::string::npos);
+  ASSERT_EQ(Source.find("PassManagerBuilder Builder"), std::string::npos);
+
+  std::ostringstream OLevelOut;
+  ASSERT_TRUE(Exporter.exportPass(C, Sequence, OLevelOut, OptLevel::O2));
+  Source = OLevelOut.str();
+  ASSERT_NE(Source.find("CodeGenOpt::Default"), std::string::npos);
+  ASSERT_LT(Source.find("Builder.populateModulePassManager(PM)"), Source.find("createGVNPass("));
+}
+
+TEST(CandidateExporterTest, UnsupportedTest) {
+  Candidate C;
+  C[DecisionPoint("gvn", ValueType::Bool)] = createLess("cfg_fn_static", "nof_bb", 10);
+
+  std::ostringstream Out;
+  CandidateExporter Exporter;
+  ASSERT_FALSE(Exporter.exportPass(C, getSequence({ Optimization::gvn }), Out));
+  ASSERT_TRUE(Out.str().empty());
+}
+
+TEST(CandidateExporterTest, RandomCandidateTest) {
+  auto Set = getFeatureSet();
+
+  std::vector<DecisionPoint> DecisionPoints;
+  std::vector<int> Sequence;
+  for (uint64_t I = 0; I < Optimizations.size(); ++I) {
+    DecisionPoints.push_back(DecisionPoint(Optimizations[I], ValueType::Bool));
+    Sequence.push_back(I);
+  }
+
+  Candidate C;
+  C.generateMissing(DecisionPoints, Set.get());
+
+  std::ostringstream Out;
+  CandidateExporter Exporter;
+  ASSERT_TRUE(Exporter.exportPass(C, Sequence, Out));
+  ASSERT_NE(Out.str().find("Enabled[" + std::to_string(Optimizations.size() - 1) + "] = "), std::string::npos);
+}
+
+TEST(CandidateExporterTest, PluginTest) {
+  auto Set = getFeatureSet();
+
+  // Each formula is at the edge of its feature's value in the module, so any count of the
+  // plugin that differs from pinhao's flips its decision.
+  std::vector<std::pair<std::string, std::string>> Uses = {
+    { "adce", "nof_cfg_crit_edges" }, { "dse", "nof_functions" }, { "gvn", "nof_bb" },
+    { "instcombine", "nof_callarg_ptr_inst" }, { "licm", "nof_load_inst" }, { "sccp", "nof_2pred_1suc_bb" }
+  };
+
+  Candidate C;
+  std::vector<int> Sequence;
+  for (uint64_t I = 0; I < Uses.size(); ++I) {
+    int Value = Set->getFeature<int>("cfg_md_static", Uses[I].second);
+    C[DecisionPoint(Uses[I].first, ValueType::Bool)] = createLess("cfg_md_static", Uses[I].second,
+        Value + static_cast<int>(I % 2));
+    Sequence.push_back(static_cast<int>(getOptimization(Uses[I].first)));
+  }
+
+  FeatureLayout Layout;
+  FormulaProgram Program(Layout);
+  std::map<std::string, uint64_t> Results;
+  for (auto &Pair : C)
+    Results[Pair.first.Name] = Program.add(Pair.second.get());
+  ASSERT_TRUE(Program.isValid());
+  Program.run(Set.get());
+
+  std::map<std::string, bool> Expected;
+  for (auto &Pair : Results)
+    Expected[Pair.first] = Program.getResult<bool>(Pair.second);
+
+  {
+    std::ofstream Source("CandidatePassTest.cpp");
+    CandidateExporter Exporter("tested");
+    ASSERT_TRUE(Exporter.exportPass(C, Sequence, Source));
+  }
+
+  // The plugin is built as with PINHAO_CANDIDATE_PASS, but by the compiler and LLVM in the PATH.
+  ASSERT_EQ(std::system("c++ -shared -fPIC $(llvm-config --cxxflags) "
+        "-o libCandidatePassTest.so CandidatePassTest.cpp"), 0);
+  ASSERT_EQ(std::system(("opt -load ./libCandidatePassTest.so -tested -tested-print-decisions "
+          "-disable-output " + Benchmark + " > CandidatePassTest.out").c_str()), 0);
+
+  std::map<std::string, bool> Decisions;
+  std::ifstream Printed("CandidatePassTest.out");
+  std::string Name;
+  bool Enabled;
+  while (Printed >> Name >> Enabled)
+    Decisions[Name] = Enabled;
+  ASSERT_EQ(Decisions, Expected);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
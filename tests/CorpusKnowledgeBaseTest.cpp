@@ -0,0 +1,150 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/MachineLearning/GrammarEvolution/CorpusKnowledgeBase.h"
+#include "pinhao/MachineLearning/GrammarEvolution/GrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/Formulas.h"
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaBytecode.h"
+
+#include <unistd.h>
+
+using namespace pinhao;
+
+static std::vector<Candidate> generateCandidates(uint64_t Size) {
+  FeatureSet::disableAll();
+  FeatureSet::enable("cfg_md_static");
+  auto Set = FeatureSet::get();
+
+  std::vector<DecisionPoint> DecisionPoints;
+  for (auto &Name : Optimizations)
+    DecisionPoints.push_back(DecisionPoint(Name, ValueType::Bool));
+
+  SerialSet<Candidate> Candidates;
+  while (Candidates.size() < Size) {
+    Candidate C;
+    C.generateMissing(DecisionPoints, Set.get());
+    C.Score = UniformRandom::getRandomReal() + 1;
+    C.Count = 1;
+    Candidates.insert(C);
+  }
+  return std::vector<Candidate>(Candidates.begin(), Candidates.end());
+}
+
+static bool isSame(const Candidate &A, const Candidate &B) {
+  return !(A < B) && !(B < A);
+}
+
+static CorpusKnowledgeBase::FeatureVector getFeatures(double Blocks, double Loops) {
+  CorpusKnowledgeBase::FeatureVector Features;
+  Features["basic_blocks"] = Blocks;
+  Features["loops"] = Loops;
+  Features["functions"] = 4;
+  return Features;
+}
+
+TEST(CorpusKnowledgeBaseTest, NearestTest) {
+  CorpusKnowledgeBase Corpus;
+  Corpus.addModule("small", getFeatures(10, 1), {});
+  Corpus.addModule("medium", getFeatures(100, 10), {});
+  Corpus.addModule("large", getFeatures(10000, 1000), {});
+  ASSERT_EQ(Corpus.size(), 3);
+
+  auto Nearest = Corpus.findNearest(getFeatures(120, 12), 3);
+  ASSERT_EQ(Nearest.size(), 3);
+  ASSERT_EQ(Corpus.getModule(Nearest[0]).Name, "medium");
+  ASSERT_EQ(Corpus.getModule(Nearest[2]).Name, "large");
+
+  // The counts are log-scaled: ten times bigger is as far as ten times smaller.
+  Nearest = Corpus.findNearest(getFeatures(1000, 100), 1);
+  ASSERT_EQ(Nearest.size(), 1);
+  ASSERT_NE(Corpus.getModule(Nearest[0]).Name, "small");
+
+  Nearest = Corpus.findNearest(getFeatures(100, 10), 2, "medium");
+  ASSERT_EQ(Nearest.size(), 2);
+  for (auto N : Nearest)
+    ASSERT_NE(Corpus.getModule(N).Name, "medium");
+
+  // Replacing a module does not add another one.
+  Corpus.addModule("medium", getFeatures(20, 2), {});
+  ASSERT_EQ(Corpus.size(), 3);
+  ASSERT_EQ(Corpus.getModule(Corpus.findNearest(getFeatures(10, 1), 1)[0]).Name, "small");
+}
+
+TEST(CorpusKnowledgeBaseTest, SeedsTest) {
+  auto Candidates = generateCandidates(9);
+  std::vector<Candidate> Near(Candidates.begin(), Candidates.begin() + 3);
+  std::vector<Candidate> Far(Candidates.begin() + 3, Candidates.begin() + 6);
+  std::vector<Candidate> Self(Candidates.begin() + 6, Candidates.end());
+
+  CorpusKnowledgeBase Corpus;
+  Corpus.addModule("near", getFeatures(100, 10), Near);
+  Corpus.addModule("far", getFeatures(10000, 1000), Far);
+  Corpus.addModule("self", getFeatures(100, 10), Self);
+
+  // The module's own candidates are never seeds.
+  auto Seeds = Corpus.getSeeds(getFeatures(100, 10), 1, 10, "self");
+  ASSERT_EQ(Seeds.size(), Near.size());
+  for (uint64_t I = 1; I < Seeds.size(); ++I)
+    ASSERT_GE(Seeds[I - 1].Score, Seeds[I].Score);
+  for (auto &C : Seeds)
+    ASSERT_TRUE(std::any_of(Near.begin(), Near.end(),
+          [&C] (const Candidate &Other) { return isSame(C, Other); }));
+
+  // The best of each neighbour comes first.
+  Seeds = Corpus.getSeeds(getFeatures(100, 10), 2, 2, "self");
+  ASSERT_EQ(Seeds.size(), 2);
+  ASSERT_TRUE(isSame(Seeds[0], Corpus.getModule(0).Candidates[0]));
+  ASSERT_TRUE(isSame(Seeds[1], Corpus.getModule(1).Candidates[0]));
+}
+
+TEST(CorpusKnowledgeBaseTest, SaveLoadTest) {
+  unlink("corpus.yaml");
+  auto Candidates = generateCandidates(4);
+
+  CorpusKnowledgeBase Corpus;
+  ASSERT_TRUE(Corpus.load("corpus.yaml"));
+  ASSERT_EQ(Corpus.size(), 0);
+  ASSERT_TRUE(Corpus.getSeeds(getFeatures(1, 1), 3, 3).empty());
+
+  Corpus.addModule("a", getFeatures(10, 1), std::vector<Candidate>(Candidates.begin(), Candidates.begin() + 2));
+  Corpus.addModule("b", getFeatures(1000, 100), std::vector<Candidate>(Candidates.begin() + 2, Candidates.end()));
+  ASSERT_TRUE(Corpus.save("corpus.yaml"));
+
+  CorpusKnowledgeBase Loaded;
+  ASSERT_TRUE(Loaded.load("corpus.yaml"));
+  ASSERT_EQ(Loaded.size(), Corpus.size());
+  for (uint64_t I = 0; I < Corpus.size(); ++I) {
+    auto &Expected = Corpus.getModule(I), &Module = Loaded.getModule(I);
+    ASSERT_EQ(Module.Name, Expected.Name);
+    ASSERT_EQ(Module.Features, Expected.Features);
+    ASSERT_EQ(Module.Candidates.size(), Expected.Candidates.size());
+    for (uint64_t J = 0; J < Module.Candidates.size(); ++J) {
+      ASSERT_TRUE(isSame(Module.Candidates[J], Expected.Candidates[J]));
+      ASSERT_EQ(Module.Candidates[J].Score, Expected.Candidates[J].Score);
+    }
+  }
+  ASSERT_EQ(Loaded.findNearest(getFeatures(900, 90), 1), Corpus.findNearest(getFeatures(900, 90), 1));
+}
+
+TEST(CorpusKnowledgeBaseTest, FeatureRowTest) {
+  CorpusKnowledgeBase Corpus;
+  Corpus.addModule("medium", getFeatures(100, 10), {});
+
+  FeatureLayout Layout;
+  Layout.getSlot(std::make_pair("cfg_md_static", "loops"), ValueType::Int);
+  Layout.getSlot(std::make_pair("cfg_md_static", "calls"), ValueType::Int);
+  std::vector<BytecodeValue> Row;
+  ASSERT_TRUE(Corpus.getFeatureRow(0, Layout, Row));
+  ASSERT_EQ(Row.size(), 2u);
+  ASSERT_EQ(Row[0].Int, 10);
+  // The features that the module does not have are zero.
+  ASSERT_EQ(Row[1].Int, 0);
+
+  // Only the features of the corpus are known.
+  Layout.getSlot(std::make_pair("static-cost", "static-cost"), ValueType::Float);
+  ASSERT_FALSE(Corpus.getFeatureRow(0, Layout, Row));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,191 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/MachineLearning/GrammarEvolution/Formulas.h"
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaBatch.h"
+
+#include "ModuleReader.h"
+
+#include <chrono>
+#include <iostream>
+
+using namespace pinhao;
+
+static std::shared_ptr<FeatureSet> getFeatureSet() {
+  std::string Benchmark("../../benchmark/polybench-ll/2mm/2mm.bc");
+  ModuleReader Reader(Benchmark);
+
+  FeatureSet::disableAll();
+  FeatureSet::enable("cfg_md_static");
+  std::shared_ptr<FeatureSet> Set = FeatureSet::get();
+  FeatureSetWrapperPass SetPass(&Set);
+  SetPass.runOnModule(*Reader.getModule());
+  return Set;
+}
+
+static std::vector<FormulaRef> generateFormulas(FeatureSet *Set, ValueType Type, uint64_t N) {
+  std::vector<FormulaRef> Formulas;
+  for (uint64_t I = 0; I < N; ++I) {
+    FormulaRef Form(generateFormula(Set, Type).release());
+    simplifyFormula(Form);
+    Formulas.push_back(Form);
+  }
+  return Formulas;
+}
+
+/// @brief Creates a matrix whose rows are the features of @a Set, perturbed at random
+/// if @a Perturb.
+static FeatureMatrix createMatrix(const FeatureLayout &Layout, FeatureSet *Set, uint64_t Rows,
+    bool Perturb = true) {
+  FeatureMatrix Matrix(Layout);
+  auto Values = Layout.fetchValues(Set);
+  for (uint64_t R = 0; R < Rows; ++R) {
+    auto Row = Values;
+    for (uint32_t Slot = 0; Slot < Row.size(); ++Slot)
+      if (Perturb && Layout.getType(Slot) == ValueType::Int)
+        Row[Slot].Int += UniformRandom::getRandomInt(-50, 50);
+    Matrix.addRow(Row);
+  }
+  return Matrix;
+}
+
+TEST(FormulaBatchTest, LiteralTest) {
+  auto Less = new BoolBinOpFormula<int>();
+  Less->setOperatorId(1);
+  auto Lhs = new LitFormula<int>();
+  Lhs->setValue(1);
+  auto Rhs = new LitFormula<int>();
+  Rhs->setValue(2);
+  Less->Lhs.reset(Lhs);
+  Less->Rhs.reset(Rhs);
+  FormulaRef Root(Less);
+
+  FeatureLayout Layout;
+  FormulaProgram Program(Layout);
+  Program.add(Root.get());
+  Program.add(Lhs);
+
+  FeatureMatrix Matrix(Layout);
+  for (int I = 0; I < 1000; ++I)
+    Matrix.addRow(std::vector<BytecodeValue>());
+
+  BatchEvaluator Evaluator(64);
+  auto Decisions = Evaluator.evaluate(Program, Matrix);
+  ASSERT_EQ(Decisions.getNumberOfRows(), 1000u);
+  ASSERT_EQ(Decisions.getNumberOfColumns(), 2u);
+  ASSERT_EQ(Decisions.getType(0), ValueType::Bool);
+  ASSERT_EQ(Decisions.getType(1), ValueType::Int);
+
+  for (int I = 0; I < 1000; ++I) {
+    ASSERT_TRUE(Decisions.get<bool>(I, 0));
+    ASSERT_EQ(Decisions.get<double>(I, 1), 1.0);
+  }
+}
+
+TEST(FormulaBatchTest, PopulationTest) {
+  auto Set = getFeatureSet();
+  const uint64_t Rows = 1000;
+
+  FeatureLayout Layout;
+  std::vector<std::vector<FormulaRef>> Population;
+  std::vector<FormulaProgram> Programs;
+  for (auto Type : { ValueType::Bool, ValueType::Int, ValueType::Bool }) {
+    Population.push_back(generateFormulas(Set.get(), Type, 100));
+    Programs.push_back(FormulaProgram(Layout));
+    for (auto &Form : Population.back())
+      Programs.back().add(Form.get());
+    ASSERT_TRUE(Programs.back().isValid());
+  }
+
+  auto Matrix = createMatrix(Layout, Set.get(), Rows);
+
+  std::vector<const FormulaProgram*> Pointers;
+  for (auto &Program : Programs)
+    Pointers.push_back(&Program);
+
+  // Blocks that do not divide the rows.
+  BatchEvaluator Evaluator(300);
+  auto Decisions = Evaluator.evaluate(Pointers, Matrix);
+  ASSERT_EQ(Decisions.size(), Programs.size());
+
+  for (uint64_t R = 0; R < Rows; ++R) {
+    std::vector<BytecodeValue> Row;
+    for (uint32_t Slot = 0; Slot < Matrix.getNumberOfColumns(); ++Slot) {
+      BytecodeValue Value;
+      auto &Column = Matrix.getColumn(Slot);
+      if (Column.Type == ValueType::Int) Value.Int = Column.Int[R];
+      else if (Column.Type == ValueType::Float) Value.Float = Column.Float[R];
+      else Value.Bool = Column.Bool[R];
+      Row.push_back(Value);
+    }
+
+    for (uint64_t P = 0; P < Programs.size(); ++P) {
+      Programs[P].run(Row);
+      for (uint64_t N = 0; N < Population[P].size(); ++N) {
+        if (Decisions[P].getType(N) == ValueType::Bool)
+          ASSERT_EQ(Decisions[P].get<bool>(R, N), Programs[P].getResult<bool>(N));
+        else
+          ASSERT_EQ(Decisions[P].get<int>(R, N), Programs[P].getResult<int>(N));
+      }
+    }
+  }
+}
+
+TEST(FormulaBatchTest, BenchmarkTest) {
+  auto Set = getFeatureSet();
+  const uint64_t Candidates = 20, DecisionPoints = 64, Rows = 2000;
+
+  FeatureLayout Layout;
+  std::vector<std::vector<FormulaRef>> Population;
+  std::vector<FormulaProgram> Programs;
+  for (uint64_t I = 0; I < Candidates; ++I) {
+    Population.push_back(generateFormulas(Set.get(), ValueType::Bool, DecisionPoints));
+    Programs.push_back(FormulaProgram(Layout));
+    for (auto &Form : Population.back())
+      Programs.back().add(Form.get());
+  }
+
+  auto Matrix = createMatrix(Layout, Set.get(), Rows, false);
+  std::vector<const FormulaProgram*> Pointers;
+  for (auto &Program : Programs)
+    Pointers.push_back(&Program);
+
+  // One solveFor per module per candidate (all the modules have the features of the set).
+  uint64_t TreeEnabled = 0;
+  auto Start = std::chrono::steady_clock::now();
+  for (uint64_t R = 0; R < Rows; ++R)
+    for (auto &Formulas : Population)
+      for (auto &Form : Formulas) {
+        Form->solveFor(Set.get());
+        TreeEnabled += getFormulaValue<bool>(Form.get());
+      }
+  auto Tree = std::chrono::steady_clock::now() - Start;
+
+  BatchEvaluator Evaluator;
+  Start = std::chrono::steady_clock::now();
+  auto Decisions = Evaluator.evaluate(Pointers, Matrix);
+  auto Batch = std::chrono::steady_clock::now() - Start;
+
+  // Every module takes the decisions of the tree walker, for each candidate.
+  uint64_t BatchEnabled = 0;
+  for (uint64_t P = 0; P < Candidates; ++P)
+    for (uint64_t N = 0; N < DecisionPoints; ++N) {
+      Population[P][N]->solveFor(Set.get());
+      bool Expected = getFormulaValue<bool>(Population[P][N].get());
+      for (uint64_t R = 0; R < Rows; ++R) {
+        ASSERT_EQ(Decisions[P].get<bool>(R, N), Expected);
+        BatchEnabled += Expected;
+      }
+    }
+  ASSERT_EQ(BatchEnabled, TreeEnabled);
+
+  typedef std::chrono::duration<double, std::milli> Milliseconds;
+  double TreeTime = std::chrono::duration_cast<Milliseconds>(Tree).count();
+  double BatchTime = std::chrono::duration_cast<Milliseconds>(Batch).count();
+  std::cout << "Tree: " << TreeTime << "ms" << std::endl;
+  std::cout << "Batch: " << BatchTime << "ms (" << TreeTime / BatchTime << "x)" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
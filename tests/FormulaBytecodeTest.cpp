@@ -0,0 +1,272 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/MachineLearning/GrammarEvolution/Formulas.h"
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaBytecode.h"
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaPool.h"
+
+#include "ModuleReader.h"
+
+#include <chrono>
+#include <iostream>
+
+using namespace pinhao;
+
+static std::shared_ptr<FeatureSet> getFeatureSet() {
+  std::string Benchmark("../../benchmark/polybench-ll/2mm/2mm.bc");
+  ModuleReader Reader(Benchmark);
+
+  FeatureSet::disableAll();
+  FeatureSet::enable("cfg_md_static");
+  std::shared_ptr<FeatureSet> Set = FeatureSet::get();
+  FeatureSetWrapperPass SetPass(&Set);
+  SetPass.runOnModule(*Reader.getModule());
+  return Set;
+}
+
+template <class T>
+static FormulaRef createLiteral(T Value) {
+  auto Lit = new LitFormula<T>();
+  Lit->setValue(Value);
+  return FormulaRef(Lit);
+}
+
+static std::vector<FormulaRef> generateFormulas(FeatureSet *Set, ValueType Type, uint64_t N) {
+  std::vector<FormulaRef> Formulas;
+  for (uint64_t I = 0; I < N; ++I) {
+    FormulaRef Form(generateFormula(Set, Type).release());
+    simplifyFormula(Form);
+    Formulas.push_back(Form);
+  }
+  return Formulas;
+}
+
+TEST(FormulaBytecodeTest, LiteralTest) {
+  auto Sum = new ArithBinOpFormula<int>();
+  Sum->setOperator(OperatorKind::MIN);
+  Sum->Lhs = createLiteral<int>(7);
+  Sum->Rhs = createLiteral<int>(2);
+
+  auto Product = new ArithBinOpFormula<int>();
+  Product->setOperator(OperatorKind::MUL);
+  Product->Lhs.reset(Sum);
+  Product->Rhs = createLiteral<int>(3);
+
+  auto Division = new ArithBinOpFormula<int>();
+  Division->setOperator(OperatorKind::DIV);
+  Division->Lhs = createLiteral<int>(3);
+  Division->Rhs = createLiteral<int>(0);
+
+  auto If = new IfFormula<int>();
+  If->Condition = createLiteral<bool>(false);
+  If->ThenBody.reset(Product);
+  If->ElseBody.reset(Division);
+  FormulaRef Root(If);
+
+  FeatureLayout Layout;
+  FormulaProgram Program(Layout);
+  Program.add(Product);
+  Program.add(Division);
+  Program.add(If);
+  ASSERT_TRUE(Program.isValid());
+
+  Program.run(std::vector<BytecodeValue>());
+  ASSERT_EQ(Program.getResult<int>(0), 15);
+  ASSERT_EQ(Program.getResult<int>(1), 0);
+  ASSERT_EQ(Program.getResult<int>(2), 0);
+  ASSERT_EQ(Program.getResult<double>(0), 15.0);
+}
+
+TEST(FormulaBytecodeTest, SharingTest) {
+  auto Sum = new ArithBinOpFormula<int>();
+  Sum->setOperator(OperatorKind::PLUS);
+  Sum->Lhs = createLiteral<int>(1);
+  Sum->Rhs = createLiteral<int>(2);
+  FormulaRef Shared(Sum);
+
+  auto Product = new ArithBinOpFormula<int>();
+  Product->setOperator(OperatorKind::MUL);
+  Product->Lhs = Shared;
+  Product->Rhs = Shared;
+  FormulaRef Root(Product);
+
+  FeatureLayout Layout;
+  FormulaProgram Program(Layout);
+  Program.add(Root.get());
+  Program.add(Shared.get());
+  ASSERT_EQ(Program.size(), 2u);
+
+  Program.run(std::vector<BytecodeValue>());
+  ASSERT_EQ(Program.getResult<int>(0), 9);
+  ASSERT_EQ(Program.getResult<int>(1), 3);
+}
+
+TEST(FormulaBytecodeTest, StringTest) {
+  auto Equal = new BoolBinOpFormula<std::string>();
+  Equal->Lhs = createLiteral<std::string>("a");
+  Equal->Rhs = createLiteral<std::string>("b");
+  FormulaRef Root(Equal);
+
+  FeatureLayout Layout;
+  FormulaProgram Program(Layout);
+  Program.add(Root.get());
+  ASSERT_FALSE(Program.isValid());
+}
+
+TEST(FormulaBytecodeTest, TypeMismatchTest) {
+  // The tree walker would read the float literal as an int.
+  auto Sum = new ArithBinOpFormula<int>();
+  Sum->setOperator(OperatorKind::PLUS);
+  Sum->Lhs = createLiteral<double>(1.5);
+  Sum->Rhs = createLiteral<int>(2);
+  FormulaRef Root(Sum);
+
+  FeatureLayout Layout;
+  FormulaProgram Program(Layout);
+  Program.add(Root.get());
+  ASSERT_FALSE(Program.isValid());
+
+  auto If = new IfFormula<int>();
+  If->Condition = createLiteral<int>(1);
+  If->ThenBody = createLiteral<int>(1);
+  If->ElseBody = createLiteral<int>(2);
+  FormulaRef IfRoot(If);
+
+  FormulaProgram IfProgram(Layout);
+  IfProgram.add(IfRoot.get());
+  ASSERT_FALSE(IfProgram.isValid());
+}
+
+TEST(FormulaBytecodeTest, LayoutTest) {
+  FeatureSet::disableAll();
+  FeatureSet::enable("cfg_md_static");
+  auto Pair = *FeatureSet::get()->begin();
+
+  FeatureLayout Layout;
+  Layout.getSlot(Pair, ValueType::Int);
+  auto Set = getFeatureSet();
+  uint64_t Id = Set->getId();
+  int Value = Set->getFeature<int>(Pair);
+  ASSERT_EQ(Layout.getValues(Set.get())[0].Int, Value);
+
+  // Another set, even at the same address, is looked up again.
+  Set.reset();
+  FeatureSet::disableAll();
+  FeatureSet::enable("cfg_md_static");
+  std::shared_ptr<FeatureSet> Empty = FeatureSet::get();
+  ASSERT_NE(Empty->getId(), Id);
+  ASSERT_EQ(Layout.getValues(Empty.get())[0].Int, Empty->getFeature<int>(Pair));
+}
+
+TEST(FormulaBytecodeTest, CacheTest) {
+  std::vector<FormulaRef> Formulas = { createLiteral<bool>(true), createLiteral<int>(4) };
+  FormulaProgramCache Programs;
+
+  // Formulas that may still change are not cached.
+  FormulaProgram *Uncached = &Programs.get(Formulas);
+  Uncached->run(std::vector<BytecodeValue>());
+  ASSERT_TRUE(Uncached->getResult<bool>(0));
+
+  for (auto &Form : Formulas)
+    FormulaPool::get().intern(Form);
+  FormulaProgram *Cached = &Programs.get(Formulas);
+  ASSERT_EQ(Cached, &Programs.get(Formulas));
+
+  Cached->run(std::vector<BytecodeValue>());
+  ASSERT_EQ(Cached->getResult<int>(1), 4);
+}
+
+TEST(FormulaBytecodeTest, RandomFormulasTest) {
+  auto Set = getFeatureSet();
+
+  for (auto Type : { ValueType::Bool, ValueType::Int }) {
+    auto Formulas = generateFormulas(Set.get(), Type, 1000);
+
+    FeatureLayout Layout;
+    FormulaProgram Program(Layout);
+    for (auto &Form : Formulas)
+      Program.add(Form.get());
+    ASSERT_TRUE(Program.isValid());
+    Program.run(Set.get());
+
+    for (uint64_t I = 0; I < Formulas.size(); ++I) {
+      Formulas[I]->solveFor(Set.get());
+      if (Type == ValueType::Bool)
+        ASSERT_EQ(Program.getResult<bool>(I), getFormulaValue<bool>(Formulas[I].get()));
+      else
+        ASSERT_EQ(Program.getResult<int>(I), getFormulaValue<int>(Formulas[I].get()));
+    }
+  }
+}
+
+TEST(FormulaBytecodeTest, BenchmarkTest) {
+  auto Set = getFeatureSet();
+  const uint64_t Candidates = 100, DecisionPoints = 64, Repetitions = 20;
+
+  std::vector<std::vector<FormulaRef>> Population;
+  // Keeps the evaluations from being optimized away.
+  uint64_t Enabled = 0;
+  for (uint64_t I = 0; I < Candidates; ++I)
+    Population.push_back(generateFormulas(Set.get(), ValueType::Bool, DecisionPoints));
+
+  auto Start = std::chrono::steady_clock::now();
+  for (uint64_t R = 0; R < Repetitions; ++R)
+    for (auto &Formulas : Population)
+      for (auto &Form : Formulas) {
+        Form->solveFor(Set.get());
+        Enabled += getFormulaValue<bool>(Form.get());
+      }
+  auto Tree = std::chrono::steady_clock::now() - Start;
+
+  // Compiled and evaluated each time, as when a candidate is evaluated once.
+  FeatureLayout Layout;
+  Start = std::chrono::steady_clock::now();
+  for (uint64_t R = 0; R < Repetitions; ++R)
+    for (auto &Formulas : Population) {
+      FormulaProgram Program(Layout);
+      for (auto &Form : Formulas)
+        Program.add(Form.get());
+      Program.run(Set.get());
+      for (uint64_t I = 0; I < Formulas.size(); ++I)
+        Enabled += Program.getResult<bool>(I);
+    }
+  auto Bytecode = std::chrono::steady_clock::now() - Start;
+
+  std::vector<FormulaProgram> Programs;
+  for (auto &Formulas : Population) {
+    Programs.push_back(FormulaProgram(Layout));
+    for (auto &Form : Formulas)
+      Programs.back().add(Form.get());
+  }
+
+  Start = std::chrono::steady_clock::now();
+  for (uint64_t R = 0; R < Repetitions; ++R)
+    for (auto &Program : Programs) {
+      Program.run(Set.get());
+      for (uint64_t I = 0; I < DecisionPoints; ++I)
+        Enabled += Program.getResult<bool>(I);
+    }
+  auto Compiled = std::chrono::steady_clock::now() - Start;
+
+  // Every decision of every candidate is the one of the tree walker.
+  for (uint64_t C = 0; C < Candidates; ++C) {
+    Programs[C].run(Set.get());
+    for (uint64_t I = 0; I < DecisionPoints; ++I) {
+      Population[C][I]->solveFor(Set.get());
+      ASSERT_EQ(Programs[C].getResult<bool>(I), getFormulaValue<bool>(Population[C][I].get()));
+    }
+  }
+
+  typedef std::chrono::duration<double, std::milli> Milliseconds;
+  double TreeTime = std::chrono::duration_cast<Milliseconds>(Tree).count();
+  double BytecodeTime = std::chrono::duration_cast<Milliseconds>(Bytecode).count();
+  double CompiledTime = std::chrono::duration_cast<Milliseconds>(Compiled).count();
+  std::cout << "Tree: " << TreeTime << "ms" << std::endl;
+  std::cout << "Compiled each time: " << BytecodeTime << "ms (" << TreeTime / BytecodeTime << "x)" << std::endl;
+  std::cout << "Precompiled: " << CompiledTime << "ms (" << TreeTime / CompiledTime << "x)" << std::endl;
+  std::cout << Enabled << " optimizations enabled." << std::endl;
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
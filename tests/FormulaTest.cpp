@@ -1,10 +1,18 @@
 #include "gtest/gtest.h"
 
 #include "pinhao/MachineLearning/GrammarEvolution/Formulas.h"
+#include "pinhao/MachineLearning/GrammarEvolution/FormulaPool.h"
+#include "pinhao/MachineLearning/GrammarEvolution/SimpleGrammarEvolution.h"
+#include "pinhao/Optimizer/Optimizations.h"
 #include "pinhao/Support/FormulaYAMLWrapper.h"
+#include "pinhao/Support/Random.h"
 
 #include <iostream>
 
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 using namespace pinhao;
 
 TEST(FormulaTest, CreateFormulas) {
@@ -184,6 +192,235 @@ TEST(FormulaTest, CloneTest) {
   ASSERT_TRUE(*BoolClone == *BoolFormula);
 }
 
+static FormulaRef createSum(int One, int Two) {
+  auto Lhs = new LitFormula<int>();
+  Lhs->setValue(One);
+  auto Rhs = new LitFormula<int>();
+  Rhs->setValue(Two);
+
+  auto Sum = new ArithBinOpFormula<int>();
+  Sum->setOperator(OperatorKind::PLUS);
+  Sum->Lhs.reset(Lhs);
+  Sum->Rhs.reset(Rhs);
+  return FormulaRef(Sum);
+}
+
+TEST(FormulaTest, PoolTest) {
+  auto &Pool = FormulaPool::get();
+  FormulaRef One = createSum(1, 2);
+  FormulaRef Two = createSum(1, 2);
+  FormulaRef Other = createSum(2, 1);
+
+  Pool.intern(One);
+  Pool.intern(Two);
+  Pool.intern(Other);
+
+  ASSERT_TRUE(One->isInterned());
+  ASSERT_EQ(One.get(), Two.get());
+  ASSERT_NE(One.get(), Other.get());
+
+  // The literals are shared between the different sums.
+  auto OneSum = static_cast<ArithBinOpFormula<int>*>(One.get());
+  auto OtherSum = static_cast<ArithBinOpFormula<int>*>(Other.get());
+  ASSERT_EQ(OneSum->Lhs.get(), OtherSum->Rhs.get());
+}
+
+TEST(FormulaTest, CopyOnWriteTest) {
+  FormulaRef Original = createSum(3, 4);
+  FormulaPool::get().intern(Original);
+  FormulaRef Evolved = Original;
+
+  makeFormulaUnique(Evolved);
+  ASSERT_NE(Evolved.get(), Original.get());
+  ASSERT_FALSE(Evolved->isInterned());
+
+  // Only the path to the formula that changes is copied.
+  auto EvolvedSum = static_cast<ArithBinOpFormula<int>*>(Evolved.get());
+  auto OriginalSum = static_cast<ArithBinOpFormula<int>*>(Original.get());
+  ASSERT_EQ(EvolvedSum->Rhs.get(), OriginalSum->Rhs.get());
+
+  makeFormulaUnique(EvolvedSum->Lhs);
+  static_cast<LitFormula<int>*>(EvolvedSum->Lhs.get())->setValue(5);
+  ASSERT_EQ(getFormulaValue<int>(OriginalSum->Lhs.get()), 3);
+  ASSERT_EQ(EvolvedSum->Rhs.get(), OriginalSum->Rhs.get());
+  ASSERT_FALSE(*Evolved == *Original);
+}
+
+TEST(FormulaTest, HashTest) {
+  FormulaRef One = createSum(8, 9);
+  FormulaRef Two = createSum(8, 9);
+  FormulaRef Other = createSum(9, 8);
+  ASSERT_EQ(One->getHash(), Two->getHash());
+  ASSERT_NE(One->getHash(), Other->getHash());
+
+  // The hash cached when interned is the structural one.
+  uint64_t Hash = One->getHash();
+  FormulaPool::get().intern(One);
+  ASSERT_EQ(One->getHash(), Hash);
+
+  FormulaRef Evolved = One;
+  makeFormulaUnique(Evolved);
+  auto EvolvedSum = static_cast<ArithBinOpFormula<int>*>(Evolved.get());
+  makeFormulaUnique(EvolvedSum->Lhs);
+  static_cast<LitFormula<int>*>(EvolvedSum->Lhs.get())->setValue(9);
+  EvolvedSum->setOperator(OperatorKind::MUL);
+  ASSERT_NE(Evolved->getHash(), Hash);
+  ASSERT_EQ(One->getHash(), Hash);
+
+  // It is the hash of the formula it became.
+  FormulaRef Product = createSum(9, 9);
+  static_cast<ArithBinOpFormula<int>*>(Product.get())->setOperator(OperatorKind::MUL);
+  FormulaPool::get().intern(Evolved);
+  ASSERT_EQ(Evolved->getHash(), Product->getHash());
+
+  // The hash of a formula that is not interned is cached until it, or one of its
+  // operands, changes.
+  FormulaRef Sum = createSum(1, 2);
+  uint64_t SumHash = Sum->getHash();
+  ASSERT_EQ(Sum->getHash(), SumHash);
+  auto SumLhs = static_cast<ArithBinOpFormula<int>*>(Sum.get())->Lhs;
+  static_cast<LitFormula<int>*>(SumLhs.get())->setValue(2);
+  ASSERT_NE(Sum->getHash(), SumHash);
+  ASSERT_EQ(Sum->getHash(), createSum(2, 2)->getHash());
+
+  // The operand marks the parent that hashed it, even when it is nested deeper.
+  auto Nested = new ArithBinOpFormula<int>();
+  Nested->setOperator(OperatorKind::MIN);
+  Nested->Lhs = Sum;
+  Nested->Rhs = createSum(5, 6);
+  FormulaRef Outer(Nested);
+  uint64_t OuterHash = Outer->getHash();
+  static_cast<LitFormula<int>*>(SumLhs.get())->setValue(1);
+  ASSERT_NE(Outer->getHash(), OuterHash);
+  ASSERT_EQ(Sum->getHash(), SumHash);
+}
+
+TEST(FormulaTest, OperatorTest) {
+  FormulaRef Plus = createSum(3, 4);
+  FormulaRef Times = createSum(3, 4);
+  static_cast<ArithBinOpFormula<int>*>(Times.get())->setOperator(OperatorKind::MUL);
+
+  ASSERT_FALSE(*Plus == *Times);
+  ASSERT_TRUE(*Plus < *Times || *Times < *Plus);
+  ASSERT_FALSE(*Plus < *Times && *Times < *Plus);
+
+  FormulaPool::get().intern(Plus);
+  FormulaPool::get().intern(Times);
+  ASSERT_NE(Plus.get(), Times.get());
+}
+
+TEST(FormulaTest, CandidateHashTest) {
+  DecisionPoint DP("licm", ValueType::Bool);
+  Candidate One, Two, Other;
+  One.insert(std::make_pair(DP, createSum(1, 2)));
+  Two.insert(std::make_pair(DP, createSum(1, 2)));
+  Other.insert(std::make_pair(DP, createSum(2, 1)));
+  ASSERT_EQ(One.getHash(), Two.getHash());
+  ASSERT_NE(One.getHash(), Other.getHash());
+
+  // The set finds the equal candidate by its hash.
+  SerialSet<Candidate> Set;
+  Set.insert(One);
+  ASSERT_TRUE(Set.has(Two));
+  ASSERT_FALSE(Set.has(Other));
+  Set.insert(Other);
+  Set.erase(Two);
+  ASSERT_FALSE(Set.has(One));
+  ASSERT_TRUE(Set.has(Other));
+  ASSERT_EQ(Set.size(), 1);
+}
+
+TEST(FormulaTest, ReleaseTest) {
+  uint64_t Live = FormulaBase::getNumberOfLive();
+  {
+    FormulaRef Sum = createSum(6, 7);
+    FormulaPool::get().intern(Sum);
+    ASSERT_EQ(FormulaBase::getNumberOfLive(), Live + 3);
+  }
+  ASSERT_EQ(FormulaBase::getNumberOfLive(), Live);
+}
+
+struct GenerationsUsage {
+  uint64_t Allocated;
+  uint64_t Live;
+  long PeakRSS;
+};
+
+/// @brief Evolves a population through @a Generations in a child process, so that its
+/// peak RSS is its own. With @a DeepCopy, each offspring gets its own copy of every
+/// formula, and all of them are kept alive, as before the formulas were shared.
+static GenerationsUsage runGenerations(int Generations, bool DeepCopy) {
+  int Fds[2];
+  GenerationsUsage Usage = { 0, 0, 0 };
+  if (pipe(Fds)) return Usage;
+
+  pid_t Pid = fork();
+  if (Pid == 0) {
+    close(Fds[0]);
+    FeatureSet::disableAll();
+    FeatureSet::enable("cfg_md_static");
+    auto Set = FeatureSet::get();
+    SimpleEvolution Evo(0.3, Set.get());
+
+    std::vector<DecisionPoint> DecisionPoints;
+    for (auto &Name : Optimizations)
+      DecisionPoints.push_back(DecisionPoint(Name, ValueType::Bool));
+
+    std::vector<Candidate> Population(20), Leaked;
+    for (auto &C : Population)
+      C.generateMissing(DecisionPoints, Set.get());
+
+    uint64_t Allocated = FormulaBase::getNumberOfAllocated();
+    for (int G = 0; G < Generations; ++G) {
+      for (auto &C : Population) {
+        Candidate Offspring = C;
+        if (DeepCopy) {
+          for (auto &Pair : Offspring)
+            Pair.second = FormulaRef(Pair.second->clone());
+          Leaked.push_back(Offspring);
+        }
+        Offspring.evolve(0.3, &Evo);
+        if (UniformRandom::getRandomReal() < 0.5) C = Offspring;
+      }
+    }
+
+    struct rusage Self;
+    getrusage(RUSAGE_SELF, &Self);
+    Usage.Allocated = FormulaBase::getNumberOfAllocated() - Allocated;
+    Usage.Live = FormulaBase::getNumberOfLive();
+    Usage.PeakRSS = Self.ru_maxrss;
+    bool Written = write(Fds[1], &Usage, sizeof(Usage)) == sizeof(Usage);
+    _exit(Written ? 0 : 1);
+  }
+
+  close(Fds[1]);
+  if (Pid > 0) {
+    if (read(Fds[0], &Usage, sizeof(Usage)) != sizeof(Usage)) Usage = { 0, 0, 0 };
+    waitpid(Pid, nullptr, 0);
+  }
+  close(Fds[0]);
+  return Usage;
+}
+
+TEST(FormulaTest, GenerationsTest) {
+  const int Generations = 1000;
+  GenerationsUsage Shared = runGenerations(Generations, false);
+  GenerationsUsage Deep = runGenerations(Generations, true);
+  ASSERT_GT(Shared.Allocated, 0u);
+  ASSERT_GT(Deep.Allocated, 0u);
+
+  std::cout << Generations << " generations. Shared: " << Shared.Allocated << " allocated, " << 
+    Shared.Live << " alive, peak RSS " << Shared.PeakRSS << "KB. Deep copies: " << 
+    Deep.Allocated << " allocated, " << Deep.Live << " alive, peak RSS " << Deep.PeakRSS << 
+    "KB." << std::endl;
+
+  // Only the paths that evolve are copied, and the formulas of the offspring that are
+  // dropped are freed.
+  ASSERT_LT(Shared.Allocated, Deep.Allocated);
+  ASSERT_LT(Shared.Live, Deep.Live);
+  ASSERT_LE(Shared.PeakRSS, Deep.PeakRSS);
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,118 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/Support/HelperPool.h"
+#include "pinhao/Support/IPC.h"
+
+#include <csignal>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace pinhao;
+
+static int Initialized = 0;
+static int Served = 0;
+
+static std::string count(const std::string &Request) {
+  ++Served;
+  return Request + ":" + std::to_string(Initialized) + ":" + std::to_string(Served);
+}
+
+TEST(HelperPoolTest, MessageTest) {
+  int Fds[2];
+  ASSERT_EQ(pipe(Fds), 0);
+  ASSERT_TRUE(writeMessage(Fds[1], "pinhao"));
+  ASSERT_TRUE(writeMessage(Fds[1], ""));
+  close(Fds[1]);
+
+  std::string Message;
+  ASSERT_TRUE(readMessage(Fds[0], Message));
+  ASSERT_EQ(Message, "pinhao");
+  ASSERT_TRUE(readMessage(Fds[0], Message));
+  ASSERT_EQ(Message, "");
+  ASSERT_FALSE(readMessage(Fds[0], Message));
+  close(Fds[0]);
+}
+
+TEST(HelperPoolTest, PersistentHelperTest) {
+  HelperPool Pool(1, count, [] () { ++Initialized; });
+  auto Results = Pool.map({ "a", "b", "c" });
+  ASSERT_EQ(Results.size(), 3u);
+  ASSERT_EQ(Results[0].Reply, "a:1:1");
+  ASSERT_EQ(Results[1].Reply, "b:1:2");
+  ASSERT_EQ(Results[2].Reply, "c:1:3");
+  ASSERT_EQ(Initialized, 0);
+  ASSERT_EQ(Served, 0);
+}
+
+TEST(HelperPoolTest, ParallelMapTest) {
+  HelperPool Pool(4, [] (const std::string &Request) { return Request + Request; });
+  std::vector<std::string> Requests;
+  for (int I = 0; I < 20; ++I)
+    Requests.push_back(std::to_string(I));
+
+  auto Results = Pool.map(Requests);
+  for (int I = 0; I < 20; ++I) {
+    ASSERT_TRUE(Results[I].Ok);
+    ASSERT_EQ(Results[I].Reply, Requests[I] + Requests[I]);
+  }
+}
+
+TEST(HelperPoolTest, CrashedHelperTest) {
+  HelperPool Pool(2, [] (const std::string &Request) {
+        if (Request == "crash") abort();
+        return Request;
+      });
+
+  auto Results = Pool.map({ "a", "crash", "b", "c" });
+  ASSERT_TRUE(Results[0].Ok);
+  ASSERT_FALSE(Results[1].Ok);
+  ASSERT_EQ(Results[2].Reply, "b");
+  ASSERT_EQ(Results[3].Reply, "c");
+  ASSERT_EQ(Pool.getNumberOfRestarts(), 1u);
+
+  Results = Pool.map({ "d", "e" });
+  ASSERT_EQ(Results[0].Reply, "d");
+  ASSERT_EQ(Results[1].Reply, "e");
+}
+
+TEST(HelperPoolTest, HungHelperTest) {
+  HelperPool Pool(2, [] (const std::string &Request) {
+        if (Request == "hang") pause();
+        return Request;
+      }, nullptr, 0.5);
+
+  auto Results = Pool.map({ "a", "hang", "b" });
+  ASSERT_TRUE(Results[0].Ok);
+  ASSERT_FALSE(Results[1].Ok);
+  ASSERT_EQ(Results[2].Reply, "b");
+  ASSERT_EQ(Pool.getNumberOfRestarts(), 1u);
+
+  Results = Pool.map({ "c", "d" });
+  ASSERT_EQ(Results[0].Reply, "c");
+  ASSERT_EQ(Results[1].Reply, "d");
+}
+
+TEST(HelperPoolTest, BrokenPipeTest) {
+  HelperPool Pool(1, [] (const std::string &Request) { return Request; });
+
+  // The pool leaves the disposition of SIGPIPE alone.
+  struct sigaction Action;
+  ASSERT_EQ(sigaction(SIGPIPE, nullptr, &Action), 0);
+  ASSERT_EQ(Action.sa_handler, SIG_DFL);
+
+  // Yet writing to a pipe without reader fails instead of killing us.
+  int Fds[2];
+  ASSERT_EQ(pipe(Fds), 0);
+  close(Fds[0]);
+  ASSERT_FALSE(writeMessage(Fds[1], "pinhao"));
+  close(Fds[1]);
+
+  sigset_t Pending;
+  sigpending(&Pending);
+  ASSERT_FALSE(sigismember(&Pending, SIGPIPE));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
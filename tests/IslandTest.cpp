@@ -0,0 +1,141 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/Support/Island.h"
+#include "pinhao/Support/IPC.h"
+#include "pinhao/Support/Socket.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+
+using namespace pinhao;
+
+static std::vector<std::string> getAddresses(unsigned N) {
+  std::vector<std::string> Addresses;
+  for (unsigned I = 0; I < N; ++I)
+    Addresses.push_back("unix:/tmp/pinhao-island-" + std::to_string(getpid()) + "-" + std::to_string(I));
+  return Addresses;
+}
+
+/// @brief Runs a migration in every island that is not skipped, at the same time.
+static std::vector<std::vector<std::string>> migrateAll(std::vector<std::unique_ptr<Island>> &Islands,
+    unsigned Skip = -1) {
+  std::vector<std::vector<std::string>> Received(Islands.size());
+  std::vector<std::thread> Threads;
+  for (unsigned I = 0; I < Islands.size(); ++I)
+    if (I != Skip)
+      Threads.push_back(std::thread([&Islands, &Received, I] () {
+            Received[I] = Islands[I]->migrate("island" + std::to_string(I));
+          }));
+
+  for (auto &T : Threads)
+    T.join();
+  return Received;
+}
+
+TEST(IslandTest, SocketTest) {
+  std::string Address = getAddresses(1)[0];
+  int Listener = listenOn(Address);
+  ASSERT_GE(Listener, 0);
+
+  int Client = connectTo(Address, 1);
+  ASSERT_GE(Client, 0);
+  int Server = acceptConnection(Listener, 1);
+  ASSERT_GE(Server, 0);
+
+  std::string Message;
+  ASSERT_TRUE(writeMessage(Client, "pinhao"));
+  ASSERT_TRUE(readMessage(Server, Message));
+  ASSERT_EQ(Message, "pinhao");
+
+  closeSocket(Client);
+  closeSocket(Server);
+  closeSocket(Listener, Address);
+
+  Listener = listenOn(Address);
+  ASSERT_EQ(acceptConnection(Listener, 0.1), -1);
+  closeSocket(Listener, Address);
+}
+
+TEST(IslandTest, RingTest) {
+  auto Addresses = getAddresses(3);
+  std::vector<std::unique_ptr<Island>> Islands;
+  for (unsigned I = 0; I < 3; ++I)
+    Islands.emplace_back(new Island(I, Addresses, Island::Topology::Ring, 5));
+
+  ASSERT_EQ(Islands[0]->getDestinations(), std::vector<unsigned>({ 1 }));
+  ASSERT_EQ(Islands[0]->getSources(), std::vector<unsigned>({ 2 }));
+
+  for (unsigned Round = 0; Round < 2; ++Round) {
+    auto Received = migrateAll(Islands);
+    ASSERT_EQ(Received[0], std::vector<std::string>({ "island2" }));
+    ASSERT_EQ(Received[1], std::vector<std::string>({ "island0" }));
+    ASSERT_EQ(Received[2], std::vector<std::string>({ "island1" }));
+  }
+}
+
+TEST(IslandTest, CompleteTest) {
+  auto Addresses = getAddresses(3);
+  std::vector<std::unique_ptr<Island>> Islands;
+  for (unsigned I = 0; I < 3; ++I)
+    Islands.emplace_back(new Island(I, Addresses, Island::Topology::Complete, 5));
+
+  auto Received = migrateAll(Islands);
+  std::sort(Received[1].begin(), Received[1].end());
+  ASSERT_EQ(Received[1], std::vector<std::string>({ "island0", "island2" }));
+  ASSERT_EQ(Received[0].size(), 2u);
+  ASSERT_EQ(Received[2].size(), 2u);
+}
+
+TEST(IslandTest, AbsentIslandTest) {
+  auto Addresses = getAddresses(3);
+  std::vector<std::unique_ptr<Island>> Islands;
+  for (unsigned I = 0; I < 3; ++I)
+    Islands.emplace_back(new Island(I, Addresses, Island::Topology::Complete, 0.5));
+
+  // Island 1 does not migrate, so the others only hear from each other.
+  auto Received = migrateAll(Islands, 1);
+  ASSERT_EQ(Received[0], std::vector<std::string>({ "island2" }));
+  ASSERT_EQ(Received[2], std::vector<std::string>({ "island0" }));
+}
+
+TEST(IslandTest, StrayPeerTest) {
+  auto Addresses = getAddresses(2);
+  std::vector<std::unique_ptr<Island>> Islands;
+  for (unsigned I = 0; I < 2; ++I)
+    Islands.emplace_back(new Island(I, Addresses, Island::Topology::Ring, 1));
+
+  // One peer announces a message far beyond the limit, the other never finishes its own.
+  uint64_t Round = 1, Huge = UINT64_MAX;
+  int Liar = connectTo(Addresses[0], 1), Staller = connectTo(Addresses[0], 1);
+  ASSERT_GE(Liar, 0);
+  ASSERT_GE(Staller, 0);
+  ASSERT_TRUE(writeAll(Liar, &Round, sizeof(uint64_t)) && writeAll(Liar, &Huge, sizeof(uint64_t)));
+  ASSERT_TRUE(writeAll(Staller, &Round, sizeof(uint64_t)));
+
+  auto Start = std::chrono::steady_clock::now();
+  auto Received = Islands[0]->migrate("island0");
+  ASSERT_LT(std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count(), 3);
+  ASSERT_TRUE(Received.empty());
+
+  closeSocket(Liar);
+  closeSocket(Staller);
+}
+
+TEST(IslandTest, MessageLimitTest) {
+  int Fds[2];
+  ASSERT_EQ(pipe(Fds), 0);
+  ASSERT_TRUE(writeMessage(Fds[1], "pinhao"));
+  close(Fds[1]);
+
+  std::string Message;
+  ASSERT_FALSE(readMessage(Fds[0], Message, 3));
+  close(Fds[0]);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,349 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/MachineLearning/GrammarEvolution/KnowledgeBaseJournal.h"
+#include "pinhao/MachineLearning/GrammarEvolution/BinaryKnowledgeBase.h"
+#include "pinhao/MachineLearning/GrammarEvolution/GrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/Formulas.h"
+#include "pinhao/Support/YAMLWrapper.h"
+
+#include <csignal>
+#include <fstream>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace pinhao;
+
+static std::vector<Candidate> generateCandidates(uint64_t Size) {
+  FeatureSet::disableAll();
+  FeatureSet::enable("cfg_md_static");
+  auto Set = FeatureSet::get();
+
+  std::vector<DecisionPoint> DecisionPoints;
+  for (auto &Name : Optimizations)
+    DecisionPoints.push_back(DecisionPoint(Name, ValueType::Bool));
+
+  SerialSet<Candidate> Candidates;
+  while (Candidates.size() < Size) {
+    Candidate C;
+    C.generateMissing(DecisionPoints, Set.get());
+    C.Score = UniformRandom::getRandomReal();
+    C.Count = Candidates.size() + 1;
+    C.Objectives = { C.Score, 1 };
+    Candidates.insert(C);
+  }
+  return std::vector<Candidate>(Candidates.begin(), Candidates.end());
+}
+
+static uint64_t getFileSize(std::string Filename) {
+  struct stat Stat;
+  return stat(Filename.c_str(), &Stat) ? 0 : Stat.st_size;
+}
+
+static SerialSet<Candidate> readKnowledgeBase(std::string Filename) {
+  SerialSet<Candidate> KnowledgeBase;
+  if (BinaryKnowledgeBase::isBinary(Filename)) {
+    BinaryKnowledgeBase Stored;
+    EXPECT_TRUE(Stored.open(Filename));
+    for (uint64_t I = 0; I < Stored.size(); ++I) {
+      Candidate C;
+      if (Stored.get(I, C)) KnowledgeBase.insert(C);
+    }
+  } else {
+    auto Node = YAMLWrapper::loadFile(Filename);
+    YAMLWrapper::fill(KnowledgeBase, Node);
+  }
+  return KnowledgeBase;
+}
+
+static void expectSame(const Candidate &Expected, const SerialSet<Candidate> &KnowledgeBase) {
+  auto It = KnowledgeBase.find(Expected);
+  ASSERT_NE(It, KnowledgeBase.end());
+  ASSERT_EQ(It->Score, Expected.Score);
+  ASSERT_EQ(It->Count, Expected.Count);
+  ASSERT_EQ(It->Objectives, Expected.Objectives);
+}
+
+TEST(KnowledgeBaseJournalTest, ReplayTest) {
+  unlink("replay.journal");
+  auto Candidates = generateCandidates(10);
+  {
+    KnowledgeBaseJournal Journal("replay.journal", 4);
+    ASSERT_EQ(Journal.open([](const Candidate&) {}), 0);
+    for (auto &C : Candidates)
+      ASSERT_TRUE(Journal.append(C));
+    // The first one is updated again: the last record wins.
+    Candidates[0].Score = 3;
+    Candidates[0].Count = 7;
+    ASSERT_TRUE(Journal.append(Candidates[0]));
+    ASSERT_EQ(Journal.size(), Candidates.size() + 1);
+  }
+
+  SerialSet<Candidate> KnowledgeBase;
+  KnowledgeBaseJournal Journal("replay.journal");
+  ASSERT_EQ(Journal.open([&](const Candidate &C) { KnowledgeBase.update(C); }),
+      Candidates.size() + 1);
+  ASSERT_EQ(KnowledgeBase.size(), Candidates.size());
+  for (auto &C : Candidates)
+    expectSame(C, KnowledgeBase);
+}
+
+TEST(KnowledgeBaseJournalTest, TornTest) {
+  unlink("torn.journal");
+  auto Candidates = generateCandidates(5);
+  {
+    KnowledgeBaseJournal Journal("torn.journal");
+    Journal.open([](const Candidate&) {});
+    for (auto &C : Candidates)
+      Journal.append(C);
+  }
+
+  // The crash tore the last record.
+  uint64_t Size = getFileSize("torn.journal");
+  ASSERT_EQ(truncate("torn.journal", Size - 3), 0);
+
+  SerialSet<Candidate> KnowledgeBase;
+  {
+    KnowledgeBaseJournal Journal("torn.journal");
+    ASSERT_EQ(Journal.open([&](const Candidate &C) { KnowledgeBase.update(C); }),
+        Candidates.size() - 1);
+    ASSERT_FALSE(KnowledgeBase.has(Candidates.back()));
+
+    // The torn bytes are dropped, so the records appended after them are replayed.
+    Journal.append(Candidates.back());
+  }
+
+  KnowledgeBase.clear();
+  KnowledgeBaseJournal Journal("torn.journal");
+  ASSERT_EQ(Journal.open([&](const Candidate &C) { KnowledgeBase.update(C); }),
+      Candidates.size());
+  for (auto &C : Candidates)
+    expectSame(C, KnowledgeBase);
+}
+
+TEST(KnowledgeBaseJournalTest, CompactTest) {
+  unlink("compact.journal");
+  unlink("compact.kb");
+  auto Candidates = generateCandidates(8);
+
+  SerialSet<Candidate> KnowledgeBase;
+  {
+    KnowledgeBaseJournal Journal("compact.journal");
+    Journal.open([](const Candidate&) {});
+    for (uint64_t I = 0; I < 4; ++I) {
+      KnowledgeBase.update(Candidates[I]);
+      Journal.append(Candidates[I]);
+    }
+
+    ASSERT_TRUE(Journal.compact([&]() {
+      return BinaryKnowledgeBase::write("compact.kb", KnowledgeBase.getSet());
+    }));
+    ASSERT_EQ(Journal.size(), 0);
+
+    // The run goes on while the snapshot is written.
+    for (uint64_t I = 4; I < Candidates.size(); ++I) {
+      KnowledgeBase.update(Candidates[I]);
+      Journal.append(Candidates[I]);
+    }
+    Journal.wait();
+  }
+
+  ASSERT_NE(access("compact.journal.old", F_OK), 0);
+  BinaryKnowledgeBase Stored;
+  ASSERT_TRUE(Stored.open("compact.kb"));
+  ASSERT_EQ(Stored.size(), 4);
+
+  // The snapshot and the new records are the whole knowledge base.
+  SerialSet<Candidate> Recovered;
+  for (uint64_t I = 0; I < Stored.size(); ++I) {
+    Candidate C;
+    ASSERT_TRUE(Stored.get(I, C));
+    Recovered.insert(C);
+  }
+  KnowledgeBaseJournal Replay("compact.journal");
+  ASSERT_EQ(Replay.open([&](const Candidate &C) { Recovered.update(C); }), 4);
+  ASSERT_EQ(Recovered.size(), Candidates.size());
+  for (auto &C : Candidates)
+    expectSame(C, Recovered);
+
+  Replay.clear();
+  ASSERT_EQ(getFileSize("compact.journal"), 0);
+}
+
+TEST(KnowledgeBaseJournalTest, FailedCompactTest) {
+  unlink("failed.journal");
+  unlink("failed.journal.old");
+  auto Candidates = generateCandidates(6);
+
+  {
+    KnowledgeBaseJournal Journal("failed.journal");
+    Journal.open([](const Candidate&) {});
+    for (uint64_t I = 0; I < 3; ++I)
+      Journal.append(Candidates[I]);
+    ASSERT_TRUE(Journal.compact([]() { return false; }));
+    Journal.wait();
+    ASSERT_EQ(access("failed.journal.old", F_OK), 0);
+
+    // The records of the failed compaction are kept until a snapshot has them.
+    for (uint64_t I = 3; I < Candidates.size(); ++I)
+      Journal.append(Candidates[I]);
+    ASSERT_TRUE(Journal.compact([]() { return false; }));
+    Journal.wait();
+
+    SerialSet<Candidate> Compacting;
+    ASSERT_EQ(Journal.replayCompacting([&](const Candidate &C) { Compacting.update(C); }),
+        Candidates.size());
+  }
+
+  SerialSet<Candidate> KnowledgeBase;
+  KnowledgeBaseJournal Replay("failed.journal");
+  ASSERT_EQ(Replay.open([&](const Candidate &C) { KnowledgeBase.update(C); }),
+      Candidates.size());
+  for (auto &C : Candidates)
+    expectSame(C, KnowledgeBase);
+}
+
+TEST(KnowledgeBaseJournalTest, TornCompactingTest) {
+  unlink("torn-old.journal");
+  unlink("torn-old.journal.old");
+  auto Candidates = generateCandidates(6);
+
+  {
+    KnowledgeBaseJournal Journal("torn-old.journal");
+    Journal.open([](const Candidate&) {});
+    for (uint64_t I = 0; I < 3; ++I)
+      Journal.append(Candidates[I]);
+    ASSERT_TRUE(Journal.compact([]() { return false; }));
+    Journal.wait();
+  }
+
+  // The crash tore the last record of the compacting journal.
+  uint64_t Size = getFileSize("torn-old.journal.old");
+  ASSERT_EQ(truncate("torn-old.journal.old", Size - 3), 0);
+
+  {
+    KnowledgeBaseJournal Journal("torn-old.journal");
+    ASSERT_EQ(Journal.open([](const Candidate&) {}), 2);
+    ASSERT_LT(getFileSize("torn-old.journal.old"), Size - 3);
+
+    // The records rotated after the dropped bytes are replayed.
+    for (uint64_t I = 2; I < Candidates.size(); ++I)
+      Journal.append(Candidates[I]);
+    ASSERT_TRUE(Journal.compact([]() { return false; }));
+    Journal.wait();
+  }
+
+  SerialSet<Candidate> KnowledgeBase;
+  KnowledgeBaseJournal Replay("torn-old.journal");
+  ASSERT_EQ(Replay.open([&](const Candidate &C) { KnowledgeBase.update(C); }),
+      Candidates.size());
+  for (auto &C : Candidates)
+    expectSame(C, KnowledgeBase);
+}
+
+TEST(KnowledgeBaseJournalTest, LockTest) {
+  unlink("locked.journal.a");
+  unlink("locked.journal.b");
+  auto Candidates = generateCandidates(3);
+
+  KnowledgeBaseJournal Running("locked.journal.a");
+  Running.open([](const Candidate&) {});
+  ASSERT_TRUE(Running.isOpen());
+  Running.append(Candidates[0]);
+
+  // The journal of a run that crashed.
+  {
+    KnowledgeBaseJournal Crashed("locked.journal.b");
+    Crashed.open([](const Candidate&) {});
+    Crashed.append(Candidates[1]);
+    Crashed.append(Candidates[2]);
+  }
+
+  auto Journals = KnowledgeBaseJournal::list("locked.journal.");
+  ASSERT_EQ(Journals, std::vector<std::string>({ "locked.journal.a", "locked.journal.b" }));
+
+  uint64_t Replayed = 0;
+  auto Count = [&](const Candidate&) { ++Replayed; };
+  KnowledgeBaseJournal Other("locked.journal.a");
+  ASSERT_EQ(Other.open(Count), 0);
+  ASSERT_FALSE(Other.isOpen());
+  ASSERT_FALSE(Other.append(Candidates[0]));
+
+  KnowledgeBaseJournal Orphan("locked.journal.b");
+  ASSERT_EQ(Orphan.open(Count), 2);
+  ASSERT_TRUE(Orphan.isOpen());
+  Orphan.remove();
+  ASSERT_EQ(access("locked.journal.b.lock", F_OK), 0);
+  ASSERT_EQ(KnowledgeBaseJournal::list("locked.journal."), std::vector<std::string>({ "locked.journal.a" }));
+}
+
+TEST(KnowledgeBaseJournalTest, KilledMergeTest) {
+  auto Candidates = generateCandidates(6);
+  std::set<Candidate> Evaluations(Candidates.begin(), Candidates.end());
+
+  for (std::string Filename : { "killed.kb", "killed.yaml" }) {
+    std::string Name = Filename + ".journal.crashed";
+    unlink(Filename.c_str());
+    unlink(Name.c_str());
+    unlink((Name + ".old").c_str());
+
+    // The run is killed once its journal is merged, before it is removed.
+    pid_t Pid = fork();
+    ASSERT_GE(Pid, 0);
+    if (Pid == 0) {
+      KnowledgeBaseJournal Journal(Name);
+      Journal.open([](const Candidate&) {});
+      for (auto &C : Candidates)
+        Journal.append(C);
+      mergeKnowledgeBase(Filename, std::set<Candidate>(), Evaluations,
+          JournalMarks({ { Name, Journal.getLastMark() } }));
+      raise(SIGKILL);
+    }
+    int Status;
+    ASSERT_EQ(waitpid(Pid, &Status, 0), Pid);
+    ASSERT_TRUE(WIFSIGNALED(Status));
+
+    // Its records are not merged again when it is recovered.
+    JournalMarks Merged;
+    ASSERT_TRUE(readJournalMarks(Filename, Merged));
+    KnowledgeBaseJournal Orphan(Name);
+    ASSERT_EQ(Orphan.open([](const Candidate&) {}, Merged[Name]), 0);
+    ASSERT_TRUE(Orphan.isOpen());
+
+    // The compaction is killed once the ".old" journal is merged, before it is removed.
+    Orphan.append(Candidates[0]);
+    ASSERT_TRUE(Orphan.compact([&]() {
+      JournalMarks Stored, Compacted;
+      SerialSet<Candidate> Compacting;
+      readJournalMarks(Filename, Stored);
+      Orphan.replayCompacting([&](const Candidate &C) { Compacting.insert(C); }, Stored[Name],
+          &Compacted[Name]);
+      mergeKnowledgeBase(Filename, std::set<Candidate>(), Compacting.getSet(), Compacted);
+      raise(SIGKILL);
+      return true;
+    }));
+    Orphan.wait();
+    ASSERT_EQ(access((Name + ".old").c_str(), F_OK), 0);
+
+    ASSERT_TRUE(readJournalMarks(Filename, Merged));
+    ASSERT_EQ(Orphan.replayCompacting([](const Candidate&) {}, Merged[Name]), 0);
+
+    auto KnowledgeBase = readKnowledgeBase(Filename);
+    ASSERT_EQ(KnowledgeBase.size(), Candidates.size());
+    ASSERT_EQ(KnowledgeBase.find(Candidates[0])->Count, 2 * Candidates[0].Count);
+    for (uint64_t I = 1; I < Candidates.size(); ++I)
+      expectSame(Candidates[I], KnowledgeBase);
+
+    // The marks of the journals removed are dropped.
+    Orphan.remove();
+    ASSERT_TRUE(mergeKnowledgeBase(Filename, std::set<Candidate>(), std::set<Candidate>()));
+    ASSERT_TRUE(readJournalMarks(Filename, Merged));
+    ASSERT_TRUE(Merged.empty());
+  }
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,144 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/PerformanceAnalyser/MeasurementDatabase.h"
+#include "pinhao/Support/Hash.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+using namespace pinhao;
+
+static MeasurementDatabase::Key getKey(std::string Sequence) {
+  return { 42, Sequence, { "prog", "arg" }, "papi-cycles", "host" };
+}
+
+TEST(MeasurementDatabaseTest, HashTest) {
+  ASSERT_EQ(hashString(""), FNVOffsetBasis);
+  ASSERT_EQ(hashString("a"), 0xaf63dc4c8601ec8cULL);
+  ASSERT_EQ(toHexString(0xaf63dc4c8601ec8cULL), "af63dc4c8601ec8c");
+  ASSERT_NE(getKey("- opt: adce").getHash(), getKey("- opt: dce").getHash());
+
+  auto K = getKey("- opt: adce");
+  K.Argv = { "progarg" };
+  ASSERT_NE(K.getHash(), getKey("- opt: adce").getHash());
+}
+
+TEST(MeasurementDatabaseTest, PersistenceTest) {
+  std::string Filename = ".measurement-db-test.yaml";
+  remove(Filename.c_str());
+
+  {
+    MeasurementDatabase Database(Filename);
+    ASSERT_FALSE(Database.has(getKey("- opt: adce")));
+    Database.addSamples(getKey("- opt: adce"), { 100, 110 });
+    Database.addSamples(getKey("- opt: dce"), { 200 });
+    Database.addSamples(getKey("- opt: adce"), { 105 });
+  }
+
+  MeasurementDatabase Database(Filename);
+  ASSERT_EQ(Database.size(), 2u);
+  ASSERT_EQ(Database.getSamples(getKey("- opt: adce")), std::vector<double>({ 100, 110, 105 }));
+  ASSERT_EQ(Database.getSamples(getKey("- opt: dce")), std::vector<double>({ 200 }));
+  ASSERT_TRUE(Database.getSamples(getKey("- opt: gvn")).empty());
+
+  remove(Filename.c_str());
+}
+
+TEST(MeasurementDatabaseTest, CollisionTest) {
+  std::string Filename = ".measurement-db-collision-test.yaml";
+  std::string Hash = toHexString(getKey("- opt: adce").getHash());
+
+  // Two keys with the same hash, and one record of an older version, without its key.
+  {
+    std::ofstream Of(Filename);
+    Of << "---\nkey: " << Hash << "\nmodule: 2a\nsequence: '- opt: adce'\nargv: [prog, arg]\n"
+       << "backend: papi-cycles\nhost: host\nsamples: [100]\n";
+    Of << "---\nkey: " << Hash << "\nmodule: 2a\nsequence: '- opt: dce'\nargv: [prog, arg]\n"
+       << "backend: papi-cycles\nhost: host\nsamples: [200]\n";
+    Of << "---\nkey: " << Hash << "\nsamples: [300]\n";
+  }
+
+  MeasurementDatabase Database(Filename);
+  ASSERT_EQ(Database.size(), 2u);
+  ASSERT_EQ(Database.getSamples(getKey("- opt: adce")), std::vector<double>({ 100 }));
+  ASSERT_EQ(Database.getSamples(getKey("- opt: dce")), std::vector<double>({ 200 }));
+
+  auto K = getKey("- opt: adce");
+  K.Argv = { "prog" };
+  ASSERT_FALSE(Database.has(K));
+
+  remove(Filename.c_str());
+}
+
+TEST(MeasurementDatabaseTest, TornTest) {
+  std::string Filename = ".measurement-db-torn-test.yaml";
+  remove(Filename.c_str());
+
+  {
+    MeasurementDatabase Database(Filename);
+    Database.addSamples(getKey("- opt: adce"), { 100 });
+  }
+
+  // A record whose samples are malformed, and an append that was interrupted.
+  {
+    std::ofstream Of(Filename, std::ios::app);
+    Of << "---\nkey: 0\nmodule: 2a\nsequence: '- opt: gvn'\nargv: [prog, arg]\n"
+       << "backend: papi-cycles\nhost: host\nsamples: [fast]\n";
+    Of << "---\nkey: 0\nmodule: 2a\nsequence: '- opt: dce'\nargv: [prog,";
+  }
+
+  {
+    MeasurementDatabase Database(Filename);
+    ASSERT_EQ(Database.size(), 1u);
+    ASSERT_EQ(Database.getSamples(getKey("- opt: adce")), std::vector<double>({ 100 }));
+    Database.addSamples(getKey("- opt: dce"), { 200 });
+  }
+
+  // The torn record was dropped, so the next append is read back.
+  MeasurementDatabase Database(Filename);
+  ASSERT_EQ(Database.size(), 2u);
+  ASSERT_EQ(Database.getSamples(getKey("- opt: dce")), std::vector<double>({ 200 }));
+  ASSERT_FALSE(Database.has(getKey("- opt: gvn")));
+
+  remove(Filename.c_str());
+}
+
+TEST(MeasurementDatabaseTest, BudgetTest) {
+  std::string Filename = ".measurement-db-budget-test.yaml";
+  remove(Filename.c_str());
+  MeasurementDatabase::Budget Small(1000), Large(2000), Timed(1000, 5);
+
+  {
+    MeasurementDatabase Database(Filename);
+    Database.addSamples(getKey("- opt: adce"), { std::numeric_limits<double>::infinity() }, Small);
+    Database.addSamples(getKey("- opt: dce"), { 100 }, Small);
+    Database.addSamples(getKey("- opt: gvn"), { std::numeric_limits<double>::infinity() });
+  }
+
+  MeasurementDatabase Database(Filename);
+  auto Samples = Database.getSamples(getKey("- opt: adce"), Small);
+  ASSERT_EQ(Samples.size(), 1u);
+  ASSERT_TRUE(std::isinf(Samples.front()));
+  ASSERT_EQ(Database.getSamples(getKey("- opt: adce"), Timed).size(), 1u);
+  ASSERT_EQ(Database.getSamples(getKey("- opt: adce"), MeasurementDatabase::Budget(500)).size(), 1u);
+
+  // Exceeding a smaller budget does not tell anything about a larger one.
+  ASSERT_TRUE(Database.getSamples(getKey("- opt: adce"), Large).empty());
+  ASSERT_TRUE(Database.getSamples(getKey("- opt: adce")).empty());
+  ASSERT_TRUE(Database.getSamples(getKey("- opt: adce"), MeasurementDatabase::Budget(0, 5)).empty());
+
+  // The samples that did not exceed it are kept under any budget.
+  ASSERT_EQ(Database.getSamples(getKey("- opt: dce"), Large), std::vector<double>({ 100 }));
+
+  // Without a budget, nothing could have exceeded it.
+  ASSERT_TRUE(Database.getSamples(getKey("- opt: gvn"), Small).empty());
+
+  remove(Filename.c_str());
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,170 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/MachineLearning/GrammarEvolution/MultiObjectiveGrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/GrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/Formulas.h"
+#include "pinhao/MachineLearning/GrammarEvolution/BinaryKnowledgeBase.h"
+#include "pinhao/Optimizer/Phenotype.h"
+#include "pinhao/Support/YamlOptions.h"
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include <algorithm>
+#include <set>
+
+using namespace pinhao;
+
+/// @brief Measures every sequence with the same fake size, compile time and cost (with
+/// an unknown fingerprint), failing if @a Fail is set.
+class TestMultiObjective : public MultiObjectiveGrammarEvolution {
+  protected:
+    std::vector<double> compileAndMeasureAll(OptimizationSequence&) override {
+      if (Fail) return std::vector<double>();
+      std::vector<double> Values = { 100, 1, 50, 50, 50 };
+      appendFingerprint(Values, 0);
+      return Values;
+    }
+
+  public:
+    bool Fail;
+
+    TestMultiObjective(std::shared_ptr<llvm::Module> Module,
+        std::string KBFilename = "multi-objective-test.yaml") :
+      MultiObjectiveGrammarEvolution(Module, KBFilename), Fail(false) {
+      BaseLine = 100;
+    }
+
+    using MultiObjectiveGrammarEvolution::evaluateObjectives;
+    using MultiObjectiveGrammarEvolution::addObjectives;
+    using MultiObjectiveGrammarEvolution::addEvaluation;
+    using MultiObjectiveGrammarEvolution::importKnowledgeBase;
+    using MultiObjectiveGrammarEvolution::getParetoRanking;
+
+    uint64_t getLoadedEntries() {
+      return std::count(LoadedEntries.begin(), LoadedEntries.end(), true);
+    }
+
+    uint64_t getEvaluations(Candidate &C, FeatureSet *Set) {
+      auto *Entry = Cache.peek(Phenotype(getOptimizationSequence(C, Set)));
+      return Entry ? Entry->Evaluations : 0;
+    }
+
+    const Candidate &getEntry(const Candidate &C) {
+      return *KnowledgeBase.find(C);
+    }
+};
+
+static std::vector<Candidate> generateCandidates(uint64_t Size, FeatureSet *Set) {
+  std::vector<DecisionPoint> DecisionPoints;
+  for (auto &Name : Optimizations)
+    DecisionPoints.push_back(DecisionPoint(Name, ValueType::Bool));
+
+  SerialSet<Candidate> Candidates;
+  while (Candidates.size() < Size) {
+    Candidate C;
+    C.generateMissing(DecisionPoints, Set);
+    Candidates.insert(C);
+  }
+  return std::vector<Candidate>(Candidates.begin(), Candidates.end());
+}
+
+static std::shared_ptr<llvm::Module> getModule() {
+  static llvm::LLVMContext Context;
+  return std::make_shared<llvm::Module>("multi-objective-test", Context);
+}
+
+static std::shared_ptr<FeatureSet> getFeatureSet() {
+  FeatureSet::disableAll();
+  FeatureSet::enable("cfg_md_static");
+  return FeatureSet::get();
+}
+
+TEST(MultiObjectiveGrammarEvolutionTest, EliteTest) {
+  TestMultiObjective Engine(getModule());
+  auto Set = getFeatureSet();
+  auto Candidates = generateCandidates(1, Set.get());
+  Candidate Other = Candidates[0];
+  // A candidate without decisions, whose phenotype is always the empty one.
+  Candidates.insert(Candidates.begin(), Candidate());
+
+  Engine.evaluateObjectives(Candidates, Set.get());
+  uint64_t Before = Engine.getEvaluations(Other, Set.get());
+  ASSERT_GE(Before, 1u);
+
+  // The phenotypes evaluated before are not measured again...
+  Engine.evaluateObjectives(Candidates, Set.get());
+  ASSERT_EQ(Engine.getEvaluations(Other, Set.get()), Before);
+
+  // ...except for the elite, until it was measured as many times as elite-evaluations.
+  for (int I = 0; I < 4; ++I) {
+    auto AllObjectives = Engine.evaluateObjectives(Candidates, Set.get(), true);
+    ASSERT_EQ(AllObjectives.back().size(), 3u);
+    ASSERT_DOUBLE_EQ(AllObjectives.back()[0], 0.5);
+  }
+  ASSERT_EQ(Engine.getEvaluations(Other, Set.get()), std::max<uint64_t>(Before, 3));
+}
+
+TEST(MultiObjectiveGrammarEvolutionTest, FailureTest) {
+  TestMultiObjective Engine(getModule());
+  auto Set = getFeatureSet();
+  auto Candidates = generateCandidates(1, Set.get());
+  Candidate C = Candidates[0];
+
+  Engine.addObjectives(C, { 0.5, 1, 2 });
+  Engine.addObjectives(C, { 1, 2, 1 });
+  ASSERT_EQ(Engine.getEntry(C).Count, 2u);
+  ASSERT_DOUBLE_EQ(Engine.getEntry(C).Score, 1.5);
+  ASSERT_EQ(Engine.getEntry(C).Objectives, std::vector<double>({ 0.75, 1.5, 1.5 }));
+
+  // A failed measurement of the elite neither resets it, nor replaces its objectives.
+  Engine.Fail = true;
+  auto AllObjectives = Engine.evaluateObjectives(Candidates, Set.get(), true);
+  ASSERT_TRUE(AllObjectives.back().empty());
+  Engine.addObjectives(C, AllObjectives.back());
+  ASSERT_EQ(Engine.getEntry(C).Count, 2u);
+  ASSERT_EQ(Engine.getEntry(C).Objectives, std::vector<double>({ 0.75, 1.5, 1.5 }));
+
+  // An evaluation without objectives keeps the averaged ones.
+  Engine.addEvaluation(C, 1.5);
+  ASSERT_EQ(Engine.getEntry(C).Count, 3u);
+  ASSERT_EQ(Engine.getEntry(C).Objectives, std::vector<double>({ 0.75, 1.5, 1.5 }));
+
+  // A candidate that only failed gets the failure score.
+  Candidate Failed = generateCandidates(2, Set.get())[1];
+  Engine.addObjectives(Failed, std::vector<double>());
+  ASSERT_EQ(Engine.getEntry(Failed).Count, 1u);
+  ASSERT_TRUE(Engine.getEntry(Failed).Objectives.empty());
+}
+
+TEST(MultiObjectiveGrammarEvolutionTest, StoredRankingTest) {
+  YAML::Node Node = YAML::Load("{ kb-resident: 0, kb-journal: false }");
+  config::parseOptions(Node);
+
+  auto Set = getFeatureSet();
+  auto Candidates = generateCandidates(4, Set.get());
+  std::set<Candidate> KnowledgeBase;
+  for (uint64_t I = 0; I < Candidates.size(); ++I) {
+    // The first one dominates the others.
+    Candidates[I].Score = 1.0 / (I + 1);
+    Candidates[I].Count = 1;
+    Candidates[I].Objectives = std::vector<double>(3, I + 1);
+    KnowledgeBase.insert(Candidates[I]);
+  }
+  ASSERT_TRUE(BinaryKnowledgeBase::write("multi-objective-test.kb", KnowledgeBase));
+
+  // The ranking is taken from the index, and only the candidates returned are decoded.
+  TestMultiObjective Engine(getModule(), "multi-objective-test.kb");
+  Engine.importKnowledgeBase();
+  ASSERT_EQ(Engine.getLoadedEntries(), 0u);
+  auto Ranking = Engine.getParetoRanking(1);
+  ASSERT_EQ(Ranking.size(), 1u);
+  ASSERT_EQ(Ranking[0].Objectives, Candidates[0].Objectives);
+  ASSERT_EQ(BinaryKnowledgeBase::encode(Ranking[0]), BinaryKnowledgeBase::encode(Candidates[0]));
+  ASSERT_EQ(Engine.getLoadedEntries(), 1u);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
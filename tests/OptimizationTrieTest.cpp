@@ -0,0 +1,59 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/InitializationRoutines.h"
+#include "pinhao/Optimizer/OptimizationTrie.h"
+
+#include "ModuleReader.h"
+
+using namespace pinhao;
+
+static OptimizationSequence getSequence(std::vector<Optimization> Opts) {
+  OptimizationSequence Sequence;
+  for (auto Opt : Opts)
+    Sequence.push_back(OptimizationInfo(Opt));
+  return Sequence;
+}
+
+static std::vector<OptimizationSequence> getSequences() {
+  return {
+    getSequence({ Optimization::mem2reg, Optimization::gvn, Optimization::licm }),
+    getSequence({ Optimization::mem2reg, Optimization::gvn, Optimization::dce }),
+    getSequence({ Optimization::mem2reg }),
+    getSequence({ Optimization::sccp }),
+    getSequence({ Optimization::mem2reg, Optimization::gvn, Optimization::licm }),
+    getSequence({ })
+  };
+}
+
+TEST(OptimizationTrieTest, SharedPassesTest) {
+  OptimizationTrie Trie(getSequences());
+  ASSERT_EQ(Trie.getNumberOfPasses(), 11u);
+  // mem2reg, gvn, licm, dce and sccp.
+  ASSERT_EQ(Trie.getNumberOfSharedPasses(), 5u);
+}
+
+TEST(OptimizationTrieTest, CompileTest) {
+  std::string Filepath("../../benchmark/polybench-ll/2mm/2mm.bc");
+  ModuleReader Reader(Filepath);
+  llvm::Module *M = Reader.getModule().get();
+
+  auto Sequences = getSequences();
+  auto Compiled = OptimizationTrie(Sequences).compile(*M);
+  ASSERT_EQ(Compiled.size(), Sequences.size());
+
+  for (uint64_t I = 0; I < Compiled.size(); ++I)
+    ASSERT_NE(Compiled[I], nullptr);
+
+  // Equal sequences share their module, and the others do not.
+  ASSERT_EQ(Compiled[0], Compiled[4]);
+  ASSERT_NE(Compiled[0], Compiled[1]);
+  ASSERT_NE(Compiled[2], Compiled[5]);
+  ASSERT_NE(Compiled[5].get(), M);
+}
+
+int main(int argc, char **argv) {
+  pinhao::initializeOptimizer();
+
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
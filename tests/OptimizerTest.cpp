@@ -108,8 +108,8 @@ TEST(OptimizerTest, EachOptimizationTest) {
     OptimizationSet Set;
     Set.enableOptimization(getOptimization(OptName));
 
-    llvm::Module *NewModule = applyOptimizations(*M, &Set);
-    ASSERT_NE(NewModule, nullptr);
+    OptimizedModule NewModule(applyOptimizations(*M, &Set));
+    ASSERT_NE(NewModule.get(), nullptr);
   }
 }
 
@@ -136,8 +136,8 @@ TEST(OptimizerTest, EachOptimizationFunctionTest) {
     OptimizationSet Set;
     Set.enableOptimization(OptName);
 
-    llvm::Module *NewModule = applyOptimizations(*M, M->getFunction("main"), &Set);
-    ASSERT_NE(NewModule, nullptr);
+    OptimizedModule NewModule(applyOptimizations(*M, M->getFunction("main"), &Set));
+    ASSERT_NE(NewModule.get(), nullptr);
   }
 }
 
@@ -151,7 +151,7 @@ TEST(OptimizerTest, RandomizationFunctionTest) {
     OptimizationSet Set;
     Set.enableFunctionOptimizations();
     std::unique_ptr<OptimizationSequence> Seq(OptimizationSequence::generate(Set, N * 10)); 
-    (void) applyOptimizations(*M, M->getFunction("main"), Seq.get());
+    deleteModule(applyOptimizations(*M, M->getFunction("main"), Seq.get()));
     Seq->print();
 
     checkOptimizationSequencePrint(*Seq.get());
@@ -1,8 +1,13 @@
 #include "gtest/gtest.h"
 
 #include "pinhao/Support/JITExecutor.h"
+#include "pinhao/PerformanceAnalyser/MeasurementDatabase.h"
 #include "pinhao/PerformanceAnalyser/PAPIWrapper.h"
 
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
 #include "ModuleReader.h"
 
 using namespace pinhao;
@@ -37,6 +42,68 @@ TEST(PAPIWrapperTest, CycleInstrTest) {
   std::cout << "}" << std::endl;
 }
 
+TEST(PAPIWrapperTest, RepeatedCycleTest) {
+  // A negative width is never reached, so it takes the maximum number of samples.
+  auto PAPIRun = PAPIWrapper::getTotalCyclesRepeatedly(*Module, { "papi-profiling" }, 
+      RepetitionPolicy(3, 5, -1));
+  ASSERT_EQ(PAPIRun.first, 0);
+  ASSERT_EQ(PAPIRun.second.Samples.size(), 5u);
+  for (auto Sample : PAPIRun.second.Samples)
+    ASSERT_GT(Sample, 0);
+  ASSERT_GT(PAPIRun.second.Median, 0);
+
+  // It stops as soon as the interval is tight enough, but not before the minimum.
+  PAPIRun = PAPIWrapper::getTotalCyclesRepeatedly(*Module, { "papi-profiling" }, 
+      RepetitionPolicy(2, 5, 1e9));
+  ASSERT_EQ(PAPIRun.first, 0);
+  ASSERT_EQ(PAPIRun.second.Samples.size(), 2u);
+}
+
+TEST(PAPIWrapperTest, RepeatedBudgetTest) {
+  auto PAPIRun = PAPIWrapper::getTotalCyclesRepeatedly(*Module, { "papi-profiling" }, 
+      RepetitionPolicy(3, 5), PAPIWrapper::Budget(1000));
+  ASSERT_EQ(PAPIRun.first, PAPIWrapper::BudgetExceeded);
+  ASSERT_TRUE(PAPIRun.second.Samples.empty());
+
+  // The fork server is gone, and the next measurement works.
+  PAPIRun = PAPIWrapper::getTotalCyclesRepeatedly(*Module, { "papi-profiling" }, 
+      RepetitionPolicy(1, 1));
+  ASSERT_EQ(PAPIRun.first, 0);
+  ASSERT_EQ(PAPIRun.second.Samples.size(), 1u);
+}
+
+/// @brief Adds an unused global to @a M, so that it is a different module.
+static void addGlobal(llvm::Module &M) {
+  llvm::Type *Int = llvm::Type::getInt32Ty(M.getContext());
+  new llvm::GlobalVariable(M, Int, true, llvm::GlobalValue::InternalLinkage, 
+      llvm::ConstantInt::get(Int, 0), "papi.wrapper.test");
+}
+
+TEST(PAPIWrapperTest, FusedCycleTest) {
+  uint64_t Original = MeasurementDatabase::hashModule(*Module);
+  uint64_t Fingerprint = 0;
+
+  auto PAPIRun = PAPIWrapper::getTotalCyclesRepeatedly(*Module, addGlobal, { "papi-profiling" }, 
+      RepetitionPolicy(2, 2), PAPIWrapper::Budget(), &Fingerprint);
+  ASSERT_EQ(PAPIRun.first, 0);
+  ASSERT_EQ(PAPIRun.second.Samples.size(), 2u);
+
+  // The module was transformed only in the fork server.
+  ASSERT_EQ(Module->getNamedGlobal("papi.wrapper.test"), nullptr);
+  ASSERT_EQ(MeasurementDatabase::hashModule(*Module), Original);
+
+  // The fingerprint is the one of the transformed module.
+  std::unique_ptr<llvm::Module> Transformed(llvm::CloneModule(Module.get()));
+  addGlobal(*Transformed);
+  ASSERT_NE(Fingerprint, Original);
+  ASSERT_EQ(Fingerprint, MeasurementDatabase::hashModule(*Transformed));
+
+  // It can be measured again.
+  PAPIRun = PAPIWrapper::getTotalCyclesRepeatedly(*Module, addGlobal, { "papi-profiling" }, 
+      RepetitionPolicy(1, 1));
+  ASSERT_EQ(PAPIRun.first, 0);
+}
+
 int main(int argc, char **argv) {
   initializeJITExecutor();
 
@@ -0,0 +1,52 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/Support/Pareto.h"
+
+#include <cmath>
+
+using namespace pinhao;
+
+TEST(ParetoTest, DominatesTest) {
+  ASSERT_TRUE(dominates({ 1, 2 }, { 2, 2 }));
+  ASSERT_TRUE(dominates({ 1, 1 }, { 2, 2 }));
+  ASSERT_FALSE(dominates({ 1, 2 }, { 1, 2 }));
+  ASSERT_FALSE(dominates({ 1, 3 }, { 2, 2 }));
+  ASSERT_FALSE(dominates({ 2, 2 }, { 1, 2 }));
+}
+
+TEST(ParetoTest, FrontsTest) {
+  std::vector<std::vector<double>> Points = { { 1, 4 }, { 2, 2 }, { 4, 1 }, { 3, 3 }, { 5, 5 }, { 2, 5 } };
+  auto Fronts = getParetoFronts(Points);
+
+  ASSERT_EQ(Fronts.size(), 3u);
+  ASSERT_EQ(Fronts[0], std::vector<uint64_t>({ 0, 1, 2 }));
+  ASSERT_EQ(Fronts[1], std::vector<uint64_t>({ 3, 5 }));
+  ASSERT_EQ(Fronts[2], std::vector<uint64_t>({ 4 }));
+}
+
+TEST(ParetoTest, CrowdingTest) {
+  std::vector<std::vector<double>> Points = { { 0, 4 }, { 1, 3 }, { 3, 1 }, { 4, 0 } };
+  auto Distances = getCrowdingDistances(Points, { 0, 1, 2, 3 });
+
+  ASSERT_TRUE(std::isinf(Distances[0]));
+  ASSERT_TRUE(std::isinf(Distances[3]));
+  // (3 - 0) / 4 for each objective.
+  ASSERT_DOUBLE_EQ(Distances[1], 1.5);
+  ASSERT_DOUBLE_EQ(Distances[2], 1.5);
+}
+
+TEST(ParetoTest, OrderTest) {
+  std::vector<std::vector<double>> Points = { { 5, 5 }, { 1, 3 }, { 0, 4 }, { 2, 2 }, { 4, 0 } };
+  auto Order = getParetoOrder(Points);
+
+  ASSERT_EQ(Order.size(), Points.size());
+  // The extremes of the first front come first, and the dominated point last.
+  ASSERT_EQ(Order[0], 2u);
+  ASSERT_EQ(Order[1], 4u);
+  ASSERT_EQ(Order.back(), 0u);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,120 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/Optimizer/OptimizationSequence.h"
+#include "pinhao/Optimizer/Phenotype.h"
+#include "pinhao/MachineLearning/GrammarEvolution/PhenotypeCache.h"
+
+using namespace pinhao;
+
+static OptimizationSequence getSequence(std::vector<Optimization> Opts) {
+  OptimizationSequence Sequence;
+  for (auto Opt : Opts)
+    Sequence.push_back(OptimizationInfo(Opt));
+  return Sequence;
+}
+
+TEST(PhenotypeTest, EnabledTest) {
+  Phenotype P(getSequence({ Optimization::adce, Optimization::tailcallelim }));
+  ASSERT_TRUE(P.isEnabled(Optimization::adce));
+  ASSERT_TRUE(P.isEnabled(Optimization::tailcallelim));
+  ASSERT_FALSE(P.isEnabled(Optimization::gvn));
+  ASSERT_EQ(P.getNumberOfEnabled(), 2u);
+}
+
+TEST(PhenotypeTest, EqualityTest) {
+  Phenotype P1(getSequence({ Optimization::adce, Optimization::gvn }));
+  Phenotype P2(getSequence({ Optimization::adce, Optimization::gvn }));
+  Phenotype P3(getSequence({ Optimization::adce }));
+  ASSERT_TRUE(P1 == P2);
+  ASSERT_FALSE(P1 == P3);
+  ASSERT_EQ(P1.getKey(), P2.getKey());
+  ASSERT_NE(P1.getKey(), P3.getKey());
+  ASSERT_TRUE(P3 < P1 || P1 < P3);
+}
+
+TEST(PhenotypeTest, ArgumentsTest) {
+  OptimizationSequence S1 = getSequence({ Optimization::gvn });
+  OptimizationSequence S2 = getSequence({ Optimization::gvn });
+  S2[0].setArg<bool>(0, !S1[0].getArg<bool>(0));
+
+  Phenotype P1(S1), P2(S2);
+  ASSERT_FALSE(P1 == P2);
+  ASSERT_TRUE(P1 < P2 || P2 < P1);
+}
+
+TEST(PhenotypeTest, CacheTest) {
+  PhenotypeCache Cache;
+  Phenotype P1(getSequence({ Optimization::adce }));
+  Phenotype P2(getSequence({ Optimization::dce }));
+
+  ASSERT_EQ(Cache.find(P1), nullptr);
+  Cache.insert(P1, 1.5);
+  ASSERT_NE(Cache.find(P1), nullptr);
+  ASSERT_EQ(Cache.find(P1)->Fitness, 1.5);
+  ASSERT_EQ(Cache.find(P2), nullptr);
+
+  ASSERT_EQ(Cache.getNumberOfHits(), 2u);
+  ASSERT_EQ(Cache.getNumberOfMisses(), 2u);
+  ASSERT_EQ(Cache.size(), 1u);
+}
+
+TEST(PhenotypeTest, PeekTest) {
+  PhenotypeCache Cache;
+  Phenotype P1(getSequence({ Optimization::adce }));
+  Phenotype P2(getSequence({ Optimization::dce }));
+
+  Cache.insert(P1, 1.5);
+  ASSERT_NE(Cache.peek(P1), nullptr);
+  ASSERT_EQ(Cache.peek(P2), nullptr);
+  ASSERT_EQ(Cache.getNumberOfHits(), 0u);
+  ASSERT_EQ(Cache.getNumberOfMisses(), 0u);
+}
+
+TEST(PhenotypeTest, AddTest) {
+  PhenotypeCache Cache;
+  Phenotype P(getSequence({ Optimization::adce }));
+
+  // A failure is replaced by the first evaluation that succeeds.
+  Cache.add(P, 0);
+  Cache.add(P, 1.2);
+  ASSERT_EQ(Cache.peek(P)->Evaluations, 1u);
+  ASSERT_DOUBLE_EQ(Cache.peek(P)->Fitness, 1.2);
+
+  Cache.add(P, 1.0);
+  Cache.add(P, 0.8);
+  ASSERT_EQ(Cache.peek(P)->Evaluations, 3u);
+  ASSERT_DOUBLE_EQ(Cache.peek(P)->Fitness, 1.0);
+
+  // The failures do not replace them.
+  Cache.add(P, 0);
+  ASSERT_EQ(Cache.peek(P)->Evaluations, 3u);
+  ASSERT_DOUBLE_EQ(Cache.peek(P)->Fitness, 1.0);
+}
+
+TEST(PhenotypeTest, FingerprintTest) {
+  PhenotypeCache Cache;
+  Phenotype P1(getSequence({ Optimization::adce }));
+  Phenotype P2(getSequence({ Optimization::dce }));
+  Phenotype P3(getSequence({ Optimization::gvn }));
+
+  // P2 is compiled into the same module as P1, so their evaluations are averaged.
+  Cache.add(P1, 1.2, nullptr, 42);
+  Cache.add(P2, 0.8, nullptr, 42);
+  ASSERT_EQ(Cache.peek(P1), Cache.peek(P2));
+  ASSERT_EQ(Cache.peek(P1)->Evaluations, 2u);
+  ASSERT_DOUBLE_EQ(Cache.peek(P1)->Fitness, 1.0);
+  ASSERT_EQ(Cache.size(), 2u);
+
+  Cache.add(P3, 2, nullptr, 7);
+  ASSERT_NE(Cache.peek(P1), Cache.peek(P3));
+
+  // Without a fingerprint, it is only the phenotype.
+  Cache.add(P3, 1);
+  ASSERT_EQ(Cache.peek(P3)->Evaluations, 2u);
+  ASSERT_EQ(Cache.peek(P1)->Evaluations, 2u);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
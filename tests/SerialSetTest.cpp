@@ -3,7 +3,11 @@
 #include "pinhao/Support/SerialSet.h"
 #include "pinhao/Support/Random.h"
 
+#include <algorithm>
+#include <functional>
 #include <limits>
+#include <type_traits>
+#include <vector>
 
 using namespace pinhao;
 
@@ -24,6 +28,43 @@ TEST(SerialSetTest, IntSetTest) {
   ASSERT_TRUE(Set == ReadSet);
 }
 
+TEST(SerialSetTest, RankingTest) {
+  SerialSet<int, std::less<int>, std::greater<int>> Set;
+  for (int I = 0; I < 200; ++I)
+    Set.insert(UniformRandom::getRandomInt(0, 1000));
+  for (int I = 0; I < 50; ++I)
+    Set.erase(UniformRandom::getRandomInt(0, 1000));
+  Set.erase(Set.begin());
+  Set.update(1001);
+
+  auto Copy = Set;
+  Set.clear();
+  ASSERT_TRUE(Set.empty());
+
+  std::vector<int> Expected(Copy.rbegin(), Copy.rend());
+  ASSERT_EQ(Copy.get(0), 1001);
+  for (uint64_t I = 0; I < Expected.size(); ++I)
+    ASSERT_EQ(Copy.get(I), Expected[I]);
+
+  std::vector<int> First = Copy.getFirst(10);
+  ASSERT_EQ(First, std::vector<int>(Expected.begin(), Expected.begin() + 10));
+  ASSERT_EQ(Copy.getFirst(Expected.size() + 5).size(), Expected.size());
+}
+
+TEST(SerialSetTest, EncapsulationTest) {
+  // The elements are only inserted and erased by the members that update the indexes.
+  ASSERT_FALSE((std::is_convertible<SerialSet<int>*, std::set<int>*>::value));
+
+  SerialSet<int, std::less<int>, std::greater<int>> Set;
+  for (int I = 0; I < 10; ++I)
+    Set.insert(I);
+  Set.erase(5);
+  ASSERT_EQ(Set.getSet(), std::set<int>({ 0, 1, 2, 3, 4, 6, 7, 8, 9 }));
+  ASSERT_EQ(Set.get(4), 4);
+  ASSERT_TRUE(Set.has(9));
+  ASSERT_FALSE(Set.has(5));
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
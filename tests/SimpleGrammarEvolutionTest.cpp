@@ -0,0 +1,116 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/MachineLearning/GrammarEvolution/SimpleGrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/GrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/Formulas.h"
+#include "pinhao/Optimizer/Phenotype.h"
+#include "pinhao/Support/YamlOptions.h"
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+using namespace pinhao;
+
+/// @brief A fingerprint that does not fit the mantissa of a double.
+static const uint64_t TestFingerprint = 0xfedcba9876543211;
+
+/// @brief Measures every sequence with the same fake cost and fingerprint.
+class TestSimple : public SimpleGrammarEvolution {
+  protected:
+    std::vector<double> compileAndMeasure(OptimizationSequence&, std::shared_ptr<llvm::Module>*,
+        uint64_t *Fingerprint) override {
+      if (Fingerprint) *Fingerprint = TestFingerprint;
+      return { 50, 50, 50 };
+    }
+
+  public:
+    TestSimple(std::shared_ptr<llvm::Module> Module) :
+      SimpleGrammarEvolution(Module, "simple-test.yaml") {
+      BaseLine = 100;
+    }
+
+    using SimpleGrammarEvolution::evaluateCandidates;
+    using SimpleGrammarEvolution::takeFingerprint;
+    using SimpleGrammarEvolution::parseEvaluation;
+
+    const PhenotypeCache::Entry *getEntry(Candidate &C, FeatureSet *Set) {
+      return Cache.peek(Phenotype(getOptimizationSequence(C, Set)));
+    }
+};
+
+static std::vector<Candidate> generateCandidates(uint64_t Size, FeatureSet *Set) {
+  std::vector<DecisionPoint> DecisionPoints;
+  for (auto &Name : Optimizations)
+    DecisionPoints.push_back(DecisionPoint(Name, ValueType::Bool));
+
+  SerialSet<Candidate> Candidates;
+  while (Candidates.size() < Size) {
+    Candidate C;
+    C.generateMissing(DecisionPoints, Set);
+    Candidates.insert(C);
+  }
+  return std::vector<Candidate>(Candidates.begin(), Candidates.end());
+}
+
+static std::shared_ptr<llvm::Module> getModule() {
+  static llvm::LLVMContext Context;
+  return std::make_shared<llvm::Module>("simple-test", Context);
+}
+
+static std::shared_ptr<FeatureSet> getFeatureSet() {
+  FeatureSet::disableAll();
+  FeatureSet::enable("cfg_md_static");
+  return FeatureSet::get();
+}
+
+TEST(SimpleGrammarEvolutionTest, WorkerFingerprintTest) {
+  YAML::Node Node = YAML::Load("{ eval-workers: 2, share-prefixes: false, helper-processes: 0 }");
+  config::parseOptions(Node);
+
+  TestSimple Engine(getModule());
+  auto Set = getFeatureSet();
+  auto Candidates = generateCandidates(4, Set.get());
+
+  // Each candidate is measured in a forked worker, which sends its fingerprint back.
+  auto Scores = Engine.evaluateCandidates(Candidates, Set.get());
+  for (uint64_t I = 0; I < Candidates.size(); ++I) {
+    ASSERT_DOUBLE_EQ(Scores[I], 2);
+    auto *Entry = Engine.getEntry(Candidates[I], Set.get());
+    ASSERT_NE(Entry, nullptr);
+    ASSERT_EQ(Entry->Fingerprint, TestFingerprint);
+  }
+}
+
+TEST(SimpleGrammarEvolutionTest, TakeFingerprintTest) {
+  WorkerPool::Values Values = { 1, 2, 3, static_cast<double>(TestFingerprint >> 32),
+    static_cast<double>(TestFingerprint & 0xffffffff) };
+  ASSERT_EQ(TestSimple::takeFingerprint(Values), TestFingerprint);
+  ASSERT_EQ(Values, WorkerPool::Values({ 1, 2, 3 }));
+
+  // A worker that died sends nothing.
+  Values.clear();
+  ASSERT_EQ(TestSimple::takeFingerprint(Values), 0u);
+  ASSERT_TRUE(Values.empty());
+}
+
+TEST(SimpleGrammarEvolutionTest, ParseEvaluationTest) {
+  std::vector<double> Samples;
+  uint64_t Fingerprint = 0;
+  ASSERT_TRUE(TestSimple::parseEvaluation(
+        "{ status: 0, samples: [50, 60], time: 1.5, fingerprint: fedcba9876543211 }",
+        Samples, Fingerprint));
+  ASSERT_EQ(Samples, std::vector<double>({ 50, 60 }));
+  ASSERT_EQ(Fingerprint, TestFingerprint);
+
+  // The replies cut short, or with fields of the wrong type, fail the evaluation.
+  for (std::string Reply : { "{ status: 0, samples: [50, 6", "", "[50, 60]",
+      "{ status: 0, samples: [50], time: 1.5 }",
+      "{ status: 0, samples: [fast], time: 1.5, fingerprint: 0 }",
+      "{ status: 0, samples: [50], time: 1.5, fingerprint: none }" })
+    ASSERT_FALSE(TestSimple::parseEvaluation(Reply, Samples, Fingerprint)) << Reply;
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
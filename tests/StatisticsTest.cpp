@@ -0,0 +1,128 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/Support/Statistics.h"
+
+#include <cmath>
+
+using namespace pinhao;
+
+TEST(StatisticsTest, MedianTest) {
+  ASSERT_EQ(getMedian({ 3 }), 3);
+  ASSERT_EQ(getMedian({ 5, 1, 3 }), 3);
+  ASSERT_EQ(getMedian({ 4, 1, 3, 2 }), 2.5);
+}
+
+TEST(StatisticsTest, MADTest) {
+  ASSERT_EQ(getMAD({ 1, 1, 2, 2, 4, 6, 9 }), 1);
+  ASSERT_EQ(getMAD({ 7, 7, 7 }), 0);
+}
+
+TEST(StatisticsTest, NormalQuantileTest) {
+  ASSERT_NEAR(getNormalQuantile(0.975), 1.96, 1e-3);
+  ASSERT_NEAR(getNormalQuantile(0.025), -1.96, 1e-3);
+  ASSERT_NEAR(getNormalQuantile(0.5), 0, 1e-3);
+}
+
+TEST(StatisticsTest, StudentQuantileTest) {
+  ASSERT_NEAR(getStudentQuantile(0.975, 1), 12.706, 1e-3);
+  ASSERT_NEAR(getStudentQuantile(0.975, 2), 4.303, 1e-3);
+  ASSERT_NEAR(getStudentQuantile(0.975, 4), 2.776, 1e-2);
+  ASSERT_NEAR(getStudentQuantile(0.975, 9), 2.262, 1e-3);
+  ASSERT_NEAR(getStudentQuantile(0.025, 9), -2.262, 1e-3);
+  ASSERT_NEAR(getStudentQuantile(0.975, 30), 2.042, 1e-3);
+}
+
+TEST(StatisticsTest, ConfidenceIntervalTest) {
+  std::vector<double> Samples;
+  for (int I = 1; I <= 100; ++I)
+    Samples.push_back(I);
+
+  auto Interval = getMedianConfidenceInterval(Samples, 0.95);
+  ASSERT_EQ(Interval.first, 40);
+  ASSERT_EQ(Interval.second, 61);
+
+  // With few samples, it is the t interval around the median: 2 +- 4.303 * sqrt(pi / 6).
+  Interval = getMedianConfidenceInterval({ 3, 1, 2 }, 0.95);
+  ASSERT_NEAR(Interval.first, 2 - 3.114, 1e-3);
+  ASSERT_NEAR(Interval.second, 2 + 3.114, 1e-3);
+
+  // Which gets narrower than the range of the samples, if they are close.
+  std::vector<double> Close = { 1000, 1001, 999, 1002, 998, 1000, 1001, 999, 1000, 1000 };
+  Interval = getMedianConfidenceInterval(Close, 0.95);
+  ASSERT_GT(Interval.first, 998);
+  ASSERT_LT(Interval.second, 1002);
+  ASSERT_LT(Interval.first, 1000);
+  ASSERT_GT(Interval.second, 1000);
+
+  Interval = getMedianConfidenceInterval({ 5 }, 0.95);
+  ASSERT_TRUE(std::isinf(Interval.first) && std::isinf(Interval.second));
+}
+
+TEST(StatisticsTest, EarlyStopTest) {
+  // Samples within 0.5% of each other stop before the maximum (10), with a 2% width.
+  unsigned Taken = 0;
+  RobustEstimate Estimate;
+  bool Ok = measureRepeatedly([&Taken] (double &Sample) { 
+        Sample = 1000 + (Taken++ % 3) * 2; 
+        return true; 
+      }, RepetitionPolicy(3, 10, 0.02), Estimate);
+
+  ASSERT_TRUE(Ok);
+  ASSERT_LT(Taken, 10u);
+  ASSERT_LE(Estimate.getRelativeWidth(), 0.02);
+}
+
+TEST(StatisticsTest, StableMeasurementTest) {
+  unsigned Taken = 0;
+  RobustEstimate Estimate;
+  bool Ok = measureRepeatedly([&Taken] (double &Sample) { ++Taken; Sample = 100; return true; },
+      RepetitionPolicy(3, 10, 0.02), Estimate);
+
+  ASSERT_TRUE(Ok);
+  ASSERT_EQ(Taken, 3u);
+  ASSERT_EQ(Estimate.Median, 100);
+  ASSERT_EQ(Estimate.MAD, 0);
+  ASSERT_EQ(Estimate.getRelativeWidth(), 0);
+}
+
+TEST(StatisticsTest, NoisyMeasurementTest) {
+  unsigned Taken = 0;
+  RobustEstimate Estimate;
+  bool Ok = measureRepeatedly([&Taken] (double &Sample) { 
+        Sample = (Taken++ % 2) ? 90 : 110; 
+        return true; 
+      }, RepetitionPolicy(3, 8, 0.02), Estimate);
+
+  ASSERT_TRUE(Ok);
+  ASSERT_EQ(Taken, 8u);
+  ASSERT_EQ(Estimate.Samples.size(), 8u);
+  ASSERT_EQ(Estimate.Median, 100);
+}
+
+TEST(StatisticsTest, FailedMeasurementTest) {
+  unsigned Taken = 0;
+  RobustEstimate Estimate;
+  bool Ok = measureRepeatedly([&Taken] (double &Sample) { Sample = 1; return ++Taken < 2; },
+      RepetitionPolicy(3, 10, 0.02), Estimate);
+
+  ASSERT_FALSE(Ok);
+  ASSERT_EQ(Estimate.Samples.size(), 1u);
+}
+
+TEST(StatisticsTest, RanksTest) {
+  auto Ranks = getRanks({ 10, 30, 20, 30 });
+  ASSERT_EQ(Ranks, std::vector<double>({ 1, 3.5, 2, 3.5 }));
+}
+
+TEST(StatisticsTest, SpearmanCorrelationTest) {
+  std::vector<double> X = { 1, 2, 3, 4, 5 };
+  ASSERT_DOUBLE_EQ(getSpearmanCorrelation(X, { 2, 4, 8, 16, 32 }), 1);
+  ASSERT_DOUBLE_EQ(getSpearmanCorrelation(X, { 5, 4, 3, 2, 1 }), -1);
+  ASSERT_DOUBLE_EQ(getSpearmanCorrelation(X, { 1, 3, 2, 5, 4 }), 0.8);
+  ASSERT_EQ(getSpearmanCorrelation(X, { 7, 7, 7, 7, 7 }), 0);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
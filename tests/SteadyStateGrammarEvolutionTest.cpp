@@ -0,0 +1,143 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/MachineLearning/GrammarEvolution/SteadyStateGrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/GrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/Formulas.h"
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include <fstream>
+
+using namespace pinhao;
+
+/// @brief Exposes the merging of the scores of the offspring. Every measurement fails,
+/// and is counted in @a Measurements.
+class TestSteadyState : public SteadyStateGrammarEvolution {
+  protected:
+    std::vector<double> measureCostRepeatedly(llvm::Module&) override {
+      ++Measurements;
+      return std::vector<double>();
+    }
+
+  public:
+    uint64_t Measurements;
+
+    TestSteadyState(std::shared_ptr<llvm::Module> Module) :
+      SteadyStateGrammarEvolution(Module, "steady-state-test.yaml"), Measurements(0) {}
+
+    using SteadyStateGrammarEvolution::mergeCandidate;
+
+    const SerialSet<Candidate, std::less<Candidate>, CompareByScore> &getKnowledgeBase() {
+      return KnowledgeBase;
+    }
+
+    double getFailureScore() const { return FailureScore; }
+};
+
+static std::vector<Candidate> generateCandidates(uint64_t Size) {
+  FeatureSet::disableAll();
+  FeatureSet::enable("cfg_md_static");
+  auto Set = FeatureSet::get();
+
+  std::vector<DecisionPoint> DecisionPoints;
+  for (auto &Name : Optimizations)
+    DecisionPoints.push_back(DecisionPoint(Name, ValueType::Bool));
+
+  SerialSet<Candidate> Candidates;
+  while (Candidates.size() < Size) {
+    Candidate C;
+    C.generateMissing(DecisionPoints, Set.get());
+    Candidates.insert(C);
+  }
+  return std::vector<Candidate>(Candidates.begin(), Candidates.end());
+}
+
+static bool isSame(const Candidate &A, const Candidate &B) {
+  return !(A < B) && !(B < A);
+}
+
+static std::shared_ptr<llvm::Module> getModule() {
+  static llvm::LLVMContext Context;
+  return std::make_shared<llvm::Module>("steady-state-test", Context);
+}
+
+TEST(SteadyStateGrammarEvolutionTest, MergeTest) {
+  TestSteadyState Engine(getModule());
+  auto Candidates = generateCandidates(3);
+  Candidate Parent = Candidates[0], Existing = Candidates[1], Hit = Candidates[2];
+
+  Engine.mergeCandidate(Existing, 1);
+  for (int I = 0; I < 3; ++I)
+    Engine.mergeCandidate(Parent, 2);
+
+  // The offspring evolved into a candidate that was evaluated before, but it still has
+  // the score and count of its parent: only its new evaluation is merged.
+  Candidate Offspring = Existing;
+  Offspring.Score = 2;
+  Offspring.Count = 3;
+  Engine.mergeCandidate(Offspring, 3);
+
+  auto It = Engine.getKnowledgeBase().find(Existing);
+  ASSERT_NE(It, Engine.getKnowledgeBase().end());
+  ASSERT_EQ(It->Count, 2u);
+  ASSERT_DOUBLE_EQ(It->Score, 2);
+
+  It = Engine.getKnowledgeBase().find(Parent);
+  ASSERT_EQ(It->Count, 3u);
+  ASSERT_DOUBLE_EQ(It->Score, 2);
+
+  // A score taken from the cache is not an evaluation: it does not change a candidate
+  // evaluated before, and a new one gets it without a count.
+  Engine.mergeCandidate(Parent, 5, false);
+  It = Engine.getKnowledgeBase().find(Parent);
+  ASSERT_EQ(It->Count, 3u);
+  ASSERT_DOUBLE_EQ(It->Score, 2);
+
+  Engine.mergeCandidate(Hit, 4, false);
+  It = Engine.getKnowledgeBase().find(Hit);
+  ASSERT_NE(It, Engine.getKnowledgeBase().end());
+  ASSERT_EQ(It->Count, 0u);
+  ASSERT_DOUBLE_EQ(It->Score, 4);
+}
+
+TEST(SteadyStateGrammarEvolutionTest, ReplacementTest) {
+  TestSteadyState Engine(getModule());
+  auto Candidates = generateCandidates(3);
+
+  Engine.mergeCandidate(Candidates[0], 1.5);
+  Engine.mergeCandidate(Candidates[1], 1.2);
+  ASSERT_TRUE(isSame(Engine.getKnowledgeBase().get(0), Candidates[0]));
+
+  // A better offspring takes the place of the best one as soon as it is merged.
+  Engine.mergeCandidate(Candidates[2], 2);
+  ASSERT_TRUE(isSame(Engine.getKnowledgeBase().get(0), Candidates[2]));
+  ASSERT_EQ(Engine.getKnowledgeBase().size(), 3u);
+
+  // A worse evaluation of the best one moves it down.
+  Engine.mergeCandidate(Candidates[2], 0.2);
+  ASSERT_TRUE(isSame(Engine.getKnowledgeBase().get(0), Candidates[0]));
+
+  // The ones that failed get the failure score.
+  Engine.mergeCandidate(Candidates[1], 0);
+  auto It = Engine.getKnowledgeBase().find(Candidates[1]);
+  ASSERT_EQ(It->Count, 2u);
+  ASSERT_DOUBLE_EQ(It->Score, (1.2 + Engine.getFailureScore()) / 2);
+}
+
+TEST(SteadyStateGrammarEvolutionTest, BaseLineTest) {
+  TestSteadyState Engine(getModule());
+  FeatureSet::disableAll();
+  FeatureSet::enable("cfg_md_static");
+
+  // Without a base line there are no speed ups, so nothing is evaluated.
+  Engine.run(2, 2, FeatureSet::get());
+  ASSERT_EQ(Engine.Measurements, 1u);
+  ASSERT_TRUE(Engine.getKnowledgeBase().empty());
+  ASSERT_FALSE(std::ifstream("steady-state-test.yaml").good());
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
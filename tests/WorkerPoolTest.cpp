@@ -0,0 +1,64 @@
+#include "gtest/gtest.h"
+
+#include "pinhao/Support/WorkerPool.h"
+
+#include <cstdlib>
+
+using namespace pinhao;
+
+static std::vector<WorkerPool::Task> getSquareTasks(int Size) {
+  std::vector<WorkerPool::Task> Tasks;
+  for (int I = 0; I < Size; ++I)
+    Tasks.push_back([I] () -> WorkerPool::Values { return { (double) I * I, (double) I }; });
+  return Tasks;
+}
+
+TEST(WorkerPoolTest, SerialMapTest) {
+  WorkerPool Pool(1);
+  auto Results = Pool.map(getSquareTasks(20));
+  ASSERT_EQ(Results.size(), 20u);
+  for (int I = 0; I < 20; ++I) {
+    ASSERT_EQ(Results[I].size(), 2u);
+    ASSERT_EQ(Results[I][0], I * I);
+    ASSERT_EQ(Results[I][1], I);
+  }
+}
+
+TEST(WorkerPoolTest, ParallelMapTest) {
+  WorkerPool Pool(4);
+  auto Results = Pool.map(getSquareTasks(20));
+  ASSERT_EQ(Results.size(), 20u);
+  for (int I = 0; I < 20; ++I) {
+    ASSERT_EQ(Results[I].size(), 2u);
+    ASSERT_EQ(Results[I][0], I * I);
+    ASSERT_EQ(Results[I][1], I);
+  }
+  ASSERT_EQ(Pool.getNumberOfPending(), 0u);
+}
+
+TEST(WorkerPoolTest, WorkerIsolationTest) {
+  int Counter = 0;
+  WorkerPool Pool(2);
+  Pool.submit([&Counter] () -> WorkerPool::Values { return { (double) ++Counter }; });
+  auto Result = Pool.wait();
+  ASSERT_EQ(Result.second, WorkerPool::Values({ 1 }));
+  ASSERT_EQ(Counter, 0);
+}
+
+TEST(WorkerPoolTest, DeadWorkerTest) {
+  WorkerPool Pool(2);
+  std::vector<WorkerPool::Task> Tasks = {
+    [] () -> WorkerPool::Values { return { 1 }; },
+    [] () -> WorkerPool::Values { abort(); return { 2 }; },
+    [] () -> WorkerPool::Values { return { 3 }; }
+  };
+  auto Results = Pool.map(Tasks);
+  ASSERT_EQ(Results[0], WorkerPool::Values({ 1 }));
+  ASSERT_TRUE(Results[1].empty());
+  ASSERT_EQ(Results[2], WorkerPool::Values({ 3 }));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
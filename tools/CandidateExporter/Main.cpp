@@ -0,0 +1,65 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file Main.cpp
+ * @brief Writes the best candidate of a knowledge base as an LLVM pass plugin.
+ */
+
+#include "pinhao/MachineLearning/GrammarEvolution/CandidateExporter.h"
+#include "pinhao/MachineLearning/GrammarEvolution/GrammarEvolution.h"
+
+#include "pinhao/PinhaoOptions.h"
+#include "pinhao/InitializationRoutines.h"
+#include "pinhao/Support/SerialSet.h"
+#include "pinhao/Support/YAMLWrapper.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+using namespace pinhao;
+
+static config::YamlOpt<std::string> KnowledgeBaseName
+("kb-name", "The name of the knowledge base.", true, "");
+
+static config::YamlOpt<std::string> KnowledgeBasePath
+("kb-path", "The path of the knowledge base.", false, "./");
+
+static config::YamlOpt<std::string> SequenceFile
+("sequence", "The file which contains a sequence of optimization.", false, ".sequence.yaml");
+
+static config::YamlOpt<std::string> ExportFile
+("export-file", "The file where the source of the pass plugin is written.", false, "CandidatePass.cpp");
+
+static config::YamlOpt<std::string> ExportPassArg
+("export-pass-arg", "The argument of opt that runs the exported pass.", false, "pinhao-candidate");
+
+int main(int argc, char **argv) {
+  parseCommandLine(argc, argv);
+  initializeOptimizer();
+  initializeCFGModuleStaticFeatures();
+
+  SerialSet<Candidate> KnowledgeBase;
+  auto KBNode = YAMLWrapper::loadFile(KnowledgeBasePath.get() + KnowledgeBaseName.get());
+  YAMLWrapper::fill(KnowledgeBase, KBNode);
+  if (KnowledgeBase.empty()) {
+    std::cerr << "The knowledge base has no candidate." << std::endl;
+    return 1;
+  }
+
+  std::vector<int> Sequence;
+  auto SequenceNode = YAMLWrapper::loadFile(SequenceFile.get());
+  YAMLWrapper::fill(Sequence, SequenceNode);
+
+  auto Best = std::min_element(KnowledgeBase.begin(), KnowledgeBase.end(), CompareByScore());
+  std::cout << "Exporting the candidate with score " << Best->Score << " to " << ExportFile.get() << std::endl;
+
+  std::ostringstream Source;
+  CandidateExporter Exporter(ExportPassArg.get());
+  if (!Exporter.exportPass(*Best, Sequence, Source))
+    return 1;
+
+  std::ofstream Out(ExportFile.get());
+  Out << Source.str();
+  return 0;
+}
@@ -0,0 +1,28 @@
+/*-------------------------- PINHAO project --------------------------*/
+
+/**
+ * @file Main.cpp
+ * @brief Converts a knowledge base between YAML and the binary format (.kb).
+ */
+
+#include "pinhao/MachineLearning/GrammarEvolution/BinaryKnowledgeBase.h"
+
+#include "pinhao/PinhaoOptions.h"
+
+#include <iostream>
+
+using namespace pinhao;
+
+static config::YamlOpt<std::string> InputFile
+("kb-input", "The knowledge base to be converted.", true, "");
+
+static config::YamlOpt<std::string> OutputFile
+("kb-output", "The converted knowledge base. It is binary if its name ends with .kb, and YAML otherwise.", true, "");
+
+int main(int argc, char **argv) {
+  parseCommandLine(argc, argv);
+
+  uint64_t Converted = convertKnowledgeBase(InputFile.get(), OutputFile.get());
+  std::cout << Converted << " candidates written to " << OutputFile.get() << std::endl;
+  return Converted ? 0 : 1;
+}
@@ -6,9 +6,12 @@
  */
 
 #include "pinhao/Features/Feature.h"
+#include "pinhao/Support/BinaryFeatureDump.h"
 
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 
+#include <fstream>
 #include <vector>
 
 using namespace llvm;
@@ -78,3 +81,50 @@ bool CFGStaticFeaturesPrinterPass::runOnModule(Module &M) {
 
 char CFGStaticFeaturesPrinterPass::ID = 0;
 static RegisterPass<CFGStaticFeaturesPrinterPass> Y("cfg-sfprint", "Prints the static features of the CFG collected.", false, false);
+
+static cl::opt<std::string> DumpFilename
+("cfg-sfdump-file", cl::desc("The file where the static features of the CFG are dumped."),
+ cl::init("cfg-static-features.bin"));
+
+namespace {
+
+  /**
+   * @brief Dumps the static features of the CFG, including the ones of every basic block.
+   *
+   * @details
+   * They are written as a @a BinaryFeatureDump, unless the file ends with ".yaml".
+   */
+  class CFGStaticFeaturesDumpPass : public ModulePass {
+    public:
+      static char ID;
+      CFGStaticFeaturesDumpPass() : ModulePass(ID) {}
+
+      void getAnalysisUsage(AnalysisUsage &Info) const override {
+        Info.setPreservesAll(); 
+      }
+  
+      bool runOnModule(Module &M) override;
+  };
+
+}
+
+bool CFGStaticFeaturesDumpPass::runOnModule(Module &M) {
+  std::string Filename = DumpFilename;
+  bool IsYAML = Filename.size() >= 5 && Filename.compare(Filename.size() - 5, 5, ".yaml") == 0;
+
+  std::ofstream Out(Filename, IsYAML ? std::ios::out : std::ios::out | std::ios::binary);
+  BinaryFeatureWriter Writer(Out);
+  for (auto Name : { "cfg_bb_static", "cfg_fn_static", "cfg_md_static" }) {
+    std::shared_ptr<Feature> F = FeatureRegistry::get(Name);
+    F->processModule(M);
+    if (IsYAML) F->print(Out);
+    else F->write(Writer);
+  }
+
+  if (!Out.good())
+    std::cerr << "Could not write the features in " << Filename << std::endl;
+  return false;
+}
+
+char CFGStaticFeaturesDumpPass::ID = 0;
+static RegisterPass<CFGStaticFeaturesDumpPass> Z("cfg-sfdump", "Dumps the static features of the CFG in a file.", false, false);
@@ -8,10 +8,14 @@
 #include "pinhao/MachineLearning/GrammarEvolution/ParSimpleGrammarEvolution.h"
 #include "pinhao/MachineLearning/GrammarEvolution/GEOSSimpleGrammarEvolution.h"
 #include "pinhao/MachineLearning/GrammarEvolution/SProfSimpleGrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/TieredSimpleGrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/SteadyStateGrammarEvolution.h"
+#include "pinhao/MachineLearning/GrammarEvolution/MultiObjectiveGrammarEvolution.h"
 
 #include "pinhao/PinhaoOptions.h"
 #include "pinhao/InitializationRoutines.h"
 #include "pinhao/Features/FeatureSet.h"
+#include "pinhao/Support/Random.h"
 
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -45,7 +49,16 @@ static config::YamlOpt<bool> Parameterized
 ("opt-param", "Whether the parameters should also vary.", false, false);
 
 static config::YamlOpt<std::string> PerfStrategy
-("perf", "The performance measure of the modules.", false, "cycles");
+("perf", "The performance measure of the modules: cycles, geos, sprof, or tiered (screens with a static model, and measures cycles).", false, "cycles");
+
+static config::YamlOpt<bool> SteadyState
+("steady-state", "Whether the candidates are bred as soon as a worker is free, instead of by generations.", false, false);
+
+static config::YamlOpt<bool> MultiObjective
+("multi-objective", "Whether the code size and the compile time are optimized along with the cycles.", false, false);
+
+static config::YamlOpt<int> RandomSeed
+("seed", "The seed of the random number generator (0 uses the clock).", false, 0);
 
 llvm::Module *readModule() {
   std::string FilePath = LLVMModulePath.get() + "/" + LLVMModuleName.get();
@@ -83,10 +96,43 @@ void startSProfSimpleGrammarEvolution(std::shared_ptr<llvm::Module> Module, std:
   SPGE.run(BestCandidatesNumber.get(), GenerationsNumber.get(), Set);
 }
 
+void startTieredSimpleGrammarEvolution(std::shared_ptr<llvm::Module> Module, std::string KnowledgeBase, 
+    std::shared_ptr<FeatureSet> Set) {
+  std::cerr << "Using a static model to screen the candidates." << std::endl;
+  TieredSimpleGrammarEvolution TSGE(Module, KnowledgeBase, EvolveProbability.get(), 
+        MaxEvolutionRate.get(), MutateProbability.get());
+
+  TSGE.setModuleArgv(LLVMModuleArgv.get());
+  TSGE.run(BestCandidatesNumber.get(), GenerationsNumber.get(), Set);
+}
+
+void startSteadyStateGrammarEvolution(std::shared_ptr<llvm::Module> Module, std::string KnowledgeBase, 
+    std::shared_ptr<FeatureSet> Set) {
+  std::cerr << "Steady state." << std::endl;
+  SteadyStateGrammarEvolution SSGE(Module, KnowledgeBase, EvolveProbability.get(), 
+        MaxEvolutionRate.get(), MutateProbability.get());
+
+  SSGE.setModuleArgv(LLVMModuleArgv.get());
+  SSGE.run(BestCandidatesNumber.get(), GenerationsNumber.get(), Set);
+}
+
+void startMultiObjectiveGrammarEvolution(std::shared_ptr<llvm::Module> Module, std::string KnowledgeBase, 
+    std::shared_ptr<FeatureSet> Set) {
+  std::cerr << "Multi-objective." << std::endl;
+  MultiObjectiveGrammarEvolution MOGE(Module, KnowledgeBase, EvolveProbability.get(), 
+        MaxEvolutionRate.get(), MutateProbability.get());
+
+  MOGE.setModuleArgv(LLVMModuleArgv.get());
+  MOGE.run(BestCandidatesNumber.get(), GenerationsNumber.get(), Set);
+}
+
 int main(int argc, char **argv) {
   parseCommandLine(argc, argv);
   initialize();
 
+  if (RandomSeed.get())
+    UniformRandom::setSeed(RandomSeed.get());
+
   std::shared_ptr<llvm::Module> Module(readModule());
 
   FeatureSet::enable("cfg_md_static");
@@ -100,6 +146,12 @@ int main(int argc, char **argv) {
     startGEOSSimpleGrammarEvolution(Module, KnowledgeBaseFP, Set);
   else if (PerfStrategy.get() == "sprof")
     startSProfSimpleGrammarEvolution(Module, KnowledgeBaseFP, Set);
+  else if (PerfStrategy.get() == "tiered")
+    startTieredSimpleGrammarEvolution(Module, KnowledgeBaseFP, Set);
+  else if (MultiObjective.get())
+    startMultiObjectiveGrammarEvolution(Module, KnowledgeBaseFP, Set);
+  else if (SteadyState.get())
+    startSteadyStateGrammarEvolution(Module, KnowledgeBaseFP, Set);
   else if (Parameterized.get()) {
     std::cerr << "Parameterized." << std::endl;
     ParSimpleGrammarEvolution PSGE(Module, KnowledgeBaseFP, EvolveProbability.get(), 